@@ -2,6 +2,8 @@
 -include Makefile.custom
 ProjectName = NvAssetLoader
 NvAssetLoader_cppfiles   += ./../../src/NvAssetLoader/NvAssetLoader.cpp
+NvAssetLoader_cppfiles   += ./../../src/NvAssetLoader/NvAssetArchive.cpp
+NvAssetLoader_cppfiles   += ./../../src/NvAssetLoader/NvAssetLoaderAsync.cpp
 
 NvAssetLoader_debug_hpaths    := 
 NvAssetLoader_debug_hpaths    += ./../../src/NvAssetLoader
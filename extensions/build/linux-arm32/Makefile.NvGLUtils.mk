@@ -2,9 +2,12 @@
 -include Makefile.custom
 ProjectName = NvGLUtils
 NvGLUtils_cppfiles   += ./../../src/NvGLUtils/BlockDXT.cpp
+NvGLUtils_cppfiles   += ./../../src/NvGLUtils/DXTDecoder.cpp
 NvGLUtils_cppfiles   += ./../../src/NvGLUtils/ColorBlock.cpp
 NvGLUtils_cppfiles   += ./../../src/NvGLUtils/NvFilePtr.cpp
 NvGLUtils_cppfiles   += ./../../src/NvGLUtils/NvGLSLProgram.cpp
+NvGLUtils_cppfiles   += ./../../src/NvGLUtils/NvGLSLProgramCache.cpp
+NvGLUtils_cppfiles   += ./../../src/NvGLUtils/NvGLSLProgramVariants.cpp
 NvGLUtils_cppfiles   += ./../../src/NvGLUtils/NvImage.cpp
 NvGLUtils_cppfiles   += ./../../src/NvGLUtils/NvImageDDS.cpp
 NvGLUtils_cppfiles   += ./../../src/NvGLUtils/NvImageGL.cpp
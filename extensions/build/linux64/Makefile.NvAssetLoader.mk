@@ -2,6 +2,8 @@
 -include Makefile.custom
 ProjectName = NvAssetLoader
 NvAssetLoader_cppfiles   += ./../../src/NvAssetLoader/NvAssetLoader.cpp
+NvAssetLoader_cppfiles   += ./../../src/NvAssetLoader/NvAssetArchive.cpp
+NvAssetLoader_cppfiles   += ./../../src/NvAssetLoader/NvAssetLoaderAsync.cpp
 
 NvAssetLoader_cpp_debug_dep    = $(addprefix $(DEPSDIR)/, $(subst ./, , $(subst ../, , $(patsubst %.cpp, %.cpp.debug.P, $(NvAssetLoader_cppfiles)))))
 NvAssetLoader_c_debug_dep      = $(addprefix $(DEPSDIR)/, $(subst ./, , $(subst ../, , $(patsubst %.c, %.c.debug.P, $(NvAssetLoader_cfiles)))))
@@ -9,7 +9,10 @@ NvAppBase_cppfiles   += ./../../src/NvAppBase/MainMacOSX.cpp
 NvAppBase_cppfiles   += ./../../src/NvAppBase/MainWin32.cpp
 NvAppBase_cppfiles   += ./../../src/NvAppBase/NvAppBase.cpp
 NvAppBase_cppfiles   += ./../../src/NvAppBase/NvFramerateCounter.cpp
+NvAppBase_cppfiles   += ./../../src/NvAppBase/NvFrameTimeStats.cpp
+NvAppBase_cppfiles   += ./../../src/NvAppBase/NvFrameTrace.cpp
 NvAppBase_cppfiles   += ./../../src/NvAppBase/NvInputTransformer.cpp
+NvAppBase_cppfiles   += ./../../src/NvAppBase/NvJobSystem.cpp
 NvAppBase_cppfiles   += ./../../src/NvAppBase/NvLogs.cpp
 NvAppBase_cppfiles   += ./../../src/NvAppBase/NvSampleApp.cpp
 NvAppBase_cfiles   += ./../../src/NvAppBase/NvAndroidNativeAppGlue.c
@@ -26,6 +29,7 @@ NvAppBase_debug_hpaths    :=
 NvAppBase_debug_hpaths    += ./../../src
 NvAppBase_debug_hpaths    += ./../../src/NvAppBase
 NvAppBase_debug_hpaths    += ./../../include
+NvAppBase_debug_hpaths    += ./../../externals/include
 NvAppBase_debug_hpaths    += $(if $(NVPACK_ROOT),$(NVPACK_ROOT),$(error the environment must define NVPACK_ROOT))/$(if $(NVPACK_NDK_VERSION),$(NVPACK_NDK_VERSION),android-ndk-r9d)/platforms/android-14/arch-arm/usr/include
 NvAppBase_debug_hpaths    += $(if $(NVPACK_ROOT),$(NVPACK_ROOT),$(error the environment must define NVPACK_ROOT))/$(if $(NVPACK_NDK_VERSION),$(NVPACK_NDK_VERSION),android-ndk-r9d)/sources/cxx-stl/gnu-libstdc++/4.8/include
 NvAppBase_debug_hpaths    += $(if $(NVPACK_ROOT),$(NVPACK_ROOT),$(error the environment must define NVPACK_ROOT))/$(if $(NVPACK_NDK_VERSION),$(NVPACK_NDK_VERSION),android-ndk-r9d)/sources/cxx-stl/gnu-libstdc++/4.8/libs/armeabi-v7a/include
@@ -93,6 +97,7 @@ NvAppBase_release_hpaths    :=
 NvAppBase_release_hpaths    += ./../../src
 NvAppBase_release_hpaths    += ./../../src/NvAppBase
 NvAppBase_release_hpaths    += ./../../include
+NvAppBase_release_hpaths    += ./../../externals/include
 NvAppBase_release_hpaths    += $(if $(NVPACK_ROOT),$(NVPACK_ROOT),$(error the environment must define NVPACK_ROOT))/$(if $(NVPACK_NDK_VERSION),$(NVPACK_NDK_VERSION),android-ndk-r9d)/platforms/android-14/arch-arm/usr/include
 NvAppBase_release_hpaths    += $(if $(NVPACK_ROOT),$(NVPACK_ROOT),$(error the environment must define NVPACK_ROOT))/$(if $(NVPACK_NDK_VERSION),$(NVPACK_NDK_VERSION),android-ndk-r9d)/sources/cxx-stl/gnu-libstdc++/4.8/include
 NvAppBase_release_hpaths    += $(if $(NVPACK_ROOT),$(NVPACK_ROOT),$(error the environment must define NVPACK_ROOT))/$(if $(NVPACK_NDK_VERSION),$(NVPACK_NDK_VERSION),android-ndk-r9d)/sources/cxx-stl/gnu-libstdc++/4.8/libs/armeabi-v7a/include
@@ -2,6 +2,8 @@
 -include Makefile.custom
 ProjectName = NvAssetLoader
 NvAssetLoader_cppfiles   += ./../../src/NvAssetLoader/NvAssetLoader.cpp
+NvAssetLoader_cppfiles   += ./../../src/NvAssetLoader/NvAssetArchive.cpp
+NvAssetLoader_cppfiles   += ./../../src/NvAssetLoader/NvAssetLoaderAsync.cpp
 
 NvAssetLoader_cpp_debug_dep    = $(addprefix $(DEPSDIR)/, $(subst ./, , $(subst ../, , $(patsubst %.cpp, %.cpp.debug.P, $(NvAssetLoader_cppfiles)))))
 NvAssetLoader_c_debug_dep      = $(addprefix $(DEPSDIR)/, $(subst ./, , $(subst ../, , $(patsubst %.c, %.c.debug.P, $(NvAssetLoader_cfiles)))))
@@ -15,6 +17,7 @@ NvAssetLoader_debug_hpaths    :=
 NvAssetLoader_debug_hpaths    += ./../../src
 NvAssetLoader_debug_hpaths    += ./../../src/NvAssetLoader
 NvAssetLoader_debug_hpaths    += ./../../include
+NvAssetLoader_debug_hpaths    += ./../../externals/include
 NvAssetLoader_debug_hpaths    += $(if $(NVPACK_ROOT),$(NVPACK_ROOT),$(error the environment must define NVPACK_ROOT))/$(if $(NVPACK_NDK_VERSION),$(NVPACK_NDK_VERSION),android-ndk-r9d)/platforms/android-14/arch-arm/usr/include
 NvAssetLoader_debug_hpaths    += $(if $(NVPACK_ROOT),$(NVPACK_ROOT),$(error the environment must define NVPACK_ROOT))/$(if $(NVPACK_NDK_VERSION),$(NVPACK_NDK_VERSION),android-ndk-r9d)/sources/cxx-stl/gnu-libstdc++/4.8/include
 NvAssetLoader_debug_hpaths    += $(if $(NVPACK_ROOT),$(NVPACK_ROOT),$(error the environment must define NVPACK_ROOT))/$(if $(NVPACK_NDK_VERSION),$(NVPACK_NDK_VERSION),android-ndk-r9d)/sources/cxx-stl/gnu-libstdc++/4.8/libs/armeabi-v7a/include
@@ -82,6 +85,7 @@ NvAssetLoader_release_hpaths    :=
 NvAssetLoader_release_hpaths    += ./../../src
 NvAssetLoader_release_hpaths    += ./../../src/NvAssetLoader
 NvAssetLoader_release_hpaths    += ./../../include
+NvAssetLoader_release_hpaths    += ./../../externals/include
 NvAssetLoader_release_hpaths    += $(if $(NVPACK_ROOT),$(NVPACK_ROOT),$(error the environment must define NVPACK_ROOT))/$(if $(NVPACK_NDK_VERSION),$(NVPACK_NDK_VERSION),android-ndk-r9d)/platforms/android-14/arch-arm/usr/include
 NvAssetLoader_release_hpaths    += $(if $(NVPACK_ROOT),$(NVPACK_ROOT),$(error the environment must define NVPACK_ROOT))/$(if $(NVPACK_NDK_VERSION),$(NVPACK_NDK_VERSION),android-ndk-r9d)/sources/cxx-stl/gnu-libstdc++/4.8/include
 NvAssetLoader_release_hpaths    += $(if $(NVPACK_ROOT),$(NVPACK_ROOT),$(error the environment must define NVPACK_ROOT))/$(if $(NVPACK_NDK_VERSION),$(NVPACK_NDK_VERSION),android-ndk-r9d)/sources/cxx-stl/gnu-libstdc++/4.8/libs/armeabi-v7a/include
@@ -39,6 +39,10 @@
 #include <stdio.h>
 #include "R3/thread.h"
 
+#if !USE_WIN32_THREADS
+# include <unistd.h>
+#endif
+
 using namespace r3;
 
 namespace  {
@@ -109,4 +113,18 @@ namespace r3 {
 		mainThreadMutex.Release();
 		return n;
 	}
+
+	int getNumCPUCores()
+	{
+#if USE_WIN32_THREADS
+		SYSTEM_INFO info;
+		GetSystemInfo( &info );
+		return (int)info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+		long n = sysconf( _SC_NPROCESSORS_ONLN );
+		return n > 0 ? (int)n : 1;
+#else
+		return 1;
+#endif
+	}
 }
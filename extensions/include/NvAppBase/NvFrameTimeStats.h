@@ -0,0 +1,108 @@
+//----------------------------------------------------------------------------------
+// File:        NvAppBase/NvFrameTimeStats.h
+// SDK Version: v1.2 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+ 
+/* Frame time distribution stats */
+
+#ifndef NV_FRAME_TIME_STATS_H
+#define NV_FRAME_TIME_STATS_H
+
+#include <NvFoundation.h>
+#include <vector>
+
+/// \file
+/// Per-frame CPU/GPU time recording and distribution statistics.
+
+/// Per-frame time recorder used by test mode.
+/// Keeps every recorded frame time so that the distribution (and not just the
+/// mean frame rate, which hides hitches) can be reported.  CPU and GPU times
+/// are separate series, as GPU timer results arrive a frame or two late and
+/// are only available when the GL supports timer queries.
+class NvFrameTimeStats
+{
+public:
+    /// Distribution of one series of frame times, all in milliseconds
+    struct Summary {
+        int32_t frames;     ///< number of frames summarized
+        float min;
+        float median;
+        float p95;          ///< 95th percentile (nearest rank)
+        float p99;          ///< 99th percentile (nearest rank)
+        float max;
+        float mean;
+        float stutterThreshold; ///< the threshold actually used
+        int32_t stutters;   ///< frames longer than stutterThreshold
+    };
+
+    /// Reserves room for the given number of frames, so that recording
+    /// does not allocate during the timed part of a run.
+    /// \param[in] frames expected number of frames
+    void reserve(int32_t frames);
+
+    /// Drops all recorded times
+    void clear();
+
+    /// Records the CPU time of the next frame
+    /// \param[in] ms frame time in milliseconds
+    void addCPUTime(float ms) { mCPUTimes.push_back(ms); }
+
+    /// Records the GPU time of the next frame
+    /// \param[in] ms frame time in milliseconds
+    void addGPUTime(float ms) { mGPUTimes.push_back(ms); }
+
+    /// \return the recorded CPU frame times in milliseconds
+    const std::vector<float>& getCPUTimes() const { return mCPUTimes; }
+
+    /// \return the recorded GPU frame times in milliseconds
+    const std::vector<float>& getGPUTimes() const { return mGPUTimes; }
+
+    /// Summarizes a series of frame times.
+    /// \param[in] times frame times in milliseconds
+    /// \param[in] stutterThreshold frames longer than this many milliseconds
+    /// count as stutters; values <= 0 mean twice the median
+    /// \return the summary; all zero for an empty series
+    static Summary summarize(const std::vector<float>& times, float stutterThreshold);
+
+    /// Writes one "frame,cpu_ms,gpu_ms" line per frame; the GPU column is
+    /// left empty for frames without a GPU time.
+    /// \param[in] path the file to write
+    /// \return true on success, false if the file could not be written
+    bool writeCSV(const char* path) const;
+
+protected:
+    /// \privatesection
+    std::vector<float> mCPUTimes;
+    std::vector<float> mGPUTimes;
+};
+
+#endif
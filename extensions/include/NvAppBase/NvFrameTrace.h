@@ -0,0 +1,126 @@
+//----------------------------------------------------------------------------------
+// File:        NvAppBase/NvFrameTrace.h
+// SDK Version: v1.2 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+ 
+/* Per-thread frame phase tracing */
+
+#ifndef NV_FRAME_TRACE_H
+#define NV_FRAME_TRACE_H
+
+#include <NvFoundation.h>
+
+/// \file
+/// Scoped CPU tracing of frame phases, exported as Chrome trace JSON.
+
+class NvStopWatchFactory;
+
+/// Lightweight scoped-timer tracing.
+/// Every thread that records a scope gets its own fixed-size ring buffer (the
+/// last #EVENTS_PER_THREAD scopes are kept), written only by that thread and
+/// published with an atomic head index, so recording never takes a lock and
+/// never allocates after the thread's first scope.  Timestamps come from
+/// NvStopWatch instances made by the same factory that NvCPUTimer uses.
+///
+/// The resulting file loads in chrome://tracing and in the Perfetto UI
+/// (ui.perfetto.dev).  NvSampleApp traces its main loop phases and the app
+/// callbacks, and writes the trace when F11 is pressed and on exit if
+/// "-trace [file]" was given on the command line.
+class NvFrameTrace
+{
+public:
+    /// Number of scopes each thread's ring buffer keeps.
+    static const uint32_t EVENTS_PER_THREAD = 8192;
+    /// Maximum number of threads that can record; scopes on any further
+    /// threads are ignored.
+    static const int32_t MAX_THREADS = 64;
+
+    /// Static initialization.  Starts the trace clock; scopes recorded
+    /// before this call are ignored.
+    /// \param [in] factory the factory object, likely from the app framework
+    static void globalInit(NvStopWatchFactory* factory);
+
+    /// Enables or disables recording (enabled by default after #globalInit).
+    /// \param [in] enabled whether scopes are recorded
+    static void setEnabled(bool enabled);
+
+    /// \return true if scopes are currently being recorded
+    static bool isEnabled();
+
+    /// Names the calling thread in the exported trace.
+    /// \param [in] name a null-terminated name, copied
+    static void setThreadName(const char* name);
+
+    /// Current time of the trace clock.
+    /// \return seconds since #globalInit
+    static double now();
+
+    /// Records a completed scope on the calling thread.
+    /// \param [in] name the scope name; must stay valid until the trace has
+    /// been written, so normally a string literal
+    /// \param [in] begin start time, from #now
+    /// \param [in] end end time, from #now
+    static void record(const char* name, double begin, double end);
+
+    /// Writes every scope still held in the ring buffers as Chrome trace
+    /// JSON.  May be called while other threads keep recording; scopes
+    /// overwritten during the write are left out, and so is the oldest scope
+    /// of a buffer that has wrapped, since it is the next to be overwritten.
+    /// \param [in] path the file to write
+    /// \return true on success, false if the file could not be written
+    static bool writeChromeTrace(const char* path);
+};
+
+/// A helper class that records its lifetime as a trace scope, analogous to
+/// NvCPUTimerScope.  Normally used through #NV_TRACE_SCOPE:
+/// \code
+///     {
+///         NV_TRACE_SCOPE("updateSkinning");
+///         // ... my block of traced code
+///     }
+/// \endcode
+struct NvTraceScope {
+    /// Constructor - notes the start time
+    /// \param [in] name the scope name, normally a string literal
+    NvTraceScope(const char* name) : m_name(name), m_begin(NvFrameTrace::isEnabled() ? NvFrameTrace::now() : -1.0) { }
+    /// Destructor - records the scope
+    ~NvTraceScope() { if (m_begin >= 0.0) NvFrameTrace::record(m_name, m_begin, NvFrameTrace::now()); }
+    const char* m_name;
+    double m_begin;
+};
+
+#define NV_TRACE_CONCAT_INNER(a, b) a##b
+#define NV_TRACE_CONCAT(a, b) NV_TRACE_CONCAT_INNER(a, b)
+/// Traces the rest of the enclosing block under the given name.
+#define NV_TRACE_SCOPE(name) NvTraceScope NV_TRACE_CONCAT(nvTraceScope, __LINE__)(name)
+
+#endif
@@ -0,0 +1,172 @@
+//----------------------------------------------------------------------------------
+// File:        NvAppBase/NvJobSystem.h
+// SDK Version: v1.2 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+ 
+/* Work-stealing job system */
+
+#ifndef NV_JOB_SYSTEM_H
+#define NV_JOB_SYSTEM_H
+
+#include <NvFoundation.h>
+#include <functional>
+#include <stddef.h>
+
+/// \file
+/// Work-stealing job scheduler on top of r3::Thread.
+
+struct NvJob;
+class NvJobSystemImpl;
+
+/// Reference to a job created by an NvJobSystem.
+/// Handles are reference counted and cheap to copy; the job's bookkeeping
+/// lives until the last handle is gone and the job has run.
+class NvJobHandle
+{
+public:
+    /// Creates an empty handle
+    NvJobHandle() : m_job(NULL) { }
+    NvJobHandle(const NvJobHandle& other);
+    NvJobHandle& operator=(const NvJobHandle& other);
+    ~NvJobHandle();
+
+    /// \return true if the handle refers to a job
+    bool isValid() const { return m_job != NULL; }
+
+    /// \return true if the job has finished running
+    bool isDone() const;
+
+protected:
+    /// \privatesection
+    friend class NvJobSystem;
+    explicit NvJobHandle(NvJob* job);
+    NvJob* m_job;
+};
+
+/// Work-stealing job scheduler.
+/// Runs one worker thread per additional CPU core.  Each worker owns a job
+/// queue: jobs a worker spawns go to the back of its own queue and are taken
+/// from there first (most recent, and most likely still in cache), while idle
+/// workers steal from the front of other queues, so large pieces of work move
+/// between threads and small ones stay local.  Jobs submitted from outside the
+/// workers go to a shared queue.  Idle workers sleep on a condition variable.
+///
+/// The thread that created the job system is its owner: when it waits for a
+/// job (#wait, #parallelFor) it runs queued jobs itself instead of blocking.
+/// Workers waiting on other jobs do the same.  Any other thread may submit and
+/// wait, but simply blocks.
+///
+/// With a single thread (and always under Emscripten, which has no threads)
+/// jobs run on the submitting thread as soon as their dependencies are done.
+class NvJobSystem
+{
+public:
+    typedef std::function<void()> Function;
+    /// Range callback of #parallelForWithThreadIndex: (begin, end, threadIndex)
+    typedef std::function<void(size_t, size_t, int32_t)> RangeFunction;
+
+    /// Constructor.  Starts the worker threads.
+    /// \param[in] numThreads threads that run jobs, counting the owner thread;
+    /// values < 1 mean one per CPU core
+    explicit NvJobSystem(int32_t numThreads = 0);
+
+    /// Destructor.  Runs all queued jobs, then stops the workers.  Jobs whose
+    /// dependencies never finish are dropped.
+    ~NvJobSystem();
+
+    /// \return the number of threads that run jobs, including the owner thread
+    int32_t getNumThreads() const;
+
+    /// Thread index of the calling thread: 0 for the owner thread (and for any
+    /// thread that is not a worker), 1 to #getNumThreads - 1 for the workers.
+    /// Lets jobs use per-thread scratch memory without locking.
+    /// \return the index of the calling thread
+    int32_t getThreadIndex() const;
+
+    /// Creates a job without scheduling it, so that dependencies can be added.
+    /// \param[in] fn the work to run
+    /// \return a handle to the new job
+    NvJobHandle createJob(const Function& fn);
+
+    /// Makes a created job wait for another one.  Must be called before the
+    /// job is submitted.
+    /// \param[in] job the job that has to wait
+    /// \param[in] dependency the job that must finish first; may already be done
+    void addDependency(const NvJobHandle& job, const NvJobHandle& dependency);
+
+    /// Schedules a created job; it runs once all its dependencies are done.
+    /// \param[in] job the job to schedule
+    void submit(const NvJobHandle& job);
+
+    /// Creates and schedules a job.
+    /// \param[in] fn the work to run
+    /// \return a handle to the new job
+    NvJobHandle run(const Function& fn);
+
+    /// Creates and schedules a continuation.
+    /// \param[in] dependency the job that must finish first
+    /// \param[in] fn the work to run after it
+    /// \return a handle to the new job
+    NvJobHandle then(const NvJobHandle& dependency, const Function& fn);
+
+    /// Waits for a job to finish, running other queued jobs in the meantime
+    /// when called on the owner thread or on a worker.
+    /// \param[in] job the job to wait for
+    void wait(const NvJobHandle& job);
+
+    /// Calls fn(begin, end) for consecutive sub-ranges of [0, count), each at
+    /// most grainSize long, and returns once all of them have returned.
+    /// fn is called concurrently and must not touch shared state unguarded.
+    template <typename F>
+    void parallelFor(size_t count, size_t grainSize, const F& fn) {
+        runParallelFor(count, grainSize, [&fn](size_t begin, size_t end, int32_t) { fn(begin, end); });
+    }
+
+    /// Like #parallelFor, but calls fn(begin, end, threadIndex), threadIndex
+    /// being #getThreadIndex of the thread running the sub-range.
+    template <typename F>
+    void parallelForWithThreadIndex(size_t count, size_t grainSize, const F& fn) {
+        runParallelFor(count, grainSize, [&fn](size_t begin, size_t end, int32_t threadIndex) { fn(begin, end, threadIndex); });
+    }
+
+protected:
+    /// \privatesection
+    void runParallelFor(size_t count, size_t grainSize, const RangeFunction& fn);
+
+    NvJobSystemImpl* m_impl;
+
+private:
+    NvJobSystem(const NvJobSystem&);
+    NvJobSystem& operator=(const NvJobSystem&);
+};
+
+#endif
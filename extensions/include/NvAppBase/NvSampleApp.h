@@ -46,12 +46,16 @@
 #include "NvUI/NvUI.h"
 #include "NvUI/NvTweakVar.h"
 #include <map>
+#include <vector>
 
 /// \file
 /// Sample app base class.
 
 class NvFramerateCounter;
+class NvFrameTimeStats;
+class NvGPUTimer;
 class NvInputTransformer;
+class NvJobSystem;
 class NvSimpleFBO;
 class NvTweakBar;
 
@@ -100,6 +104,15 @@ public:
     /// \return a pointer to the framerate counter object
     NvFramerateCounter *getFramerate() { return mFramerate; }
 
+    /// Get the shared job system.
+    /// One pool of worker threads for all of the app's parallel CPU work
+    /// (animation, skinning, asset decoding, ...), created on first use with
+    /// one thread per CPU core; "-jobthreads N" on the command line overrides
+    /// the thread count.  Must first be called from the main thread, which
+    /// then helps run jobs whenever it waits for them.
+    /// \return a pointer to the job system, owned by the app
+    NvJobSystem *getJobSystem();
+
     /// Extension requirement declaration.
     /// Allow an app to declare an extension as "required".
     /// \param[in] ext the extension name to be required
@@ -223,6 +236,8 @@ protected:
     void baseFocusChanged(bool focused);
     void baseHandleReaction(void);
     void logTestResults(float frameRate, int32_t frames);
+    void logFrameTimeStats(const char* label, const std::vector<float>& times);
+    void recordTestModeGPUTimes();
 
     void SwapBuffers();
 
@@ -251,6 +266,22 @@ private:
 
     uint32_t m_testModeIssues;
 
+    // per-frame test mode timing; "-stutter <ms>" and "-framecsv <file>"
+    float mTestStutterThreshold;
+    std::string mTestFrameCSV;
+    NvFrameTimeStats* mTestFrameStats;
+    NvGPUTimer* mTestModeGPUTimer;
+    int32_t mTestModeGPUWarmupFrames;
+    int32_t mTestModeGPUCycles;
+    float mTestModeGPUTime;
+
+    // NvFrameTrace output; written on F11, and on exit with "-trace [file]"
+    std::string mTraceFile;
+    bool mWriteTraceOnExit;
+
+    NvJobSystem* mJobSystem;
+    int32_t mJobThreads;
+
     const static int32_t TESTMODE_WARMUP_FRAMES = 10;
 
     // mainLoop method was split into a setup and "main" main loop (mainLoopInternal).
@@ -0,0 +1,134 @@
+//----------------------------------------------------------------------------------
+// File:        NvAssetLoader/NvAssetArchive.h
+// SDK Version: v1.2 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#ifndef NV_ASSET_ARCHIVE_H
+#define NV_ASSET_ARCHIVE_H
+
+#include <NvFoundation.h>
+#include <string>
+#include <vector>
+
+/// \file
+/// Packed asset archive format.
+/// An archive holds any number of asset files in one file, so that
+/// NvAssetLoader finds each of them with a single hash probe into a mapped
+/// index rather than by trying to open it along every search path (see
+/// #NvAssetLoaderMountArchive).  Layout, all little-endian:
+///
+/// - #NvAssetArchiveHeader
+/// - bucket table: uint32_t[2^bucketBits + 1]; bucket b holds the entries
+///   [buckets[b], buckets[b + 1]), those whose hash has b as its top bits
+/// - entries: #NvAssetArchiveEntry, sorted by hash
+/// - names: the entries' paths, null-terminated
+/// - data: each file starting at a multiple of #NvAssetArchiveHeader::Alignment
+///   and followed by a null byte
+///
+/// There are at least as many buckets as entries, so a lookup usually
+/// compares a single entry.  Paths are hashed as given, with '/' separators.
+
+/// Archive header.
+struct NvAssetArchiveHeader {
+    enum { Version = 1, Alignment = 16 };
+
+    char     magic[4];          ///< "NVPK"
+    uint32_t version;
+    uint32_t numEntries;
+    uint32_t bucketBits;
+    uint32_t bucketsOffset;
+    uint32_t entriesOffset;
+    uint32_t namesOffset;
+    uint32_t dataOffset;
+};
+
+/// One file of an archive.  Offsets are in bytes from the start of the archive.
+struct NvAssetArchiveEntry {
+    uint64_t hash;              ///< #NvAssetArchive::hashPath of the name
+    uint32_t nameOffset;
+    uint32_t nameLength;        ///< Without the null terminator.
+    uint32_t offset;
+    uint32_t size;
+};
+
+/// A file to be packed by #NvAssetArchive::build.
+struct NvAssetArchiveFile {
+    std::string name;           ///< Path below "assets", with '/' separators
+    std::vector<char> data;
+};
+
+/// Read-only view of an archive in memory, usually a mapping of the file.
+class NvAssetArchive {
+public:
+    NvAssetArchive();
+
+    /// Checks the header, index and every entry's range.
+    /// \param[in] data the archive; must stay valid while the view is used
+    /// \param[in] length the size of the archive in bytes
+    /// \return true if data is a well-formed archive of this version; the
+    /// view is left empty otherwise
+    bool init(const char* data, size_t length);
+
+    /// Looks a file up.
+    /// \param[in] filePath the path the file was packed under
+    /// \param[out] length the size of the file in bytes
+    /// \return a pointer to the file's data within the archive, followed by a
+    /// null byte, or NULL if the archive does not contain filePath
+    const char* find(const char* filePath, int32_t& length) const;
+
+    /// \return the number of files in the archive
+    uint32_t getNumEntries() const { return m_numEntries; }
+
+    /// \return true if ptr points into the archive's data
+    bool contains(const char* ptr) const { return ptr >= m_data && ptr < m_data + m_length; }
+
+    /// 64-bit FNV-1a hash of a path.
+    static uint64_t hashPath(const char* path, size_t length);
+
+    /// Packs files into an archive.  Later files with the same name replace
+    /// earlier ones.
+    /// \param[in] files the files to pack
+    /// \param[out] archive the archive's contents
+    /// \return false if the archive would exceed 4GB
+    static bool build(const std::vector<NvAssetArchiveFile>& files, std::vector<char>& archive);
+
+protected:
+    /// \privatesection
+    const char* m_data;
+    size_t m_length;
+    uint32_t m_numEntries;
+    uint32_t m_bucketBits;
+    const uint32_t* m_buckets;
+    const NvAssetArchiveEntry* m_entries;
+};
+
+#endif
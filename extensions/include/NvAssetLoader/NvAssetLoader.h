@@ -59,6 +59,15 @@
 ///
 /// On Android, the file opened is always <filepath>, since the "assets"
 /// directory is known (it is the APK's assets).
+///
+/// Where each file was found (or that it was not) is remembered until the
+/// search paths change, so the search runs once per file.
+///
+/// Files can also be packed into archives (see NvAssetArchive.h) that are
+/// mounted with #NvAssetLoaderMountArchive.  Loose files found by the search
+/// above override packed ones unless #NvAssetLoaderSetLooseFileOverride
+/// turns that off, in which case archives are looked in first and
+/// the search only runs for files that none of them contains.
 
 
 /// Initializes the loader at application start.
@@ -112,5 +121,47 @@ char *NvAssetLoaderRead(const char *filePath, int32_t &length);
 /// \return true on success and false on failure
 bool NvAssetLoaderFree(char* asset);
 
+/// Maps an asset file read-only, returning a pointer to its contents
+/// along with the length, without copying the file into a heap block
+/// where the platform allows it (mmap on Linux, a file mapping on
+/// Windows, the asset's own buffer on Android).  Where it does not,
+/// the file is read as with #NvAssetLoaderRead.  The mapping starts at
+/// a page boundary (or a heap allocation's alignment when read), but
+/// unlike #NvAssetLoaderRead it is not null-terminated.
+/// \param[in] filePath the partial path (below "assets") to the file
+/// \param[out] length the length of the file in bytes
+/// \return a pointer to the contents of the file or NULL on error.  The
+/// block must be released with a call to #NvAssetLoaderUnmap and must
+/// not be written to.
+const char *NvAssetLoaderMap(const char *filePath, int32_t &length);
+
+/// Releases a block returned from #NvAssetLoaderMap.
+/// \param[in] asset a pointer returned from #NvAssetLoaderMap
+/// \return true on success and false on failure
+bool NvAssetLoaderUnmap(const char* asset);
+
+/// Mounts a packed asset archive.
+/// Maps the archive with #NvAssetLoaderMap and adds its files to those
+/// #NvAssetLoaderRead and #NvAssetLoaderMap can find; archives mounted
+/// later are looked in first.  Mapping a packed file returns a slice of the
+/// archive's mapping, without copying; reading one copies it.  Archives must
+/// not be unmounted while reads are pending or mapped slices are in use.
+/// \param[in] archivePath the partial path (below "assets") to the archive
+/// \return true on success and false if the archive could not be mapped or
+/// is not a valid archive
+bool NvAssetLoaderMountArchive(const char *archivePath);
+
+/// Unmounts an archive mounted with #NvAssetLoaderMountArchive.
+/// \param[in] archivePath the path the archive was mounted with
+/// \return true on success and false if no such archive is mounted
+bool NvAssetLoaderUnmountArchive(const char *archivePath);
+
+/// Sets whether loose files override packed ones.
+/// Defaults to true, so that edited files are picked up without repacking.
+/// With the override off, a packed file is found with a single hash probe
+/// and no file system access.  Should be set before any reads are queued.
+/// \param[in] enable true to look for loose files first
+void NvAssetLoaderSetLooseFileOverride(bool enable);
+
 
 #endif
@@ -0,0 +1,185 @@
+//----------------------------------------------------------------------------------
+// File:        NvAssetLoader/NvAssetLoaderAsync.h
+// SDK Version: v1.2 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#ifndef NV_ASSET_LOADER_ASYNC_H
+#define NV_ASSET_LOADER_ASYNC_H
+
+#include <NvFoundation.h>
+#include <functional>
+
+/// \file
+/// Asynchronous asset reads.
+/// Reads files like #NvAssetLoaderRead, but on a background I/O thread, so
+/// that models, animations and textures can stream in while the application
+/// keeps rendering.  #NvAssetLoaderReadAsync queues a read and returns a
+/// handle to it right away.  The I/O thread takes queued reads highest
+/// priority first (in submission order within a priority).  Completion
+/// callbacks never run on the I/O thread: #NvAssetLoaderDispatchCompletions
+/// runs them on the thread that calls it, which NvSampleApp does once per
+/// frame from its main loop before updating and drawing.
+/// #NvAssetLoaderMapAsync queues a mapping (#NvAssetLoaderMap) the same way,
+/// for files that are used in place rather than copied.
+///
+/// Reads use the search paths of NvAssetLoader.h; these must not change
+/// while reads are queued.  Under Emscripten, which has no threads, queued
+/// reads are done by #NvAssetLoaderDispatchCompletions and #NvAssetLoadHandle::wait.
+
+struct NvAssetLoadRequest;
+class NvAssetLoaderQueue;
+
+/// State of an asynchronous read
+enum NvAssetLoadStatus {
+    NV_ASSET_LOAD_PENDING,      ///< queued or being read
+    NV_ASSET_LOAD_DONE,         ///< read; the data is available
+    NV_ASSET_LOAD_FAILED,       ///< the file could not be opened
+    NV_ASSET_LOAD_CANCELLED     ///< cancelled before it completed
+};
+
+/// Common read priorities; any value may be used, larger ones are read first
+enum NvAssetLoadPriority {
+    NV_ASSET_PRIORITY_LOW = -100,
+    NV_ASSET_PRIORITY_NORMAL = 0,
+    NV_ASSET_PRIORITY_HIGH = 100
+};
+
+/// Reference to an asynchronous read, which doubles as its future.
+/// Handles are reference counted and cheap to copy; the request, and the
+/// data read unless it has been taken with #takeData, live until the last
+/// handle is gone and the loader is done with the request.  Handles must only
+/// be used on the thread that dispatches completions.
+class NvAssetLoadHandle
+{
+public:
+    /// Creates an empty handle
+    NvAssetLoadHandle() : m_request(NULL) { }
+    NvAssetLoadHandle(const NvAssetLoadHandle& other);
+    NvAssetLoadHandle& operator=(const NvAssetLoadHandle& other);
+    ~NvAssetLoadHandle();
+
+    /// \return true if the handle refers to a request
+    bool isValid() const { return m_request != NULL; }
+
+    /// The state of the read.  A read can be done before its completion
+    /// callback has run.
+    /// \return the status of the read
+    NvAssetLoadStatus getStatus() const;
+
+    /// \return true if the read is no longer pending (done, failed or cancelled)
+    bool isDone() const { return getStatus() != NV_ASSET_LOAD_PENDING; }
+
+    /// \return the partial path the read was queued with
+    const char* getPath() const;
+
+    /// The contents of the file, null-terminated like the block returned from
+    /// #NvAssetLoaderRead.  For a mapping it is the block returned from
+    /// #NvAssetLoaderMap: not null-terminated, and not to be written to.
+    /// \return the data, or NULL unless the read is done or if it was taken
+    const char* getData() const;
+
+    /// \return the length of the file in bytes, or 0 unless the read is done
+    int32_t getLength() const;
+
+    /// Takes ownership of the data, so that it outlives the request.
+    /// \return the data, which must be freed with #NvAssetLoaderFree, or NULL
+    /// unless the read is done, if it was taken already or if the request is
+    /// a mapping, which stays with the request
+    char* takeData();
+
+    /// Changes the priority of a read that is still queued.
+    /// \param[in] priority the new priority; larger values are read first
+    void setPriority(int32_t priority);
+
+    /// Cancels the read.  A queued read is dropped; one that is being read is
+    /// discarded when the read finishes.  Once cancel has succeeded the
+    /// completion callback will not run.
+    /// \return true if the read was cancelled, false if it had already been
+    /// cancelled, or had completed and its callback (if any) had run
+    bool cancel();
+
+    /// Blocks until the read is no longer pending.  A read that is still
+    /// queued is done on the calling thread instead of waiting for its turn.
+    /// The completion callback is not run; it still runs from the next
+    /// #NvAssetLoaderDispatchCompletions.
+    void wait();
+
+protected:
+    /// \privatesection
+    friend class NvAssetLoaderQueue;
+    explicit NvAssetLoadHandle(NvAssetLoadRequest* request);
+    NvAssetLoadRequest* m_request;
+};
+
+/// Completion callback; called for reads that are done or failed, with a
+/// handle to the request.
+typedef std::function<void(NvAssetLoadHandle&)> NvAssetLoadCallback;
+
+/// Queues an asynchronous read of an asset file.
+/// Starts the I/O thread the first time it is called.
+/// \param[in] filePath the partial path (below "assets") to the file
+/// \param[in] priority reads with larger priorities are read first
+/// \param[in] onComplete called from #NvAssetLoaderDispatchCompletions once
+/// the read is done or has failed; may be empty
+/// \return a handle to the request
+NvAssetLoadHandle NvAssetLoaderReadAsync(const char* filePath, int32_t priority = NV_ASSET_PRIORITY_NORMAL,
+    const NvAssetLoadCallback& onComplete = NvAssetLoadCallback());
+
+/// Queues an asynchronous mapping of an asset file.
+/// Like #NvAssetLoaderReadAsync, except that the I/O thread maps the file
+/// with #NvAssetLoaderMap instead of reading it into a heap block; a file
+/// packed in a mounted archive is a slice of the archive's mapping.  The
+/// mapping is released once the last handle to the request is gone.
+/// \param[in] filePath the partial path (below "assets") to the file
+/// \param[in] priority requests with larger priorities are served first
+/// \param[in] onComplete called from #NvAssetLoaderDispatchCompletions once
+/// the file is mapped or mapping it has failed; may be empty
+/// \return a handle to the request
+NvAssetLoadHandle NvAssetLoaderMapAsync(const char* filePath, int32_t priority = NV_ASSET_PRIORITY_NORMAL,
+    const NvAssetLoadCallback& onComplete = NvAssetLoadCallback());
+
+/// Runs the completion callbacks of finished reads on the calling thread,
+/// in the order the reads finished.  Callbacks may queue further reads.
+/// \param[in] maxCallbacks the most callbacks to run; values < 1 mean all
+/// \return the number of callbacks run
+int32_t NvAssetLoaderDispatchCompletions(int32_t maxCallbacks = 0);
+
+/// \return the number of reads that are queued, being read, or waiting for
+/// their completion callback
+int32_t NvAssetLoaderGetPendingCount();
+
+/// Stops the I/O thread.  Queued reads are cancelled and callbacks that
+/// have not run yet are dropped.  Called by #NvAssetLoaderShutdown.
+/// \return true on success and false on failure
+bool NvAssetLoaderAsyncShutdown();
+
+#endif
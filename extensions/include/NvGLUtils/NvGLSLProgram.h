@@ -37,15 +37,38 @@
 
 #include <NvFoundation.h>
 #include "NV/NvPlatformGL.h"
+#include <map>
+#include <string>
+#include <vector>
 
 /// \file
 /// GLSL shader program wrapper
 
+class NvGLSLProgramCache;
+
+/// GL calls made and avoided by the shadow state of all programs, see
+/// #NvGLSLProgram::getCallStats.
+struct NvGLSLProgramCallStats
+{
+    uint32_t programsIssued;    ///< glUseProgram calls made
+    uint32_t programsSkipped;   ///< glUseProgram calls avoided
+    uint32_t uniformsIssued;    ///< glUniform* calls made
+    uint32_t uniformsSkipped;   ///< glUniform* calls avoided
+};
+
 /// Convenience wrapper for GLSL shader programs.
 /// Wraps shader programs and simplifies creation, setting uniforms and setting
 /// vertex attributes.  Supports all forms of shaders, but has simple paths for
 /// the common case of shader programs consisting of only vertex and fragment
 /// shaders.
+///
+/// Program binding and uniform values are shadowed: #enable skips glUseProgram
+/// when the program is already bound, #disable defers the unbind until another
+/// program is needed, and the setUniform* functions skip uploads of the value
+/// a uniform already has.  Code that binds programs with glUseProgram directly
+/// must do so through #useProgram, or call #resetShadowState afterwards.
+/// Uniforms set with glUniform* directly are not seen by the shadow; a
+/// uniform should be set either always or never through this class.
 class NvGLSLProgram
 {
 public:
@@ -109,12 +132,46 @@ public:
     /// \return true on success and false on failure
     bool setSourceFromStrings(ShaderSourceItem* src, int32_t count, bool strict = false);
 
+    /// Fixes the locations of vertex attributes in the programs linked by later
+    /// setSource* calls: names[i] is bound to location i.  Programs that share
+    /// a vertex layout then share the attribute setup, too.
+    /// \param[in] names the null-terminated attribute names
+    /// \param[in] count the number of elements in #names; 0 leaves the
+    /// locations to the linker
+    void setAttribLocations(const char* const* names, int32_t count);
+
+    /// Returns shader source with #define lines inserted after its #version
+    /// directive (or at the start, if it has none), for compiling variants of
+    /// one source.
+    /// \param[in] src the null-terminated shader source
+    /// \param[in] defines the macros, each a name optionally followed by a
+    /// space and a value, such as "MAX_INFLUENCES 2"
+    /// \param[in] count the number of elements in #defines
+    static std::string addDefines(const char* src, const char* const* defines, int32_t count);
+
     /// Binds the given shader program as current in the GL context
     void enable();
 
-    /// Unbinds the given shader program from the GL context (binds shader 0)
+    /// Unbinds the given shader program from the GL context.  The program
+    /// stays bound in GL until another one is enabled; call #useProgram(0)
+    /// where GL must have no program bound.
     void disable();
 
+    /// Binds a program, unless the shadow state says it is bound already.
+    /// \param[in] program the GL program object, or 0
+    static void useProgram(GLuint program);
+
+    /// Forgets the shadowed program binding, so that the next #enable binds
+    /// its program whatever GL has bound.  Call after code that changes the
+    /// binding behind the shadow's back, and whenever the context is recreated.
+    static void resetShadowState();
+
+    /// \return the GL calls made and avoided since the last #resetCallStats
+    static const NvGLSLProgramCallStats& getCallStats() { return ms_callStats; }
+
+    /// Zeroes the counts returned by #getCallStats.
+    static void resetCallStats();
+
     /// Binds a 2D texture to a shader uniform by name.
     /// Binds the given texture to the supplied texture unit and the unit to the given uniform
     /// Assumes that the given shader is bound via #enable
@@ -280,7 +337,9 @@ public:
     /// \return the GL shader object ID
     GLuint getProgram() { return m_program; }
 
-    /// Relinks an existing shader program to update based on external changes
+    /// Relinks an existing shader program to update based on external changes.
+    /// Programs loaded from the binary cache have no shaders attached and cannot
+    /// be relinked.
     bool relink();
 
     /// Enables logging of missing uniforms even for non-strict shaders
@@ -288,15 +347,45 @@ public:
     /// even if the shader was not created with the strict flag
     static void setLogAllMissing(bool logMissing) { ms_logAllMissing = logMissing; }
 
+    /// Sets the cache programs are looked up in before they are compiled from
+    /// source, and stored in afterwards.  Used only where the driver supports
+    /// program binaries (GL 4.1, ARB_get_program_binary, OES_get_program_binary).
+    /// \param[in] cache the cache, or NULL to always compile from source; must
+    /// outlive its use by program creation
+    static void setBinaryCache(NvGLSLProgramCache* cache) { ms_binaryCache = cache; }
+
+    /// \return the cache set by #setBinaryCache
+    static NvGLSLProgramCache* getBinaryCache() { return ms_binaryCache; }
+
 protected:
+    /// Last value uploaded to a uniform location.
+    struct UniformValue {
+        uint32_t type;          ///< GL type enum of the setter, high bit set if transposed
+        int32_t count;          ///< Array elements set, from the location on
+        std::vector<char> data;
+    };
+
+    /// Records a uniform upload in the shadow state.
+    /// \return true if the value differs from the shadowed one and has to be
+    /// uploaded, false if the upload can be skipped
+    bool shadowUniform(GLint index, uint32_t type, int32_t count, const void* value, size_t bytes);
+
     bool checkCompileError(GLuint object, int32_t target);
     GLuint compileProgram(const char *vsource, const char *fsource);
     GLuint compileProgram(ShaderSourceItem* src, int32_t count);
+    GLuint loadProgram(ShaderSourceItem* src, int32_t count);
+    void bindAttribLocations(GLuint program);
 
     bool m_strict;
     GLuint m_program;
+    std::vector<std::string> m_attribLocations;
+    std::map<GLint, UniformValue> m_uniforms;
 
     static bool ms_logAllMissing;
+    static NvGLSLProgramCache* ms_binaryCache;
+    static GLuint ms_boundProgram;
+    static bool ms_boundProgramKnown;
+    static NvGLSLProgramCallStats ms_callStats;
 };
 
 #endif // NV_GLSL_PROGRAM_H
@@ -0,0 +1,139 @@
+//----------------------------------------------------------------------------------
+// File:        NvGLUtils/NvGLSLProgramCache.h
+// SDK Version: v1.2 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#ifndef NV_GLSL_PROGRAM_CACHE_H
+#define NV_GLSL_PROGRAM_CACHE_H
+
+#include <NvFoundation.h>
+#include <string>
+#include <vector>
+
+/// \file
+/// On-disk cache of linked GLSL program binaries.
+/// #NvGLSLProgram looks programs up here before compiling them from source
+/// (see #NvGLSLProgram::setBinaryCache).  Each program is stored in a file of
+/// its own, named after its key: a hash of the driver identity and of every
+/// shader stage's type and source text, #defines included.  A driver update
+/// or an edited shader therefore changes the key and misses; a binary the
+/// driver still rejects is removed and rebuilt from source.  File layout,
+/// little-endian: #NvGLSLProgramCacheHeader followed by the binary.
+
+/// Header of a cached program binary.
+struct NvGLSLProgramCacheHeader {
+    enum { Version = 1 };
+
+    char     magic[4];          ///< "NVPB"
+    uint32_t version;
+    uint64_t key;               ///< Must match the file name's key
+    uint32_t binaryFormat;      ///< As returned by glGetProgramBinary
+    uint32_t binaryLength;
+    uint64_t checksum;          ///< #NvGLSLProgramCache::hash of the binary
+    float    compileSeconds;    ///< Time it took to build the program from source
+    uint32_t reserved;
+};
+
+/// A program binary and what it cost to build.
+struct NvGLSLProgramBinary {
+    uint32_t format;
+    float compileSeconds;
+    std::vector<char> data;
+};
+
+/// Program cache statistics, since the cache was created.
+struct NvGLSLProgramCacheStats {
+    uint32_t hits;              ///< Programs loaded from a binary
+    uint32_t misses;            ///< Programs built from source, rejected binaries included
+    uint32_t rejected;          ///< Binaries found but not accepted by the driver
+    uint32_t stored;            ///< Binaries written
+    float compileSeconds;       ///< Time spent building programs from source
+    float loadSeconds;          ///< Time spent loading binaries
+    float savedSeconds;         ///< Build time of the hits, less their load time
+};
+
+/// Directory of program binaries.
+class NvGLSLProgramCache {
+public:
+    /// \param[in] directory the directory the binaries are kept in; created if
+    /// missing (but not its parents)
+    NvGLSLProgramCache(const char* directory);
+
+    /// 64-bit FNV-1a hash, continued from seed.
+    static uint64_t hash(const void* data, size_t length, uint64_t seed = 14695981039346656037ULL);
+
+    /// Computes the key of a program.
+    /// \param[in] driver the driver identity (vendor, renderer, version strings)
+    /// \param[in] types the GL_*_SHADER type of each stage
+    /// \param[in] sources the null-terminated source of each stage as it is
+    /// compiled, #defines included
+    /// \param[in] count the number of stages
+    static uint64_t computeKey(const std::string& driver, const int32_t* types, const char* const* sources, int32_t count);
+
+    /// \return the file a program's binary is kept in
+    std::string getPath(uint64_t key) const;
+
+    /// Reads a binary.
+    /// \return false if there is none, or if the file is truncated or corrupt
+    bool load(uint64_t key, NvGLSLProgramBinary& binary) const;
+
+    /// Writes a binary, replacing any previous one.  The file is written under
+    /// a temporary name first, so that a crash never leaves a partial binary.
+    /// \return false if the file cannot be written
+    bool store(uint64_t key, const NvGLSLProgramBinary& binary);
+
+    /// Removes a binary the driver did not accept.
+    void remove(uint64_t key);
+
+    /// Serializes a binary to the file layout.
+    static void encode(uint64_t key, const NvGLSLProgramBinary& binary, std::vector<char>& file);
+
+    /// Parses the file layout.
+    /// \return false unless file is a complete binary of this version for key
+    static bool decode(uint64_t key, const char* file, size_t length, NvGLSLProgramBinary& binary);
+
+    /// Counts a program loaded from a binary.
+    void countHit(float loadSeconds, float compileSeconds);
+
+    /// Counts a program built from source.
+    /// \param[in] rejected true if a binary was found but not accepted
+    void countMiss(float compileSeconds, bool rejected);
+
+    const NvGLSLProgramCacheStats& getStats() const { return m_stats; }
+
+protected:
+    /// \privatesection
+    std::string m_directory;
+    NvGLSLProgramCacheStats m_stats;
+};
+
+#endif
@@ -0,0 +1,103 @@
+//----------------------------------------------------------------------------------
+// File:        NvGLUtils/NvGLSLProgramVariants.h
+// SDK Version: v1.2 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#ifndef NV_GLSL_PROGRAM_VARIANTS_H
+#define NV_GLSL_PROGRAM_VARIANTS_H
+
+#include <NvFoundation.h>
+#include <map>
+#include <string>
+#include <vector>
+
+class NvGLSLProgram;
+
+/// \file
+/// Specialized programs compiled from one vertex/fragment source pair.
+/// Each variant is the pair compiled with a list of #defines inserted after
+/// the #version line (see #NvGLSLProgram::addDefines), so that features are
+/// chosen by the preprocessor rather than by uniform branches.  Variants are
+/// compiled when first asked for, go through the program binary cache like
+/// any other program, and share their attribute locations (see
+/// #setAttribLocations), so that one vertex setup serves them all.
+
+/// Set of programs built from the same sources with different #defines.
+class NvGLSLProgramVariants {
+public:
+    NvGLSLProgramVariants();
+
+    /// Deletes every variant.
+    ~NvGLSLProgramVariants();
+
+    /// Reads the sources the variants are compiled from, with #NvAssetLoaderRead.
+    /// Variants compiled from earlier sources are deleted.
+    /// \param[in] vertFilename the filename and partial path of the vertex shader source
+    /// \param[in] fragFilename the filename and partial path of the fragment shader source
+    /// \param[in] strict passed on to every variant, see #NvGLSLProgram::setSourceFromStrings
+    /// \return false if either file cannot be read
+    bool setSourceFromFiles(const char* vertFilename, const char* fragFilename, bool strict = false);
+
+    /// Sets the sources the variants are compiled from.
+    /// Variants compiled from earlier sources are deleted.
+    void setSourceFromStrings(const char* vertSrc, const char* fragSrc, bool strict = false);
+
+    /// Attribute locations of variants compiled from now on, see
+    /// #NvGLSLProgram::setAttribLocations.
+    void setAttribLocations(const char* const* names, int32_t count);
+
+    /// Returns the variant with the given #defines, compiling it the first
+    /// time.  Both stages get the same #defines, in the order given; a
+    /// different order is a different variant.
+    /// \param[in] defines the macros, each a name optionally followed by a
+    /// space and a value
+    /// \param[in] count the number of elements in #defines
+    /// \return the variant, owned by this object, or NULL if it failed to
+    /// compile (which is remembered, and not retried)
+    NvGLSLProgram* get(const char* const* defines, int32_t count);
+
+    /// \return the number of variants compiled, failures included
+    size_t size() const { return m_programs.size(); }
+
+    /// Deletes every variant.
+    void clear();
+
+protected:
+    /// \privatesection
+    std::string m_vertSrc;
+    std::string m_fragSrc;
+    bool m_strict;
+    std::vector<std::string> m_attribLocations;
+    std::map<std::string, NvGLSLProgram*> m_programs;   ///< By their #defines, joined with newlines
+};
+
+#endif
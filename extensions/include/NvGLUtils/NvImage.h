@@ -37,6 +37,7 @@
 
 #include <NvFoundation.h>
 #include <vector>
+#include <functional>
 #include <assert.h>
 #include <NV/NvGfxAPI.h>
 
@@ -212,6 +213,20 @@ public:
     /// \return true if DXT images will be expanded, false if they will be passed through
     static bool getDXTExpansion() { return m_expandDXT; }
 
+    /// Range callback of a #ParallelForFunction: (begin, end)
+    typedef std::function<void(size_t, size_t)> RangeFunction;
+
+    /// Calls fn(begin, end) for sub-ranges of [0, count), at most grainSize
+    /// long, possibly concurrently, and returns once all of them have returned.
+    typedef std::function<void(size_t count, size_t grainSize, const RangeFunction& fn)> ParallelForFunction;
+
+    /// Sets how image processing may spread work over threads.  DXT expansion
+    /// decodes independent rows of blocks through it.  By default (and after
+    /// setting an empty function) all work runs on the loading thread.
+    /// The function is called from whichever thread loads the image.
+    /// \param[in] parallelFor the function that runs the ranges
+    static void setParallelFor(const ParallelForFunction& parallelFor) { m_parallelFor = parallelFor; }
+
 protected:
     /// \privatesection
 
@@ -248,6 +263,7 @@ protected:
     static FormatInfo formatTable[]; 
     static bool upperLeftOrigin;
     static bool m_expandDXT;
+    static ParallelForFunction m_parallelFor;
 
     static bool readDDS(const uint8_t* fileData, size_t size, NvImage& i);
 
@@ -0,0 +1,109 @@
+//----------------------------------------------------------------------------------
+// File:        NvAppBase/NvFrameTimeStats.cpp
+// SDK Version: v1.2 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+ 
+/* Frame time distribution stats */
+#include <NvAppBase/NvFrameTimeStats.h>
+#include <NV/NvLogs.h>
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include <stdio.h>
+
+// Nearest-rank percentile of a sorted, non-empty series
+static float percentile(const std::vector<float>& sorted, float p) {
+    size_t rank = (size_t)ceil(p * sorted.size());
+    if (rank < 1)
+        rank = 1;
+    return sorted[std::min(rank, sorted.size()) - 1];
+}
+
+void NvFrameTimeStats::reserve(int32_t frames) {
+    mCPUTimes.reserve(frames);
+    mGPUTimes.reserve(frames);
+}
+
+void NvFrameTimeStats::clear() {
+    mCPUTimes.clear();
+    mGPUTimes.clear();
+}
+
+NvFrameTimeStats::Summary NvFrameTimeStats::summarize(const std::vector<float>& times, float stutterThreshold) {
+    Summary s;
+    memset(&s, 0, sizeof(s));
+    if (times.empty())
+        return s;
+
+    std::vector<float> sorted(times);
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0.0;
+    for (size_t i = 0; i < sorted.size(); i++)
+        sum += sorted[i];
+
+    s.frames = (int32_t)sorted.size();
+    s.min = sorted.front();
+    s.median = percentile(sorted, 0.5f);
+    s.p95 = percentile(sorted, 0.95f);
+    s.p99 = percentile(sorted, 0.99f);
+    s.max = sorted.back();
+    s.mean = (float)(sum / sorted.size());
+    s.stutterThreshold = (stutterThreshold > 0.0f) ? stutterThreshold : 2.0f * s.median;
+    s.stutters = (int32_t)(sorted.end() - std::upper_bound(sorted.begin(), sorted.end(), s.stutterThreshold));
+    return s;
+}
+
+bool NvFrameTimeStats::writeCSV(const char* path) const {
+    FILE* fp = fopen(path, "w");
+    if (!fp) {
+        LOGE("NvFrameTimeStats: could not open %s", path);
+        return false;
+    }
+
+    fprintf(fp, "frame,cpu_ms,gpu_ms\n");
+    const size_t frames = std::max(mCPUTimes.size(), mGPUTimes.size());
+    for (size_t i = 0; i < frames; i++) {
+        fprintf(fp, "%d,", (int)i);
+        if (i < mCPUTimes.size())
+            fprintf(fp, "%.4f", mCPUTimes[i]);
+        fprintf(fp, ",");
+        if (i < mGPUTimes.size())
+            fprintf(fp, "%.4f", mGPUTimes[i]);
+        fprintf(fp, "\n");
+    }
+
+    const bool ok = !ferror(fp);
+    fclose(fp);
+    return ok;
+}
@@ -0,0 +1,227 @@
+//----------------------------------------------------------------------------------
+// File:        NvAppBase/NvFrameTrace.cpp
+// SDK Version: v1.2 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+ 
+/* Per-thread frame phase tracing */
+#include <NvAppBase/NvFrameTrace.h>
+#include <NV/NvStopWatch.h>
+#include <NV/NvLogs.h>
+
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#if defined(_MSC_VER)
+#define NV_TRACE_THREAD_LOCAL __declspec(thread)
+#else
+#define NV_TRACE_THREAD_LOCAL __thread
+#endif
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    double begin;
+    float duration;
+};
+
+// NvStopWatch reports float seconds, which would lose microseconds after a
+// few minutes; each thread restarts its own stopwatch once it passes this many
+// seconds and keeps the elapsed total in a double.
+const float CLOCK_REBASE_SECONDS = 1.0f;
+
+struct ThreadTrace {
+    NvStopWatch* clock;     // only touched by the owning thread
+    double epoch;           // trace time at which clock was last restarted
+    int32_t id;
+    char name[32];
+    std::atomic<uint32_t> head; // number of events ever recorded
+    TraceEvent events[NvFrameTrace::EVENTS_PER_THREAD];
+};
+
+NvStopWatchFactory* s_factory = NULL;
+NvStopWatch* s_sessionClock = NULL;    // started once, never reset; read by every thread
+std::atomic<bool> s_enabled(false);
+std::atomic<int32_t> s_numThreads(0);
+std::atomic<ThreadTrace*> s_threads[NvFrameTrace::MAX_THREADS];
+
+NV_TRACE_THREAD_LOCAL ThreadTrace* t_trace = NULL;
+NV_TRACE_THREAD_LOCAL bool t_overflowed = false;
+
+ThreadTrace* getThreadTrace() {
+    if (t_trace || t_overflowed || !s_sessionClock)
+        return t_trace;
+
+    const int32_t index = s_numThreads.fetch_add(1);
+    if (index >= NvFrameTrace::MAX_THREADS) {
+        t_overflowed = true;
+        return NULL;
+    }
+
+    ThreadTrace* trace = new ThreadTrace;
+    trace->clock = s_factory->createStopWatch();
+    trace->epoch = s_sessionClock->getTime();
+    trace->clock->start();
+    trace->id = index + 1;
+    sprintf(trace->name, "thread %d", trace->id);
+    trace->head.store(0);
+    s_threads[index].store(trace, std::memory_order_release);
+    t_trace = trace;
+    return trace;
+}
+
+double threadTime(ThreadTrace* trace) {
+    float t = trace->clock->getTime();
+    if (t > CLOCK_REBASE_SECONDS) {
+        trace->epoch += t;
+        trace->clock->reset();
+        t = 0.0f;
+    }
+    return trace->epoch + t;
+}
+
+void writeJSONString(FILE* fp, const char* s) {
+    fputc('"', fp);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\')
+            fputc('\\', fp);
+        if ((unsigned char)*s >= 0x20)
+            fputc(*s, fp);
+    }
+    fputc('"', fp);
+}
+
+} // namespace
+
+void NvFrameTrace::globalInit(NvStopWatchFactory* factory) {
+    if (s_sessionClock)
+        return;
+    s_factory = factory;
+    s_sessionClock = factory->createStopWatch();
+    s_sessionClock->start();
+    s_enabled.store(true);
+}
+
+void NvFrameTrace::setEnabled(bool enabled) {
+    s_enabled.store(enabled && s_sessionClock != NULL);
+}
+
+bool NvFrameTrace::isEnabled() {
+    return s_enabled.load(std::memory_order_relaxed);
+}
+
+void NvFrameTrace::setThreadName(const char* name) {
+    ThreadTrace* trace = getThreadTrace();
+    if (trace) {
+        strncpy(trace->name, name, sizeof(trace->name) - 1);
+        trace->name[sizeof(trace->name) - 1] = '\0';
+    }
+}
+
+double NvFrameTrace::now() {
+    ThreadTrace* trace = getThreadTrace();
+    return trace ? threadTime(trace) : 0.0;
+}
+
+void NvFrameTrace::record(const char* name, double begin, double end) {
+    ThreadTrace* trace = getThreadTrace();
+    if (!trace)
+        return;
+
+    // Single writer: fill the slot, then publish it by advancing the head.
+    const uint32_t head = trace->head.load(std::memory_order_relaxed);
+    TraceEvent& e = trace->events[head % EVENTS_PER_THREAD];
+    e.name = name;
+    e.begin = begin;
+    e.duration = (float)(end - begin);
+    trace->head.store(head + 1, std::memory_order_release);
+}
+
+bool NvFrameTrace::writeChromeTrace(const char* path) {
+    FILE* fp = fopen(path, "w");
+    if (!fp) {
+        LOGE("NvFrameTrace: could not open %s", path);
+        return false;
+    }
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    size_t numEvents = 0;
+    std::vector<TraceEvent> events;
+
+    int32_t numThreads = s_numThreads.load();
+    if (numThreads > MAX_THREADS)
+        numThreads = MAX_THREADS;
+    for (int32_t i = 0; i < numThreads; i++) {
+        ThreadTrace* trace = s_threads[i].load(std::memory_order_acquire);
+        if (!trace)
+            continue;
+
+        // Copy what is published, then drop whatever the owner may have
+        // overwritten (or be overwriting) in the meantime.
+        const uint32_t head = trace->head.load(std::memory_order_acquire);
+        uint32_t oldest = head > EVENTS_PER_THREAD ? head - EVENTS_PER_THREAD : 0;
+        events.resize(head - oldest);
+        for (uint32_t n = oldest; n < head; n++)
+            events[n - oldest] = trace->events[n % EVENTS_PER_THREAD];
+        const uint32_t headAfter = trace->head.load(std::memory_order_acquire);
+        const uint32_t firstValid = headAfter + 1 > EVENTS_PER_THREAD ? headAfter + 1 - EVENTS_PER_THREAD : 0;
+
+        fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":",
+            first ? "" : ",\n", trace->id);
+        writeJSONString(fp, trace->name);
+        fprintf(fp, "}}");
+        first = false;
+
+        for (uint32_t n = oldest < firstValid ? firstValid : oldest; n < head; n++) {
+            const TraceEvent& e = events[n - oldest];
+            fprintf(fp, ",\n{\"name\":");
+            writeJSONString(fp, e.name);
+            // Chrome trace timestamps are in microseconds
+            fprintf(fp, ",\"cat\":\"frame\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+                e.begin * 1.0e6, e.duration * 1.0e6, trace->id);
+            numEvents++;
+        }
+    }
+    fprintf(fp, "\n]}\n");
+
+    const bool ok = !ferror(fp);
+    fclose(fp);
+    if (ok) {
+        LOGI("NvFrameTrace: wrote %d scopes from %d threads to %s", (int)numEvents, numThreads, path);
+    } else {
+        LOGE("NvFrameTrace: error writing %s", path);
+    }
+    return ok;
+}
@@ -0,0 +1,423 @@
+//----------------------------------------------------------------------------------
+// File:        NvAppBase/NvJobSystem.cpp
+// SDK Version: v1.2 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+ 
+/* Work-stealing job system */
+#include <NvAppBase/NvJobSystem.h>
+#include "R3/thread.h"
+
+#include <atomic>
+#include <deque>
+#include <vector>
+
+#if defined(_MSC_VER)
+#define NV_JOB_THREAD_LOCAL __declspec(thread)
+#else
+#define NV_JOB_THREAD_LOCAL __thread
+#endif
+
+struct NvJob {
+    NvJobSystem::Function fn;
+    std::atomic<int32_t> refs;      // handles, the scheduler and dependents' lists
+    std::atomic<int32_t> pending;   // 1 until submitted, plus unfinished dependencies
+    std::atomic<bool> done;
+    bool submitted;                 // only touched by the thread that owns the handle
+    r3::Mutex lock;                 // orders adding continuations against completion
+    std::vector<NvJob*> continuations;
+};
+
+static void retainJob(NvJob* job) {
+    job->refs.fetch_add(1);
+}
+
+static void releaseJob(NvJob* job) {
+    if (job->refs.fetch_sub(1) == 1)
+        delete job;
+}
+
+class NvJobSystemImpl;
+
+// The job system and index of the calling thread, if it is the owner (index 0)
+// or a worker of that job system
+static NV_JOB_THREAD_LOCAL NvJobSystemImpl* t_system = NULL;
+static NV_JOB_THREAD_LOCAL int32_t t_index = 0;
+
+class NvJobSystemImpl {
+public:
+    struct Queue {
+        r3::Mutex lock;
+        std::deque<NvJob*> jobs;
+    };
+
+    struct Worker : public r3::Thread {
+        NvJobSystemImpl* system;
+        int32_t index;
+        virtual ~Worker() { }
+        virtual void Run() { system->workerLoop(index); }
+    };
+
+    NvJobSystemImpl(int32_t numThreads)
+        : m_queued(0)
+        , m_sleepingWorkers(0)
+        , m_waiters(0)
+        , m_quit(false) {
+        // queue 0 is shared by the owner and every non-worker thread
+        m_queues.resize(numThreads);
+        for (int32_t i = 0; i < numThreads; i++)
+            m_queues[i] = new Queue;
+        m_workers.resize(numThreads - 1);
+        for (int32_t i = 0; i < numThreads - 1; i++) {
+            m_workers[i] = new Worker;
+            m_workers[i]->system = this;
+            m_workers[i]->index = i + 1;
+        }
+        t_system = this;
+        t_index = 0;
+        for (size_t i = 0; i < m_workers.size(); i++)
+            m_workers[i]->Start();
+    }
+
+    ~NvJobSystemImpl() {
+        m_quit.store(true);
+        m_condition.Acquire();
+        m_condition.Broadcast();
+        m_condition.Release();
+        for (size_t i = 0; i < m_workers.size(); i++) {
+            m_workers[i]->WaitForExit();
+            delete m_workers[i];
+        }
+        for (size_t i = 0; i < m_queues.size(); i++)
+            delete m_queues[i];
+        if (t_system == this)
+            t_system = NULL;
+    }
+
+    int32_t getNumThreads() const { return (int32_t)m_queues.size(); }
+
+    // true on the owner thread and on the workers, which run jobs while waiting
+    bool canHelp() const { return t_system == this; }
+
+    int32_t getThreadIndex() const { return canHelp() ? t_index : 0; }
+
+    // Queues a job whose dependencies are all done
+    void schedule(NvJob* job) {
+        if (m_workers.empty()) {
+            execute(job);
+            return;
+        }
+
+        Queue* queue = m_queues[getThreadIndex()];
+        queue->lock.Acquire();
+        queue->jobs.push_back(job);
+        queue->lock.Release();
+
+        // Pairs with the sleepers' increment-then-check: either they see the
+        // job or we see them and wake them.
+        m_queued.fetch_add(1);
+        if (m_sleepingWorkers.load() + m_waiters.load() > 0) {
+            m_condition.Acquire();
+            m_condition.Broadcast();
+            m_condition.Release();
+        }
+    }
+
+    // Own queue newest-first, then steal oldest-first from the others
+    NvJob* findJob(int32_t index) {
+        // the count may briefly lag (or, by one pop, lead) the queues
+        if (m_queued.load() <= 0)
+            return NULL;
+
+        const int32_t numQueues = (int32_t)m_queues.size();
+        for (int32_t i = 0; i < numQueues; i++) {
+            Queue* queue = m_queues[(index + i) % numQueues];
+            NvJob* job = NULL;
+            queue->lock.Acquire();
+            if (!queue->jobs.empty()) {
+                if (i == 0) {
+                    job = queue->jobs.back();
+                    queue->jobs.pop_back();
+                } else {
+                    job = queue->jobs.front();
+                    queue->jobs.pop_front();
+                }
+            }
+            queue->lock.Release();
+            if (job) {
+                m_queued.fetch_sub(1);
+                return job;
+            }
+        }
+        return NULL;
+    }
+
+    void execute(NvJob* job) {
+        job->fn();
+        job->fn = NvJobSystem::Function(); // release captures now
+
+        std::vector<NvJob*> continuations;
+        job->lock.Acquire();
+        continuations.swap(job->continuations);
+        job->done.store(true);
+        job->lock.Release();
+        notifyWaiters();
+
+        for (size_t i = 0; i < continuations.size(); i++) {
+            if (continuations[i]->pending.fetch_sub(1) == 1)
+                schedule(continuations[i]);
+            releaseJob(continuations[i]);
+        }
+        releaseJob(job); // the scheduler's reference
+    }
+
+    void notifyWaiters() {
+        if (m_waiters.load() > 0) {
+            m_condition.Acquire();
+            m_condition.Broadcast();
+            m_condition.Release();
+        }
+    }
+
+    // Returns once done is set, running queued jobs meanwhile if allowed
+    void waitFor(const std::atomic<bool>& done) {
+        const bool help = canHelp();
+        while (!done.load()) {
+            if (help) {
+                NvJob* job = findJob(t_index);
+                if (job) {
+                    execute(job);
+                    continue;
+                }
+            }
+
+            m_condition.Acquire();
+            m_waiters.fetch_add(1);
+            while (!done.load() && !(help && m_queued.load() > 0))
+                m_condition.Wait();
+            m_waiters.fetch_sub(1);
+            m_condition.Release();
+        }
+    }
+
+    void workerLoop(int32_t index) {
+        t_system = this;
+        t_index = index;
+        for (;;) {
+            NvJob* job = findJob(index);
+            if (job) {
+                execute(job);
+                continue;
+            }
+
+            m_condition.Acquire();
+            m_sleepingWorkers.fetch_add(1);
+            while (m_queued.load() <= 0 && !m_quit.load())
+                m_condition.Wait();
+            m_sleepingWorkers.fetch_sub(1);
+            m_condition.Release();
+
+            if (m_quit.load() && m_queued.load() <= 0)
+                break;
+        }
+        t_system = NULL;
+    }
+
+protected:
+    std::vector<Queue*> m_queues;
+    std::vector<Worker*> m_workers;
+    std::atomic<int32_t> m_queued;
+    std::atomic<int32_t> m_sleepingWorkers;
+    std::atomic<int32_t> m_waiters;
+    std::atomic<bool> m_quit;
+    r3::Condition m_condition;
+};
+
+NvJobHandle::NvJobHandle(NvJob* job) : m_job(job) {
+    if (m_job)
+        retainJob(m_job);
+}
+
+NvJobHandle::NvJobHandle(const NvJobHandle& other) : m_job(other.m_job) {
+    if (m_job)
+        retainJob(m_job);
+}
+
+NvJobHandle& NvJobHandle::operator=(const NvJobHandle& other) {
+    if (other.m_job)
+        retainJob(other.m_job);
+    if (m_job)
+        releaseJob(m_job);
+    m_job = other.m_job;
+    return *this;
+}
+
+NvJobHandle::~NvJobHandle() {
+    if (m_job)
+        releaseJob(m_job);
+}
+
+bool NvJobHandle::isDone() const {
+    return m_job && m_job->done.load();
+}
+
+NvJobSystem::NvJobSystem(int32_t numThreads) {
+#ifdef EMSCRIPTEN
+    numThreads = 1;
+#else
+    if (numThreads < 1)
+        numThreads = r3::getNumCPUCores();
+    if (numThreads < 1)
+        numThreads = 1;
+#endif
+    m_impl = new NvJobSystemImpl(numThreads);
+}
+
+NvJobSystem::~NvJobSystem() {
+    delete m_impl;
+}
+
+int32_t NvJobSystem::getNumThreads() const {
+    return m_impl->getNumThreads();
+}
+
+int32_t NvJobSystem::getThreadIndex() const {
+    return m_impl->getThreadIndex();
+}
+
+NvJobHandle NvJobSystem::createJob(const Function& fn) {
+    NvJob* job = new NvJob;
+    job->fn = fn;
+    job->refs.store(0);
+    job->pending.store(1);
+    job->done.store(false);
+    job->submitted = false;
+    return NvJobHandle(job);
+}
+
+void NvJobSystem::addDependency(const NvJobHandle& job, const NvJobHandle& dependency) {
+    NvJob* dependent = job.m_job;
+    NvJob* first = dependency.m_job;
+    if (!dependent || !first || dependent->submitted)
+        return;
+
+    first->lock.Acquire();
+    if (!first->done.load()) {
+        dependent->pending.fetch_add(1);
+        retainJob(dependent);
+        first->continuations.push_back(dependent);
+    }
+    first->lock.Release();
+}
+
+void NvJobSystem::submit(const NvJobHandle& job) {
+    NvJob* j = job.m_job;
+    if (!j || j->submitted)
+        return;
+    j->submitted = true;
+    retainJob(j); // released once the job has run
+    if (j->pending.fetch_sub(1) == 1)
+        m_impl->schedule(j);
+}
+
+NvJobHandle NvJobSystem::run(const Function& fn) {
+    NvJobHandle job = createJob(fn);
+    submit(job);
+    return job;
+}
+
+NvJobHandle NvJobSystem::then(const NvJobHandle& dependency, const Function& fn) {
+    NvJobHandle job = createJob(fn);
+    addDependency(job, dependency);
+    submit(job);
+    return job;
+}
+
+void NvJobSystem::wait(const NvJobHandle& job) {
+    if (job.m_job && job.m_job->submitted)
+        m_impl->waitFor(job.m_job->done);
+}
+
+namespace {
+
+struct ParallelForState {
+    NvJobSystem* system;
+    const NvJobSystem::RangeFunction* fn;
+    size_t grainSize;
+    std::atomic<size_t> remaining;
+    std::atomic<bool> done;
+};
+
+// Hands the upper half of the range back to the pool until only one grain
+// is left, so that idle workers steal big pieces first, then runs that grain.
+void runRange(NvJobSystemImpl* impl, ParallelForState* state, size_t begin, size_t end) {
+    while (end - begin > state->grainSize) {
+        const size_t grains = (end - begin + state->grainSize - 1) / state->grainSize;
+        const size_t mid = begin + (grains / 2) * state->grainSize;
+        state->system->run([impl, state, mid, end]() { runRange(impl, state, mid, end); });
+        end = mid;
+    }
+
+    (*state->fn)(begin, end, impl->getThreadIndex());
+
+    // Whoever finishes the last element ends the loop; the state lives on the
+    // caller's stack, so it must not be touched after that.
+    if (state->remaining.fetch_sub(end - begin) == end - begin) {
+        state->done.store(true);
+        impl->notifyWaiters();
+    }
+}
+
+} // namespace
+
+void NvJobSystem::runParallelFor(size_t count, size_t grainSize, const RangeFunction& fn) {
+    if (count == 0)
+        return;
+    if (grainSize == 0)
+        grainSize = 1;
+    if (getNumThreads() == 1 || count <= grainSize) {
+        for (size_t begin = 0; begin < count; begin += grainSize)
+            fn(begin, begin + grainSize < count ? begin + grainSize : count, getThreadIndex());
+        return;
+    }
+
+    ParallelForState state;
+    state.system = this;
+    state.fn = &fn;
+    state.grainSize = grainSize;
+    state.remaining.store(count);
+    state.done.store(false);
+    if (m_impl->canHelp())
+        runRange(m_impl, &state, 0, count);
+    else
+        run([this, &state, count]() { runRange(m_impl, &state, 0, count); });
+    m_impl->waitFor(state.done);
+}
@@ -35,7 +35,12 @@
 #include "NV/NvLogs.h"
 #include "NV/NvPlatformGL.h"
 #include "NvAppBase/NvFramerateCounter.h"
+#include "NvAppBase/NvFrameTimeStats.h"
+#include "NvAppBase/NvFrameTrace.h"
 #include "NvAppBase/NvInputTransformer.h"
+#include "NvAppBase/NvJobSystem.h"
+#include "NvAssetLoader/NvAssetLoaderAsync.h"
+#include "NvGLUtils/NvGLSLProgram.h"
 #include "NvGLUtils/NvImage.h"
 #include "NvGLUtils/NvSimpleFBO.h"
 #include "NvGLUtils/NvTimers.h"
@@ -71,6 +76,16 @@ NvSampleApp::NvSampleApp(NvPlatformContext* platform, const char* appTitle) :
     , mTestDuration(0.0f)
     , mTestRepeatFrames(1)
     , m_testModeIssues(TEST_MODE_ISSUE_NONE)
+    , mTestStutterThreshold(0.0f)
+    , mTestFrameStats(NULL)
+    , mTestModeGPUTimer(NULL)
+    , mTestModeGPUWarmupFrames(0)
+    , mTestModeGPUCycles(0)
+    , mTestModeGPUTime(0.0f)
+    , mTraceFile("frametrace.json")
+    , mWriteTraceOnExit(false)
+    , mJobSystem(NULL)
+    , mJobThreads(0)
 {
     m_transformer = new NvInputTransformer;
     mFrameTimer = createStopWatch();
@@ -102,25 +117,52 @@ NvSampleApp::NvSampleApp(NvPlatformContext* platform, const char* appTitle) :
         } else if (0==(*iter).compare("-repeat")) {
             iter++;
             std::stringstream(*iter) >> mTestRepeatFrames;
+        } else if (0==(*iter).compare("-jobthreads")) {
+            iter++;
+            std::stringstream(*iter) >> mJobThreads;
+        } else if (0==(*iter).compare("-stutter")) {
+            iter++;
+            std::stringstream(*iter) >> mTestStutterThreshold;
+        } else if (0==(*iter).compare("-framecsv")) {
+            iter++;
+            mTestFrameCSV = (*iter);
         } else if (0==(*iter).compare("-fbo")) {
             mUseFBOPair = true;
             iter++;
             std::stringstream(*iter) >> m_fboWidth;
             iter++;
             std::stringstream(*iter) >> m_fboHeight;
+        } else if (0==(*iter).compare("-trace")) {
+            mWriteTraceOnExit = true;
+            // the file name is optional
+            if ((iter+1) != cmd.end() && (*(iter+1))[0] != '-') {
+                iter++;
+                mTraceFile = (*iter);
+            }
         }
         iter++;
     }
     NvCPUTimer::globalInit(this);
+    NvFrameTrace::globalInit(this);
 }
 
 NvSampleApp::~NvSampleApp() 
 { 
     // clean up internal allocs
+    NvImage::setParallelFor(NvImage::ParallelForFunction());
+    delete mJobSystem;
     delete mFrameTimer;
+    delete mTestFrameStats;
+    delete mTestModeGPUTimer;
     delete m_transformer;
 }
 
+NvJobSystem* NvSampleApp::getJobSystem() {
+    if (!mJobSystem)
+        mJobSystem = new NvJobSystem(mJobThreads);
+    return mJobSystem;
+}
+
 void NvSampleApp::baseInitRendering(void) {
     LOGI("GL_RENDERER   = %s", (char *) glGetString(GL_RENDERER));
     LOGI("GL_VERSION    = %s", (char *) glGetString(GL_VERSION));
@@ -191,7 +233,17 @@ void NvSampleApp::baseInitRendering(void) {
         NvImage::setDXTExpansion(true);
     }
 
-    initRendering();
+    // expand DXT (and any other image work that splits up) on the job system;
+    // it is created here so that the main thread owns it
+    NvJobSystem* jobSystem = getJobSystem();
+    NvImage::setParallelFor([jobSystem](size_t count, size_t grainSize, const NvImage::RangeFunction& fn) {
+        jobSystem->parallelFor(count, grainSize, fn);
+    });
+
+    {
+        NV_TRACE_SCOPE("initRendering");
+        initRendering();
+    }
     baseInitUI();
 }
 
@@ -257,14 +309,17 @@ void NvSampleApp::baseReshape(int32_t w, int32_t h) {
 
     m_transformer->setScreenSize(w, h);
 
+    NV_TRACE_SCOPE("reshape");
     reshape(w, h);
 }
 
 void NvSampleApp::baseUpdate(void) {
+    NV_TRACE_SCOPE("update");
     update();
 }
 
 void NvSampleApp::baseDraw(void) {
+    NV_TRACE_SCOPE("draw");
     draw();
 }
 
@@ -279,6 +334,7 @@ void NvSampleApp::baseDrawUI(void) {
         mUIWindow->Draw(ds);
     }
 
+    NV_TRACE_SCOPE("drawUI");
     drawUI();
 }
 
@@ -372,6 +428,12 @@ void NvSampleApp::addTweakKeyBind(NvTweakVarBase *var, uint32_t incKey, uint32_t
 }
 
 bool NvSampleApp::keyInput(uint32_t code, NvKeyActionType::Enum action) {
+    if (code == NvKey::K_F11 && action == NvKeyActionType::DOWN) {
+        // dump the most recent frames on demand, e.g. right after a hitch
+        NvFrameTrace::writeChromeTrace(mTraceFile.c_str());
+        return true;
+    }
+
     // only do down and repeat for now.
     if (NvKeyActionType::UP!=action) {
         NvAppKeyBind::const_iterator bind = mKeyBinds.find(code);
@@ -622,10 +684,14 @@ void NvSampleApp::mainLoop() {
 
     if (mTestMode) {
         writeLogFile(mTestName, false, "*** Starting Test\n");
+        mTestFrameStats = new NvFrameTimeStats;
+        // at most one frame per millisecond; avoids growing while timing
+        mTestFrameStats->reserve((int32_t)(mTestDuration * 1000.0f) + 1);
     }
 
     mFramerate = new NvFramerateCounter(this);
     mFrameTimer->start();
+    NvFrameTrace::setThreadName("main");
 
 #ifdef EMSCRIPTEN
     em_app = this;
@@ -641,19 +707,29 @@ void NvSampleApp::mainLoop() {
         mHasInitializedGL = false;
     }
 
+    if (mWriteTraceOnExit)
+        NvFrameTrace::writeChromeTrace(mTraceFile.c_str());
+
     // mainloop exiting, clean up things created in mainloop lifespan.
     delete mFramerate;
     mFramerate = NULL;
 }
 
 void NvSampleApp::mainLoopInternal() {
+    NV_TRACE_SCOPE("frame");
     bool needsReshape = false;
 
-    getPlatformContext()->pollEvents(this);
+    {
+        NV_TRACE_SCOPE("pollEvents");
+        getPlatformContext()->pollEvents(this);
+    }
 
     NvPlatformContext* ctx = getPlatformContext();
 
-    baseUpdate();
+    {
+        NV_TRACE_SCOPE("baseUpdate");
+        baseUpdate();
+    }
 
     // If the context has been lost and graphics resources are still around,
     // signal for them to be deleted
@@ -669,14 +745,22 @@ void NvSampleApp::mainLoopInternal() {
         // If we've not (re-)initialized the resources, do it
         if (!mHasInitializedGL) {
             NvImage::setAPIVersion(getGLContext()->getConfiguration().apiVer);
+            // A new context has no program bound, whatever the shadow says.
+            NvGLSLProgram::resetShadowState();
 
             baseInitRendering();
             mHasInitializedGL = true;
             needsReshape = true;
 
             // In test mode, disable VSYNC if possible
-            if (mTestMode)
+            if (mTestMode) {
                 getGLContext()->setSwapInterval(0);
+
+                if (!mTestModeGPUTimer) {
+                    mTestModeGPUTimer = new NvGPUTimer;
+                    mTestModeGPUTimer->init();
+                }
+            }
         } else if (ctx->hasWindowResized()) {
             if (mUIWindow) {
                 const int32_t w = getGLContext()->width(), h = getGLContext()->height();
@@ -698,6 +782,11 @@ void NvSampleApp::mainLoopInternal() {
 
             // just an estimate
             mTotalTime += mFrameTimer->getTime();
+
+            // the frame timer spans the whole previous frame; only keep
+            // the frames that ran after the warm-up
+            if (mTestModeFrames > 0)
+                mTestFrameStats->addCPUTime(mFrameTimer->getTime() * 1000.0f);
         } else {
             mFrameDelta = mFrameTimer->getTime();
             // just an estimate
@@ -710,6 +799,13 @@ void NvSampleApp::mainLoopInternal() {
         if (!isExiting()) {
             mFrameTimer->start();
 
+            {
+                // Asynchronous reads finish here, on the thread that owns
+                // the GL context, since their callbacks may upload data.
+                NV_TRACE_SCOPE("assetCompletions");
+                NvAssetLoaderDispatchCompletions();
+            }
+
             if (mAutoRepeatButton) {
                 const float elapsed = mAutoRepeatTimer->getTime();
                 if ( (!mAutoRepeatTriggered && elapsed >= 0.5f) ||
@@ -719,9 +815,19 @@ void NvSampleApp::mainLoopInternal() {
                 }
             }
 
-            baseDraw();
-            CHECK_GL_ERROR(); // sanity catch errors
+            if (mTestMode) {
+                if (mTestModeFrames < 0)
+                    mTestModeGPUWarmupFrames++;
+                mTestModeGPUTimer->start();
+            }
+
+            {
+                NV_TRACE_SCOPE("baseDraw");
+                baseDraw();
+                CHECK_GL_ERROR(); // sanity catch errors
+            }
             if (!mTestMode) {
+                NV_TRACE_SCOPE("baseDrawUI");
                 baseDrawUI();
                 CHECK_GL_ERROR(); // sanity catch errors
             }
@@ -735,6 +841,11 @@ void NvSampleApp::mainLoopInternal() {
                 }
             }
 
+            if (mTestMode) {
+                mTestModeGPUTimer->stop();
+                recordTestModeGPUTimes();
+            }
+
             if (mTestMode && mUseFBOPair) {
                 // Check if the app bound FBO 0 in FBO mode
                 GLuint currFBO = 0;
@@ -746,8 +857,12 @@ void NvSampleApp::mainLoopInternal() {
                     m_testModeIssues |= TEST_MODE_FBO_ISSUE;
             }
 
-            SwapBuffers();
+            {
+                NV_TRACE_SCOPE("SwapBuffers");
+                SwapBuffers();
+            }
 
+            NV_TRACE_SCOPE("framerate");
             if (mFramerate->nextFrame()) {
                 // for now, disabling console output of fps as we have on-screen.
                 // makes it easier to read USEFUL log output messages.
@@ -760,6 +875,7 @@ void NvSampleApp::mainLoopInternal() {
             // if we've come to the end of the warm-up, start timing
             if (mTestModeFrames == 0) {
                 mTotalTime = 0.0f;
+                NvGLSLProgram::resetCallStats();
                 mTestModeTimer->start();
             }
 
@@ -767,6 +883,10 @@ void NvSampleApp::mainLoopInternal() {
                 mTestModeTimer->stop();
                 double frameRate = mTestModeFrames / mTestModeTimer->getTime();
                 logTestResults((float)frameRate, mTestModeFrames);
+                if (!mTestFrameCSV.empty())
+                    mTestFrameStats->writeCSV(mTestFrameCSV.c_str());
+                if (mWriteTraceOnExit)
+                    NvFrameTrace::writeChromeTrace(mTraceFile.c_str());
                 exit(0);
 //                    appRequestExit();
             }
@@ -866,9 +986,48 @@ void NvSampleApp::baseShutdownRendering(void) {
     shutdownRendering();
 }
 
+void NvSampleApp::recordTestModeGPUTimes() {
+    // Results arrive a frame or two late, possibly several at once; the
+    // timer only reports their sum, so those frames share it evenly.
+    // Nothing ever completes if the GL has no timer queries.
+    const float elapsed = mTestModeGPUTimer->getScaledCycles();
+    const int32_t cycles = mTestModeGPUTimer->getStartStopCycles();
+    if (cycles > mTestModeGPUCycles) {
+        const float frameTime = (elapsed - mTestModeGPUTime) / (cycles - mTestModeGPUCycles);
+        for (int32_t i = mTestModeGPUCycles; i < cycles; i++) {
+            if (i >= mTestModeGPUWarmupFrames)
+                mTestFrameStats->addGPUTime(frameTime);
+        }
+        mTestModeGPUCycles = cycles;
+        mTestModeGPUTime = elapsed;
+    }
+}
+
+void NvSampleApp::logFrameTimeStats(const char* label, const std::vector<float>& times) {
+    if (times.empty()) {
+        writeLogFile(mTestName, true, "%s frame time: not available\n", label);
+        return;
+    }
+
+    const NvFrameTimeStats::Summary s = NvFrameTimeStats::summarize(times, mTestStutterThreshold);
+    LOGI("%s frame time (ms): min %.3f median %.3f p95 %.3f p99 %.3f max %.3f, %d stutters > %.3f ms\n",
+        label, s.min, s.median, s.p95, s.p99, s.max, s.stutters, s.stutterThreshold);
+    writeLogFile(mTestName, true, "%s frame time (ms, %d frames): min %.3f median %.3f p95 %.3f p99 %.3f max %.3f mean %.3f\n",
+        label, s.frames, s.min, s.median, s.p95, s.p99, s.max, s.mean);
+    writeLogFile(mTestName, true, "%s stutter frames (> %.3f ms): %d\n", label, s.stutterThreshold, s.stutters);
+}
+
 void NvSampleApp::logTestResults(float frameRate, int32_t frames) {
-    LOGI("Test Frame Rate = %lf (frames = %d)\n", frameRate, frames);
+    LOGI("Test Frame Rate = %lf (frames = %d, repeat = %d)\n", frameRate, frames, mTestRepeatFrames);
     writeLogFile(mTestName, true, "\n%s %lf fps (%d frames)\n", mTestName.c_str(), frameRate, frames);
+    writeLogFile(mTestName, true, "Repeat %d (update+draw passes per frame)\n", mTestRepeatFrames);
+    logFrameTimeStats("CPU", mTestFrameStats->getCPUTimes());
+    logFrameTimeStats("GPU", mTestFrameStats->getGPUTimes());
+    const NvGLSLProgramCallStats& calls = NvGLSLProgram::getCallStats();
+    const float perFrame = frames > 0 ? 1.0f / frames : 0.0f;
+    writeLogFile(mTestName, true, "GL calls per frame: glUseProgram %.1f issued, %.1f skipped; glUniform %.1f issued, %.1f skipped\n",
+        calls.programsIssued * perFrame, calls.programsSkipped * perFrame,
+        calls.uniformsIssued * perFrame, calls.uniformsSkipped * perFrame);
     if (mUseFBOPair) {
         writeLogFile(mTestName, true, "\nOffscreen Mode: FBO Size %d x %d\n", m_width, m_height);
     } else {
@@ -0,0 +1,214 @@
+//----------------------------------------------------------------------------------
+// File:        NvAssetLoader/NvAssetArchive.cpp
+// SDK Version: v1.2 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+/* Packed asset archive */
+#include "NvAssetLoader/NvAssetArchive.h"
+
+#include <algorithm>
+
+static uint32_t bucketOf(uint64_t hash, uint32_t bucketBits) {
+    return bucketBits ? uint32_t(hash >> (64 - bucketBits)) : 0;
+}
+
+static bool inRange(uint64_t offset, uint64_t size, size_t length) {
+    return offset <= length && size <= length - offset;
+}
+
+NvAssetArchive::NvAssetArchive()
+    : m_data(NULL)
+    , m_length(0)
+    , m_numEntries(0)
+    , m_bucketBits(0)
+    , m_buckets(NULL)
+    , m_entries(NULL) {
+}
+
+uint64_t NvAssetArchive::hashPath(const char* path, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= uint8_t(path[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool NvAssetArchive::init(const char* data, size_t length) {
+    *this = NvAssetArchive();
+    if (!data || length < sizeof(NvAssetArchiveHeader) || uintptr_t(data) % 4 != 0)
+        return false;
+    const NvAssetArchiveHeader& header = *reinterpret_cast<const NvAssetArchiveHeader*>(data);
+    if (memcmp(header.magic, "NVPK", 4) != 0 || header.version != NvAssetArchiveHeader::Version ||
+        header.bucketBits > 31 || header.numEntries > (1u << header.bucketBits))
+        return false;
+
+    const uint64_t numBuckets = (uint64_t(1) << header.bucketBits) + 1;
+    if (header.bucketsOffset % 4 != 0 || header.entriesOffset % 8 != 0 ||
+        !inRange(header.bucketsOffset, numBuckets * sizeof(uint32_t), length) ||
+        !inRange(header.entriesOffset, uint64_t(header.numEntries) * sizeof(NvAssetArchiveEntry), length) ||
+        !inRange(header.namesOffset, 0, length))
+        return false;
+
+    const uint32_t* buckets = reinterpret_cast<const uint32_t*>(data + header.bucketsOffset);
+    const NvAssetArchiveEntry* entries = reinterpret_cast<const NvAssetArchiveEntry*>(data + header.entriesOffset);
+    if (buckets[0] != 0 || buckets[numBuckets - 1] != header.numEntries)
+        return false;
+    for (uint64_t b = 0; b + 1 < numBuckets; b++) {
+        if (buckets[b] > buckets[b + 1])
+            return false;
+        for (uint32_t i = buckets[b]; i < buckets[b + 1]; i++)
+            if (bucketOf(entries[i].hash, header.bucketBits) != b)
+                return false;
+    }
+    for (uint32_t i = 0; i < header.numEntries; i++) {
+        const NvAssetArchiveEntry& entry = entries[i];
+        // Sorted by hash, names and data followed by a null byte, sizes that
+        // fit an int32_t.
+        if ((i > 0 && entries[i - 1].hash > entry.hash) ||
+            !inRange(entry.nameOffset, uint64_t(entry.nameLength) + 1, length) ||
+            !inRange(entry.offset, uint64_t(entry.size) + 1, length) ||
+            entry.size > 0x7fffffffu || data[entry.nameOffset + entry.nameLength] != '\0' ||
+            data[entry.offset + entry.size] != '\0')
+            return false;
+    }
+
+    m_data = data;
+    m_length = length;
+    m_numEntries = header.numEntries;
+    m_bucketBits = header.bucketBits;
+    m_buckets = buckets;
+    m_entries = entries;
+    return true;
+}
+
+const char* NvAssetArchive::find(const char* filePath, int32_t& length) const {
+    if (!m_data)
+        return NULL;
+    const size_t pathLength = strlen(filePath);
+    const uint64_t hash = hashPath(filePath, pathLength);
+    const uint32_t bucket = bucketOf(hash, m_bucketBits);
+    for (uint32_t i = m_buckets[bucket]; i < m_buckets[bucket + 1]; i++) {
+        const NvAssetArchiveEntry& entry = m_entries[i];
+        if (entry.hash == hash && entry.nameLength == pathLength &&
+            memcmp(m_data + entry.nameOffset, filePath, pathLength) == 0) {
+            length = int32_t(entry.size);
+            return m_data + entry.offset;
+        }
+    }
+    return NULL;
+}
+
+static uint64_t alignUp(uint64_t offset, uint64_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+bool NvAssetArchive::build(const std::vector<NvAssetArchiveFile>& files, std::vector<char>& archive) {
+    // Last file of each name, ordered by hash (then name, for a stable layout).
+    struct Sorted {
+        uint64_t hash;
+        const NvAssetArchiveFile* file;
+        bool operator<(const Sorted& other) const {
+            return hash != other.hash ? hash < other.hash : file->name < other.file->name;
+        }
+    };
+    std::vector<Sorted> sorted;
+    for (size_t i = files.size(); i-- > 0; ) {
+        Sorted s = { hashPath(files[i].name.data(), files[i].name.size()), &files[i] };
+        bool replaced = false;
+        for (size_t j = 0; j < sorted.size() && !replaced; j++)
+            replaced = sorted[j].hash == s.hash && sorted[j].file->name == s.file->name;
+        if (!replaced)
+            sorted.push_back(s);
+    }
+    std::sort(sorted.begin(), sorted.end());
+
+    NvAssetArchiveHeader header;
+    memcpy(header.magic, "NVPK", 4);
+    header.version = NvAssetArchiveHeader::Version;
+    header.numEntries = uint32_t(sorted.size());
+    header.bucketBits = 0;
+    while ((uint64_t(1) << header.bucketBits) < sorted.size())
+        header.bucketBits++;
+    const uint64_t numBuckets = (uint64_t(1) << header.bucketBits) + 1;
+
+    uint64_t end = sizeof(NvAssetArchiveHeader);
+    const uint64_t bucketsOffset = end;
+    end += numBuckets * sizeof(uint32_t);
+    const uint64_t entriesOffset = alignUp(end, 8);
+    end = entriesOffset + sorted.size() * sizeof(NvAssetArchiveEntry);
+    const uint64_t namesOffset = end;
+    for (size_t i = 0; i < sorted.size(); i++)
+        end += sorted[i].file->name.size() + 1;
+    const uint64_t dataOffset = alignUp(end, NvAssetArchiveHeader::Alignment);
+    end = dataOffset;
+    for (size_t i = 0; i < sorted.size(); i++) {
+        if (sorted[i].file->data.size() > 0x7fffffffu)
+            return false;
+        end = alignUp(end, NvAssetArchiveHeader::Alignment) + sorted[i].file->data.size() + 1;
+    }
+    if (end > 0xffffffffu)
+        return false;
+
+    header.bucketsOffset = uint32_t(bucketsOffset);
+    header.entriesOffset = uint32_t(entriesOffset);
+    header.namesOffset = uint32_t(namesOffset);
+    header.dataOffset = uint32_t(dataOffset);
+    archive.assign(size_t(end), '\0');
+    memcpy(&archive[0], &header, sizeof(header));
+
+    uint32_t* buckets = reinterpret_cast<uint32_t*>(&archive[bucketsOffset]);
+    NvAssetArchiveEntry* entries = reinterpret_cast<NvAssetArchiveEntry*>(&archive[entriesOffset]);
+    uint64_t nameOffset = namesOffset, offset = dataOffset;
+    for (size_t i = 0; i < sorted.size(); i++) {
+        const NvAssetArchiveFile& file = *sorted[i].file;
+        NvAssetArchiveEntry& entry = entries[i];
+        entry.hash = sorted[i].hash;
+        entry.nameOffset = uint32_t(nameOffset);
+        entry.nameLength = uint32_t(file.name.size());
+        entry.offset = uint32_t(offset);
+        entry.size = uint32_t(file.data.size());
+        memcpy(&archive[nameOffset], file.name.data(), file.name.size());
+        if (!file.data.empty())
+            memcpy(&archive[offset], &file.data[0], file.data.size());
+        nameOffset += file.name.size() + 1;
+        offset = alignUp(offset + file.data.size() + 1, NvAssetArchiveHeader::Alignment);
+    }
+    // Bucket b starts at the first entry whose bucket is b or later.
+    uint32_t entry = 0;
+    for (uint64_t b = 0; b < numBuckets; b++) {
+        while (entry < sorted.size() && bucketOf(entries[entry].hash, header.bucketBits) < b)
+            entry++;
+        buckets[b] = entry;
+    }
+    return true;
+}
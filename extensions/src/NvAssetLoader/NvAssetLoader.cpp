@@ -32,9 +32,110 @@
 //
 //----------------------------------------------------------------------------------
 #include "NvAssetLoader/NvAssetLoader.h"
+#include "NvAssetLoader/NvAssetLoaderAsync.h"
+#include "NvAssetLoader/NvAssetArchive.h"
 #include "NV/NvLogs.h"
+#include "R3/thread.h"
 
 #include <string>
+#include <map>
+#include <vector>
+
+// Archives mounted with NvAssetLoaderMountArchive, most recent last.  Reads
+// may come from the asynchronous loader's I/O thread, hence the lock.
+struct MountedArchive {
+    std::string path;
+    const char *data;
+    NvAssetArchive archive;
+};
+
+static std::vector<MountedArchive*> s_archives;
+static r3::Mutex s_archiveLock;
+static bool s_looseFileOverride = true;
+
+static const char *findPacked(const char *filePath, int32_t &length)
+{
+    r3::ScopedMutex lock(s_archiveLock);
+    for (size_t i = s_archives.size(); i-- > 0; ) {
+        const char *packed = s_archives[i]->archive.find(filePath, length);
+        if (packed)
+            return packed;
+    }
+    return NULL;
+}
+
+// Whether asset is a slice of a mounted archive, as returned by NvAssetLoaderMap.
+static bool isPacked(const char *asset)
+{
+    r3::ScopedMutex lock(s_archiveLock);
+    for (size_t i = 0; i < s_archives.size(); i++) {
+        if (s_archives[i]->archive.contains(asset))
+            return true;
+    }
+    return false;
+}
+
+static char *copyPacked(const char *packed, int32_t length)
+{
+    char *data = new char[length + 1];
+    memcpy(data, packed, length);
+    data[length] = '\0';
+    return data;
+}
+
+bool NvAssetLoaderMountArchive(const char *archivePath)
+{
+    int32_t length = 0;
+    const char *data = NvAssetLoaderMap(archivePath, length);
+    if (!data)
+        return false;
+
+    MountedArchive *mounted = new MountedArchive;
+    mounted->path = archivePath;
+    mounted->data = data;
+    if (!mounted->archive.init(data, length)) {
+        LOGE("Not a valid asset archive: '%s'", archivePath);
+        NvAssetLoaderUnmap(data);
+        delete mounted;
+        return false;
+    }
+
+    LOGI("Mounted asset archive '%s', %u files", archivePath, mounted->archive.getNumEntries());
+    r3::ScopedMutex lock(s_archiveLock);
+    s_archives.push_back(mounted);
+    return true;
+}
+
+bool NvAssetLoaderUnmountArchive(const char *archivePath)
+{
+    MountedArchive *mounted = NULL;
+    s_archiveLock.Acquire();
+    for (size_t i = s_archives.size(); i-- > 0 && !mounted; ) {
+        if (s_archives[i]->path == archivePath) {
+            mounted = s_archives[i];
+            s_archives.erase(s_archives.begin() + i);
+        }
+    }
+    s_archiveLock.Release();
+
+    // Unmapped once no longer mounted, or Unmap would take it for a slice.
+    if (!mounted)
+        return false;
+    NvAssetLoaderUnmap(mounted->data);
+    delete mounted;
+    return true;
+}
+
+static void unmountAllArchives()
+{
+    while (!s_archives.empty())
+        NvAssetLoaderUnmountArchive(s_archives.back()->path.c_str());
+}
+
+void NvAssetLoaderSetLooseFileOverride(bool enable)
+{
+    s_looseFileOverride = enable;
+}
 
 #ifdef ANDROID
 
@@ -55,6 +156,9 @@ bool NvAssetLoaderInit(void* platform)
 
 bool NvAssetLoaderShutdown()
 {
+    // The I/O thread reads through the asset manager.
+    NvAssetLoaderAsyncShutdown();
+    unmountAllArchives();
     s_assetManager = NULL;
     return true;
 }
@@ -69,6 +173,20 @@ bool NvAssetLoaderRemoveSearchPath(const char *)
     return true;
 }
 
+// Looks filePath up in the mounted archives and the APK, in the order set by
+// NvAssetLoaderSetLooseFileOverride.  Returns the packed file, or NULL with
+// fileAsset set to the opened asset (NULL if there is none).
+static const char *findAsset(const char *filePath, AAsset *&fileAsset, int32_t &length)
+{
+    fileAsset = NULL;
+    const char *packed = s_looseFileOverride ? NULL : findPacked(filePath, length);
+    if (!packed)
+        fileAsset = AAssetManager_open(s_assetManager, filePath, AASSET_MODE_BUFFER);
+    if (!packed && !fileAsset && s_looseFileOverride)
+        packed = findPacked(filePath, length);
+    return packed;
+}
+
 char *NvAssetLoaderRead(const char *filePath, int32_t &length)
 {
     char *buff = NULL;
@@ -76,7 +194,10 @@ char *NvAssetLoaderRead(const char *filePath, int32_t &length)
     if (!s_assetManager)
         return NULL;
 
-    AAsset *fileAsset = AAssetManager_open(s_assetManager, filePath, AASSET_MODE_BUFFER);
+    AAsset *fileAsset = NULL;
+    const char *packed = findAsset(filePath, fileAsset, length);
+    if (packed)
+        return copyPacked(packed, length);
 
     if(fileAsset != NULL)
     {
@@ -100,13 +221,68 @@ bool NvAssetLoaderFree(char* asset)
     return true;
 }
 
+// Mapped assets stay open until unmapped; the buffer belongs to the asset.
+static std::map<const char*, AAsset*> s_mappedAssets;
+
+const char *NvAssetLoaderMap(const char *filePath, int32_t &length)
+{
+    if (!s_assetManager)
+        return NULL;
+
+    AAsset *fileAsset = NULL;
+    const char *packed = findAsset(filePath, fileAsset, length);
+    if (packed)
+        return packed;
+    if (fileAsset == NULL)
+        return NULL;
+
+    const char *buff = (const char*)AAsset_getBuffer(fileAsset);
+    if (buff == NULL) {
+        // Compressed in the APK; there is nothing to map.
+        AAsset_close(fileAsset);
+        return NvAssetLoaderRead(filePath, length);
+    }
+
+    length = AAsset_getLength(fileAsset);
+    s_mappedAssets[buff] = fileAsset;
+    LOGI("Mapped asset '%s', %d bytes", filePath, length);
+    return buff;
+}
+
+bool NvAssetLoaderUnmap(const char* asset)
+{
+    if (isPacked(asset))
+        return true;
+
+    std::map<const char*, AAsset*>::iterator mapped = s_mappedAssets.find(asset);
+    if (mapped == s_mappedAssets.end())
+        return NvAssetLoaderFree(const_cast<char*>(asset));
+
+    AAsset_close(mapped->second);
+    s_mappedAssets.erase(mapped);
+    return true;
+}
+
 #elif defined(WIN32)
 
 #include <stdio.h>
+#include <io.h>
+#include <windows.h>
 #include <vector>
 
 static std::vector<std::string> s_searchPath;
 
+// Where each file was found, or an empty string if it was not; cleared when
+// the search paths change.
+static std::map<std::string, std::string> s_resolvedPaths;
+static r3::Mutex s_resolvedPathsLock;
+
+static void clearResolvedPaths()
+{
+    r3::ScopedMutex lock(s_resolvedPathsLock);
+    s_resolvedPaths.clear();
+}
+
 bool NvAssetLoaderInit(void*)
 {
     return true;
@@ -114,7 +290,11 @@ bool NvAssetLoaderInit(void*)
 
 bool NvAssetLoaderShutdown()
 {
+    // The I/O thread reads through the search paths.
+    NvAssetLoaderAsyncShutdown();
+    unmountAllArchives();
     s_searchPath.clear();
+    clearResolvedPaths();
     return true;
 }
 
@@ -129,6 +309,7 @@ bool NvAssetLoaderAddSearchPath(const char *path)
     }
 
     s_searchPath.push_back(path);
+    clearResolvedPaths();
     return true;
 }
 
@@ -139,6 +320,7 @@ bool NvAssetLoaderRemoveSearchPath(const char *path)
     while (src != s_searchPath.end()) {
         if (!(*src).compare(path)) {
             s_searchPath.erase(src);
+            clearResolvedPaths();
             return true;
         }
         src++;
@@ -146,9 +328,26 @@ bool NvAssetLoaderRemoveSearchPath(const char *path)
     return true;
 }
 
-char *NvAssetLoaderRead(const char *filePath, int32_t &length)
+// Opens filePath with the search described in NvAssetLoader.h, unless it
+// has been resolved before.
+static FILE *openAsset(const char *filePath)
 {
     FILE *fp = NULL;
+    s_resolvedPathsLock.Acquire();
+    std::map<std::string, std::string>::const_iterator resolved = s_resolvedPaths.find(filePath);
+    const bool known = resolved != s_resolvedPaths.end();
+    const std::string knownPath = known ? resolved->second : std::string();
+    s_resolvedPathsLock.Release();
+    if (known) {
+        if (knownPath.empty())
+            return NULL;
+        if ((fopen_s(&fp, knownPath.c_str(), "rb") != 0) || (fp == NULL))
+            fp = NULL;
+        if (fp)
+            return fp;
+        // Moved or deleted since; search again.
+    }
+
     // loop N times up the hierarchy, testing at each level
     std::string upPath;
     std::string fullPath;
@@ -184,10 +383,35 @@ char *NvAssetLoaderRead(const char *filePath, int32_t &length)
         upPath.append("../");
     }
 
-    if (!fp) {
+    r3::ScopedMutex lock(s_resolvedPathsLock);
+    s_resolvedPaths[filePath] = fp ? fullPath : std::string();
+    return fp;
+}
+
+// Looks filePath up in the mounted archives and the search paths, in the
+// order set by NvAssetLoaderSetLooseFileOverride.  Returns the packed file,
+// or NULL with fp set to the opened loose file (NULL if there is none).
+static const char *findAsset(const char *filePath, FILE *&fp, int32_t &length)
+{
+    fp = NULL;
+    const char *packed = s_looseFileOverride ? NULL : findPacked(filePath, length);
+    if (!packed)
+        fp = openAsset(filePath);
+    if (!packed && !fp && s_looseFileOverride)
+        packed = findPacked(filePath, length);
+    if (!packed && !fp)
         fprintf(stderr, "Error opening file '%s'\n", filePath);
+    return packed;
+}
+
+char *NvAssetLoaderRead(const char *filePath, int32_t &length)
+{
+    FILE *fp = NULL;
+    const char *packed = findAsset(filePath, fp, length);
+    if (packed)
+        return copyPacked(packed, length);
+    if (!fp)
         return NULL;
-    }
 
     fseek(fp, 0, SEEK_END);
     length = ftell(fp);
@@ -211,13 +435,64 @@ bool NvAssetLoaderFree(char* asset)
     return true;
 }
 
+const char *NvAssetLoaderMap(const char *filePath, int32_t &length)
+{
+    FILE *fp = NULL;
+    const char *packed = findAsset(filePath, fp, length);
+    if (packed)
+        return packed;
+    if (!fp)
+        return NULL;
+
+    fseek(fp, 0, SEEK_END);
+    length = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    const char *data = NULL;
+    HANDLE file = (HANDLE)_get_osfhandle(_fileno(fp));
+    HANDLE mapping = length > 0 ? CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+    if (mapping) {
+        // The view keeps the mapping alive after both handles are closed.
+        data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+    }
+    fclose(fp);
+
+    if (!data) {
+        fprintf(stderr, "Error mapping file '%s'\n", filePath);
+        return NULL;
+    }
+    return data;
+}
+
+bool NvAssetLoaderUnmap(const char* asset)
+{
+    if (isPacked(asset))
+        return true;
+    return UnmapViewOfFile(asset) != 0;
+}
+
 #elif defined(LINUX) || defined(MACOSX) // have mac and linux share ftm.
 
 #include <stdio.h>
 #include <vector>
+#ifndef EMSCRIPTEN
+#include <sys/mman.h>
+#endif
 
 static std::vector<std::string> s_searchPath;
 
+// Where each file was found, or an empty string if it was not; cleared when
+// the search paths change.
+static std::map<std::string, std::string> s_resolvedPaths;
+static r3::Mutex s_resolvedPathsLock;
+
+static void clearResolvedPaths()
+{
+    r3::ScopedMutex lock(s_resolvedPathsLock);
+    s_resolvedPaths.clear();
+}
+
 bool NvAssetLoaderInit(void*)
 {
     return true;
@@ -225,7 +500,11 @@ bool NvAssetLoaderInit(void*)
 
 bool NvAssetLoaderShutdown()
 {
+    // The I/O thread reads through the search paths.
+    NvAssetLoaderAsyncShutdown();
+    unmountAllArchives();
     s_searchPath.clear();
+    clearResolvedPaths();
     return true;
 }
 
@@ -240,6 +519,7 @@ bool NvAssetLoaderAddSearchPath(const char *path)
     }
 
     s_searchPath.push_back(path);
+    clearResolvedPaths();
     return true;
 }
 
@@ -250,6 +530,7 @@ bool NvAssetLoaderRemoveSearchPath(const char *path)
     while (src != s_searchPath.end()) {
         if (!(*src).compare(path)) {
             s_searchPath.erase(src);
+            clearResolvedPaths();
             return true;
         }
         src++;
@@ -257,9 +538,25 @@ bool NvAssetLoaderRemoveSearchPath(const char *path)
     return true;
 }
 
-char *NvAssetLoaderRead(const char *filePath, int32_t &length)
+// Opens filePath with the search described in NvAssetLoader.h, unless it
+// has been resolved before.
+static FILE *openAsset(const char *filePath)
 {
     FILE *fp = NULL;
+    s_resolvedPathsLock.Acquire();
+    std::map<std::string, std::string>::const_iterator resolved = s_resolvedPaths.find(filePath);
+    const bool known = resolved != s_resolvedPaths.end();
+    const std::string knownPath = known ? resolved->second : std::string();
+    s_resolvedPathsLock.Release();
+    if (known) {
+        if (knownPath.empty())
+            return NULL;
+        fp = fopen(knownPath.c_str(), "rb");
+        if (fp)
+            return fp;
+        // Moved or deleted since; search again.
+    }
+
     // loop N times up the hierarchy, testing at each level
     std::string upPath;
     std::string fullPath;
@@ -294,10 +591,35 @@ char *NvAssetLoaderRead(const char *filePath, int32_t &length)
         upPath.append("../");
     }
 
-    if (!fp) {
+    r3::ScopedMutex lock(s_resolvedPathsLock);
+    s_resolvedPaths[filePath] = fp ? fullPath : std::string();
+    return fp;
+}
+
+// Looks filePath up in the mounted archives and the search paths, in the
+// order set by NvAssetLoaderSetLooseFileOverride.  Returns the packed file,
+// or NULL with fp set to the opened loose file (NULL if there is none).
+static const char *findAsset(const char *filePath, FILE *&fp, int32_t &length)
+{
+    fp = NULL;
+    const char *packed = s_looseFileOverride ? NULL : findPacked(filePath, length);
+    if (!packed)
+        fp = openAsset(filePath);
+    if (!packed && !fp && s_looseFileOverride)
+        packed = findPacked(filePath, length);
+    if (!packed && !fp)
         fprintf(stderr, "Error opening file '%s'\n", filePath);
+    return packed;
+}
+
+char *NvAssetLoaderRead(const char *filePath, int32_t &length)
+{
+    FILE *fp = NULL;
+    const char *packed = findAsset(filePath, fp, length);
+    if (packed)
+        return copyPacked(packed, length);
+    if (!fp)
         return NULL;
-    }
 
     fseek(fp, 0, SEEK_END);
     length = ftell(fp);
@@ -321,6 +643,85 @@ bool NvAssetLoaderFree(char* asset)
     return true;
 }
 
+#ifdef EMSCRIPTEN
+
+// The preloaded file system lives in memory already; mapping a loose file
+// is a read.
+const char *NvAssetLoaderMap(const char *filePath, int32_t &length)
+{
+    FILE *fp = NULL;
+    const char *packed = findAsset(filePath, fp, length);
+    if (packed)
+        return packed;
+    if (!fp)
+        return NULL;
+    fclose(fp);
+    return NvAssetLoaderRead(filePath, length);
+}
+
+bool NvAssetLoaderUnmap(const char* asset)
+{
+    if (isPacked(asset))
+        return true;
+    return NvAssetLoaderFree(const_cast<char*>(asset));
+}
+
+#else
+
+// munmap needs the length of each mapping.  Files may be mapped on the
+// asynchronous loader's I/O thread, hence the lock.
+static std::map<const char*, size_t> s_mappedAssets;
+static r3::Mutex s_mappedAssetsLock;
+
+const char *NvAssetLoaderMap(const char *filePath, int32_t &length)
+{
+    FILE *fp = NULL;
+    const char *packed = findAsset(filePath, fp, length);
+    if (packed)
+        return packed;
+    if (!fp)
+        return NULL;
+
+    fseek(fp, 0, SEEK_END);
+    length = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    // The mapping outlives the descriptor.
+    void *data = length > 0 ? mmap(NULL, length, PROT_READ, MAP_PRIVATE, fileno(fp), 0) : MAP_FAILED;
+    fclose(fp);
+
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Error mapping file '%s'\n", filePath);
+        return NULL;
+    }
+
+    {
+        r3::ScopedMutex lock(s_mappedAssetsLock);
+        s_mappedAssets[(const char*)data] = length;
+    }
+#ifdef DEBUG
+    fprintf(stderr, "Mapped file '%s', %d bytes\n", filePath, length);
+#endif
+    return (const char*)data;
+}
+
+bool NvAssetLoaderUnmap(const char* asset)
+{
+    if (isPacked(asset))
+        return true;
+
+    r3::ScopedMutex lock(s_mappedAssetsLock);
+    std::map<const char*, size_t>::iterator mapped = s_mappedAssets.find(asset);
+    if (mapped == s_mappedAssets.end())
+        return false;
+
+    const bool unmapped = munmap(const_cast<char*>(asset), mapped->second) == 0;
+    s_mappedAssets.erase(mapped);
+    return unmapped;
+}
+
+#endif
+
 #else
 
 #error "No asset loader library defined for this platform!"
@@ -0,0 +1,421 @@
+//----------------------------------------------------------------------------------
+// File:        NvAssetLoader/NvAssetLoaderAsync.cpp
+// SDK Version: v1.2 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+/* Asynchronous asset reads on a background I/O thread */
+#include "NvAssetLoader/NvAssetLoaderAsync.h"
+#include "NvAssetLoader/NvAssetLoader.h"
+#include "R3/thread.h"
+
+#include <atomic>
+#include <deque>
+#include <string>
+#include <vector>
+
+struct NvAssetLoadRequest {
+    std::string path;
+    NvAssetLoadCallback onComplete; // only touched by the dispatching thread
+    bool hasCallback;
+    bool mapped;                    // NvAssetLoaderMap rather than NvAssetLoaderRead
+    int32_t priority;               // guarded by the queue lock
+    uint64_t sequence;
+    std::atomic<int32_t> refs;      // handles and the loader
+    std::atomic<int32_t> status;
+    char* data;                     // written by the reading thread before status
+    int32_t length;                 // leaves NV_ASSET_LOAD_PENDING
+    bool awaitingCallback;          // guarded by the queue lock
+
+    ~NvAssetLoadRequest() {
+        releaseData(data);
+    }
+
+    void releaseData(char* block) const {
+        if (!mapped)
+            NvAssetLoaderFree(block);
+        else if (block)
+            NvAssetLoaderUnmap(block);
+    }
+};
+
+static void retainRequest(NvAssetLoadRequest* request) {
+    request->refs.fetch_add(1);
+}
+
+static void releaseRequest(NvAssetLoadRequest* request) {
+    if (request->refs.fetch_sub(1) == 1)
+        delete request;
+}
+
+// Queued, finished and in-flight requests.  The loader holds one reference
+// to each request from submission until its read is discarded or its
+// callback has been taken by the dispatching thread.
+class NvAssetLoaderQueue {
+public:
+    static NvAssetLoadHandle submit(const char* filePath, bool mapped, int32_t priority, const NvAssetLoadCallback& onComplete);
+    static int32_t dispatch(int32_t maxCallbacks);
+    static int32_t getPendingCount();
+    static void shutdown();
+    static void setPriority(NvAssetLoadRequest* request, int32_t priority);
+    static bool cancel(NvAssetLoadRequest* request);
+    static void wait(NvAssetLoadRequest* request);
+
+private:
+    class IOThread : public r3::Thread {
+    public:
+        virtual ~IOThread() {}
+        virtual void Run() { NvAssetLoaderQueue::ioLoop(); }
+    };
+
+    static void ioLoop();
+    static NvAssetLoadRequest* takeQueued(NvAssetLoadRequest* request);
+    static NvAssetLoadRequest* takeNext();
+    static void read(NvAssetLoadRequest* request);
+
+    static r3::Condition s_lock;    // guards everything below; signalled on new and finished reads
+    static std::vector<NvAssetLoadRequest*> s_queued;
+    static std::deque<NvAssetLoadRequest*> s_completed;
+    static int32_t s_reading;
+    static uint64_t s_sequence;
+    static IOThread* s_thread;
+    static bool s_stopping;
+    static bool s_threadExited;
+};
+
+r3::Condition NvAssetLoaderQueue::s_lock;
+std::vector<NvAssetLoadRequest*> NvAssetLoaderQueue::s_queued;
+std::deque<NvAssetLoadRequest*> NvAssetLoaderQueue::s_completed;
+int32_t NvAssetLoaderQueue::s_reading = 0;
+uint64_t NvAssetLoaderQueue::s_sequence = 0;
+NvAssetLoaderQueue::IOThread* NvAssetLoaderQueue::s_thread = NULL;
+bool NvAssetLoaderQueue::s_stopping = false;
+bool NvAssetLoaderQueue::s_threadExited = false;
+
+NvAssetLoadHandle NvAssetLoaderQueue::submit(const char* filePath, bool mapped, int32_t priority, const NvAssetLoadCallback& onComplete) {
+    NvAssetLoadRequest* request = new NvAssetLoadRequest;
+    request->path = filePath;
+    request->onComplete = onComplete;
+    request->hasCallback = bool(onComplete);
+    request->mapped = mapped;
+    request->priority = priority;
+    request->refs.store(1);
+    request->status.store(NV_ASSET_LOAD_PENDING);
+    request->data = NULL;
+    request->length = 0;
+    request->awaitingCallback = false;
+    // The handle's reference must exist before the read can finish.
+    NvAssetLoadHandle handle(request);
+
+    s_lock.Acquire();
+    request->sequence = s_sequence++;
+    s_queued.push_back(request);
+#ifndef EMSCRIPTEN
+    if (!s_thread) {
+        s_thread = new IOThread;
+        s_thread->Start();
+    }
+#endif
+    s_lock.Broadcast();
+    s_lock.Release();
+    return handle;
+}
+
+// Removes request from the queue; the caller gets the loader's reference.
+// Returns NULL if it is not queued.  Called with the lock held.
+NvAssetLoadRequest* NvAssetLoaderQueue::takeQueued(NvAssetLoadRequest* request) {
+    for (size_t i = 0; i < s_queued.size(); i++) {
+        if (s_queued[i] == request) {
+            s_queued.erase(s_queued.begin() + i);
+            return request;
+        }
+    }
+    return NULL;
+}
+
+// Highest priority first, oldest first within a priority.  Called with the
+// lock held.
+NvAssetLoadRequest* NvAssetLoaderQueue::takeNext() {
+    if (s_queued.empty())
+        return NULL;
+    size_t best = 0;
+    for (size_t i = 1; i < s_queued.size(); i++) {
+        const NvAssetLoadRequest* r = s_queued[i];
+        if (r->priority > s_queued[best]->priority ||
+            (r->priority == s_queued[best]->priority && r->sequence < s_queued[best]->sequence))
+            best = i;
+    }
+    return takeQueued(s_queued[best]);
+}
+
+// Reads a request taken from the queue.  Called with the lock held; it is
+// released around the read itself.
+void NvAssetLoaderQueue::read(NvAssetLoadRequest* request) {
+    s_reading++;
+    s_lock.Release();
+    int32_t length = 0;
+    // A mapping is never written to; data is only non-const for reads.
+    char* data = request->mapped ? const_cast<char*>(NvAssetLoaderMap(request->path.c_str(), length))
+                                 : NvAssetLoaderRead(request->path.c_str(), length);
+    s_lock.Acquire();
+    s_reading--;
+
+    if (request->status.load() == NV_ASSET_LOAD_CANCELLED) {
+        request->releaseData(data);
+        releaseRequest(request);
+    } else {
+        request->data = data;
+        request->length = data ? length : 0;
+        request->status.store(data ? NV_ASSET_LOAD_DONE : NV_ASSET_LOAD_FAILED);
+        if (request->hasCallback) {
+            request->awaitingCallback = true;
+            s_completed.push_back(request);
+        } else {
+            releaseRequest(request);
+        }
+    }
+    s_lock.Broadcast();
+}
+
+void NvAssetLoaderQueue::ioLoop() {
+    s_lock.Acquire();
+    while (true) {
+        while (!s_stopping && s_queued.empty())
+            s_lock.Wait();
+        if (s_stopping)
+            break;
+        read(takeNext());
+    }
+    s_threadExited = true;
+    s_lock.Broadcast();
+    s_lock.Release();
+}
+
+int32_t NvAssetLoaderQueue::dispatch(int32_t maxCallbacks) {
+    s_lock.Acquire();
+#ifdef EMSCRIPTEN
+    // No I/O thread; do the queued reads here.
+    while (NvAssetLoadRequest* request = takeNext())
+        read(request);
+#endif
+    int32_t count = 0;
+    while ((maxCallbacks < 1 || count < maxCallbacks) && !s_completed.empty()) {
+        NvAssetLoadRequest* request = s_completed.front();
+        s_completed.pop_front();
+        request->awaitingCallback = false;
+        s_lock.Release();
+
+        // The callback may queue, cancel or wait for other reads.  Clearing
+        // it first drops whatever it captured, including handles to this
+        // request.
+        NvAssetLoadHandle handle(request);
+        releaseRequest(request);
+        NvAssetLoadCallback callback;
+        callback.swap(request->onComplete);
+        callback(handle);
+        count++;
+
+        s_lock.Acquire();
+    }
+    s_lock.Release();
+    return count;
+}
+
+int32_t NvAssetLoaderQueue::getPendingCount() {
+    r3::ScopedMutex lock(s_lock);
+    return int32_t(s_queued.size() + s_completed.size()) + s_reading;
+}
+
+void NvAssetLoaderQueue::shutdown() {
+    s_lock.Acquire();
+    IOThread* thread = s_thread;
+    if (thread) {
+        s_stopping = true;
+        s_lock.Broadcast();
+        // Run returning is all WaitForExit can be relied on for.
+        while (!s_threadExited)
+            s_lock.Wait();
+    }
+    s_lock.Release();
+    if (thread) {
+        thread->WaitForExit();
+        delete thread;
+    }
+
+    s_lock.Acquire();
+    for (size_t i = 0; i < s_queued.size(); i++) {
+        s_queued[i]->status.store(NV_ASSET_LOAD_CANCELLED);
+        s_queued[i]->onComplete = NvAssetLoadCallback();
+        releaseRequest(s_queued[i]);
+    }
+    s_queued.clear();
+    for (size_t i = 0; i < s_completed.size(); i++) {
+        s_completed[i]->awaitingCallback = false;
+        s_completed[i]->onComplete = NvAssetLoadCallback();
+        releaseRequest(s_completed[i]);
+    }
+    s_completed.clear();
+    s_thread = NULL;
+    s_stopping = false;
+    s_threadExited = false;
+    s_lock.Release();
+}
+
+void NvAssetLoaderQueue::setPriority(NvAssetLoadRequest* request, int32_t priority) {
+    r3::ScopedMutex lock(s_lock);
+    request->priority = priority;
+}
+
+bool NvAssetLoaderQueue::cancel(NvAssetLoadRequest* request) {
+    r3::ScopedMutex lock(s_lock);
+    switch (request->status.load()) {
+    case NV_ASSET_LOAD_CANCELLED:
+        return false;
+    case NV_ASSET_LOAD_PENDING:
+        // Either queued, or the reading thread discards it when done.
+        request->status.store(NV_ASSET_LOAD_CANCELLED);
+        request->onComplete = NvAssetLoadCallback();
+        if (takeQueued(request))
+            releaseRequest(request);
+        return true;
+    default:
+        if (!request->awaitingCallback)
+            return false;
+        for (size_t i = 0; i < s_completed.size(); i++) {
+            if (s_completed[i] == request) {
+                s_completed.erase(s_completed.begin() + i);
+                break;
+            }
+        }
+        request->awaitingCallback = false;
+        request->status.store(NV_ASSET_LOAD_CANCELLED);
+        request->onComplete = NvAssetLoadCallback();
+        request->releaseData(request->data);
+        request->data = NULL;
+        request->length = 0;
+        releaseRequest(request);
+        return true;
+    }
+}
+
+void NvAssetLoaderQueue::wait(NvAssetLoadRequest* request) {
+    s_lock.Acquire();
+    // Rather than waiting for its turn, a queued read is done right here.
+    if (takeQueued(request))
+        read(request);
+    while (request->status.load() == NV_ASSET_LOAD_PENDING)
+        s_lock.Wait();
+    s_lock.Release();
+}
+
+NvAssetLoadHandle::NvAssetLoadHandle(NvAssetLoadRequest* request)
+    : m_request(request) {
+    retainRequest(m_request);
+}
+
+NvAssetLoadHandle::NvAssetLoadHandle(const NvAssetLoadHandle& other)
+    : m_request(other.m_request) {
+    if (m_request)
+        retainRequest(m_request);
+}
+
+NvAssetLoadHandle& NvAssetLoadHandle::operator=(const NvAssetLoadHandle& other) {
+    if (other.m_request)
+        retainRequest(other.m_request);
+    if (m_request)
+        releaseRequest(m_request);
+    m_request = other.m_request;
+    return *this;
+}
+
+NvAssetLoadHandle::~NvAssetLoadHandle() {
+    if (m_request)
+        releaseRequest(m_request);
+}
+
+NvAssetLoadStatus NvAssetLoadHandle::getStatus() const {
+    return m_request ? NvAssetLoadStatus(m_request->status.load()) : NV_ASSET_LOAD_CANCELLED;
+}
+
+const char* NvAssetLoadHandle::getPath() const {
+    return m_request ? m_request->path.c_str() : NULL;
+}
+
+const char* NvAssetLoadHandle::getData() const {
+    return getStatus() == NV_ASSET_LOAD_DONE ? m_request->data : NULL;
+}
+
+int32_t NvAssetLoadHandle::getLength() const {
+    return getStatus() == NV_ASSET_LOAD_DONE ? m_request->length : 0;
+}
+
+char* NvAssetLoadHandle::takeData() {
+    if (getStatus() != NV_ASSET_LOAD_DONE || m_request->mapped)
+        return NULL;
+    char* data = m_request->data;
+    m_request->data = NULL;
+    return data;
+}
+
+void NvAssetLoadHandle::setPriority(int32_t priority) {
+    if (m_request)
+        NvAssetLoaderQueue::setPriority(m_request, priority);
+}
+
+bool NvAssetLoadHandle::cancel() {
+    return m_request ? NvAssetLoaderQueue::cancel(m_request) : false;
+}
+
+void NvAssetLoadHandle::wait() {
+    if (m_request)
+        NvAssetLoaderQueue::wait(m_request);
+}
+
+NvAssetLoadHandle NvAssetLoaderReadAsync(const char* filePath, int32_t priority, const NvAssetLoadCallback& onComplete) {
+    return NvAssetLoaderQueue::submit(filePath, false, priority, onComplete);
+}
+
+NvAssetLoadHandle NvAssetLoaderMapAsync(const char* filePath, int32_t priority, const NvAssetLoadCallback& onComplete) {
+    return NvAssetLoaderQueue::submit(filePath, true, priority, onComplete);
+}
+
+int32_t NvAssetLoaderDispatchCompletions(int32_t maxCallbacks) {
+    return NvAssetLoaderQueue::dispatch(maxCallbacks);
+}
+
+int32_t NvAssetLoaderGetPendingCount() {
+    return NvAssetLoaderQueue::getPendingCount();
+}
+
+bool NvAssetLoaderAsyncShutdown() {
+    NvAssetLoaderQueue::shutdown();
+    return true;
+}
@@ -0,0 +1,320 @@
+//----------------------------------------------------------------------------------
+// File:        NvGLUtils/DXTDecoder.cpp
+// SDK Version: v1.2 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include "DXTDecoder.h"
+
+#include <string.h>
+
+// SSE2 is part of every x86-64 target; other targets use the scalar decoder.
+#if !defined(NV_DXT_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define NV_DXT_SSE2 1
+#include <emmintrin.h>
+#endif
+
+using namespace nv;
+
+namespace
+{
+    // Blocks are little endian and not necessarily aligned.
+    inline uint16_t load16(const uint8_t* p)
+    {
+        uint16_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    inline uint64_t load64(const uint8_t* p)
+    {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    /// A 4 bit DXT3 alpha, expanded to 8 bits and moved to the top byte.
+    inline uint32_t alphaDXT3(uint32_t a)
+    {
+        return ((a << 4) | a) << 24;
+    }
+
+#ifdef NV_DXT_SSE2
+
+    /// Lanes of a where mask is set, lanes of b elsewhere.
+    inline __m128i select(__m128i mask, __m128i a, __m128i b)
+    {
+        return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+    }
+
+    /// The four colors of a DXT1 block, red in the low byte of each lane.
+    /// Same results as BlockDXT1::evaluatePalette: both interpolated colors
+    /// are computed in one register of 16 bit channels, and the division by
+    /// three is an exact multiply-high for the sums that can occur (< 766).
+    inline __m128i colorPalette(uint32_t c0, uint32_t c1)
+    {
+        const uint32_t r0 = (c0 >> 11) & 0x1F, g0 = (c0 >> 5) & 0x3F, b0 = c0 & 0x1F;
+        const uint32_t r1 = (c1 >> 11) & 0x1F, g1 = (c1 >> 5) & 0x3F, b1 = c1 & 0x1F;
+        const __m128i ends = _mm_setr_epi16(
+            short((r0 << 3) | (r0 >> 2)), short((g0 << 2) | (g0 >> 4)), short((b0 << 3) | (b0 >> 2)), 0xFF,
+            short((r1 << 3) | (r1 >> 2)), short((g1 << 2) | (g1 >> 4)), short((b1 << 3) | (b1 >> 2)), 0xFF);
+        const __m128i swapped = _mm_shuffle_epi32(ends, _MM_SHUFFLE(1, 0, 3, 2));
+
+        __m128i mid;
+        if (c0 > c1) {
+            // (2 * c0 + c1) / 3 in the low half, (2 * c1 + c0) / 3 in the high half
+            const __m128i sum = _mm_add_epi16(_mm_add_epi16(ends, ends), swapped);
+            mid = _mm_srli_epi16(_mm_mulhi_epu16(sum, _mm_set1_epi16(short(0xAAAB))), 1);
+        } else {
+            // (c0 + c1) / 2, then transparent black
+            mid = _mm_srli_epi16(_mm_add_epi16(ends, swapped), 1);
+            mid = _mm_unpacklo_epi64(mid, _mm_setzero_si128());
+        }
+        return _mm_packus_epi16(ends, mid);
+    }
+
+    /// Alpha of the pixels of a block, one row of four per register.
+    typedef __m128i AlphaRows[4];
+
+    // The alpha rows are put together in registers: writing them to memory a
+    // pixel at a time and loading whole rows back would stall every load on
+    // store forwarding.
+    inline void decodeAlphaDXT3(const uint8_t* block, AlphaRows alpha)
+    {
+        for (uint32_t y = 0; y < 4; y++) {
+            const uint32_t bits = load16(block + 2 * y);
+            alpha[y] = _mm_setr_epi32(alphaDXT3(bits & 0xF), alphaDXT3((bits >> 4) & 0xF),
+                alphaDXT3((bits >> 8) & 0xF), alphaDXT3(bits >> 12));
+        }
+    }
+
+    /// The alpha palette is computed in one register of 16 bit lanes, for
+    /// both modes at once: lane i is (w0[i] * alpha0 + w1[i] * alpha1) / 7
+    /// or / 5, the divisions being exact multiply-highs for sums < 1786.
+    inline void decodeAlphaDXT5(const uint8_t* block, AlphaRows alpha)
+    {
+        const __m128i a0 = _mm_set1_epi16(block[0]);
+        const __m128i a1 = _mm_set1_epi16(block[1]);
+        const __m128i eightAlphas = _mm_cmpgt_epi16(a0, a1);
+        const __m128i w0 = select(eightAlphas, _mm_setr_epi16(7, 0, 6, 5, 4, 3, 2, 1), _mm_setr_epi16(5, 0, 4, 3, 2, 1, 0, 0));
+        const __m128i w1 = select(eightAlphas, _mm_setr_epi16(0, 7, 1, 2, 3, 4, 5, 6), _mm_setr_epi16(0, 5, 1, 2, 3, 4, 0, 0));
+        const __m128i divisor = select(eightAlphas, _mm_set1_epi16(9363), _mm_set1_epi16(13108));   // 2^16 / 7, 2^16 / 5
+        __m128i p = _mm_mulhi_epu16(_mm_add_epi16(_mm_mullo_epi16(a0, w0), _mm_mullo_epi16(a1, w1)), divisor);
+        p = _mm_or_si128(p, _mm_andnot_si128(eightAlphas, _mm_setr_epi16(0, 0, 0, 0, 0, 0, 0, 0xFF)));
+
+        uint8_t palette[16];
+        _mm_storeu_si128((__m128i*)palette, _mm_packus_epi16(p, p));
+        uint64_t bits = load64(block) >> 16;
+        for (uint32_t y = 0; y < 4; y++, bits >>= 12) {
+            alpha[y] = _mm_setr_epi32(uint32_t(palette[bits & 7]) << 24, uint32_t(palette[(bits >> 3) & 7]) << 24,
+                uint32_t(palette[(bits >> 6) & 7]) << 24, uint32_t(palette[(bits >> 9) & 7]) << 24);
+        }
+    }
+
+    /// Writes the 4x4 pixels of a DXT1 color block to out, rows stride pixels
+    /// apart.  With HasAlpha the alpha of the color palette is replaced by
+    /// the given alpha.  Each row selects its palette entries with compares
+    /// against the four possible 2 bit indices and is stored at once.
+    template <bool HasAlpha>
+    inline void decodeColorBlock(const uint8_t* block, const AlphaRows alpha, uint32_t* out, size_t stride)
+    {
+        const __m128i palette = colorPalette(load16(block), load16(block + 2));
+        const __m128i color0 = _mm_shuffle_epi32(palette, 0x00);
+        const __m128i color1 = _mm_shuffle_epi32(palette, 0x55);
+        const __m128i color2 = _mm_shuffle_epi32(palette, 0xAA);
+        const __m128i color3 = _mm_shuffle_epi32(palette, 0xFF);
+        const __m128i mask = _mm_setr_epi32(0x03, 0x0C, 0x30, 0xC0);
+        const __m128i index1 = _mm_setr_epi32(0x01, 0x04, 0x10, 0x40);
+        const __m128i index2 = _mm_setr_epi32(0x02, 0x08, 0x20, 0x80);
+
+        for (uint32_t y = 0; y < 4; y++) {
+            const __m128i index = _mm_and_si128(_mm_set1_epi32(block[4 + y]), mask);
+            __m128i c = _mm_and_si128(_mm_cmpeq_epi32(index, _mm_setzero_si128()), color0);
+            c = _mm_or_si128(c, _mm_and_si128(_mm_cmpeq_epi32(index, index1), color1));
+            c = _mm_or_si128(c, _mm_and_si128(_mm_cmpeq_epi32(index, index2), color2));
+            c = _mm_or_si128(c, _mm_and_si128(_mm_cmpeq_epi32(index, mask), color3));
+            if (HasAlpha) {
+                c = _mm_or_si128(_mm_and_si128(c, _mm_set1_epi32(0x00FFFFFF)), alpha[y]);
+            }
+            _mm_storeu_si128((__m128i*)(out + y * stride), c);
+        }
+    }
+
+#else
+
+    inline uint32_t rgba(uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+    {
+        return r | (g << 8) | (b << 16) | (a << 24);
+    }
+
+    /// The four colors of a DXT1 block, red in the low byte.  Same arithmetic
+    /// as BlockDXT1::evaluatePalette.
+    inline void colorPalette(uint32_t c0, uint32_t c1, uint32_t palette[4])
+    {
+        const uint32_t r0 = ((c0 >> 8) & 0xF8) | ((c0 >> 13) & 0x07);
+        const uint32_t g0 = ((c0 >> 3) & 0xFC) | ((c0 >> 9) & 0x03);
+        const uint32_t b0 = ((c0 << 3) & 0xF8) | ((c0 >> 2) & 0x07);
+        const uint32_t r1 = ((c1 >> 8) & 0xF8) | ((c1 >> 13) & 0x07);
+        const uint32_t g1 = ((c1 >> 3) & 0xFC) | ((c1 >> 9) & 0x03);
+        const uint32_t b1 = ((c1 << 3) & 0xF8) | ((c1 >> 2) & 0x07);
+        palette[0] = rgba(r0, g0, b0, 0xFF);
+        palette[1] = rgba(r1, g1, b1, 0xFF);
+        if (c0 > c1) {
+            palette[2] = rgba((2 * r0 + r1) / 3, (2 * g0 + g1) / 3, (2 * b0 + b1) / 3, 0xFF);
+            palette[3] = rgba((2 * r1 + r0) / 3, (2 * g1 + g0) / 3, (2 * b1 + b0) / 3, 0xFF);
+        } else {
+            palette[2] = rgba((r0 + r1) / 2, (g0 + g1) / 2, (b0 + b1) / 2, 0xFF);
+            palette[3] = 0;
+        }
+    }
+
+    /// Alpha of the pixels of a block, row by row.
+    typedef uint32_t AlphaRows[16];
+
+    /// The eight alphas of a DXT5 block, in the top byte.  Same arithmetic
+    /// as AlphaBlockDXT5::evaluatePalette.
+    inline void alphaPaletteDXT5(uint32_t a0, uint32_t a1, uint32_t palette[8])
+    {
+        palette[0] = a0;
+        palette[1] = a1;
+        if (a0 > a1) {
+            palette[2] = (6 * a0 + 1 * a1) / 7;
+            palette[3] = (5 * a0 + 2 * a1) / 7;
+            palette[4] = (4 * a0 + 3 * a1) / 7;
+            palette[5] = (3 * a0 + 4 * a1) / 7;
+            palette[6] = (2 * a0 + 5 * a1) / 7;
+            palette[7] = (1 * a0 + 6 * a1) / 7;
+        } else {
+            palette[2] = (4 * a0 + 1 * a1) / 5;
+            palette[3] = (3 * a0 + 2 * a1) / 5;
+            palette[4] = (2 * a0 + 3 * a1) / 5;
+            palette[5] = (1 * a0 + 4 * a1) / 5;
+            palette[6] = 0x00;
+            palette[7] = 0xFF;
+        }
+        for (uint32_t i = 0; i < 8; i++)
+            palette[i] <<= 24;
+    }
+
+    inline void decodeAlphaDXT3(const uint8_t* block, AlphaRows alpha)
+    {
+        const uint64_t bits = load64(block);
+        for (uint32_t i = 0; i < 16; i++)
+            alpha[i] = alphaDXT3(uint32_t(bits >> (4 * i)) & 0xF);
+    }
+
+    inline void decodeAlphaDXT5(const uint8_t* block, AlphaRows alpha)
+    {
+        uint32_t palette[8];
+        alphaPaletteDXT5(block[0], block[1], palette);
+        const uint64_t bits = load64(block) >> 16;
+        for (uint32_t i = 0; i < 16; i++)
+            alpha[i] = palette[uint32_t(bits >> (3 * i)) & 7];
+    }
+
+    /// Writes the 4x4 pixels of a DXT1 color block to out, rows stride pixels
+    /// apart.  With HasAlpha the alpha of the color palette is replaced by
+    /// the given alpha.
+    template <bool HasAlpha>
+    inline void decodeColorBlock(const uint8_t* block, const AlphaRows alpha, uint32_t* out, size_t stride)
+    {
+        uint32_t palette[4];
+        colorPalette(load16(block), load16(block + 2), palette);
+        if (HasAlpha) {
+            for (uint32_t i = 0; i < 4; i++)
+                palette[i] &= 0x00FFFFFF;
+        }
+
+        for (uint32_t y = 0; y < 4; y++) {
+            const uint32_t bits = block[4 + y];
+            uint32_t* row = out + y * stride;
+            for (uint32_t x = 0; x < 4; x++) {
+                uint32_t c = palette[(bits >> (2 * x)) & 3];
+                if (HasAlpha)
+                    c |= alpha[4 * y + x];
+                row[x] = c;
+            }
+        }
+    }
+
+#endif
+
+    template <DXTFormat Format>
+    void decodeBlockRows(const uint8_t* blocks, int32_t width, int32_t height,
+        int32_t firstBlockRow, int32_t endBlockRow, uint32_t* dest)
+    {
+        const uint32_t blockSize = (Format == DXTFormat_DXT1) ? 8 : 16;
+        const bool hasAlpha = (Format != DXTFormat_DXT1);
+        const int32_t bw = (width + 3) / 4;
+
+        AlphaRows alpha;
+        uint32_t edge[16];
+        for (int32_t j = firstBlockRow; j < endBlockRow; j++) {
+            const uint8_t* block = blocks + size_t(j) * bw * blockSize;
+            uint32_t* out = dest + size_t(4 * j) * width;
+            const int32_t rows = (height - 4 * j < 4) ? height - 4 * j : 4;
+
+            for (int32_t i = 0; i < bw; i++, block += blockSize) {
+                if (Format == DXTFormat_DXT3)
+                    decodeAlphaDXT3(block, alpha);
+                else if (Format == DXTFormat_DXT5)
+                    decodeAlphaDXT5(block, alpha);
+                const uint8_t* color = hasAlpha ? block + 8 : block;
+
+                const int32_t cols = (width - 4 * i < 4) ? width - 4 * i : 4;
+                if (rows == 4 && cols == 4) {
+                    decodeColorBlock<hasAlpha>(color, alpha, out + 4 * i, width);
+                } else {
+                    // partial block at the right or bottom edge
+                    decodeColorBlock<hasAlpha>(color, alpha, edge, 4);
+                    for (int32_t y = 0; y < rows; y++)
+                        memcpy(out + size_t(y) * width + 4 * i, edge + 4 * y, cols * sizeof(uint32_t));
+                }
+            }
+        }
+    }
+}
+
+void nv::decodeDXTBlockRows(DXTFormat format, const uint8_t* blocks, int32_t width, int32_t height,
+    int32_t firstBlockRow, int32_t endBlockRow, uint32_t* dest)
+{
+    switch (format) {
+    case DXTFormat_DXT1:
+        decodeBlockRows<DXTFormat_DXT1>(blocks, width, height, firstBlockRow, endBlockRow, dest);
+        break;
+    case DXTFormat_DXT3:
+        decodeBlockRows<DXTFormat_DXT3>(blocks, width, height, firstBlockRow, endBlockRow, dest);
+        break;
+    case DXTFormat_DXT5:
+        decodeBlockRows<DXTFormat_DXT5>(blocks, width, height, firstBlockRow, endBlockRow, dest);
+        break;
+    }
+}
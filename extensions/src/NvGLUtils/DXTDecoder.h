@@ -0,0 +1,73 @@
+//----------------------------------------------------------------------------------
+// File:        NvGLUtils/DXTDecoder.h
+// SDK Version: v1.2 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#ifndef NV_IMAGE_DXTDECODER_H
+#define NV_IMAGE_DXTDECODER_H
+
+#include <NvFoundation.h>
+
+namespace nv
+{
+    /// Block compressed formats handled by decodeDXTBlockRows.
+    enum DXTFormat
+    {
+        DXTFormat_DXT1,
+        DXTFormat_DXT3,
+        DXTFormat_DXT5
+    };
+
+    /// Bytes per 4x4 block: 8 for DXT1, 16 for DXT3 and DXT5.
+    inline uint32_t blockSizeDXT(DXTFormat format)
+    {
+        return (format == DXTFormat_DXT1) ? 8 : 16;
+    }
+
+    /// Decodes the block rows [firstBlockRow, endBlockRow) of a DXT surface
+    /// straight into its RGBA8 expansion.  Produces the same pixels as
+    /// BlockDXT1/3/5::decodeBlock, without going through a ColorBlock.
+    /// Only the pixels of the given block rows are written, so disjoint
+    /// ranges of the same surface may be decoded concurrently.
+    /// \param[in] format the block format
+    /// \param[in] blocks the first block of the surface (not of the range)
+    /// \param[in] width the surface width in pixels
+    /// \param[in] height the surface height in pixels
+    /// \param[in] firstBlockRow the first block row to decode
+    /// \param[in] endBlockRow one past the last block row to decode
+    /// \param[out] dest the width x height destination surface, row major
+    void decodeDXTBlockRows(DXTFormat format, const uint8_t* blocks, int32_t width, int32_t height,
+        int32_t firstBlockRow, int32_t endBlockRow, uint32_t* dest);
+
+} // nv namespace
+
+#endif // NV_IMAGE_DXTDECODER_H
@@ -32,11 +32,94 @@
 //
 //----------------------------------------------------------------------------------
 #include "NvGLUtils/NvGLSLProgram.h"
+#include "NvGLUtils/NvGLSLProgramCache.h"
 #include "NvAssetLoader/NvAssetLoader.h"
 #include "NV/NvLogs.h"
 #include <string>
+#include <cstring>
+#include <chrono>
 
 bool NvGLSLProgram::ms_logAllMissing = false;
+NvGLSLProgramCache* NvGLSLProgram::ms_binaryCache = NULL;
+GLuint NvGLSLProgram::ms_boundProgram = 0;
+bool NvGLSLProgram::ms_boundProgramKnown = false;
+NvGLSLProgramCallStats NvGLSLProgram::ms_callStats = { 0, 0, 0, 0 };
+
+// Program binaries are core in GL 4.1 and ES 3, and extensions before that;
+// WebGL has none.
+#if defined(ANDROID)
+static PFNGLGETPROGRAMBINARYOESPROC s_glGetProgramBinary = NULL;
+static PFNGLPROGRAMBINARYOESPROC s_glProgramBinary = NULL;
+#endif
+
+static bool programBinariesSupported()
+{
+    static int32_t supported = -1;
+    if (supported < 0) {
+#if defined(EMSCRIPTEN) || defined(USE_REGAL)
+        supported = 0;
+#else
+#if defined(ANDROID)
+        const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+        if (extensions && strstr(extensions, "GL_OES_get_program_binary")) {
+            s_glGetProgramBinary = (PFNGLGETPROGRAMBINARYOESPROC)eglGetProcAddress("glGetProgramBinaryOES");
+            s_glProgramBinary = (PFNGLPROGRAMBINARYOESPROC)eglGetProcAddress("glProgramBinaryOES");
+        }
+        supported = (s_glGetProgramBinary && s_glProgramBinary) ? 1 : 0;
+#else
+        supported = (glGetProgramBinary && glProgramBinary && glProgramParameteri) ? 1 : 0;
+#endif
+        // Drivers may expose the entry points but no format to store.
+        GLint numFormats = 0;
+        if (supported)
+            glGetIntegerv(0x87FE /* GL_NUM_PROGRAM_BINARY_FORMATS */, &numFormats);
+        supported = (numFormats > 0) ? 1 : 0;
+#endif
+    }
+    return supported != 0;
+}
+
+#if !defined(EMSCRIPTEN) && !defined(USE_REGAL)
+static void getProgramBinary(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* format, void* binary)
+{
+#if defined(ANDROID)
+    s_glGetProgramBinary(program, bufSize, length, format, binary);
+#else
+    glGetProgramBinary(program, bufSize, length, format, binary);
+#endif
+}
+
+static void programBinary(GLuint program, GLenum format, const void* binary, GLsizei length)
+{
+#if defined(ANDROID)
+    s_glProgramBinary(program, format, binary, length);
+#else
+    glProgramBinary(program, format, binary, length);
+#endif
+}
+#endif
+
+/// Identifies the driver in cache keys; its binaries are of no use to any other.
+static const std::string& driverIdentity()
+{
+    static std::string identity;
+    if (identity.empty()) {
+        const GLenum names[] = { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION };
+        for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+            const char* value = (const char*)glGetString(names[i]);
+            identity += value ? value : "";
+            identity += '\n';
+        }
+    }
+    return identity;
+}
+
+typedef std::chrono::steady_clock Clock;
+
+static float secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::duration<float> >(Clock::now() - start).count();
+}
 
 NvGLSLProgram::NvGLSLProgram()
     : m_program(0), m_strict(false)
@@ -45,6 +128,10 @@ NvGLSLProgram::NvGLSLProgram()
 
 NvGLSLProgram::~NvGLSLProgram()
 {
+    // A deferred disable may have left the program bound; GL would keep it
+    // alive, and the shadow would take a later program of the same name for it.
+    if (m_program && ms_boundProgramKnown && ms_boundProgram == m_program)
+        useProgram(0);
     //LOGI("glDeleteProgram(%d)", m_program);
     glDeleteProgram(m_program);
     //CHECK_GL_ERROR();
@@ -93,41 +180,120 @@ bool NvGLSLProgram::setSourceFromFiles(const char* vertFilename, const char* fra
 }
 
 bool NvGLSLProgram::setSourceFromStrings(const char* vertSrc, const char* fragSrc, bool strict)
+{
+    ShaderSourceItem src[] = {
+        { vertSrc, GL_VERTEX_SHADER },
+        { fragSrc, GL_FRAGMENT_SHADER }
+    };
+    return setSourceFromStrings(src, 2, strict);
+}
+
+bool NvGLSLProgram::setSourceFromStrings(ShaderSourceItem* src, int32_t count, bool strict)
 {
     if (m_program) {
+        if (ms_boundProgramKnown && ms_boundProgram == m_program)
+            useProgram(0);
         glDeleteProgram(m_program);
         m_program = 0;
     }
+    m_uniforms.clear();
 
     m_strict = strict;
 
-    m_program = compileProgram(vertSrc, fragSrc);
+    m_program = loadProgram(src, count);
 
     return m_program != 0;
 }
 
-bool NvGLSLProgram::setSourceFromStrings(ShaderSourceItem* src, int32_t count, bool strict)
+void NvGLSLProgram::setAttribLocations(const char* const* names, int32_t count)
 {
-    if (m_program) {
-        glDeleteProgram(m_program);
-        m_program = 0;
-    }
-
-    m_strict = strict;
+    m_attribLocations.assign(names, names + count);
+}
 
-    m_program = compileProgram(src, count);
+std::string NvGLSLProgram::addDefines(const char* src, const char* const* defines, int32_t count)
+{
+    // #version must be the first thing in a shader; it is followed by the
+    // end of its line or of the source.
+    const char* body = src;
+    const char* version = strstr(src, "#version");
+    if (version && strspn(src, " \t\r\n") == size_t(version - src)) {
+        body = version + strcspn(version, "\n");
+        if (*body)
+            body++;
+    }
 
-    return m_program != 0;
+    std::string result(src, body);
+    if (!result.empty() && result[result.size() - 1] != '\n')
+        result += '\n';
+    for (int32_t i = 0; i < count; i++) {
+        result += "#define ";
+        result += defines[i];
+        result += '\n';
+    }
+    result += body;
+    return result;
 }
 
 void NvGLSLProgram::enable()
 {
-    glUseProgram(m_program);
+    useProgram(m_program);
 }
 
 void NvGLSLProgram::disable()
 {
-    glUseProgram(0);
+    // Deferred: the next enable either keeps this program or replaces it.
+}
+
+void NvGLSLProgram::useProgram(GLuint program)
+{
+    if (ms_boundProgramKnown && ms_boundProgram == program) {
+        ms_callStats.programsSkipped++;
+        return;
+    }
+    glUseProgram(program);
+    ms_boundProgram = program;
+    ms_boundProgramKnown = true;
+    ms_callStats.programsIssued++;
+}
+
+void NvGLSLProgram::resetShadowState()
+{
+    ms_boundProgramKnown = false;
+}
+
+void NvGLSLProgram::resetCallStats()
+{
+    memset(&ms_callStats, 0, sizeof(ms_callStats));
+}
+
+bool NvGLSLProgram::shadowUniform(GLint index, uint32_t type, int32_t count, const void* value, size_t bytes)
+{
+    std::map<GLint, UniformValue>::iterator it = m_uniforms.find(index);
+    if (it != m_uniforms.end() && it->second.type == type && it->second.count == count &&
+        memcmp(it->second.data.data(), value, bytes) == 0) {
+        ms_callStats.uniformsSkipped++;
+        return false;
+    }
+    ms_callStats.uniformsIssued++;
+
+    // An array upload also sets the elements after index, which may have
+    // been shadowed through their own locations, and an earlier array may
+    // reach into index; neither shadow is valid any more.
+    if (count > 1)
+        m_uniforms.erase(m_uniforms.upper_bound(index), m_uniforms.lower_bound(index + count));
+    it = m_uniforms.lower_bound(index);
+    if (it != m_uniforms.begin()) {
+        std::map<GLint, UniformValue>::iterator previous = it;
+        --previous;
+        if (previous->first + previous->second.count > index)
+            m_uniforms.erase(previous);
+    }
+
+    UniformValue& shadow = m_uniforms[index];
+    shadow.type = type;
+    shadow.count = count;
+    shadow.data.assign(static_cast<const char*>(value), static_cast<const char*>(value) + bytes);
+    return true;
 }
 
 bool NvGLSLProgram::checkCompileError(GLuint shader, int32_t target)
@@ -185,6 +351,7 @@ GLuint NvGLSLProgram::compileProgram(const char *vsource, const char *fsource)
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
 
+    bindAttribLocations(program);
     glLinkProgram(program);
 
     // check if program linked
@@ -219,8 +386,10 @@ GLuint NvGLSLProgram::compileProgram(ShaderSourceItem* src, int32_t count)
         GLuint shader = glCreateShader(src[i].type);
         glShaderSource(shader, 1, &(src[i].src), 0);
         glCompileShader(shader);
-        if (!checkCompileError(shader, src[i].type))
+        if (!checkCompileError(shader, src[i].type)) {
+            glDeleteProgram(program);
             return 0;
+        }
 
         glAttachShader(program, shader);
 
@@ -228,6 +397,13 @@ GLuint NvGLSLProgram::compileProgram(ShaderSourceItem* src, int32_t count)
         glDeleteShader(shader);
     }
 
+#if !defined(EMSCRIPTEN) && !defined(USE_REGAL) && !defined(ANDROID)
+    // Without the hint the driver need not keep a binary to hand out.
+    if (ms_binaryCache && programBinariesSupported())
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
+
+    bindAttribLocations(program);
     glLinkProgram(program);
 
     // check if program linked
@@ -253,8 +429,89 @@ GLuint NvGLSLProgram::compileProgram(ShaderSourceItem* src, int32_t count)
     return program;
 }
 
+void NvGLSLProgram::bindAttribLocations(GLuint program)
+{
+    for (size_t i = 0; i < m_attribLocations.size(); i++)
+        glBindAttribLocation(program, GLuint(i), m_attribLocations[i].c_str());
+}
+
+GLuint NvGLSLProgram::loadProgram(ShaderSourceItem* src, int32_t count)
+{
+#if defined(EMSCRIPTEN) || defined(USE_REGAL)
+    return compileProgram(src, count);
+#else
+    NvGLSLProgramCache* cache = ms_binaryCache;
+    if (!cache || !programBinariesSupported())
+        return compileProgram(src, count);
+
+    // The attribute locations are part of the binary, and so of the key; they
+    // go in as one more stage, of type 0.
+    std::vector<int32_t> types(count);
+    std::vector<const char*> sources(count);
+    for (int32_t i = 0; i < count; i++) {
+        types[i] = src[i].type;
+        sources[i] = src[i].src;
+    }
+    std::string attribLocations;
+    if (!m_attribLocations.empty()) {
+        for (size_t i = 0; i < m_attribLocations.size(); i++)
+            attribLocations += m_attribLocations[i] + '\n';
+        types.push_back(0);
+        sources.push_back(attribLocations.c_str());
+    }
+    const uint64_t key = NvGLSLProgramCache::computeKey(driverIdentity(), types.data(), sources.data(), int32_t(types.size()));
+
+    NvGLSLProgramBinary binary;
+    bool rejected = false;
+    Clock::time_point start = Clock::now();
+    if (cache->load(key, binary)) {
+        GLuint program = glCreateProgram();
+        programBinary(program, binary.format, binary.data.data(), GLsizei(binary.data.size()));
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (success) {
+            cache->countHit(secondsSince(start), binary.compileSeconds);
+            return program;
+        }
+
+        // A driver update that kept its version strings, usually; the
+        // binary is rebuilt from source.
+        glDeleteProgram(program);
+        while (glGetError() != GL_NO_ERROR) {}
+        cache->remove(key);
+        rejected = true;
+        start = Clock::now();
+    }
+
+    GLuint program = compileProgram(src, count);
+    const float compileSeconds = secondsSince(start);
+    cache->countMiss(compileSeconds, rejected);
+    if (!program)
+        return 0;
+
+    GLint length = 0;
+    glGetProgramiv(program, 0x8741 /* GL_PROGRAM_BINARY_LENGTH */, &length);
+    if (length > 0) {
+        GLsizei written = 0;
+        GLenum format = 0;
+        binary.data.resize(length);
+        getProgramBinary(program, length, &written, &format, binary.data.data());
+        binary.data.resize(written > 0 ? written : 0);
+        binary.format = format;
+        binary.compileSeconds = compileSeconds;
+        if (!binary.data.empty() && !cache->store(key, binary)) {
+            LOGI("Could not write program binary %s", cache->getPath(key).c_str());
+        }
+    }
+    return program;
+#endif
+}
+
 bool NvGLSLProgram::relink()
 {
+    // Linking resets every uniform.
+    m_uniforms.clear();
+    bindAttribLocations(m_program);
     glLinkProgram(m_program);
 
     // check if program linked
@@ -320,7 +577,7 @@ void NvGLSLProgram::bindTexture2D(const char *name, int32_t unit, GLuint tex)
 {
     GLint loc = getUniformLocation(name, false);
     if (loc >= 0) {
-        glUniform1i(loc, unit);
+        setUniform1i(loc, unit);
         glActiveTexture(GL_TEXTURE0 + unit);
         glBindTexture(GL_TEXTURE_2D, tex);
     }
@@ -328,7 +585,7 @@ void NvGLSLProgram::bindTexture2D(const char *name, int32_t unit, GLuint tex)
 
 void NvGLSLProgram::bindTexture2D(GLint index, int32_t unit, GLuint tex)
 {
-    glUniform1i(index, unit);
+    setUniform1i(index, unit);
     glActiveTexture(GL_TEXTURE0 + unit);
     glBindTexture(GL_TEXTURE_2D, tex);
 }
@@ -337,7 +594,7 @@ void NvGLSLProgram::bindTextureArray(const char *name, int32_t unit, GLuint tex)
 {
     GLint loc = getUniformLocation(name, false);
     if (loc >= 0) {
-        glUniform1i(loc, unit);
+        setUniform1i(loc, unit);
         glActiveTexture(GL_TEXTURE0 + unit);
         glBindTexture(0x8c1a, tex); // GL_TEXTURE_2D_ARRAY
     }
@@ -345,7 +602,7 @@ void NvGLSLProgram::bindTextureArray(const char *name, int32_t unit, GLuint tex)
 
 void NvGLSLProgram::bindTextureArray(GLint index, int32_t unit, GLuint tex)
 {
-    glUniform1i(index, unit);
+    setUniform1i(index, unit);
     glActiveTexture(GL_TEXTURE0 + unit);
     glBindTexture(0x8c1a, tex); // GL_TEXTURE_2D_ARRAY
 
@@ -356,7 +613,7 @@ NvGLSLProgram::setUniform1i(const char *name, int32_t value)
 {
     GLint loc = getUniformLocation(name, false);
     if (loc >= 0) {
-        glUniform1i(loc, value);
+        setUniform1i(loc, value);
     }
 }
 
@@ -364,7 +621,8 @@ void
 NvGLSLProgram::setUniform1i(GLint index, int32_t value)
 {
     if (index >= 0) {
-        glUniform1i(index, value);
+        if (shadowUniform(index, GL_INT, 1, &value, sizeof(value)))
+            glUniform1i(index, value);
     }
 }
 
@@ -373,7 +631,7 @@ NvGLSLProgram::setUniform2i(const char *name, int32_t x, int32_t y)
 {
     GLint loc = getUniformLocation(name, false);
     if (loc >= 0) {
-        glUniform2i(loc, x, y);
+        setUniform2i(loc, x, y);
     }
 }
 
@@ -381,7 +639,9 @@ void
 NvGLSLProgram::setUniform2i(GLint index, int32_t x, int32_t y)
 {
     if (index >= 0) {
-        glUniform2i(index, x, y);
+        const int32_t value[] = { x, y };
+        if (shadowUniform(index, GL_INT_VEC2, 1, value, sizeof(value)))
+            glUniform2i(index, x, y);
     }
 }
 
@@ -390,7 +650,7 @@ NvGLSLProgram::setUniform3i(const char *name, int32_t x, int32_t y, int32_t z)
 {
     GLint loc = getUniformLocation(name, false);
     if (loc >= 0) {
-        glUniform3i(loc, x, y, z);
+        setUniform3i(loc, x, y, z);
     }
 }
 
@@ -398,7 +658,9 @@ void
 NvGLSLProgram::setUniform3i(GLint index, int32_t x, int32_t y, int32_t z)
 {
     if (index >= 0) {
-        glUniform3i(index, x, y, z);
+        const int32_t value[] = { x, y, z };
+        if (shadowUniform(index, GL_INT_VEC3, 1, value, sizeof(value)))
+            glUniform3i(index, x, y, z);
     }
 }
 
@@ -407,7 +669,7 @@ NvGLSLProgram::setUniform1f(const char *name, float value)
 {
     GLint loc = getUniformLocation(name, false);
     if (loc >= 0) {
-        glUniform1f(loc, value);
+        setUniform1f(loc, value);
     }
 }
 
@@ -415,7 +677,8 @@ void
 NvGLSLProgram::setUniform1f(GLint index, float value)
 {
     if (index >= 0) {
-        glUniform1f(index, value);
+        if (shadowUniform(index, GL_FLOAT, 1, &value, sizeof(value)))
+            glUniform1f(index, value);
     }
 }
 
@@ -424,7 +687,7 @@ NvGLSLProgram::setUniform2f(const char *name, float x, float y)
 {
     GLint loc = getUniformLocation(name, false);
     if (loc >= 0) {
-        glUniform2f(loc, x, y);
+        setUniform2f(loc, x, y);
     }
 }
 
@@ -432,7 +695,9 @@ void
 NvGLSLProgram::setUniform2f(GLint index, float x, float y)
 {
     if (index >= 0) {
-        glUniform2f(index, x, y);
+        const float value[] = { x, y };
+        if (shadowUniform(index, GL_FLOAT_VEC2, 1, value, sizeof(value)))
+            glUniform2f(index, x, y);
     }
 }
 
@@ -441,7 +706,7 @@ NvGLSLProgram::setUniform3f(const char *name, float x, float y, float z)
 {
     GLint loc = getUniformLocation(name, false);
     if (loc >= 0) {
-        glUniform3f(loc, x, y, z);
+        setUniform3f(loc, x, y, z);
     }
 }
 
@@ -449,7 +714,9 @@ void
 NvGLSLProgram::setUniform3f(GLint index, float x, float y, float z)
 {
     if (index >= 0) {
-        glUniform3f(index, x, y, z);
+        const float value[] = { x, y, z };
+        if (shadowUniform(index, GL_FLOAT_VEC3, 1, value, sizeof(value)))
+            glUniform3f(index, x, y, z);
     }
 }
 
@@ -458,7 +725,7 @@ NvGLSLProgram::setUniform4f(const char *name, float x, float y, float z, float w
 {
     GLint loc = getUniformLocation(name, false);
     if (loc >= 0) {
-        glUniform4f(loc, x, y, z, w);
+        setUniform4f(loc, x, y, z, w);
     }
 }
 
@@ -466,7 +733,9 @@ void
 NvGLSLProgram::setUniform4f(GLint index, float x, float y, float z, float w)
 {
     if (index >= 0) {
-        glUniform4f(index, x, y, z, w);
+        const float value[] = { x, y, z, w };
+        if (shadowUniform(index, GL_FLOAT_VEC4, 1, value, sizeof(value)))
+            glUniform4f(index, x, y, z, w);
     }
 }
 
@@ -475,7 +744,7 @@ NvGLSLProgram::setUniform3fv(const char *name, const float *value, int32_t count
 {
     GLint loc = getUniformLocation(name, false);
     if (loc >= 0) {
-        glUniform3fv(loc, count, value);
+        setUniform3fv(loc, value, count);
     }
 
 }
@@ -484,7 +753,8 @@ void
 NvGLSLProgram::setUniform3fv(GLint index, const float *value, int32_t count)
 {
     if (index >= 0) {
-        glUniform3fv(index, count, value);
+        if (shadowUniform(index, GL_FLOAT_VEC3, count, value, 3 * count * sizeof(float)))
+            glUniform3fv(index, count, value);
     }
 
 }
@@ -494,7 +764,7 @@ NvGLSLProgram::setUniform4fv(const char *name, const float *value, int32_t count
 {
     GLint loc = getUniformLocation(name, false);
     if (loc >= 0) {
-        glUniform4fv(loc, count, value);
+        setUniform4fv(loc, value, count);
     }
 }
 
@@ -502,7 +772,8 @@ void
 NvGLSLProgram::setUniform4fv(GLint index, const float *value, int32_t count)
 {
     if (index >= 0) {
-        glUniform4fv(index, count, value);
+        if (shadowUniform(index, GL_FLOAT_VEC4, count, value, 4 * count * sizeof(float)))
+            glUniform4fv(index, count, value);
     }
 }
 
@@ -511,7 +782,7 @@ NvGLSLProgram::setUniformMatrix4fv(const char *name, float *m, int32_t count, bo
 {
     GLint loc = getUniformLocation(name, false);
     if (loc >= 0) {
-        glUniformMatrix4fv(loc, count, transpose, m);
+        setUniformMatrix4fv(loc, m, count, transpose);
     }
 }
 
@@ -519,6 +790,8 @@ void
 NvGLSLProgram::setUniformMatrix4fv(GLint index, float *m, int32_t count, bool transpose)
 {
     if (index >= 0) {
-        glUniformMatrix4fv(index, count, transpose, m);
+        const uint32_t type = GL_FLOAT_MAT4 | (transpose ? 0x80000000u : 0);
+        if (shadowUniform(index, type, count, m, 16 * count * sizeof(float)))
+            glUniformMatrix4fv(index, count, transpose, m);
     }
 }
@@ -0,0 +1,188 @@
+//----------------------------------------------------------------------------------
+// File:        NvGLUtils/NvGLSLProgramCache.cpp
+// SDK Version: v1.2 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+/* On-disk cache of GLSL program binaries */
+#include "NvGLUtils/NvGLSLProgramCache.h"
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+static FILE* openFile(const std::string& path, const char* mode) {
+#ifdef _WIN32
+    FILE* fp = NULL;
+    if (fopen_s(&fp, path.c_str(), mode) != 0)
+        return NULL;
+    return fp;
+#else
+    return fopen(path.c_str(), mode);
+#endif
+}
+
+NvGLSLProgramCache::NvGLSLProgramCache(const char* directory)
+    : m_directory(directory ? directory : "") {
+    memset(&m_stats, 0, sizeof(m_stats));
+    if (m_directory.empty())
+        m_directory = ".";
+    // Fails harmlessly if the directory exists; store reports any other problem.
+#ifdef _WIN32
+    _mkdir(m_directory.c_str());
+#else
+    mkdir(m_directory.c_str(), 0755);
+#endif
+}
+
+uint64_t NvGLSLProgramCache::hash(const void* data, size_t length, uint64_t seed) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint64_t NvGLSLProgramCache::computeKey(const std::string& driver, const int32_t* types, const char* const* sources, int32_t count) {
+    // Lengths go in too, so that moving text from one stage to the next
+    // changes the key.
+    uint64_t length = driver.size();
+    uint64_t key = hash(&length, sizeof(length));
+    key = hash(driver.data(), driver.size(), key);
+    for (int32_t i = 0; i < count; i++) {
+        length = strlen(sources[i]);
+        key = hash(&types[i], sizeof(types[i]), key);
+        key = hash(&length, sizeof(length), key);
+        key = hash(sources[i], size_t(length), key);
+    }
+    return key;
+}
+
+std::string NvGLSLProgramCache::getPath(uint64_t key) const {
+    char name[32];
+    sprintf(name, "/%08x%08x.nvpb", uint32_t(key >> 32), uint32_t(key));
+    return m_directory + name;
+}
+
+void NvGLSLProgramCache::encode(uint64_t key, const NvGLSLProgramBinary& binary, std::vector<char>& file) {
+    NvGLSLProgramCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "NVPB", 4);
+    header.version = NvGLSLProgramCacheHeader::Version;
+    header.key = key;
+    header.binaryFormat = binary.format;
+    header.binaryLength = uint32_t(binary.data.size());
+    header.checksum = hash(binary.data.data(), binary.data.size());
+    header.compileSeconds = binary.compileSeconds;
+
+    file.resize(sizeof(header) + binary.data.size());
+    memcpy(&file[0], &header, sizeof(header));
+    if (!binary.data.empty())
+        memcpy(&file[sizeof(header)], binary.data.data(), binary.data.size());
+}
+
+bool NvGLSLProgramCache::decode(uint64_t key, const char* file, size_t length, NvGLSLProgramBinary& binary) {
+    NvGLSLProgramCacheHeader header;
+    if (!file || length < sizeof(header))
+        return false;
+    memcpy(&header, file, sizeof(header));
+    if (memcmp(header.magic, "NVPB", 4) != 0 || header.version != NvGLSLProgramCacheHeader::Version ||
+        header.key != key || header.binaryLength != length - sizeof(header) || header.binaryLength == 0)
+        return false;
+
+    const char* data = file + sizeof(header);
+    if (hash(data, header.binaryLength) != header.checksum)
+        return false;
+    binary.format = header.binaryFormat;
+    binary.compileSeconds = header.compileSeconds;
+    binary.data.assign(data, data + header.binaryLength);
+    return true;
+}
+
+bool NvGLSLProgramCache::load(uint64_t key, NvGLSLProgramBinary& binary) const {
+    FILE* fp = openFile(getPath(key), "rb");
+    if (!fp)
+        return false;
+    std::vector<char> file;
+    char buffer[16384];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+        file.insert(file.end(), buffer, buffer + read);
+    fclose(fp);
+    return decode(key, file.data(), file.size(), binary);
+}
+
+bool NvGLSLProgramCache::store(uint64_t key, const NvGLSLProgramBinary& binary) {
+    std::vector<char> file;
+    encode(key, binary, file);
+
+    const std::string path = getPath(key);
+    const std::string temporary = path + ".tmp";
+    FILE* fp = openFile(temporary, "wb");
+    if (!fp)
+        return false;
+    const bool written = fwrite(file.data(), 1, file.size(), fp) == file.size();
+    if (fclose(fp) != 0 || !written) {
+        ::remove(temporary.c_str());
+        return false;
+    }
+    // rename does not replace an existing file on Windows.
+    ::remove(path.c_str());
+    if (rename(temporary.c_str(), path.c_str()) != 0) {
+        ::remove(temporary.c_str());
+        return false;
+    }
+    m_stats.stored++;
+    return true;
+}
+
+void NvGLSLProgramCache::remove(uint64_t key) {
+    ::remove(getPath(key).c_str());
+}
+
+void NvGLSLProgramCache::countHit(float loadSeconds, float compileSeconds) {
+    m_stats.hits++;
+    m_stats.loadSeconds += loadSeconds;
+    m_stats.savedSeconds += compileSeconds - loadSeconds;
+}
+
+void NvGLSLProgramCache::countMiss(float compileSeconds, bool rejected) {
+    m_stats.misses++;
+    m_stats.rejected += rejected ? 1 : 0;
+    m_stats.compileSeconds += compileSeconds;
+}
@@ -0,0 +1,108 @@
+//----------------------------------------------------------------------------------
+// File:        NvGLUtils/NvGLSLProgramVariants.cpp
+// SDK Version: v1.2 
+// Email:       gameworks@nvidia.com
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2014, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+/* Programs compiled from one source with different #defines */
+#include "NvGLUtils/NvGLSLProgramVariants.h"
+#include "NvGLUtils/NvGLSLProgram.h"
+#include "NvAssetLoader/NvAssetLoader.h"
+
+NvGLSLProgramVariants::NvGLSLProgramVariants()
+    : m_strict(false) {
+}
+
+NvGLSLProgramVariants::~NvGLSLProgramVariants() {
+    clear();
+}
+
+bool NvGLSLProgramVariants::setSourceFromFiles(const char* vertFilename, const char* fragFilename, bool strict) {
+    int32_t len;
+    char* vertSrc = NvAssetLoaderRead(vertFilename, len);
+    char* fragSrc = NvAssetLoaderRead(fragFilename, len);
+    if (!vertSrc || !fragSrc) {
+        NvAssetLoaderFree(vertSrc);
+        NvAssetLoaderFree(fragSrc);
+        return false;
+    }
+
+    setSourceFromStrings(vertSrc, fragSrc, strict);
+
+    NvAssetLoaderFree(vertSrc);
+    NvAssetLoaderFree(fragSrc);
+    return true;
+}
+
+void NvGLSLProgramVariants::setSourceFromStrings(const char* vertSrc, const char* fragSrc, bool strict) {
+    clear();
+    m_vertSrc = vertSrc;
+    m_fragSrc = fragSrc;
+    m_strict = strict;
+}
+
+void NvGLSLProgramVariants::setAttribLocations(const char* const* names, int32_t count) {
+    m_attribLocations.assign(names, names + count);
+}
+
+NvGLSLProgram* NvGLSLProgramVariants::get(const char* const* defines, int32_t count) {
+    std::string name;
+    for (int32_t i = 0; i < count; i++) {
+        name += defines[i];
+        name += '\n';
+    }
+
+    std::map<std::string, NvGLSLProgram*>::iterator it = m_programs.find(name);
+    if (it != m_programs.end())
+        return it->second;
+
+    const std::string vertSrc = NvGLSLProgram::addDefines(m_vertSrc.c_str(), defines, count);
+    const std::string fragSrc = NvGLSLProgram::addDefines(m_fragSrc.c_str(), defines, count);
+
+    std::vector<const char*> attribLocations(m_attribLocations.size());
+    for (size_t i = 0; i < m_attribLocations.size(); i++)
+        attribLocations[i] = m_attribLocations[i].c_str();
+
+    NvGLSLProgram* program = new NvGLSLProgram;
+    program->setAttribLocations(attribLocations.data(), int32_t(attribLocations.size()));
+    if (!program->setSourceFromStrings(vertSrc.c_str(), fragSrc.c_str(), m_strict)) {
+        delete program;
+        program = NULL;
+    }
+    m_programs[name] = program;
+    return program;
+}
+
+void NvGLSLProgramVariants::clear() {
+    for (std::map<std::string, NvGLSLProgram*>::iterator it = m_programs.begin(); it != m_programs.end(); ++it)
+        delete it->second;
+    m_programs.clear();
+}
@@ -36,7 +36,7 @@
 #include <algorithm>
 
 #include "NvGLUtils/NvImage.h"
-#include "BlockDXT.h"
+#include "DXTDecoder.h"
 
 #include "NvGLEnums.h"
 
@@ -54,6 +54,7 @@ NvImage::FormatInfo NvImage::formatTable[] = {
 bool NvImage::upperLeftOrigin = true;
 NvGfxAPIVersion NvImage::m_gfxAPIVersion = NvGfxAPIVersionGL4_3();
 bool NvImage::m_expandDXT = true;
+NvImage::ParallelForFunction NvImage::m_parallelFor;
 
 //
 //
@@ -347,10 +348,6 @@ void NvImage::componentSwapSurface(uint8_t *surf, int32_t width, int32_t height,
 
 }    
 
-static inline int32_t min(int32_t a, int32_t b) {
-    return (a <= b) ? a : b;
-}
-
 //
 //
 ////////////////////////////////////////////////////////////
@@ -358,91 +355,42 @@ uint8_t* NvImage::expandDXT(uint8_t *surf, int32_t width, int32_t height, int32_
 {
     depth = (depth) ? depth : 1;
 
-    uint32_t* dest = new uint32_t[width * height * depth];
-    uint32_t* plane = dest;
-
-    int32_t bh = (height + 3) / 4;
-    int32_t bw = (width + 3) / 4;
-
-    if (_format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) {
-        for (int32_t k = 0; k < depth; k++) {
-
-            for (int32_t j = 0; j < bh; j++) {
-                int32_t yBlockSize = min(4, height - 4 * j);
-
-                for (int32_t i = 0; i < bw; i++) {
-                    int32_t xBlockSize = min(4, width - 4 * i);
-                    nv::BlockDXT1* block = (nv::BlockDXT1*)surf;
-                    nv::ColorBlock color;
-
-                    block->decodeBlock(&color);
-
-                    // Write color block.
-                    for (int32_t y = 0; y < yBlockSize; y++) {
-                        for (int32_t x = 0; x < xBlockSize; x++) {
-                            plane[4*i+x + (4*j+y)*width] = (uint32_t)color.color(x, y);
-                        }
-                    }
-
-                    surf += sizeof(nv::BlockDXT1); // 64bits
-                }
-            }
-
-            plane += width * height;
-        }
-    } else if (_format == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT) {
-        for (int32_t k = 0; k < depth; k++) {
-
-            for (int32_t j = 0; j < bh; j++) {
-                int32_t yBlockSize = min(4, height - 4 * j);
-
-                for (int32_t i = 0; i < bw; i++) {
-                    int32_t xBlockSize = min(4, width - 4 * i);
-                    nv::BlockDXT3* block = (nv::BlockDXT3*)surf;
-                    nv::ColorBlock color;
-
-                    block->decodeBlock(&color);
-
-                    // Write color block.
-                    for (int32_t y = 0; y < yBlockSize; y++) {
-                        for (int32_t x = 0; x < xBlockSize; x++) {
-                            plane[4*i+x + (4*j+y)*width] = (uint32_t)color.color(x, y);
-                        }
-                    }
-
-                    surf += sizeof(nv::BlockDXT3); // 64bits
-                }
-            }
-
-            plane += width * height;
-        }
-    } else {
-        for (int32_t k = 0; k < depth; k++) {
-
-            for (int32_t j = 0; j < bh; j++) {
-                int32_t yBlockSize = min(4U, height - 4 * j);
-
-                for (int32_t i = 0; i < bw; i++) {
-                    int32_t xBlockSize = min(4, width - 4 * i);
-                    nv::BlockDXT5* block = (nv::BlockDXT5*)surf;
-                    nv::ColorBlock color;
-
-                    block->decodeBlock(&color);
-
-                    // Write color block.
-                    for (int32_t y = 0; y < yBlockSize; y++) {
-                        for (int32_t x = 0; x < xBlockSize; x++) {
-                            plane[4*i+x + (4*j+y)*width] = (uint32_t)color.color(x, y);
-                        }
-                    }
+    nv::DXTFormat format;
+    if (_format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT)
+        format = nv::DXTFormat_DXT1;
+    else if (_format == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT)
+        format = nv::DXTFormat_DXT3;
+    else
+        format = nv::DXTFormat_DXT5;
 
-                    surf += sizeof(nv::BlockDXT5); // 64bits
-                }
-            }
+    uint32_t* dest = new uint32_t[width * height * depth];
 
-            plane += width * height;
+    const int32_t bh = (height + 3) / 4;
+    const int32_t bw = (width + 3) / 4;
+    const size_t planeBytes = size_t(bw) * bh * nv::blockSizeDXT(format);
+    const size_t planePixels = size_t(width) * height;
+
+    // Rows of blocks decode independently, each into its own rows of dest,
+    // so the block rows of all planes form one range to split up
+    const uint8_t* blocks = surf;
+    RangeFunction decodeRows = [=](size_t begin, size_t end) {
+        while (begin < end) {
+            const size_t plane = begin / bh;
+            const size_t planeEnd = std::min(end, (plane + 1) * bh);
+            nv::decodeDXTBlockRows(format, blocks + plane * planeBytes, width, height,
+                int32_t(begin - plane * bh), int32_t(planeEnd - plane * bh), dest + plane * planePixels);
+            begin = planeEnd;
         }
-    }
+    };
+
+    // Ranges of about 64K pixels; smaller surfaces (most mip levels) are not
+    // worth handing to other threads
+    const size_t blockRows = size_t(bh) * depth;
+    const size_t grainSize = std::max<size_t>(1, 16384 / bw);
+    if (m_parallelFor && blockRows > grainSize)
+        m_parallelFor(blockRows, grainSize, decodeRows);
+    else
+        decodeRows(0, blockRows);
 
     return (uint8_t*)dest;
 }
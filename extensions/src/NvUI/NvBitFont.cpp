@@ -1501,7 +1501,7 @@ void NvBFRestoreGLState()
 
     TestPrintGLError("Error 0x%x in RestoreState @ start...\n");
 
-    glUseProgram(gStateBlock.programBound);
+    NvGLSLProgram::useProgram(gStateBlock.programBound);
 
     // set buffers first, in case attribs bound to them...
     glBindBuffer(GL_ARRAY_BUFFER, gStateBlock.vboBound);
@@ -406,7 +406,7 @@ void NvUIGraphic::StaticCleanup()
     {
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-        glUseProgram(0);
+        NvGLSLProgram::useProgram(0);
 
         delete ms_shader.m_program;
         ms_shader.m_program = 0;
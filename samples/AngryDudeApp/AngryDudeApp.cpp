@@ -12,29 +12,42 @@
 /// updateSkinning is templatized (T being either nv::matrix4f or DualQuaternion)
 /// in order to avoid code duplication. The only difference between matrix and dual
 /// quaternion approaches (in this implementation) is in the mathematical object
-/// used to represent rigid body transformations. Since we store bone offsets
-/// with matrices, we have to convert those to dual quaternions (toT<T>())
-/// when skinning with dual quaternions.
+/// used to represent rigid body transformations. Bone offsets and node default
+/// transforms are stored with matrices; SkeletonCache converts them to dual
+/// quaternions once at load time, so per frame only animated nodes (and their
+/// descendants) are evaluated.
 
 #include "AngryDudeApp.hpp"
 
 #include "NvUI/NvTweakBar.h"
 #include "NvAppBase/NvFramerateCounter.h"
+#include "NvAppBase/NvFrameTrace.h"
 #include "NV/NvStopWatch.h"
 #include "NvAssetLoader/NvAssetLoader.h"
+#include "NvAssetLoader/NvAssetLoaderAsync.h"
 #include "NvGLUtils/NvGLSLProgram.h"
+#include "NvGLUtils/NvGLSLProgramCache.h"
+#include "NvGLUtils/NvGLSLProgramVariants.h"
 #include "NvGLUtils/NvImage.h"
 #include "NV/NvLogs.h"
 
 #include "Skinning.hpp"
 #include "DualQuaternion.hpp"
-#include "cereal/archives/binary.hpp"
-#include "cereal/types/vector.hpp"
-#include "cereal/types/string.hpp"
+#include "Animation.hpp"
+#include "Skeleton.hpp"
+#include "CompressedAnimation.hpp"
+#include "BakedAnimation.hpp"
+#include "AnimationBlending.hpp"
+#include "Crowd.hpp"
+#include "BinaryModel.hpp"
 
 #include <fstream>
+#include <sstream>
+#include <cmath>
 #include <utility>
 #include <cstddef>
+#include <memory>
+#include <algorithm>
 
 void AngryDudeApp::draw()
 {
@@ -48,6 +61,12 @@ void AngryDudeApp::draw()
     glActiveTexture(GL_TEXTURE0);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+    // Still loading, see onModelLoaded.
+    if (!mModel)
+        return;
+
+    streamTextures();
+
     const float fov   = 45.0f;
     const float ratio = static_cast<GLfloat>(m_width) / m_height;
     nv::perspective(mModelViewProjection, fov, ratio, 0.1f, 100.0f);
@@ -55,47 +74,24 @@ void AngryDudeApp::draw()
     scale.set_scale(nv::vec3f(0.3f, 0.3f, 0.3f));
     mModelViewProjection *= m_transformer->getModelViewMat();
     mModelViewProjection *= scale;
-    mSkinningProgram->enable();
-    mSkinningProgram->setUniformMatrix4fv(mModelViewProjectionLocation, mModelViewProjection._array, 1, false);
-    mSkinningProgram->setUniform1i(mUseDQBLocation, mUseDQB);
-    mSkinningProgram->disable();
+
+    if (mCrowdMode) {
+        if (mUseDQB)
+            drawCrowd<DualQuaternion>();
+        else
+            drawCrowd<nv::matrix4f>();
+        return;
+    }
 
     if (mUseDQB)
         updateSkinning<DualQuaternion>();
     else
         updateSkinning<nv::matrix4f>();
 
-    mSkinningProgram->enable();
-    glEnableVertexAttribArray(mPositionAttribute);
-    glEnableVertexAttribArray(mNormalAttribute);
-    glEnableVertexAttribArray(mBonesAttribute);
-    glEnableVertexAttribArray(mUVAttribute);
-
-    for (const MeshGL& mesh: mModel->meshesGL) {
-        mSkinningProgram->bindTexture2D(mAlbedoSampler, 0, mesh.albedoTextureId);
-        glBindBuffer(GL_ARRAY_BUFFER,         mesh.vertexBufferId);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBufferId);
-
-        #define ATTR_OFFSET(type, member) reinterpret_cast<GLvoid*>(offsetof(type, member))
-        glVertexAttribPointer(mPositionAttribute, 3, GL_FLOAT, false, sizeof(Vertex), ATTR_OFFSET(Vertex, position));
-        glVertexAttribPointer(mNormalAttribute,   3, GL_FLOAT, false, sizeof(Vertex), ATTR_OFFSET(Vertex, normal));
-        glVertexAttribPointer(mBonesAttribute,    4, GL_FLOAT, false, sizeof(Vertex), ATTR_OFFSET(Vertex, bones));
-        glVertexAttribPointer(mUVAttribute,       2, GL_FLOAT, false, sizeof(Vertex), ATTR_OFFSET(Vertex, uv));
-        #undef ATTR_OFFSET
-
-        glDrawElements(GL_TRIANGLES, mesh.numIndices, GL_UNSIGNED_SHORT, 0);
-        CHECK_GL_ERROR();
-    }
-
-    glDisableVertexAttribArray(mPositionAttribute);
-    glDisableVertexAttribArray(mNormalAttribute);
-    glDisableVertexAttribArray(mBonesAttribute);
-    glDisableVertexAttribArray(mUVAttribute);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    mSkinningProgram->disable();
+    setSkinningState(mModelViewProjection, mModelPalette.data());
+    drawMeshes();
 
-    if (mDrawSkeleton) {
+    if (mDrawSkeleton && mModel->bones.size() <= 60) {
         glDisable(GL_DEPTH_TEST);
         mDebugProgram->enable();
         mDebugProgram->setUniformMatrix4fv(mDebugMVPLocation, mModelViewProjection._array, 1, false);
@@ -111,46 +107,18 @@ void AngryDudeApp::draw()
 
 nv::vec3f AngryDudeApp::getInterpolatedTranslation(int nodeAnimationIdx)
 {
-    const NodeAnimation& anim = mModel->nodeAnimations[nodeAnimationIdx];
-    size_t index0 = 0;
-    size_t index1 = 0;
-    while (index1 < anim.translationKeys.size() && anim.translationKeys[index1].time < mTime)
-        index1++;
-    if (index1 == anim.translationKeys.size())
-        index1 = 0;
-    if (index1 > 0)
-        index0 = index1-1;
-
-    const nv::vec4f& trans0 = anim.translationKeys[index0].value;
-    const nv::vec4f& trans1 = anim.translationKeys[index1].value;
-    const nv::vec3f  trans03 = nv::vec3f(trans0.x, trans0.y, trans0.z);
-    const nv::vec3f  trans13 = nv::vec3f(trans1.x, trans1.y, trans1.z);
-
-    const float t = (mTime - anim.translationKeys[index0].time) /
-                    (anim.translationKeys[index1].time - anim.translationKeys[index0].time);
-    return (1.f-t)*trans03 + t*trans13;
+    if (mUseCompressedAnimation)
+        return mCompressedClip.sampleTranslation(nodeAnimationIdx, mTime, mCompressedCursors[nodeAnimationIdx].translation);
+
+    return sampleTranslation(mModel->nodeAnimations[nodeAnimationIdx], mTime, mAnimationCursors[nodeAnimationIdx]);
 }
 
 nv::quaternionf AngryDudeApp::getInterpolatedRotation(int nodeAnimationIdx)
 {
-    const NodeAnimation& anim = mModel->nodeAnimations[nodeAnimationIdx];
-    size_t index0 = 0;
-    size_t index1 = 0;
-    while (index1 < anim.rotationKeys.size() && anim.rotationKeys[index1].time < mTime)
-        index1++;
-    if (index1 == anim.rotationKeys.size())
-        index1 = 0;
-    if (index1 > 0)
-        index0 = index1-1;
-
-    const nv::vec4f& rot0 = anim.rotationKeys[index0].value;
-    const nv::vec4f& rot1 = anim.rotationKeys[index1].value;
-    const nv::quaternionf rotq0 = nv::quaternionf(rot0.x, rot0.y, rot0.z, rot0.w);
-    const nv::quaternionf rotq1 = nv::quaternionf(rot1.x, rot1.y, rot1.z, rot1.w);
-
-    const float t = (mTime - anim.rotationKeys[index0].time) /
-                    (anim.rotationKeys[index1].time - anim.rotationKeys[index0].time);
-    return nv::slerp(rotq0, rotq1, t);
+    if (mUseCompressedAnimation)
+        return mCompressedClip.sampleRotation(nodeAnimationIdx, mTime, mCompressedCursors[nodeAnimationIdx].rotation);
+
+    return sampleRotation(mModel->nodeAnimations[nodeAnimationIdx], mTime, mAnimationCursors[nodeAnimationIdx]);
 }
 
 void AngryDudeApp::getAnimatedTransform(int nodeAnimationIdx, nv::matrix4f& animatedTransform)
@@ -202,79 +170,294 @@ nv::matrix4f identity()
     return nv::matrix4f();
 }
 
+template <>
+SkeletonPose<nv::matrix4f>& AngryDudeApp::getSkeletonPose<nv::matrix4f>()
+{
+    return mMatrixPose;
+}
+
+template <>
+SkeletonPose<DualQuaternion>& AngryDudeApp::getSkeletonPose<DualQuaternion>()
+{
+    return mDualQuaternionPose;
+}
+
+template <>
+std::vector<nv::matrix4f>& AngryDudeApp::getBakedTransforms<nv::matrix4f>()
+{
+    return mBakedMatrices;
+}
+
+template <>
+std::vector<DualQuaternion>& AngryDudeApp::getBakedTransforms<DualQuaternion>()
+{
+    return mBakedDualQuaternions;
+}
+
 template <typename T>
 void AngryDudeApp::updateSkinning()
 {
+    NV_TRACE_SCOPE("updateSkinning");
     mTime += mTimeScalar * getFrameDeltaTime();
-    const float animationDuration = 1.26f;
-    if (mTime > animationDuration)
-        mTime = mTime - animationDuration;
+    if (mTime > mAnimationDuration)
+        mTime = mTime - mAnimationDuration;
 
-    T boneTransformArray[60];
-    nv::matrix4f debugTransforms[60];
-    assert(60 > mModel->bones.size());
+    mModelPalette.resize(mModel->bones.size() * sizeof(T) / sizeof(float));
+    T* boneTransformArray = reinterpret_cast<T*>(mModelPalette.data());
+    mDebugTransforms.resize(mModel->bones.size());
     const T rootInverse = toT<T>(translation(nv::vec3f(0.f, -30.f, 0.f)));
 
-    typedef std::pair<int, T> NodeIdxCumulativeTransform;
-    std::vector<NodeIdxCumulativeTransform> breadth{std::make_pair(0, toT<T>(identity()))};
+    // Only animated nodes and their descendants change, see SkeletonCache.
+    SkeletonPose<T>& pose = getSkeletonPose<T>();
+    if (mUseBakedAnimation) {
+        // The clip under its additive upper body layer, see onModelLoaded.
+        // The players follow mTime rather than a clock of their own, so that
+        // switching sampling modes keeps the phase.
+        std::vector<T>& tracks = getBakedTransforms<T>();
+        float upperBodyTime = mTime + 0.5f * mAnimationDuration;
+        if (upperBodyTime > mAnimationDuration)
+            upperBodyTime = upperBodyTime - mAnimationDuration;
+        mAnimation.layers[0].players[0].time = mTime;
+        mAnimation.layers[1].players[0].time = upperBodyTime;
+        mAnimation.layers[1].weight = mUpperBodyWeight;
+        animationblending::evaluate(mAnimation, mAnimations, mBlendScratch, tracks.data());
+        for (int i: mSkeletonCache.animatedNodes)
+            pose.local[i] = tracks[mSkeleton.nodeAnimationIndices[i]];
+    } else {
+        for (int i: mSkeletonCache.animatedNodes)
+            getAnimatedTransform(mSkeleton.nodeAnimationIndices[i], pose.local[i]);
+    }
 
-    while (!breadth.empty()) {
-        std::vector<NodeIdxCumulativeTransform> children;
+    computeGlobalTransforms(mSkeleton, mSkeletonCache, pose);
 
-        for (const NodeIdxCumulativeTransform& nct: breadth) {
-            const ModelNode& node = mModel->modelNodes[nct.first];
-            T nodeTransform = toT<T>(node.defaultTransform);
-            if (node.nodeAnimationIdx != -1) {
-                getAnimatedTransform(node.nodeAnimationIdx, nodeTransform);
-            }
+    const std::vector<T>& boneOffsets = mSkeletonCache.get<T>().boneOffsets;
+    for (size_t boneIdx = 0; boneIdx < mModel->bones.size(); boneIdx++) {
+        const int i = mSkeletonCache.boneNodes[boneIdx];
+        if (i == -1)
+            continue;
+        const T boneGlobal = rootInverse * pose.global[i];
+        boneTransformArray[boneIdx] = boneGlobal * boneOffsets[boneIdx];
+        mDebugTransforms[boneIdx] = toT<nv::matrix4f>(boneGlobal);
+    }
 
-            const T& parentCumulativeTransform = nct.second;
-            const T cumulativeTransform = parentCumulativeTransform * nodeTransform;
+    // debug.vert is not partitioned; it takes 60 bones.
+    if (mModel->bones.size() <= 60) {
+        mDebugProgram->enable();
+        mDebugProgram->setUniformMatrix4fv(mDebugBonesLocation, reinterpret_cast<float*>(mDebugTransforms.data()), mModel->bones.size(), false);
+        mDebugProgram->disable();
+    }
+}
 
-            if (node.boneIdx != -1) {
-                const Bone& bone = mModel->bones[node.boneIdx];
-                boneTransformArray[node.boneIdx] = rootInverse * cumulativeTransform * toT<T>(bone.offset);
-                debugTransforms[node.boneIdx] = toT<nv::matrix4f>(rootInverse * cumulativeTransform);
+void AngryDudeApp::drawMeshes()
+{
+    NV_TRACE_SCOPE("drawMeshes");
+    glEnableVertexAttribArray(PositionAttribute);
+    glEnableVertexAttribArray(NormalAttribute);
+    glEnableVertexAttribArray(BonesAttribute);
+    glEnableVertexAttribArray(UVAttribute);
+    if (mUsePackedVertices)
+        glEnableVertexAttribArray(WeightsAttribute);
+
+    for (const MeshGL& mesh: mModel->meshesGL) {
+        if (!mesh.albedoTextureId)
+            continue;
+        glBindBuffer(GL_ARRAY_BUFFER,         mesh.vertexBufferId);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBufferId);
+
+        // Every variant has the same attribute locations, see createSkinningVariants.
+        #define ATTR_OFFSET(type, member) reinterpret_cast<GLvoid*>(offsetof(type, member))
+        if (mUsePackedVertices) {
+            // Decoded in skinning.vert, see PackedVertex.hpp.
+            glVertexAttribPointer(PositionAttribute, 3, GL_UNSIGNED_SHORT, true,  sizeof(PackedVertex), ATTR_OFFSET(PackedVertex, position));
+            glVertexAttribPointer(NormalAttribute,   2, GL_BYTE,           false, sizeof(PackedVertex), ATTR_OFFSET(PackedVertex, normal));
+            glVertexAttribPointer(BonesAttribute,    4, GL_UNSIGNED_BYTE,  false, sizeof(PackedVertex), ATTR_OFFSET(PackedVertex, bones));
+            glVertexAttribPointer(WeightsAttribute,  4, GL_UNSIGNED_BYTE,  false, sizeof(PackedVertex), ATTR_OFFSET(PackedVertex, weights));
+            glVertexAttribPointer(UVAttribute,       2, GL_UNSIGNED_SHORT, false, sizeof(PackedVertex), ATTR_OFFSET(PackedVertex, uv));
+        } else {
+            glVertexAttribPointer(PositionAttribute, 3, GL_FLOAT, false, sizeof(Vertex), ATTR_OFFSET(Vertex, position));
+            glVertexAttribPointer(NormalAttribute,   3, GL_FLOAT, false, sizeof(Vertex), ATTR_OFFSET(Vertex, normal));
+            glVertexAttribPointer(BonesAttribute,    4, GL_FLOAT, false, sizeof(Vertex), ATTR_OFFSET(Vertex, bones));
+            glVertexAttribPointer(UVAttribute,       2, GL_FLOAT, false, sizeof(Vertex), ATTR_OFFSET(Vertex, uv));
+        }
+        #undef ATTR_OFFSET
+
+        for (const MeshPartitionGL& partition: mesh.partitions) {
+            // A partition's vertices index its own palette, gathered from the
+            // model's; the variants upload it again for every partition.
+            if (!partition.bones.empty()) {
+                const size_t floatsPerBone = (mUseDQB ? sizeof(DualQuaternion) : sizeof(nv::matrix4f)) / sizeof(float);
+                mPartitionPalette.resize(partition.bones.size() * floatsPerBone);
+                for (size_t i = 0; i < partition.bones.size(); i++)
+                    std::copy(mPalette + partition.bones[i] * floatsPerBone, mPalette + (partition.bones[i] + 1) * floatsPerBone,
+                              mPartitionPalette.begin() + i * floatsPerBone);
+                mDrawPalette = mPartitionPalette.data();
+                mDrawPaletteBones = static_cast<int>(partition.bones.size());
+                mSkinningGeneration++;
             }
 
-            for (int childIndex: node.childrenIndices) {
-                children.push_back(std::make_pair(childIndex, cumulativeTransform));
+            for (const InfluenceBatch& batch: partition.batches) {
+                SkinningVariant* variant = useSkinningVariant(mSplitInfluences ? batch.maxInfluences : influencesplit::MaxInfluences);
+                if (!variant)
+                    continue;
+                variant->program->bindTexture2D(variant->albedoSampler, 0, mesh.albedoTextureId);
+                variant->program->setUniform3f(variant->positionOffsetLocation, mesh.bounds.offset.x, mesh.bounds.offset.y, mesh.bounds.offset.z);
+                variant->program->setUniform3f(variant->positionScaleLocation, mesh.bounds.scale.x, mesh.bounds.scale.y, mesh.bounds.scale.z);
+                glDrawElements(GL_TRIANGLES, GLsizei(batch.numIndices), GL_UNSIGNED_SHORT,
+                               reinterpret_cast<GLvoid*>(batch.firstIndex * sizeof(unsigned short)));
             }
         }
+        CHECK_GL_ERROR();
+    }
 
-        breadth = children;
+    glDisableVertexAttribArray(PositionAttribute);
+    glDisableVertexAttribArray(NormalAttribute);
+    glDisableVertexAttribArray(BonesAttribute);
+    glDisableVertexAttribArray(UVAttribute);
+    if (mUsePackedVertices)
+        glDisableVertexAttribArray(WeightsAttribute);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void AngryDudeApp::createSkinningVariants(int paletteSize)
+{
+    static const char* const attributes[] = { "position", "normal", "bones", "weights", "uv" };
+    static const char* const blendModes[] = { nullptr, "BLEND_DQ" };
+    static const char* const influences[] = { "MAX_INFLUENCES 1", "MAX_INFLUENCES 2", "MAX_INFLUENCES 3", "MAX_INFLUENCES 4" };
+
+    // The uniform array is no larger than the largest palette drawn.
+    std::ostringstream bones;
+    bones << "MAX_BONES " << std::max(paletteSize, 1);
+    const std::string maxBones = bones.str();
+
+    mSkinningPrograms->setAttribLocations(attributes, sizeof(attributes) / sizeof(attributes[0]));
+    for (int dq = 0; dq < 2; dq++) {
+        for (int n = 0; n < influencesplit::MaxInfluences; n++) {
+            const char* defines[4];
+            int numDefines = 0;
+            defines[numDefines++] = influences[n];
+            defines[numDefines++] = maxBones.c_str();
+            if (blendModes[dq])
+                defines[numDefines++] = blendModes[dq];
+            if (mUsePackedVertices)
+                defines[numDefines++] = "PACKED_VERTICES";
+
+            SkinningVariant& variant = mSkinningVariants[dq][n];
+            variant.program = mSkinningPrograms->get(defines, numDefines);
+            variant.generation = 0;
+            if (!variant.program) {
+                LOGE("Failed to build skinning.vert with %s%s\n", influences[n], dq ? ", BLEND_DQ" : "");
+                continue;
+            }
+            variant.modelViewProjectionLocation = variant.program->getUniformLocation("mvp");
+            variant.paletteLocation             = variant.program->getUniformLocation(dq ? "boneDualQuaternions" : "boneMatrices");
+            variant.positionOffsetLocation      = variant.program->getUniformLocation("positionOffset");
+            variant.positionScaleLocation       = variant.program->getUniformLocation("positionScale");
+            variant.albedoSampler               = variant.program->getUniformLocation("sampler0");
+        }
     }
+    mSkinningGeneration = 1;
+}
 
-    mSkinningProgram->enable();
-    if (std::is_same<T, DualQuaternion>::value)
-        mSkinningProgram->setUniform4fv(mBoneDualQuaternionsLocation, reinterpret_cast<float*>(&boneTransformArray[0]), mModel->bones.size()*2);
-    else
-        mSkinningProgram->setUniformMatrix4fv(mBoneMatricesLocation, reinterpret_cast<float*>(&boneTransformArray[0]), mModel->bones.size(), false);
-    mSkinningProgram->disable();
+void AngryDudeApp::setSkinningState(const nv::matrix4f& mvp, const float* palette)
+{
+    mSkinningMVP = mvp;
+    mPalette = palette;
+    mDrawPalette = palette;
+    mDrawPaletteBones = static_cast<int>(mModel->bones.size());
+    mSkinningGeneration++;
+}
 
-    mDebugProgram->enable();
-    mDebugProgram->setUniformMatrix4fv(mDebugBonesLocation, reinterpret_cast<float*>(&debugTransforms[0]), mModel->bones.size(), false);
-    mDebugProgram->disable();
+SkinningVariant* AngryDudeApp::useSkinningVariant(int maxInfluences)
+{
+    SkinningVariant& variant = mSkinningVariants[mUseDQB ? 1 : 0][maxInfluences - 1];
+    if (!variant.program)
+        return nullptr;
+    variant.program->enable();
+
+    // Each variant has uniforms of its own; they are brought up to date the
+    // first time it draws after setSkinningState.
+    if (variant.generation != mSkinningGeneration) {
+        float* palette = const_cast<float*>(mDrawPalette);
+        variant.program->setUniformMatrix4fv(variant.modelViewProjectionLocation, mSkinningMVP._array, 1, false);
+        if (mUseDQB)
+            variant.program->setUniform4fv(variant.paletteLocation, palette, mDrawPaletteBones*2);
+        else
+            variant.program->setUniformMatrix4fv(variant.paletteLocation, palette, mDrawPaletteBones, false);
+        variant.generation = mSkinningGeneration;
+    }
+    return &variant;
+}
+
+template <typename T>
+void AngryDudeApp::drawCrowd()
+{
+    {
+        NV_TRACE_SCOPE("Crowd::update");
+        mCrowd->update<T>(mTimeScalar * getFrameDeltaTime());
+    }
+
+    NV_TRACE_SCOPE("drawCrowd");
+
+    // Palettes are per instance and whole; drawMeshes gathers partitions from them.
+    const CrowdInstances& instances = mCrowd->getInstances();
+    for (size_t i = 0; i < mCrowd->size(); i++) {
+        setSkinningState(mModelViewProjection * instances.worldTransforms[i],
+                         reinterpret_cast<const float*>(mCrowd->getPalette<T>(i)));
+        drawMeshes();
+    }
+}
+
+void AngryDudeApp::setUpCrowd(int numInstances)
+{
+    mCrowd->resize(numInstances);
+    CrowdInstances& instances = mCrowd->getInstances();
+    const int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(numInstances))));
+    const float spacing = 50.f;
+    for (int i = 0; i < numInstances; i++) {
+        // Grid around the origin; the model's root sits 30 units up (see updateSkinning).
+        const float x = (i % columns - 0.5f*(columns - 1)) * spacing;
+        const float z = -(i / columns) * spacing;
+        instances.worldTransforms[i] = translation(nv::vec3f(x, -30.f, z));
+        const float phase = 0.618034f * i - std::floor(0.618034f * i);
+        instances.rates[i] = 0.75f + 0.5f * phase;
+        // Each with some of the upper body layer, out of step with the legs.
+        AnimationState& animation = instances.animations[i];
+        animation = animationblending::playClip(0, phase * mAnimationDuration);
+        AnimationLayer* upperBody = animationblending::addLayer(animation, AdditiveBlend, phase, 0);
+        animationblending::addPlayer(*upperBody, 1, 1.f, (1.f - phase) * mAnimationDuration);
+    }
 }
 
 void AngryDudeApp::initRendering() {
     NvImage::UpperLeftOrigin(false);
     NvAssetLoaderAddSearchPath("AngryDudeApp");
-    mSkinningProgram = NvGLSLProgram::createFromFiles("skinning.vert", "diffuse.frag");
+    // The skinning variants are built once the model tells which vertex
+    // format they read, see onModelLoaded.
+    mSkinningPrograms = new NvGLSLProgramVariants;
+    if (!mSkinningPrograms->setSourceFromFiles("skinning.vert", "diffuse.frag"))
+        LOGE("Failed to read skinning.vert or diffuse.frag\n");
     mDebugProgram    = NvGLSLProgram::createFromFiles("debug.vert", "debug.frag");
     mDebugMVPLocation = mDebugProgram->getUniformLocation("mvp");
     mDebugBonesLocation = mDebugProgram->getUniformLocation("boneMatrices");
     mDebugPositionBoneAttr = mDebugProgram->getAttribLocation("positionBone");
 
-    mModelViewProjectionLocation = mSkinningProgram->getUniformLocation("mvp");
-    mBoneMatricesLocation        = mSkinningProgram->getUniformLocation("boneMatrices");
-    mBoneDualQuaternionsLocation = mSkinningProgram->getUniformLocation("boneDualQuaternions");
-    mUseDQBLocation              = mSkinningProgram->getUniformLocation("useDQB");
-    mAlbedoSampler               = mSkinningProgram->getUniformLocation("sampler0");
-    mPositionAttribute = mSkinningProgram->getAttribLocation("position");
-    mNormalAttribute   = mSkinningProgram->getAttribLocation("normal");
-    mBonesAttribute    = mSkinningProgram->getAttribLocation("bones");
-    mUVAttribute       = mSkinningProgram->getAttribLocation("uv");
+    // A palette entry takes up to 4 vectors (a matrix); mvp, positionOffset
+    // and positionScale need 6 more, and some are kept for the compiler.
+    // ES2 promises 128 vectors, so 30 bones. Models with more are drawn in
+    // partitions, see onModelLoaded.
+    GLint uniformVectors = 0;
+    glGetIntegerv(GL_MAX_VERTEX_UNIFORM_VECTORS, &uniformVectors);
+#ifdef GL_MAX_VERTEX_UNIFORM_COMPONENTS
+    if (glGetError() != GL_NO_ERROR || uniformVectors == 0) {
+        // Desktop GL before 4.1 counts components.
+        GLint uniformComponents = 0;
+        glGetIntegerv(GL_MAX_VERTEX_UNIFORM_COMPONENTS, &uniformComponents);
+        uniformVectors = uniformComponents / 4;
+    }
+#endif
+    const int boneLimit = std::max((uniformVectors - 8) / 4, 30);
+    mBoneLimit = mBoneLimit > 0 ? std::min(mBoneLimit, boneLimit) : boneLimit;
 
     m_transformer->setRotationVec(nv::vec3f(0.0f, NV_PI*0.25f, 0.0f));
     m_transformer->setTranslationVec(nv::vec3f(0.0f, 0.0f, -25.0f));
@@ -282,45 +465,184 @@ void AngryDudeApp::initRendering() {
 
     CHECK_GL_ERROR();
 
-    struct memorybuf : public std::streambuf {
-        memorybuf(char* p, std::size_t n) {
-            setg(p, p, p+n);
-        }
-    };
-
-    int numBytes = 0;
-    char* pdude = NvAssetLoaderRead("dude.binmesh", numBytes);
-    assert(numBytes > 0);
-    memorybuf mb(pdude, numBytes);
-    std::istream is(&mb);
-    cereal::BinaryInputArchive iarchive(is);
-    mModel = new SkinnedModelGL;
-    iarchive(*mModel);
-    NvAssetLoaderFree(pdude);
+    // The model is mapped while the app keeps rendering (without it), see
+    // onModelLoaded.
+    NvAssetLoaderMapAsync("dude.skm", NV_ASSET_PRIORITY_HIGH,
+                           [this](NvAssetLoadHandle& load) { onModelLoaded(load); });
+}
 
-    for (const Mesh& mesh: mModel->meshes) {
+void AngryDudeApp::onModelLoaded(NvAssetLoadHandle& load)
+{
+    if (load.getStatus() != NV_ASSET_LOAD_DONE) {
+        LOGE("Failed to load %s", load.getPath());
+        return;
+    }
+
+    // The file is used where it is mapped: vertices and indices go straight
+    // to the buffers, see BinaryModel.hpp. The mapping belongs to the request
+    // and goes with it once this returns.
+    BinaryModel binaryModel;
+    // The skeleton needs a root node; an empty model is as unusable as a
+    // corrupt one.
+    if (!BinaryModel::parse(load.getData(), load.getLength(), binaryModel) || binaryModel.nodes.count == 0) {
+        LOGE("Cannot parse %s as a model", load.getPath());
+        return;
+    }
+    mModel = new SkinnedModelGL;
+    binaryModel.toSkinnedModel(*mModel, false);
+    mUsePackedVertices = mUsePackedVertices && binaryModel.packedVertices.size() > 0;
+    assert(mUsePackedVertices || binaryModel.vertices.size() > 0);
+
+    // Models whose bones do not fit the palette have every mesh partitioned,
+    // each partition with a palette of its own bones (BonePartitioning.hpp);
+    // the vertices are then copied, with bone indices into those palettes.
+    const bool partitioned = static_cast<int>(mModel->bones.size()) > mBoneLimit;
+    int paletteSize = partitioned ? 0 : static_cast<int>(mModel->bones.size());
+    BonePartitionStats partitionStats = {};
+    PartitionedMesh<PackedVertex> packedPartitions;
+    PartitionedMesh<Vertex> floatPartitions;
+
+    InfluenceSplitStats splitStats = {};
+    std::vector<unsigned short> indices;
+    for (const BinaryMesh& mesh: binaryModel.meshes) {
         MeshGL meshGL;
-        meshGL.numIndices = mesh.indices.size();
+        meshGL.numIndices = mesh.numIndices;
+        meshGL.bounds.offset = nv::vec3f(0.f, 0.f, 0.f);
+        meshGL.bounds.scale = nv::vec3f(1.f, 1.f, 1.f);
+
+        const unsigned short* meshIndices = binaryModel.meshIndices(mesh);
+        const void* vertices = mUsePackedVertices ? static_cast<const void*>(binaryModel.meshPackedVertices(mesh))
+                                                  : static_cast<const void*>(binaryModel.meshVertices(mesh));
+        size_t numVertices = mesh.numVertices;
+        std::vector<BonePartition> partitions(1);
+        indices.assign(meshIndices, meshIndices + mesh.numIndices);
+        partitions[0].firstIndex = 0;
+        partitions[0].numIndices = mesh.numIndices;
+        partitions[0].firstVertex = 0;
+        partitions[0].numVertices = mesh.numVertices;
+        if (partitioned) {
+            const bool fits = mUsePackedVertices
+                ? bonepartitioning::partitionMesh(binaryModel.meshPackedVertices(mesh), mesh.numVertices, meshIndices, mesh.numIndices,
+                                                  mBoneLimit, packedPartitions, &partitionStats)
+                : bonepartitioning::partitionMesh(binaryModel.meshVertices(mesh), mesh.numVertices, meshIndices, mesh.numIndices,
+                                                  mBoneLimit, floatPartitions, &partitionStats);
+            if (fits) {
+                if (mUsePackedVertices) {
+                    vertices = packedPartitions.vertices.data();
+                    numVertices = packedPartitions.vertices.size();
+                    indices.swap(packedPartitions.indices);
+                    partitions.swap(packedPartitions.partitions);
+                } else {
+                    vertices = floatPartitions.vertices.data();
+                    numVertices = floatPartitions.vertices.size();
+                    indices.swap(floatPartitions.indices);
+                    partitions.swap(floatPartitions.partitions);
+                }
+                for (const BonePartition& partition: partitions)
+                    paletteSize = std::max(paletteSize, static_cast<int>(partition.bones.size()));
+            } else {
+                // Drawn whole; bones past the palette come out wrong.
+                LOGE("Cannot partition a mesh into palettes of %d bones\n", mBoneLimit);
+                paletteSize = std::max(paletteSize, mBoneLimit);
+            }
+        }
+
+        // Triangles are grouped by the bones they blend, each group drawn
+        // with its own skinning variant; the indices are copied for that.
+        const std::vector<uint8_t> counts = mUsePackedVertices
+            ? influencesplit::countInfluences(static_cast<const PackedVertex*>(vertices), numVertices)
+            : influencesplit::countInfluences(static_cast<const Vertex*>(vertices), numVertices);
+        for (const BonePartition& partition: partitions) {
+            MeshPartitionGL partitionGL;
+            partitionGL.bones = partition.bones;
+            partitionGL.batches = influencesplit::splitByInfluences(&indices[partition.firstIndex], partition.numIndices,
+                                                                    counts.data(), &splitStats);
+            for (InfluenceBatch& batch: partitionGL.batches)
+                batch.firstIndex += partition.firstIndex;
+            meshGL.partitions.push_back(partitionGL);
+        }
+
         glGenBuffers(1, &meshGL.indexBufferId);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshGL.indexBufferId);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(mesh.indices[0]),
-                                              mesh.indices.data(), GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned short), indices.data(), GL_STATIC_DRAW);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
         glGenBuffers(1, &meshGL.vertexBufferId);
         glBindBuffer(GL_ARRAY_BUFFER, meshGL.vertexBufferId);
-        glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(mesh.vertices[0]),
-                                      mesh.vertices.data(), GL_STATIC_DRAW);
+        if (mUsePackedVertices) {
+            meshGL.bounds = mesh.bounds();
+            glBufferData(GL_ARRAY_BUFFER, numVertices * sizeof(PackedVertex), vertices, GL_STATIC_DRAW);
+        } else {
+            glBufferData(GL_ARRAY_BUFFER, numVertices * sizeof(Vertex), vertices, GL_STATIC_DRAW);
+        }
         glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-        meshGL.albedoTextureId = NvImage::UploadTextureFromDDSFile(mesh.albedoTextureFilename.c_str());
-        glBindTexture(GL_TEXTURE_2D, meshGL.albedoTextureId);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        // Set by streamTextures; the mesh is not drawn until then.
+        meshGL.albedoTextureId = 0;
         mModel->meshesGL.push_back(meshGL);
     }
+    LOGI("Influence split: %u/%u/%u/%u triangles and %u/%u/%u/%u vertices blend 1/2/3/4 bones, %.2f bones per vertex instead of 4\n",
+         unsigned(splitStats.numTriangles[0]), unsigned(splitStats.numTriangles[1]),
+         unsigned(splitStats.numTriangles[2]), unsigned(splitStats.numTriangles[3]),
+         unsigned(splitStats.numVertices[0]), unsigned(splitStats.numVertices[1]),
+         unsigned(splitStats.numVertices[2]), unsigned(splitStats.numVertices[3]),
+         splitStats.averageInfluences());
+    if (partitioned) {
+        LOGI("Bone partitioning: %u bones in %u partitions of at most %u (limit %d), %u of %u vertices duplicated\n",
+             unsigned(mModel->bones.size()), unsigned(partitionStats.numPartitions), unsigned(partitionStats.maxBones), mBoneLimit,
+             unsigned(partitionStats.numDuplicatedVertices), unsigned(partitionStats.numVertices));
+    }
+
+    createSkinningVariants(paletteSize);
+    if (mProgramCache) {
+        // The UI's programs, made before ours, are counted too.
+        const NvGLSLProgramCacheStats& stats = mProgramCache->getStats();
+        LOGI("Program cache: %u hits, %u misses (%u rejected), %.1f ms compiling, %.1f ms saved\n",
+             stats.hits, stats.misses, stats.rejected, 1000.f * stats.compileSeconds, 1000.f * stats.savedSeconds);
+    }
+    // NvImage decodes from the mapping into storage of its own.
+    for (size_t meshIdx = 0; meshIdx < binaryModel.meshes.size(); meshIdx++) {
+        NvAssetLoaderMapAsync(binaryModel.string(binaryModel.meshes[meshIdx].albedoTextureFilename), NV_ASSET_PRIORITY_NORMAL,
+                              [this, meshIdx](NvAssetLoadHandle& load) { onAlbedoTextureLoaded(meshIdx, load); });
+    }
+
+    // Tracks end in padding keys, see animationDuration.
+    mAnimationDuration = animationDuration(mModel->nodeAnimations);
+    mAnimationCursors.assign(mModel->nodeAnimations.size(), NodeAnimationCursor());
+    // The compressed clip is a playback mode to compare with the keyframes,
+    // not a replacement; the source tracks stay, as do the baked clips.
+    AnimationCompressionStats compressionStats;
+    mCompressedClip = CompressedClip::compress(mModel->nodeAnimations, AnimationCompressionSettings(), &compressionStats);
+    mCompressedCursors.assign(mModel->nodeAnimations.size(), NodeAnimationCursor());
+    mBakedMatrices.resize(mModel->nodeAnimations.size());
+    mBakedDualQuaternions.resize(mModel->nodeAnimations.size());
+    LOGI("Animation compressed from %u to %u bytes (%u to %u keys, max error %f units, %f radians)\n",
+         unsigned(compressionStats.sourceBytes), unsigned(compressionStats.compressedBytes),
+         unsigned(compressionStats.sourceKeys), unsigned(compressionStats.compressedKeys),
+         compressionStats.maxTranslationError, compressionStats.maxRotationError);
+    mSkeleton = Skeleton::fromModel(*mModel);
+    mSkeletonCache = SkeletonCache::fromSkeleton(mSkeleton, mModel->bones);
+    mSkeletonCache.initPose(mMatrixPose);
+    mSkeletonCache.initPose(mDualQuaternionPose);
+
+    // Clip 0 is dude's animation. Clip 1 is its motion relative to its first
+    // frame; played additively on the spine and what hangs off it (mask 0),
+    // it exaggerates the upper body's swing on top of clip 0. The layer stays
+    // off until the Upper Body Layer slider is raised, so that baked playback
+    // shows what the other modes do.
+    const BakedClip clip = BakedClip::bake(mModel->nodeAnimations, mAnimationDuration);
+    mAnimations.clips.assign(1, clip);
+    mAnimations.clips.push_back(animationblending::makeAdditive(clip, clip, 0.f));
+    const int spine = findNode(mSkeleton, *mModel, "Spine1");
+    mAnimations.masks.assign(1, animationblending::makeSubtreeMask(mSkeleton, spine != -1 ? spine : 0, clip.stride));
+    mAnimations.restPose = animationblending::makeRestPose(mSkeleton, mSkeletonCache, clip.stride);
+    mAnimation = animationblending::playClip(0);
+    AnimationLayer* upperBody = animationblending::addLayer(mAnimation, AdditiveBlend, mUpperBodyWeight, 0);
+    animationblending::addPlayer(*upperBody, 1, 1.f, 0.5f * mAnimationDuration);
+
+    // The crowd sizes its palettes and poses from the skeleton cache.
+    mCrowd = new Crowd(mSkeleton, mSkeletonCache, mAnimations, getJobSystem());
+    setUpCrowd(mCrowdSize);
 
     // Build debug skeleton.
     std::vector<nv::vec4f> debugLines;
@@ -345,24 +667,204 @@ void AngryDudeApp::initRendering() {
     CHECK_GL_ERROR();
 }
 
+namespace {
+
+/// Client memory a streamed texture uploads from: the decoded file and any
+/// levels generated for it.
+struct TextureStaging
+{
+    NvImage              image;
+    std::vector<uint8_t> generatedLevels;
+};
+
+} // namespace
+
+void AngryDudeApp::onAlbedoTextureLoaded(size_t meshIdx, NvAssetLoadHandle& load)
+{
+    // A failed read has been reported by the loader; the mesh stays hidden.
+    if (load.getStatus() != NV_ASSET_LOAD_DONE)
+        return;
+
+    std::shared_ptr<TextureStaging> staging = std::make_shared<TextureStaging>();
+    NvImage& image = staging->image;
+    if (!image.loadImageFromFileData(reinterpret_cast<const uint8_t*>(load.getData()), load.getLength(), "dds")) {
+        LOGE("Cannot decode the texture of mesh %u\n", unsigned(meshIdx));
+        return;
+    }
+
+    std::vector<MipLevel> levels(image.getMipLevels());
+    for (int32_t l = 0; l < image.getMipLevels(); l++) {
+        levels[l].width = std::max(image.getWidth() >> l, 1);
+        levels[l].height = std::max(image.getHeight() >> l, 1);
+        levels[l].bytes = image.getImageSize(l);
+        levels[l].data = static_cast<const uint8_t*>(image.getLevel(l));
+    }
+    // DDS chains are used as they are; only images without one (the dude's
+    // DXT5 files have a single level, expanded to RGBA on load) get their
+    // levels generated here, instead of by glGenerateMipmap after the upload.
+    if (levels.size() == 1 && !image.isCompressed() && image.getFormat() == GL_RGBA && image.getType() == GL_UNSIGNED_BYTE)
+        texturestreaming::buildMipChainRGBA8(levels, staging->generatedLevels);
+
+    StreamedTextureGL texture;
+    texture.meshIdx = meshIdx;
+    texture.buildId = 0;
+    texture.internalFormat = (NvImage::getAPIVersion().api == NvGfxAPI::GLES) ? image.getFormat() : image.getInternalFormat();
+    texture.format = image.getFormat();
+    texture.type = image.getType();
+    texture.compressed = image.isCompressed();
+    // ES 2 samples non power of two textures without mipmaps only.
+    const bool powerOfTwo = !(image.getWidth() & (image.getWidth() - 1)) && !(image.getHeight() & (image.getHeight() - 1));
+    texture.mipmapped = powerOfTwo && texturestreaming::isCompleteChain(levels);
+    mStreamedTextures.push_back(texture);
+    mTextureStreamer.add(levels, texture.compressed, staging);
+}
+
+void AngryDudeApp::streamTextures()
+{
+    if (!mTextureStreamer.isStreaming())
+        return;
+
+    NV_TRACE_SCOPE("streamTextures");
+    mTextureUploads.clear();
+    mTextureStreamer.update(mTextureBudget, mTextureUploads);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (const TextureUpload& upload: mTextureUploads) {
+        StreamedTextureGL& texture = mStreamedTextures[upload.texture];
+        const MipLevel& level = mTextureStreamer.getLevels(upload.texture)[upload.level];
+        if (upload.beginBuild)
+            glGenTextures(1, &texture.buildId);
+        glBindTexture(GL_TEXTURE_2D, texture.buildId);
+
+        if (texture.compressed) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, upload.targetLevel, texture.internalFormat, level.width, level.height,
+                                   0, static_cast<GLsizei>(upload.bytes), upload.data);
+        } else if (upload.firstRow == 0 && upload.endRow == level.height) {
+            glTexImage2D(GL_TEXTURE_2D, upload.targetLevel, texture.internalFormat, level.width, level.height,
+                         0, texture.format, texture.type, upload.data);
+        } else {
+            // A band of rows; the level is defined empty with the first one.
+            if (upload.defineLevel)
+                glTexImage2D(GL_TEXTURE_2D, upload.targetLevel, texture.internalFormat, level.width, level.height,
+                             0, texture.format, texture.type, nullptr);
+            glTexSubImage2D(GL_TEXTURE_2D, upload.targetLevel, 0, upload.firstRow, level.width, upload.endRow - upload.firstRow,
+                            texture.format, texture.type, upload.data);
+        }
+
+        if (upload.endBuild) {
+            // Coarser chains than the full one are complete too, down to 1x1.
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, texture.mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            MeshGL& mesh = mModel->meshesGL[texture.meshIdx];
+            if (mesh.albedoTextureId)
+                glDeleteTextures(1, &mesh.albedoTextureId);
+            mesh.albedoTextureId = texture.buildId;
+            texture.buildId = 0;
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    CHECK_GL_ERROR();
+
+    if (!mTextureStreamer.isStreaming()) {
+        const TextureStreamingStats stats = mTextureStreamer.getStats();
+        LOGI("Textures resident: %u of %u complete, %u KB (%u KB uploaded over %u frames)\n",
+             unsigned(stats.numComplete), unsigned(stats.numTextures), unsigned(stats.residentBytes / 1024),
+             unsigned(stats.uploadedBytes / 1024), unsigned(stats.uploadFrames));
+    }
+}
+
 AngryDudeApp::AngryDudeApp(NvPlatformContext* platform)
     : NvSampleApp(platform, "Angry Dude")
     , mModel(nullptr)
-    , mSkinningProgram(nullptr)
+    , mSkinningPrograms(nullptr)
+    , mSkinningGeneration(0)
+    , mPalette(nullptr)
+    , mDrawPalette(nullptr)
+    , mDrawPaletteBones(0)
     , mTimeScalar(0.1f)
     , mUseDQB(true)
     , mDrawSkeleton(false)
+    , mUseCompressedAnimation(false)
+    , mUseBakedAnimation(false)
+    , mAnimationDuration(0.f)
+    , mUpperBodyWeight(0.f)
+    , mUsePackedVertices(true)
+    , mSplitInfluences(true)
+    , mBoneLimit(0)
+    , mCrowdMode(false)
+    , mCrowdSize(256)
+    , mCrowd(nullptr)
+    , mTextureBudget(1024 * 1024)
+    , mProgramCache(nullptr)
     , mTime(0.f)
 {
     // Required in all subclasses to avoid silent link issues.
     forceLinkHack();
+    memset(mSkinningVariants, 0, sizeof(mSkinningVariants));
+
+    // -crowd <count> starts in crowd mode with count instances,
+    // -floatvertices draws with the 48 byte Vertex instead of PackedVertex,
+    // -noinfluencesplit blends 4 bones for every vertex,
+    // -maxbones <count> lowers the bone palette size (at least 12), which
+    // partitions models with more bones,
+    // -archive <file> reads assets from an archive made by AssetPacker,
+    // -texturebudget <KB> sets the texture bytes uploaded per frame,
+    // -shadercache <dir> keeps linked program binaries in dir ("shadercache"
+    // by default), -noshadercache always compiles shaders from source.
+    std::string programCacheDirectory = "shadercache";
+    const std::vector<std::string>& cmd = platform->getCommandLine();
+    for (std::vector<std::string>::const_iterator iter = cmd.begin(); iter != cmd.end(); ++iter) {
+        if (0 == (*iter).compare("-crowd") && iter + 1 != cmd.end()) {
+            mCrowdMode = true;
+            std::stringstream(*++iter) >> mCrowdSize;
+        }
+        else if (0 == (*iter).compare("-floatvertices")) {
+            mUsePackedVertices = false;
+        }
+        else if (0 == (*iter).compare("-noinfluencesplit")) {
+            mSplitInfluences = false;
+        }
+        else if (0 == (*iter).compare("-maxbones") && iter + 1 != cmd.end()) {
+            // A triangle can reference 12 bones; partitions cannot be smaller.
+            std::stringstream(*++iter) >> mBoneLimit;
+            mBoneLimit = std::max(mBoneLimit, 12);
+        }
+        else if (0 == (*iter).compare("-archive") && iter + 1 != cmd.end()) {
+            // Everything the archive holds is then found with one lookup;
+            // loose files only fill in what it lacks.
+            NvAssetLoaderAddSearchPath("AngryDudeApp");
+            if (NvAssetLoaderMountArchive((*++iter).c_str()))
+                NvAssetLoaderSetLooseFileOverride(false);
+        }
+        else if (0 == (*iter).compare("-texturebudget") && iter + 1 != cmd.end()) {
+            size_t kilobytes = 0;
+            std::stringstream(*++iter) >> kilobytes;
+            mTextureBudget = kilobytes * 1024;
+        }
+        else if (0 == (*iter).compare("-shadercache") && iter + 1 != cmd.end()) {
+            programCacheDirectory = *++iter;
+        }
+        else if (0 == (*iter).compare("-noshadercache")) {
+            programCacheDirectory.clear();
+        }
+    }
+
+    // Set before the UI makes its programs in baseInitRendering.
+    if (!programCacheDirectory.empty()) {
+        mProgramCache = new NvGLSLProgramCache(programCacheDirectory.c_str());
+        NvGLSLProgram::setBinaryCache(mProgramCache);
+    }
 }
 
 AngryDudeApp::~AngryDudeApp()
 {
+    delete mCrowd;
     delete mModel;
-    delete mSkinningProgram;
+    delete mSkinningPrograms;
     delete mDebugProgram;
+    NvGLSLProgram::setBinaryCache(nullptr);
+    delete mProgramCache;
     NvAssetLoaderShutdown();
     LOGI("AngryDudeApp: destroyed\n");
 }
@@ -382,6 +884,19 @@ void AngryDudeApp::initUI()
         mTweakBar->addPadding();
         var = mTweakBar->addValue("Draw Skeleton", mDrawSkeleton);
         addTweakKeyBind(var, NvKey::K_N);
+
+        mTweakBar->addPadding();
+        var = mTweakBar->addValue("Compressed Animation", mUseCompressedAnimation);
+        addTweakKeyBind(var, NvKey::K_C);
+
+        mTweakBar->addPadding();
+        var = mTweakBar->addValue("Baked Animation", mUseBakedAnimation);
+        addTweakKeyBind(var, NvKey::K_V);
+        mTweakBar->addValue("Upper Body Layer", mUpperBodyWeight, 0, 1.0, 0.1f);
+
+        mTweakBar->addPadding();
+        var = mTweakBar->addValue("Crowd", mCrowdMode);
+        addTweakKeyBind(var, NvKey::K_M);
     }
 
     mFramerate->setMaxReportRate(.2f);
@@ -8,9 +8,29 @@
 #include "NvAppBase/NvInputTransformer.h"
 
 #include "Skinning.hpp"
+#include "Animation.hpp"
+#include "DualQuaternion.hpp"
+#include "Skeleton.hpp"
+#include "CompressedAnimation.hpp"
+#include "BakedAnimation.hpp"
+#include "AnimationBlending.hpp"
+#include "PackedVertex.hpp"
+#include "TextureStreaming.hpp"
+#include "InfluenceSplit.hpp"
+#include "BonePartitioning.hpp"
 
 class NvGLSLProgram;
-class DualQuaternion;
+class NvGLSLProgramCache;
+class NvGLSLProgramVariants;
+class NvAssetLoadHandle;
+class Crowd;
+
+/// \brief Triangles of a mesh drawn with one bone palette.
+struct MeshPartitionGL
+{
+    std::vector<int> bones;                 ///< Model bone of each palette entry; empty for the whole palette.
+    std::vector<InfluenceBatch> batches;    ///< Ranges of the index buffer, see InfluenceSplit.hpp.
+};
 
 struct MeshGL
 {
@@ -18,6 +38,42 @@ struct MeshGL
     GLuint indexBufferId;
     GLsizei numIndices;
     GLuint albedoTextureId;
+    PackedVertexBounds bounds;  ///< Identity for float vertices.
+    std::vector<MeshPartitionGL> partitions;  ///< One, unless the model has more bones than the palette holds.
+};
+
+/// \brief Attribute locations shared by every skinning.vert variant.
+enum SkinningAttribute
+{
+    PositionAttribute,
+    NormalAttribute,
+    BonesAttribute,
+    WeightsAttribute,
+    UVAttribute
+};
+
+/// \brief A skinning.vert variant and its uniform locations.
+struct SkinningVariant
+{
+    NvGLSLProgram* program;     ///< Owned by the NvGLSLProgramVariants; null if it failed to build.
+    int modelViewProjectionLocation;
+    int paletteLocation;        ///< boneDualQuaternions or boneMatrices.
+    int positionOffsetLocation;
+    int positionScaleLocation;
+    int albedoSampler;
+    unsigned generation;        ///< Skinning state last uploaded, see AngryDudeApp::setSkinningState.
+};
+
+/// \brief GL side of a texture in the TextureStreamer.
+struct StreamedTextureGL
+{
+    size_t meshIdx;
+    GLuint buildId;         ///< Texture being filled by the current build, 0 between builds.
+    GLenum internalFormat;
+    GLenum format;
+    GLenum type;
+    bool   compressed;
+    bool   mipmapped;       ///< The chain goes down to 1x1 and can be sampled with mipmaps.
 };
 
 struct SkinnedModelGL : public SkinnedModel
@@ -40,37 +96,73 @@ public:
 
 private:
     template <typename T> void updateSkinning();
+    template <typename T> void drawCrowd();
+    void drawMeshes();
+    void createSkinningVariants(int paletteSize);
+    void setSkinningState(const nv::matrix4f& mvp, const float* palette);
+    SkinningVariant* useSkinningVariant(int maxInfluences);
+    void setUpCrowd(int numInstances);
+    void onModelLoaded(NvAssetLoadHandle& load);
+    void onAlbedoTextureLoaded(size_t meshIdx, NvAssetLoadHandle& load);
+    void streamTextures();
+    template <typename T> SkeletonPose<T>& getSkeletonPose();
+    template <typename T> std::vector<T>& getBakedTransforms();
     void getAnimatedTransform(int nodeAnimationIdx, nv::matrix4f& animatedTransform);
     void getAnimatedTransform(int nodeAnimationIdx, DualQuaternion& animatedTransform);
     nv::vec3f getInterpolatedTranslation(int nodeAnimationIdx);
     nv::quaternionf getInterpolatedRotation(int nodeAnimationIdx);
 
     SkinnedModelGL* mModel;
-    NvGLSLProgram*  mSkinningProgram;
+    std::vector<NodeAnimationCursor> mAnimationCursors;
+    CompressedClip  mCompressedClip;  ///< A playback mode only: the source tracks stay resident to compare against.
+    std::vector<NodeAnimationCursor> mCompressedCursors;
+    AnimationSet    mAnimations;      ///< The baked clip and its additive form, see onModelLoaded.
+    AnimationState  mAnimation;       ///< What the single instance plays with baked animation.
+    BlendScratch    mBlendScratch;
+    std::vector<nv::matrix4f>   mBakedMatrices;   ///< Per track, blended from mAnimations.
+    std::vector<DualQuaternion> mBakedDualQuaternions;
+    Skeleton        mSkeleton;
+    SkeletonCache   mSkeletonCache;
+    SkeletonPose<nv::matrix4f>   mMatrixPose;
+    SkeletonPose<DualQuaternion> mDualQuaternionPose;
+    NvGLSLProgramVariants* mSkinningPrograms;
+    SkinningVariant mSkinningVariants[2][4];    ///< [mUseDQB][maxInfluences - 1]
+    unsigned        mSkinningGeneration;
+    nv::matrix4f    mSkinningMVP;
+    const float*    mPalette;           ///< mModel->bones.size() transforms of the current blend mode.
+    const float*    mDrawPalette;       ///< What the variants upload: mPalette, or mPartitionPalette.
+    int             mDrawPaletteBones;
+    std::vector<float> mPartitionPalette;   ///< The bones of one partition, gathered from mPalette.
+    std::vector<float> mModelPalette;   ///< The palette outside crowd mode.
     NvGLSLProgram*  mDebugProgram;
+    NvGLSLProgramCache* mProgramCache;
     nv::matrix4f    mModelViewProjection;
 
     float           mTime;
     float           mTimeScalar;
     bool            mUseDQB;
     bool            mDrawSkeleton;
-
-    int             mModelViewProjectionLocation;
-    int             mBoneMatricesLocation;
-    int             mBoneDualQuaternionsLocation;
-    int             mUseDQBLocation;
-    int             mAlbedoSampler;
-
-    int             mPositionAttribute;
-    int             mNormalAttribute;
-    int             mBonesAttribute;
-    int             mUVAttribute;
+    bool            mUseCompressedAnimation;
+    bool            mUseBakedAnimation;
+    float           mAnimationDuration;   ///< Of the keys before padding, see animationDuration.
+    float           mUpperBodyWeight;     ///< Of the additive upper body layer; off by default.
+    bool            mUsePackedVertices;
+    bool            mSplitInfluences;
+    int             mBoneLimit;       ///< Palette size the vertex uniforms allow, see initRendering.
+    bool            mCrowdMode;
+    int             mCrowdSize;
+    Crowd*          mCrowd;
+    TextureStreamer mTextureStreamer;
+    std::vector<StreamedTextureGL> mStreamedTextures;  ///< Indexed like mTextureStreamer.
+    std::vector<TextureUpload>     mTextureUploads;
+    size_t          mTextureBudget;   ///< Bytes uploaded per frame.
 
     int             mDebugMVPLocation;
     int             mDebugBonesLocation;
     int             mDebugPositionBoneAttr;
     GLuint          mDebugBufferId;
     int             mDebugNumIndices;
+    std::vector<nv::matrix4f> mDebugTransforms;
 };
 
 #endif
@@ -0,0 +1,214 @@
+#ifndef __Animation_hpp__
+#define __Animation_hpp__
+
+#include "Skinning.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+/// \file Animation.hpp
+/// \brief Keyframe lookup for NodeAnimation tracks.
+///
+/// Sampling a track means finding the two keys surrounding the current time.
+/// Scanning from the first key every frame costs O(number of keys); during normal
+/// playback, however, time only moves forward by a frame, so the answer is almost
+/// always the previous pair or the one right after it. KeyframeCursor remembers
+/// the previous answer; findKeyframes() first checks it, then steps forward a few
+/// keys and only falls back to a binary search when time jumped (seeks, loops,
+/// large time steps). Per track and frame that is O(1) in the common case and
+/// O(log n) otherwise.
+///
+/// Exported tracks may end in padding: dude.binmesh pads every track to 100
+/// keys, the keys after its last real one all at time 0. The binary search
+/// needs ascending times, so the cursor also remembers how many keys at the
+/// start of the track ascend: lookups up to the last of them binary search
+/// that prefix, lookups past it scan the remaining keys, as a linear scan from
+/// key 0 would.
+
+/// \brief Remembers the last key pair found in one track.
+struct KeyframeCursor
+{
+    KeyframeCursor(): index1(0), sortedKeys(0) {}
+
+    size_t index1;     ///< Second key of the last pair found.
+    size_t sortedKeys; ///< Length of the ascending prefix of the track, 0 until known.
+};
+
+/// \brief Two keys surrounding a point in time and the interpolation factor between them.
+struct KeyframePair
+{
+    size_t index0;
+    size_t index1;
+    float  t;      ///< 0 at key index0, 1 at key index1.
+};
+
+/// \brief Cursors for both tracks of a NodeAnimation.
+struct NodeAnimationCursor
+{
+    KeyframeCursor translation;
+    KeyframeCursor rotation;
+};
+
+/// How many keys findKeyframes steps forward before giving up and binary searching.
+const size_t maxKeyframeCursorSteps = 4;
+
+namespace detail {
+
+/// Key time accessors, so that findKeyframes works on AnimationKeys and on
+/// plain time arrays alike.
+struct AnimationKeyTimes
+{
+    const AnimationKey* keys;
+    float operator[](size_t i) const { return keys[i].time; }
+};
+
+struct FloatTimes
+{
+    const float* times;
+    float operator[](size_t i) const { return times[i]; }
+};
+
+template <typename Times>
+inline KeyframePair findKeyframes(const Times& times, size_t numKeys, float time, KeyframeCursor& cursor)
+{
+    if (cursor.sortedKeys == 0 || cursor.sortedKeys > numKeys) {
+        size_t sorted = 1;
+        while (sorted < numKeys && times[sorted-1] < times[sorted])
+            sorted++;
+        cursor.sortedKeys = sorted;
+    }
+    const size_t sortedKeys = cursor.sortedKeys;
+    size_t index1 = cursor.index1 < sortedKeys ? cursor.index1 : 0;
+
+    // index1 is correct if its key is not before time and the previous key is.
+    const bool afterPrevious = index1 == 0 || times[index1-1] < time;
+    if (afterPrevious) {
+        // Walk forward a few keys; during playback this almost always succeeds.
+        size_t steps = 0;
+        while (index1 < sortedKeys && times[index1] < time && steps < maxKeyframeCursorSteps) {
+            index1++;
+            steps++;
+        }
+    }
+    const bool found = afterPrevious && (index1 < sortedKeys ? !(times[index1] < time) : sortedKeys == numKeys);
+    if (!found) {
+        if (time <= times[sortedKeys-1]) {
+            // Binary search the ascending prefix for the first key not before time.
+            size_t first = 0, count = sortedKeys;
+            while (count > 0) {
+                const size_t half = count / 2;
+                if (times[first + half] < time) {
+                    first += half + 1;
+                    count -= half + 1;
+                } else {
+                    count = half;
+                }
+            }
+            index1 = first;
+        } else {
+            // Past the ascending keys; padding keys need not ascend.
+            index1 = sortedKeys;
+            while (index1 < numKeys && times[index1] < time)
+                index1++;
+        }
+    }
+    if (index1 == numKeys)
+        index1 = 0;
+    cursor.index1 = index1;
+
+    KeyframePair pair;
+    pair.index1 = index1;
+    pair.index0 = index1 > 0 ? index1-1 : 0;
+    const float dt = times[pair.index1] - times[pair.index0];
+    // Before the first key, and past the last one once index1 wrapped, both
+    // indices are 0 and key 0 is held.
+    pair.t = dt > 0.f ? (time - times[pair.index0]) / dt : 0.f;
+    return pair;
+}
+
+} // namespace detail
+
+/// Finds the keys surrounding time. index1 is the first key at or after time
+/// and index0 the one before it, which is exactly what a linear scan from key
+/// 0 returns. When no key is at or after time, index1 wraps to key 0.
+inline KeyframePair findKeyframes(const std::vector<AnimationKey>& keys, float time, KeyframeCursor& cursor)
+{
+    const detail::AnimationKeyTimes times = {keys.data()};
+    return detail::findKeyframes(times, keys.size(), time, cursor);
+}
+
+/// Same as above for numKeys key times.
+inline KeyframePair findKeyframes(const float* keyTimes, size_t numKeys, float time, KeyframeCursor& cursor)
+{
+    const detail::FloatTimes times = {keyTimes};
+    return detail::findKeyframes(times, numKeys, time, cursor);
+}
+
+/// Spherical interpolation along the shorter arc, returning a unit quaternion.
+/// nv::slerp snaps to p once cos(omega) rounds to 1, which for nearly identical
+/// keys is off by more than quantization steps; close rotations are
+/// normalized-lerped instead.
+inline nv::quaternionf interpolateRotation(const nv::quaternionf& p, const nv::quaternionf& q, float t)
+{
+    float cosOmega = p.x*q.x + p.y*q.y + p.z*q.z + p.w*q.w;
+    const float sign = cosOmega < 0.f ? -1.f : 1.f;
+    cosOmega *= sign;
+    float a = 1.f - t, b = t;
+    if (cosOmega < 0.9995f) {
+        const float omega = std::acos(cosOmega);
+        const float invSinOmega = 1.f / std::sin(omega);
+        a = std::sin(a*omega) * invSinOmega;
+        b = std::sin(b*omega) * invSinOmega;
+    }
+    b *= sign;
+    const nv::quaternionf r(a*p.x + b*q.x, a*p.y + b*q.y, a*p.z + b*q.z, a*p.w + b*q.w);
+    const float invLength = 1.f / std::sqrt(r.x*r.x + r.y*r.y + r.z*r.z + r.w*r.w);
+    return nv::quaternionf(r.x*invLength, r.y*invLength, r.z*invLength, r.w*invLength);
+}
+
+/// Number of keys at the start of a track whose times ascend, that is the
+/// keys before padding (see the note on padding above). 0 without keys.
+inline size_t ascendingKeys(const std::vector<AnimationKey>& keys)
+{
+    size_t count = keys.empty() ? 0 : 1;
+    while (count < keys.size() && keys[count-1].time < keys[count].time)
+        count++;
+    return count;
+}
+
+/// Length of animations: the latest key time in the ascending prefix of any
+/// track, so that padding keys do not count. 0 without keys.
+inline float animationDuration(const std::vector<NodeAnimation>& animations)
+{
+    float duration = 0.f;
+    for (const NodeAnimation& animation: animations) {
+        const std::vector<AnimationKey>* tracks[2] = {&animation.translationKeys, &animation.rotationKeys};
+        for (const std::vector<AnimationKey>* keys: tracks) {
+            const size_t count = ascendingKeys(*keys);
+            if (count > 0 && (*keys)[count-1].time > duration)
+                duration = (*keys)[count-1].time;
+        }
+    }
+    return duration;
+}
+
+/// Translation of a keyframed node at time, linearly interpolated.
+inline nv::vec3f sampleTranslation(const NodeAnimation& animation, float time, NodeAnimationCursor& cursor)
+{
+    const KeyframePair keys = findKeyframes(animation.translationKeys, time, cursor.translation);
+    const nv::vec4f& t0 = animation.translationKeys[keys.index0].value;
+    const nv::vec4f& t1 = animation.translationKeys[keys.index1].value;
+    return (1.f-keys.t)*nv::vec3f(t0.x, t0.y, t0.z) + keys.t*nv::vec3f(t1.x, t1.y, t1.z);
+}
+
+/// Rotation of a keyframed node at time, spherically interpolated.
+inline nv::quaternionf sampleRotation(const NodeAnimation& animation, float time, NodeAnimationCursor& cursor)
+{
+    const KeyframePair keys = findKeyframes(animation.rotationKeys, time, cursor.rotation);
+    const nv::vec4f& r0 = animation.rotationKeys[keys.index0].value;
+    const nv::vec4f& r1 = animation.rotationKeys[keys.index1].value;
+    return nv::slerp(nv::quaternionf(r0.x, r0.y, r0.z, r0.w), nv::quaternionf(r1.x, r1.y, r1.z, r1.w), keys.t);
+}
+
+#endif
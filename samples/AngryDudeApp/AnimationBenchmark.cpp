@@ -0,0 +1,346 @@
+/// \file AnimationBenchmark.cpp
+/// \brief Headless benchmark of the CPU side of AngryDudeApp::updateSkinning.
+///
+/// Loads dude.binmesh (or any asset given with -model, .binmesh or .skm)
+/// through NvAssetLoader, without a window or GL context, and runs the three
+/// stages of updateSkinning for every instance and frame:
+///
+/// - sample:    local transforms of the animated nodes, from keyframes (as the
+///              sample does by default), the compressed clip or the baked clip
+/// - hierarchy: global transforms of the dynamic nodes (SkeletonCache)
+/// - palette:   global transform times bone offset, per bone
+///
+/// for both matrices and dual quaternions. Each stage is timed over all
+/// instances of a frame at once. Crowd::update, which fuses the stages and
+/// runs on an NvJobSystem, is timed as well: playing the clip alone, and
+/// layered (a crossfade between two phases of the clip under a masked
+/// additive upper body layer, three samples per instance). Results go to
+/// stdout (or -o file) as JSON, for regression tracking on machines without
+/// a GPU:
+///
+///     AnimationBenchmark [-frames N] [-instances M] [-model dude.binmesh] [-o results.json]
+///
+/// Times are reported per node (hierarchy), per bone (palette), per animated
+/// node (sample) and per instance (all stages). Instances play at different
+/// rates and phases, so cursors and caches see the spread a crowd would.
+
+#include "NvAssetLoader/NvAssetLoader.h"
+
+#include "Skinning.hpp"
+#include "DualQuaternion.hpp"
+#include "Animation.hpp"
+#include "Skeleton.hpp"
+#include "CompressedAnimation.hpp"
+#include "BakedAnimation.hpp"
+#include "AnimationBlending.hpp"
+#include "BinaryModel.hpp"
+#include "Crowd.hpp"
+#include "NvAppBase/NvJobSystem.h"
+#include "cereal/archives/binary.hpp"
+#include "cereal/types/vector.hpp"
+#include "cereal/types/string.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double elapsedNs(Clock::time_point begin, Clock::time_point end)
+{
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+}
+
+enum Sampling { Keyframes, Compressed, Baked, NumSamplings };
+const char* samplingNames[NumSamplings] = {"keyframes", "compressed", "baked"};
+
+void toTransform(const nv::vec3f& translation, const nv::quaternionf& rotation, nv::matrix4f& m)
+{
+    rotation.get_value(m);
+    m.set_translate(translation);
+}
+
+void toTransform(const nv::vec3f& translation, const nv::quaternionf& rotation, DualQuaternion& dq)
+{
+    dq = DualQuaternion(translation, rotation);
+}
+
+const char* representationName(const nv::matrix4f*) { return "matrix"; }
+const char* representationName(const DualQuaternion*) { return "dualquaternion"; }
+
+/// Folds a palette into a number that is printed, so that no stage can be
+/// optimized away.
+float checksum(const nv::matrix4f& m) { return m._array[0] + m._array[13]; }
+float checksum(const DualQuaternion& dq) { return dq.real.w + dq.dual.x; }
+
+struct Model
+{
+    SkinnedModel     model;
+    Skeleton         skeleton;
+    SkeletonCache    cache;
+    CompressedClip   compressedClip;
+    BakedClip        bakedClip;
+    AnimationSet     animations;   ///< bakedClip and the additive clip of it, with an upper body mask.
+    float            duration;
+};
+
+struct Result
+{
+    std::string representation;
+    std::string sampling;
+    double sampleNs;
+    double hierarchyNs;
+    double paletteNs;
+    float  checksum;
+};
+
+template <typename T>
+struct Instance
+{
+    float time;
+    float rate;
+    SkeletonPose<T> pose;
+    std::vector<NodeAnimationCursor> cursors;
+    std::vector<T> palette;
+};
+
+template <typename T>
+Result runStages(const Model& m, Sampling sampling, int numFrames, int numInstances, float deltaTime)
+{
+    const std::vector<int>& animatedNodes = m.cache.animatedNodes;
+    const std::vector<int>& boneNodes = m.cache.boneNodes;
+    const std::vector<T>& boneOffsets = m.cache.get<T>().boneOffsets;
+
+    std::vector<Instance<T> > instances(numInstances);
+    for (int i = 0; i < numInstances; i++) {
+        Instance<T>& instance = instances[i];
+        const float phase = 0.618034f * i - std::floor(0.618034f * i);
+        instance.time = phase * m.duration;
+        instance.rate = 0.75f + 0.5f * phase;
+        m.cache.initPose(instance.pose);
+        instance.cursors.assign(m.model.nodeAnimations.size(), NodeAnimationCursor());
+        instance.palette.resize(boneNodes.size());
+    }
+    std::vector<T> tracks(m.bakedClip.numTracks);
+
+    Result result;
+    result.representation = representationName(static_cast<const T*>(nullptr));
+    result.sampling = samplingNames[sampling];
+    result.sampleNs = result.hierarchyNs = result.paletteNs = 0.0;
+    result.checksum = 0.f;
+
+    for (int frame = 0; frame < numFrames; frame++) {
+        const Clock::time_point sampleBegin = Clock::now();
+        for (Instance<T>& instance: instances) {
+            instance.time += instance.rate * deltaTime;
+            if (instance.time >= m.duration)
+                instance.time -= m.duration;
+            const float time = instance.time;
+
+            if (sampling == Baked) {
+                m.bakedClip.samplePose(time, tracks.data());
+                for (int i: animatedNodes)
+                    instance.pose.local[i] = tracks[m.skeleton.nodeAnimationIndices[i]];
+            } else {
+                for (int i: animatedNodes) {
+                    const int track = m.skeleton.nodeAnimationIndices[i];
+                    NodeAnimationCursor& cursor = instance.cursors[track];
+                    if (sampling == Compressed)
+                        toTransform(m.compressedClip.sampleTranslation(track, time, cursor.translation),
+                                    m.compressedClip.sampleRotation(track, time, cursor.rotation), instance.pose.local[i]);
+                    else
+                        toTransform(sampleTranslation(m.model.nodeAnimations[track], time, cursor),
+                                    sampleRotation(m.model.nodeAnimations[track], time, cursor), instance.pose.local[i]);
+                }
+            }
+        }
+
+        const Clock::time_point hierarchyBegin = Clock::now();
+        for (Instance<T>& instance: instances)
+            computeGlobalTransforms(m.skeleton, m.cache, instance.pose);
+
+        const Clock::time_point paletteBegin = Clock::now();
+        for (Instance<T>& instance: instances) {
+            for (size_t bone = 0; bone < boneNodes.size(); bone++) {
+                const int node = boneNodes[bone];
+                if (node != -1)
+                    instance.palette[bone] = instance.pose.global[node] * boneOffsets[bone];
+            }
+        }
+        const Clock::time_point paletteEnd = Clock::now();
+
+        result.sampleNs += elapsedNs(sampleBegin, hierarchyBegin);
+        result.hierarchyNs += elapsedNs(hierarchyBegin, paletteBegin);
+        result.paletteNs += elapsedNs(paletteBegin, paletteEnd);
+        for (const Instance<T>& instance: instances)
+            result.checksum += checksum(instance.palette[frame % instance.palette.size()]);
+    }
+    return result;
+}
+
+template <typename T>
+double runCrowd(const Model& m, NvJobSystem* workers, int numFrames, int numInstances, float deltaTime, bool layered, float& sum)
+{
+    Crowd crowd(m.skeleton, m.cache, m.animations, workers);
+    crowd.resize(numInstances);
+    CrowdInstances& instances = crowd.getInstances();
+    for (int i = 0; i < numInstances; i++) {
+        const float phase = 0.618034f * i - std::floor(0.618034f * i);
+        AnimationState& animation = instances.animations[i];
+        animation = animationblending::playClip(0, phase * m.duration);
+        instances.rates[i] = 0.75f + 0.5f * phase;
+        if (layered) {
+            // Fades that never finish, so that every frame blends.
+            animationblending::crossfade(animation.layers[0], 0, 1e6f, 0.5f * phase * m.duration);
+            AnimationLayer* upperBody = animationblending::addLayer(animation, AdditiveBlend, 0.5f, 0);
+            animationblending::addPlayer(*upperBody, 1, 1.f, (1.f - phase) * m.duration);
+        }
+    }
+
+    const Clock::time_point begin = Clock::now();
+    for (int frame = 0; frame < numFrames; frame++) {
+        crowd.update<T>(deltaTime);
+        sum += checksum(crowd.getPalette<T>(frame % numInstances)[0]);
+    }
+    return elapsedNs(begin, Clock::now());
+}
+
+bool loadModel(const std::string& assetName, Model& m)
+{
+    int32_t length = 0;
+    char* data = NvAssetLoaderRead(assetName.c_str(), length);
+    if (!data)
+        return false;
+
+    bool loaded = true;
+    if (assetName.size() > 4 && assetName.compare(assetName.size() - 4, 4, ".skm") == 0) {
+        BinaryModel binary;
+        loaded = BinaryModel::parse(data, length, binary);
+        if (loaded)
+            binary.toSkinnedModel(m.model, false);
+    } else {
+        struct memorybuf : public std::streambuf {
+            memorybuf(char* p, std::size_t n) {
+                setg(p, p, p+n);
+            }
+        };
+        memorybuf mb(data, length);
+        std::istream is(&mb);
+        cereal::BinaryInputArchive iarchive(is);
+        iarchive(m.model);
+    }
+    NvAssetLoaderFree(data);
+    return loaded;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int numFrames = 1000;
+    int numInstances = 16;
+    std::string assetName = "dude.binmesh";
+    std::string outputName;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "-frames" && i + 1 < argc)
+            std::stringstream(argv[++i]) >> numFrames;
+        else if (arg == "-instances" && i + 1 < argc)
+            std::stringstream(argv[++i]) >> numInstances;
+        else if (arg == "-model" && i + 1 < argc)
+            assetName = argv[++i];
+        else if (arg == "-o" && i + 1 < argc)
+            outputName = argv[++i];
+        else {
+            std::fprintf(stderr, "Usage: %s [-frames N] [-instances M] [-model dude.binmesh] [-o results.json]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (numFrames < 1 || numInstances < 1) {
+        std::fprintf(stderr, "Frame and instance counts must be positive\n");
+        return 1;
+    }
+    // Opened before the run, so that a bad path does not cost one.
+    FILE* out = outputName.empty() ? stdout : std::fopen(outputName.c_str(), "w");
+    if (!out) {
+        std::fprintf(stderr, "Cannot write %s\n", outputName.c_str());
+        return 1;
+    }
+
+    NvAssetLoaderInit(NULL);
+    NvAssetLoaderAddSearchPath("AngryDudeApp");
+    Model m;
+    if (!loadModel(assetName, m)) {
+        std::fprintf(stderr, "Cannot load %s\n", assetName.c_str());
+        if (out != stdout)
+            std::fclose(out);
+        return 1;
+    }
+    NvAssetLoaderShutdown();
+
+    m.duration = animationDuration(m.model.nodeAnimations);
+    m.skeleton = Skeleton::fromModel(m.model);
+    m.cache = SkeletonCache::fromSkeleton(m.skeleton, m.model.bones);
+    m.compressedClip = CompressedClip::compress(m.model.nodeAnimations, AnimationCompressionSettings());
+    m.bakedClip = BakedClip::bake(m.model.nodeAnimations, m.duration);
+    m.animations.clips.push_back(m.bakedClip);
+    m.animations.clips.push_back(animationblending::makeAdditive(m.bakedClip, m.bakedClip, 0.f));
+    const int spine = findNode(m.skeleton, m.model, "Spine1");
+    m.animations.masks.push_back(animationblending::makeSubtreeMask(m.skeleton, spine != -1 ? spine : 0, m.bakedClip.stride));
+    m.animations.restPose = animationblending::makeRestPose(m.skeleton, m.cache, m.bakedClip.stride);
+    const float deltaTime = 1.f / 60.f;
+
+    std::vector<Result> results;
+    for (int s = 0; s < NumSamplings; s++) {
+        results.push_back(runStages<nv::matrix4f>(m, Sampling(s), numFrames, numInstances, deltaTime));
+        results.push_back(runStages<DualQuaternion>(m, Sampling(s), numFrames, numInstances, deltaTime));
+    }
+
+    NvJobSystem workers;
+    float crowdChecksum = 0.f;
+    const double crowdMatrixNs = runCrowd<nv::matrix4f>(m, &workers, numFrames, numInstances, deltaTime, false, crowdChecksum);
+    const double crowdDualQuaternionNs = runCrowd<DualQuaternion>(m, &workers, numFrames, numInstances, deltaTime, false, crowdChecksum);
+    const double layeredMatrixNs = runCrowd<nv::matrix4f>(m, &workers, numFrames, numInstances, deltaTime, true, crowdChecksum);
+    const double layeredDualQuaternionNs = runCrowd<DualQuaternion>(m, &workers, numFrames, numInstances, deltaTime, true, crowdChecksum);
+
+    const double instanceFrames = double(numFrames) * numInstances;
+    const size_t numDynamicNodes = m.cache.dynamicNodes.size();
+    const size_t numAnimatedNodes = m.cache.animatedNodes.size();
+    const size_t numBones = m.cache.boneNodes.size();
+    std::fprintf(out, "{\n");
+    std::fprintf(out, "  \"model\": \"%s\",\n", assetName.c_str());
+    std::fprintf(out, "  \"frames\": %d,\n", numFrames);
+    std::fprintf(out, "  \"instances\": %d,\n", numInstances);
+    std::fprintf(out, "  \"nodes\": %u,\n", unsigned(m.skeleton.size()));
+    std::fprintf(out, "  \"dynamicNodes\": %u,\n", unsigned(numDynamicNodes));
+    std::fprintf(out, "  \"animatedNodes\": %u,\n", unsigned(numAnimatedNodes));
+    std::fprintf(out, "  \"bones\": %u,\n", unsigned(numBones));
+    std::fprintf(out, "  \"stages\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        std::fprintf(out, "    {\"representation\": \"%s\", \"sampling\": \"%s\", "
+                          "\"sampleNsPerNode\": %.2f, \"hierarchyNsPerNode\": %.2f, \"paletteNsPerBone\": %.2f, "
+                          "\"nsPerInstance\": %.1f, \"checksum\": %g}%s\n",
+                     r.representation.c_str(), r.sampling.c_str(),
+                     r.sampleNs / (instanceFrames * numAnimatedNodes),
+                     r.hierarchyNs / (instanceFrames * numDynamicNodes),
+                     r.paletteNs / (instanceFrames * numBones),
+                     (r.sampleNs + r.hierarchyNs + r.paletteNs) / instanceFrames,
+                     r.checksum, i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(out, "  ],\n");
+    std::fprintf(out, "  \"crowd\": {\"threads\": %d, \"matrixNsPerInstance\": %.1f, \"dualQuaternionNsPerInstance\": %.1f, "
+                      "\"layeredMatrixNsPerInstance\": %.1f, \"layeredDualQuaternionNsPerInstance\": %.1f, \"checksum\": %g}\n",
+                 workers.getNumThreads(), crowdMatrixNs / instanceFrames, crowdDualQuaternionNs / instanceFrames,
+                 layeredMatrixNs / instanceFrames, layeredDualQuaternionNs / instanceFrames, crowdChecksum);
+    std::fprintf(out, "}\n");
+    if (out != stdout)
+        std::fclose(out);
+    return 0;
+}
@@ -0,0 +1,449 @@
+#ifndef __AnimationBlending_hpp__
+#define __AnimationBlending_hpp__
+
+#include "Skinning.hpp"
+#include "DualQuaternion.hpp"
+#include "DualQuaternionN.hpp"
+#include "Skeleton.hpp"
+#include "BakedAnimation.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/// \file AnimationBlending.hpp
+/// \brief Clip players, crossfades, weighted blends, additive layers and bone masks.
+///
+/// An AnimationState is what one animated instance plays: up to MaxLayers
+/// layers, evaluated in order, each a weighted blend of up to MaxPlayers clip
+/// players. A layer either overrides what the layers below produced (by its
+/// weight, scaled per track by an optional bone mask) or adds to it. Additive
+/// clips hold every track relative to a reference pose, see makeAdditive.
+/// A crossfade is a layer with two players, one fading out while the other
+/// fades in; a blend of N clips is a layer with N players at fixed weights.
+///
+/// The state is plain data of fixed size: there are no node objects and no
+/// virtual calls, evaluate is one switch per layer, and nothing is allocated
+/// per frame, so Crowd keeps one state per instance and evaluates them all
+/// in parallel, each thread in its own BlendScratch.
+///
+/// Poses are blended as dual quaternions (DLB: weighted sum of the eight
+/// components in one hemisphere, then normalization), in structure-of-arrays
+/// form: one lane of BakedClip::stride floats per component, FloatN::Width
+/// tracks per instruction. The result is emitted as dual quaternions or as
+/// matrices; a linear blend of matrices would not stay rigid.
+
+/// \brief Local transforms of every track, as dual quaternion components in
+/// structure-of-arrays form: component c of track i at lanes[c*stride + i].
+struct BlendPose
+{
+    enum Lane { RX, RY, RZ, RW, DX, DY, DZ, DW, NumLanes };
+
+    BlendPose(): stride(0) {}
+
+    size_t stride;              ///< Tracks, padded to FloatN::Width.
+    std::vector<float> lanes;
+
+    /// Sizes the pose and sets every track to identity.
+    void reset(size_t paddedTracks)
+    {
+        stride = paddedTracks;
+        lanes.assign(NumLanes * stride, 0.f);
+        std::fill(&lanes[RW*stride], &lanes[RW*stride] + stride, 1.f);
+    }
+
+    float* lane(int c) { return &lanes[c*stride]; }
+    const float* lane(int c) const { return &lanes[c*stride]; }
+
+    /// FloatN::Width tracks starting at track.
+    const DualQuaternionN load(size_t track) const
+    {
+        const float* p = lanes.data() + track;
+        return DualQuaternionN(QuaternionN(FloatN::load(p + RX*stride), FloatN::load(p + RY*stride),
+                                           FloatN::load(p + RZ*stride), FloatN::load(p + RW*stride)),
+                               QuaternionN(FloatN::load(p + DX*stride), FloatN::load(p + DY*stride),
+                                           FloatN::load(p + DZ*stride), FloatN::load(p + DW*stride)));
+    }
+
+    void store(size_t track, const DualQuaternionN& dq)
+    {
+        float* p = lanes.data() + track;
+        dq.real.x.store(p + RX*stride); dq.real.y.store(p + RY*stride);
+        dq.real.z.store(p + RZ*stride); dq.real.w.store(p + RW*stride);
+        dq.dual.x.store(p + DX*stride); dq.dual.y.store(p + DY*stride);
+        dq.dual.z.store(p + DZ*stride); dq.dual.w.store(p + DW*stride);
+    }
+};
+
+/// \brief How a layer combines with the layers below it.
+enum BlendMode
+{
+    OverrideBlend,  ///< Blends towards the layer's pose by its weight.
+    AdditiveBlend   ///< Applies the layer's (additive) pose on top, scaled by its weight.
+};
+
+/// \brief Playback of one clip within a layer.
+struct ClipPlayer
+{
+    int   clip;      ///< Index into AnimationSet::clips.
+    float time;
+    float rate;      ///< 1 is real time.
+    float weight;    ///< Relative to the other players of the layer.
+    float fadeRate;  ///< Weight change per second; a player faded out to 0 is dropped.
+    bool  loop;      ///< Wraps time around the clip's duration; holds the last frame otherwise.
+};
+
+/// \brief Weighted blend of clip players.
+struct AnimationLayer
+{
+    static const int MaxPlayers = 4;
+
+    BlendMode  mode;
+    float      weight;      ///< Of the whole layer, 0 to 1.
+    int        mask;        ///< Index into AnimationSet::masks; -1 for every track.
+    int        numPlayers;
+    ClipPlayer players[MaxPlayers];
+};
+
+/// \brief Everything one animated instance plays.
+struct AnimationState
+{
+    static const int MaxLayers = 4;
+
+    int            numLayers;
+    AnimationLayer layers[MaxLayers];
+};
+
+/// \brief Clips, bone masks and rest pose shared by the instances blending them.
+/// Every clip is baked from the same tracks.
+struct AnimationSet
+{
+    std::vector<BakedClip> clips;
+    std::vector<std::vector<float> > masks;   ///< Weight per track, stride long, see makeSubtreeMask.
+    BlendPose restPose;                       ///< What a base layer of weight below 1 blends with; identities if unset.
+
+    size_t numTracks() const { return clips.empty() ? 0 : clips[0].numTracks; }
+    size_t stride() const { return clips.empty() ? 0 : clips[0].stride; }
+};
+
+/// \brief Per-thread working memory of evaluate; sized on first use.
+struct BlendScratch
+{
+    BlendPose result;
+    BlendPose layer;
+    BlendPose sample;
+};
+
+namespace animationblending {
+
+/// A state playing clip in a single override layer.
+inline AnimationState playClip(int clip, float time = 0.f, float rate = 1.f, bool loop = true)
+{
+    AnimationState state;
+    state.numLayers = 1;
+    AnimationLayer& layer = state.layers[0];
+    layer.mode = OverrideBlend;
+    layer.weight = 1.f;
+    layer.mask = -1;
+    layer.numPlayers = 1;
+    const ClipPlayer player = {clip, time, rate, 1.f, 0.f, loop};
+    layer.players[0] = player;
+    return state;
+}
+
+/// Adds an empty layer on top; returns it, or nullptr if the state is full.
+inline AnimationLayer* addLayer(AnimationState& state, BlendMode mode, float weight = 1.f, int mask = -1)
+{
+    if (state.numLayers == AnimationState::MaxLayers)
+        return nullptr;
+    AnimationLayer& layer = state.layers[state.numLayers++];
+    layer.mode = mode;
+    layer.weight = weight;
+    layer.mask = mask;
+    layer.numPlayers = 0;
+    return &layer;
+}
+
+/// Adds a player to the blend of layer, replacing the lightest one if the
+/// layer is full.
+inline ClipPlayer& addPlayer(AnimationLayer& layer, int clip, float weight, float time = 0.f, float rate = 1.f, bool loop = true)
+{
+    int slot = layer.numPlayers;
+    if (slot == AnimationLayer::MaxPlayers) {
+        slot = 0;
+        for (int i = 1; i < layer.numPlayers; i++)
+            if (layer.players[i].weight < layer.players[slot].weight)
+                slot = i;
+    } else {
+        layer.numPlayers++;
+    }
+    const ClipPlayer player = {clip, time, rate, weight, 0.f, loop};
+    layer.players[slot] = player;
+    return layer.players[slot];
+}
+
+/// Starts clip in layer and fades it in over fadeTime seconds while every
+/// other player of the layer fades out. A fadeTime of 0 cuts.
+inline void crossfade(AnimationLayer& layer, int clip, float fadeTime, float time = 0.f, float rate = 1.f, bool loop = true)
+{
+    if (fadeTime <= 0.f) {
+        layer.numPlayers = 0;
+        addPlayer(layer, clip, 1.f, time, rate, loop);
+        return;
+    }
+    for (int i = 0; i < layer.numPlayers; i++)
+        layer.players[i].fadeRate = -layer.players[i].weight / fadeTime;
+    ClipPlayer& player = addPlayer(layer, clip, 0.f, time, rate, loop);
+    player.fadeRate = 1.f / fadeTime;
+}
+
+/// Advances every player by deltaTime times its rate and its fade, and drops
+/// the players that faded out.
+inline void advance(AnimationState& state, float deltaTime, const AnimationSet& set)
+{
+    for (int l = 0; l < state.numLayers; l++) {
+        AnimationLayer& layer = state.layers[l];
+        int kept = 0;
+        for (int i = 0; i < layer.numPlayers; i++) {
+            ClipPlayer player = layer.players[i];
+            const float duration = set.clips[player.clip].duration;
+            float time = player.time + player.rate * deltaTime;
+            if (player.loop && duration > 0.f && (time >= duration || time < 0.f)) {
+                time = std::fmod(time, duration);
+                if (time < 0.f)
+                    time += duration;
+            } else if (!player.loop) {
+                time = std::min(std::max(time, 0.f), duration);
+            }
+            player.time = time;
+
+            if (player.fadeRate != 0.f) {
+                player.weight += player.fadeRate * deltaTime;
+                if (player.weight >= 1.f) {
+                    player.weight = 1.f;
+                    player.fadeRate = 0.f;
+                } else if (player.weight <= 0.f) {
+                    continue;
+                }
+            }
+            layer.players[kept++] = player;
+        }
+        layer.numPlayers = kept;
+    }
+}
+
+/// Per-track mask weighting the tracks of the nodes in the subtree of flat
+/// node root (the upper body below the spine, say) by 1 and all others by 0.
+inline std::vector<float> makeSubtreeMask(const Skeleton& skeleton, int root, size_t stride)
+{
+    std::vector<float> mask(stride, 0.f);
+    std::vector<char> inside(skeleton.size(), 0);
+    // Preorder: a subtree is contiguous and starts at its root.
+    for (size_t i = root; i < skeleton.size(); i++) {
+        inside[i] = static_cast<int>(i) == root || (skeleton.parents[i] >= 0 && inside[skeleton.parents[i]]);
+        if (!inside[i])
+            break;
+        const int track = skeleton.nodeAnimationIndices[i];
+        if (track != -1 && static_cast<size_t>(track) < stride)
+            mask[track] = 1.f;
+    }
+    return mask;
+}
+
+/// The default local transforms of the animated nodes, by track.
+inline BlendPose makeRestPose(const Skeleton& skeleton, const SkeletonCache& cache, size_t stride)
+{
+    BlendPose pose;
+    pose.reset(stride);
+    for (int i: cache.animatedNodes) {
+        const size_t track = skeleton.nodeAnimationIndices[i];
+        const DualQuaternion& dq = cache.dualQuaternions.defaultLocal[i];
+        const float* components = &dq.real.x;
+        for (int c = 0; c < BlendPose::NumLanes; c++)
+            pose.lane(c)[track] = components[c];
+    }
+    return pose;
+}
+
+/// clip relative to the pose reference has at referenceTime: every frame holds
+/// the transform that, applied after the reference (as the local transform of
+/// the same node), gives the frame. An AdditiveBlend layer playing it at
+/// weight 1 adds the motion clip makes away from that pose.
+inline BakedClip makeAdditive(const BakedClip& clip, const BakedClip& reference, float referenceTime)
+{
+    std::vector<DualQuaternion> base(reference.numTracks);
+    reference.samplePose(referenceTime, base.data());
+
+    BakedClip additive = clip;
+    const size_t stride = clip.stride;
+    for (size_t frame = 0; frame < clip.numFrames; frame++) {
+        float* c = &additive.samples[frame * BakedClip::NumChannels * stride];
+        for (size_t track = 0; track < clip.numTracks; track++) {
+            const Quaternion rotation(c[BakedClip::RX*stride + track], c[BakedClip::RY*stride + track],
+                                      c[BakedClip::RZ*stride + track], c[BakedClip::RW*stride + track]);
+            const nv::vec3f translation(c[BakedClip::TX*stride + track], c[BakedClip::TY*stride + track],
+                                        c[BakedClip::TZ*stride + track]);
+            const DualQuaternion inverseBase(conjugate(base[track].real), conjugate(base[track].dual));
+            const DualQuaternion delta = inverseBase * DualQuaternion(translation, rotation);
+            const Quaternion t = 2.f * delta.dual * conjugate(delta.real);
+            const float values[BakedClip::NumChannels] = {t.x, t.y, t.z, delta.real.x, delta.real.y, delta.real.z, delta.real.w};
+            for (int channel = 0; channel < BakedClip::NumChannels; channel++)
+                c[channel*stride + track] = values[channel];
+        }
+    }
+    return additive;
+}
+
+namespace detail {
+
+inline const FloatN hemisphere(const DualQuaternionN& a, const DualQuaternionN& b)
+{
+    return select(dot(a.real, b.real) < FloatN(0.f), FloatN(-1.f), FloatN(1.f));
+}
+
+inline const DualQuaternionN scale(const FloatN& s, const DualQuaternionN& dq)
+{
+    return DualQuaternionN(s * dq.real, s * dq.dual);
+}
+
+inline const DualQuaternionN add(const DualQuaternionN& a, const DualQuaternionN& b)
+{
+    return DualQuaternionN(a.real + b.real, a.dual + b.dual);
+}
+
+/// acc += weight * pose, pose flipped into acc's hemisphere; acc = weight * pose if first.
+inline void accumulate(BlendPose& acc, const BlendPose& pose, float weight, bool first)
+{
+    const FloatN w(weight);
+    for (size_t track = 0; track < acc.stride; track += FloatN::Width) {
+        const DualQuaternionN b = pose.load(track);
+        if (first) {
+            acc.store(track, scale(w, b));
+        } else {
+            const DualQuaternionN a = acc.load(track);
+            acc.store(track, add(a, scale(w * hemisphere(a, b), b)));
+        }
+    }
+}
+
+inline void normalize(BlendPose& pose)
+{
+    for (size_t track = 0; track < pose.stride; track += FloatN::Width)
+        pose.store(track, ::normalize(pose.load(track)));
+}
+
+/// Per-track weight of a layer.
+inline const FloatN trackWeight(const FloatN& weight, const float* mask, size_t track)
+{
+    return mask ? weight * FloatN::load(mask + track) : weight;
+}
+
+/// a = normalize((1 - w) a + w b), w being weight times the mask.
+inline void blend(BlendPose& a, const BlendPose& b, float weight, const float* mask)
+{
+    const FloatN layerWeight(weight), one(1.f);
+    for (size_t track = 0; track < a.stride; track += FloatN::Width) {
+        const FloatN w = trackWeight(layerWeight, mask, track);
+        const DualQuaternionN p = a.load(track), q = b.load(track);
+        a.store(track, ::normalize(add(scale(one - w, p), scale(w * hemisphere(p, q), q))));
+    }
+}
+
+/// a = a * normalize((1 - w) identity + w delta), w being weight times the mask.
+inline void applyAdditive(BlendPose& a, const BlendPose& delta, float weight, const float* mask)
+{
+    const FloatN layerWeight(weight), one(1.f);
+    const DualQuaternionN identity(DualQuaternion::identity());
+    for (size_t track = 0; track < a.stride; track += FloatN::Width) {
+        const FloatN w = trackWeight(layerWeight, mask, track);
+        const DualQuaternionN d = delta.load(track);
+        const DualQuaternionN scaled = ::normalize(add(scale(one - w, identity), scale(w * hemisphere(identity, d), d)));
+        a.store(track, a.load(track) * scaled);
+    }
+}
+
+inline void emit(const BlendPose& pose, size_t numTracks, DualQuaternion* out)
+{
+    for (size_t track = 0; track < numTracks; track += FloatN::Width) {
+        const size_t count = std::min<size_t>(numTracks - track, FloatN::Width);
+        if (count == static_cast<size_t>(FloatN::Width))
+            pose.load(track).store(out + track);
+        else
+            pose.load(track).storePartial(out + track, count);
+    }
+}
+
+inline void emit(const BlendPose& pose, size_t numTracks, nv::matrix4f* out)
+{
+    for (size_t track = 0; track < numTracks; track += FloatN::Width) {
+        const size_t count = std::min<size_t>(numTracks - track, FloatN::Width);
+        nv::matrix4f matrices[FloatN::Width];
+        pose.load(track).toMatrices(matrices);
+        for (size_t i = 0; i < count; i++)
+            out[track + i] = matrices[i];
+    }
+}
+
+} // namespace detail
+
+/// Blends the local transforms state plays into tracks[0, set.numTracks()),
+/// T being nv::matrix4f or DualQuaternion. Tracks no layer covers keep the
+/// rest pose.
+template <typename T>
+void evaluate(const AnimationState& state, const AnimationSet& set, BlendScratch& scratch, T* tracks)
+{
+    const size_t stride = set.stride();
+    if (scratch.result.stride != stride) {
+        scratch.result.reset(stride);
+        scratch.layer.reset(stride);
+        scratch.sample.reset(stride);
+    }
+    if (set.restPose.stride == stride)
+        std::copy(set.restPose.lanes.begin(), set.restPose.lanes.end(), scratch.result.lanes.begin());
+    else
+        scratch.result.reset(stride);
+
+    for (int l = 0; l < state.numLayers; l++) {
+        const AnimationLayer& layer = state.layers[l];
+        float totalWeight = 0.f;
+        for (int i = 0; i < layer.numPlayers; i++)
+            totalWeight += layer.players[i].weight;
+        if (layer.weight <= 0.f || totalWeight <= 0.f)
+            continue;
+
+        // The players' weighted blend; a single player is sampled as is.
+        int sampled = 0;
+        for (int i = 0; i < layer.numPlayers; i++) {
+            const ClipPlayer& player = layer.players[i];
+            if (player.weight <= 0.f)
+                continue;
+            const BakedClip& clip = set.clips[player.clip];
+            if (player.weight == totalWeight) {
+                clip.samplePose(player.time, scratch.layer.lanes.data(), stride);
+                sampled = 1;
+                break;
+            }
+            clip.samplePose(player.time, scratch.sample.lanes.data(), stride);
+            detail::accumulate(scratch.layer, scratch.sample, player.weight / totalWeight, sampled == 0);
+            sampled++;
+        }
+        if (sampled > 1)
+            detail::normalize(scratch.layer);
+
+        const float* mask = layer.mask >= 0 ? set.masks[layer.mask].data() : nullptr;
+        const float weight = std::min(layer.weight, 1.f);
+        if (layer.mode == AdditiveBlend)
+            detail::applyAdditive(scratch.result, scratch.layer, weight, mask);
+        else if (weight == 1.f && !mask)
+            std::swap(scratch.result.lanes, scratch.layer.lanes);
+        else
+            detail::blend(scratch.result, scratch.layer, weight, mask);
+    }
+    detail::emit(scratch.result, set.numTracks(), tracks);
+}
+
+} // namespace animationblending
+
+#endif
@@ -0,0 +1,554 @@
+#include "Animation.hpp"
+#include "CompressedAnimation.hpp"
+#include "BakedAnimation.hpp"
+#include "AnimationBlending.hpp"
+#include "NV/NvMath.h"
+#include <iostream>
+#include <vector>
+
+/// Compiled with
+/// clang AnimationTests.cpp -o AnimationTests -g3 -Wall -std=c++11 -I. -I../../extensions/include/ -L./gtest/ -lgtest -lstdc++ -lpthread -lm
+///
+
+#include "gtest/gtest.h"
+
+std::vector<AnimationKey> makeTestKeys(int count)
+{
+    std::vector<AnimationKey> keys(count);
+    float time = 0.f;
+    for (int i = 0; i < count; i++) {
+        keys[i].value = nv::vec4f(float(i), 0.f, 0.f, 1.f);
+        keys[i].time = time;
+        time += 0.01f + 0.005f*(i % 3);
+    }
+    return keys;
+}
+
+// The scan AngryDudeApp used before cursors were introduced.
+void linearScan(const std::vector<AnimationKey>& keys, float time, size_t& index0, size_t& index1)
+{
+    index0 = 0;
+    index1 = 0;
+    while (index1 < keys.size() && keys[index1].time < time)
+        index1++;
+    if (index1 == keys.size())
+        index1 = 0;
+    if (index1 > 0)
+        index0 = index1-1;
+}
+
+void expectMatchesLinearScan(const std::vector<AnimationKey>& keys, float time, KeyframeCursor& cursor)
+{
+    size_t index0, index1;
+    linearScan(keys, time, index0, index1);
+    const KeyframePair pair = findKeyframes(keys, time, cursor);
+    EXPECT_EQ(index0, pair.index0) << "time " << time;
+    EXPECT_EQ(index1, pair.index1) << "time " << time;
+    EXPECT_GE(pair.t, 0.f);
+    EXPECT_LE(pair.t, 1.f);
+}
+
+TEST(KeyframeCursorTest, ForwardPlayback)
+{
+    const std::vector<AnimationKey> keys = makeTestKeys(100);
+    KeyframeCursor cursor;
+    for (float time = 0.f; time < keys.back().time + 0.1f; time += 1.f/60.f)
+        expectMatchesLinearScan(keys, time, cursor);
+}
+
+TEST(KeyframeCursorTest, LoopsAndSeeks)
+{
+    const std::vector<AnimationKey> keys = makeTestKeys(1000);
+    const float duration = keys.back().time;
+    KeyframeCursor cursor;
+    float time = 0.f;
+    for (int frame = 0; frame < 5000; frame++) {
+        time += 0.037f;
+        if (time > duration)
+            time -= duration;
+        if (frame % 97 == 0)
+            time = duration * ((frame * 7919) % 1000) / 1000.f; // random seek
+        expectMatchesLinearScan(keys, time, cursor);
+    }
+}
+
+TEST(KeyframeCursorTest, ExactKeyTimesAndEdges)
+{
+    const std::vector<AnimationKey> keys = makeTestKeys(10);
+    KeyframeCursor cursor;
+    for (size_t i = 0; i < keys.size(); i++)
+        expectMatchesLinearScan(keys, keys[i].time, cursor);
+    expectMatchesLinearScan(keys, -1.f, cursor);
+    expectMatchesLinearScan(keys, keys.back().time + 1.f, cursor);
+
+    const KeyframePair pair = findKeyframes(keys, 0.5f*(keys[3].time + keys[4].time), cursor);
+    EXPECT_NEAR(0.5f, pair.t, 0.0001f);
+
+    std::vector<AnimationKey> single = makeTestKeys(1);
+    KeyframeCursor singleCursor;
+    const KeyframePair hold = findKeyframes(single, 0.5f, singleCursor);
+    EXPECT_EQ(0u, hold.index0);
+    EXPECT_EQ(0u, hold.index1);
+    EXPECT_EQ(0.f, hold.t);
+}
+
+TEST(KeyframeCursorTest, TrailingPaddingKeys)
+{
+    // Like dude.binmesh: 39 keys, then padding at time 0 up to 100 keys.
+    std::vector<AnimationKey> keys = makeTestKeys(39);
+    keys.resize(100, makeTestKeys(1)[0]);
+
+    KeyframeCursor cursor;
+    const float end = keys[38].time + 0.05f;
+    for (int loop = 0; loop < 3; loop++)
+        for (float time = 0.f; time < end; time += 1.f/60.f)
+            expectMatchesLinearScan(keys, time, cursor);
+    for (float time = end; time > -0.05f; time -= 0.037f)
+        expectMatchesLinearScan(keys, time, cursor);
+    EXPECT_EQ(39u, cursor.sortedKeys);
+
+    const KeyframePair past = findKeyframes(keys, end, cursor);
+    EXPECT_EQ(0u, past.index0);
+    EXPECT_EQ(0u, past.index1);
+    EXPECT_EQ(0.f, past.t);
+}
+
+TEST(KeyframeCursorTest, PlainTimeArrays)
+{
+    const std::vector<AnimationKey> keys = makeTestKeys(50);
+    std::vector<float> times;
+    for (const AnimationKey& key: keys)
+        times.push_back(key.time);
+    KeyframeCursor keyCursor, timeCursor;
+    for (float time = -0.1f; time < keys.back().time + 0.1f; time += 0.013f) {
+        const KeyframePair a = findKeyframes(keys, time, keyCursor);
+        const KeyframePair b = findKeyframes(times.data(), times.size(), time, timeCursor);
+        EXPECT_EQ(a.index0, b.index0);
+        EXPECT_EQ(a.index1, b.index1);
+        EXPECT_EQ(a.t, b.t);
+    }
+}
+
+nv::quaternionf testRotation(float angle, const nv::vec3f& axis)
+{
+    const nv::vec3f n = nv::normalize(axis);
+    const float s = std::sin(0.5f*angle);
+    return nv::quaternionf(s*n.x, s*n.y, s*n.z, std::cos(0.5f*angle));
+}
+
+/// Three tracks sampled at 30 fps: a moving and turning node, a node that only
+/// moves linearly and a constant one.
+std::vector<NodeAnimation> makeTestClip(int numKeys)
+{
+    std::vector<NodeAnimation> clip(3);
+    for (int i = 0; i < numKeys; i++) {
+        const float time = i / 30.f;
+        AnimationKey key;
+        key.time = time;
+
+        key.value = nv::vec4f(std::sin(3.f*time), 10.f + 2.f*std::cos(2.f*time), 0.5f*time, 0.f);
+        clip[0].translationKeys.push_back(key);
+        const nv::quaternionf q = testRotation(2.5f*std::sin(1.7f*time), nv::vec3f(1.f, time, 0.3f));
+        key.value = nv::vec4f(q.x, q.y, q.z, q.w);
+        clip[0].rotationKeys.push_back(key);
+
+        key.value = nv::vec4f(-4.f + 3.f*time, 1.f, 2.f, 0.f);
+        clip[1].translationKeys.push_back(key);
+        key.value = nv::vec4f(0.f, 0.f, 0.f, 1.f);
+        clip[1].rotationKeys.push_back(key);
+
+        key.value = nv::vec4f(0.f, 7.f, 0.f, 0.f);
+        clip[2].translationKeys.push_back(key);
+        const nv::quaternionf r = testRotation(0.8f, nv::vec3f(0.f, 1.f, 1.f));
+        key.value = nv::vec4f(r.x, r.y, r.z, r.w);
+        clip[2].rotationKeys.push_back(key);
+    }
+    return clip;
+}
+
+TEST(CompressedAnimationTest, SmallestThreeRoundTrip)
+{
+    for (int i = 0; i < 200; i++) {
+        nv::quaternionf q = testRotation(0.1f*i - 10.f, nv::vec3f(std::sin(0.3f*i), std::cos(0.7f*i), 0.2f));
+        if (i % 2)
+            q = nv::quaternionf(-q.x, -q.y, -q.z, -q.w);
+        uint16_t packed[3];
+        animationcompression::encodeRotation(q, packed);
+        const nv::quaternionf decoded = animationcompression::decodeRotation(packed);
+        EXPECT_LT(animationcompression::rotationError(q, decoded), animationcompression::rotationQuantizationError);
+    }
+}
+
+TEST(CompressedAnimationTest, WithinErrorBound)
+{
+    const std::vector<NodeAnimation> source = makeTestClip(90);
+    AnimationCompressionSettings settings;
+    settings.maxTranslationError = 0.005f;
+    settings.maxRotationError = 0.002f;
+    AnimationCompressionStats stats;
+    const CompressedClip clip = CompressedClip::compress(source, settings, &stats);
+
+    ASSERT_EQ(source.size(), clip.numTracks());
+    EXPECT_LE(stats.maxTranslationError, settings.maxTranslationError);
+    EXPECT_LE(stats.maxRotationError, settings.maxRotationError);
+    EXPECT_LT(stats.compressedKeys, stats.sourceKeys);
+    EXPECT_EQ(stats.compressedBytes, clip.sizeInBytes());
+    EXPECT_LT(4*stats.compressedBytes, stats.sourceBytes);
+
+    // Between keys both sides interpolate linearly, so translation errors stay bounded too.
+    for (size_t track = 0; track < source.size(); track++) {
+        const std::vector<AnimationKey>& keys = source[track].translationKeys;
+        KeyframeCursor sourceCursor, cursor;
+        for (float time = 0.f; time < keys.back().time; time += 1.f/97.f) {
+            const KeyframePair pair = findKeyframes(keys, time, sourceCursor);
+            const nv::vec4f v = (1.f-pair.t)*keys[pair.index0].value + pair.t*keys[pair.index1].value;
+            const nv::vec3f sampled = clip.sampleTranslation(static_cast<int>(track), time, cursor);
+            EXPECT_LE(animationcompression::translationError(nv::vec3f(v.x, v.y, v.z), sampled), settings.maxTranslationError)
+                << "track " << track << " time " << time;
+        }
+    }
+}
+
+TEST(CompressedAnimationTest, SharedTimeAxesAndConstantTracks)
+{
+    const std::vector<NodeAnimation> source = makeTestClip(60);
+    AnimationCompressionSettings settings;
+    settings.removeKeys = false;
+    const CompressedClip clip = CompressedClip::compress(source, settings);
+    // Without key removal every track has the same keys.
+    EXPECT_EQ(1u, clip.timeAxes.size());
+    EXPECT_EQ(60u, clip.times.size());
+
+    const CompressedClip reduced = CompressedClip::compress(source);
+    // Track 1 translates linearly: only its end keys remain.
+    EXPECT_EQ(2u, reduced.timeAxes[reduced.translationTracks[1].timeAxis].numKeys);
+    // Constant tracks keep one key and share one axis.
+    EXPECT_EQ(1u, reduced.timeAxes[reduced.translationTracks[2].timeAxis].numKeys);
+    EXPECT_EQ(reduced.rotationTracks[1].timeAxis, reduced.translationTracks[2].timeAxis);
+    EXPECT_EQ(reduced.rotationTracks[2].timeAxis, reduced.translationTracks[2].timeAxis);
+    EXPECT_EQ(8u, reduced.translationTracks[2].bits);
+    KeyframeCursor cursor;
+    const nv::vec3f constant = reduced.sampleTranslation(2, 1.3f, cursor);
+    EXPECT_NEAR(7.f, constant.y, 0.0001f);
+}
+
+TEST(CompressedAnimationTest, PaddingKeysAreLeftOut)
+{
+    // Like dude.binmesh: every track padded to 100 keys at time 0.
+    const std::vector<NodeAnimation> source = makeTestClip(60);
+    std::vector<NodeAnimation> padded = source;
+    for (NodeAnimation& animation: padded) {
+        AnimationKey padding = animation.translationKeys.back();
+        padding.time = 0.f;
+        animation.translationKeys.resize(100, padding);
+        padding = animation.rotationKeys.back();
+        padding.time = 0.f;
+        animation.rotationKeys.resize(100, padding);
+    }
+
+    for (bool removeKeys: {true, false}) {
+        AnimationCompressionSettings settings;
+        settings.removeKeys = removeKeys;
+        AnimationCompressionStats stats, paddedStats;
+        const CompressedClip clip = CompressedClip::compress(source, settings, &stats);
+        const CompressedClip paddedClip = CompressedClip::compress(padded, settings, &paddedStats);
+        EXPECT_EQ(stats.compressedKeys, paddedStats.compressedKeys);
+        EXPECT_EQ(stats.compressedBytes, paddedStats.compressedBytes);
+        EXPECT_EQ(clip.times, paddedClip.times);
+        EXPECT_EQ(stats.maxTranslationError, paddedStats.maxTranslationError);
+        EXPECT_EQ(stats.maxRotationError, paddedStats.maxRotationError);
+    }
+}
+
+TEST(CompressedAnimationTest, CursorsMatchFreshLookups)
+{
+    const std::vector<NodeAnimation> source = makeTestClip(60);
+    const CompressedClip clip = CompressedClip::compress(source);
+    KeyframeCursor translationCursor, rotationCursor;
+    const float duration = source[0].translationKeys.back().time;
+    for (float time = 0.f; time < 3.f * duration; time += 1.f/60.f) {
+        const float t = std::fmod(time, duration);
+        KeyframeCursor fresh;
+        const nv::vec3f a = clip.sampleTranslation(0, t, translationCursor);
+        const nv::vec3f b = clip.sampleTranslation(0, t, fresh);
+        EXPECT_EQ(a.x, b.x);
+        EXPECT_EQ(a.y, b.y);
+        EXPECT_EQ(a.z, b.z);
+        fresh = KeyframeCursor();
+        const nv::quaternionf p = clip.sampleRotation(0, t, rotationCursor);
+        const nv::quaternionf q = clip.sampleRotation(0, t, fresh);
+        EXPECT_EQ(p.w, q.w);
+    }
+}
+
+/// Local transform of a keyframe track the way AngryDudeApp samples it.
+DualQuaternion sampleKeyframes(const NodeAnimation& animation, float time)
+{
+    NodeAnimationCursor cursor;
+    const KeyframePair tk = findKeyframes(animation.translationKeys, time, cursor.translation);
+    const nv::vec4f t = (1.f-tk.t)*animation.translationKeys[tk.index0].value + tk.t*animation.translationKeys[tk.index1].value;
+    const KeyframePair rk = findKeyframes(animation.rotationKeys, time, cursor.rotation);
+    const nv::vec4f& r0 = animation.rotationKeys[rk.index0].value;
+    const nv::vec4f& r1 = animation.rotationKeys[rk.index1].value;
+    const nv::quaternionf r = interpolateRotation(nv::quaternionf(r0.x, r0.y, r0.z, r0.w), nv::quaternionf(r1.x, r1.y, r1.z, r1.w), rk.t);
+    return DualQuaternion(nv::vec3f(t.x, t.y, t.z), Quaternion(r.x, r.y, r.z, r.w));
+}
+
+::testing::AssertionResult TransformsNear(const DualQuaternion& a, const DualQuaternion& b, float eps)
+{
+    const nv::matrix4f ma = DualQuaternion::toMatrix<nv::matrix4f>(a);
+    const nv::matrix4f mb = DualQuaternion::toMatrix<nv::matrix4f>(b);
+    for (int e = 0; e < 16; e++)
+        if (std::abs(ma._array[e] - mb._array[e]) > eps)
+            return ::testing::AssertionFailure() << "element " << e << ": " << ma._array[e] << " vs " << mb._array[e];
+    return ::testing::AssertionSuccess();
+}
+
+TEST(BakedClipTest, FrameLookup)
+{
+    const std::vector<NodeAnimation> source = makeTestClip(40);
+    const BakedClip clip = BakedClip::bake(source, 1.f, 30.f);
+    EXPECT_EQ(31u, clip.numFrames);
+    EXPECT_EQ(0u, clip.stride % FloatN::Width);
+
+    BakedFramePair pair = clip.findFrames(0.5f / 30.f);
+    EXPECT_EQ(0u, pair.frame0);
+    EXPECT_EQ(1u, pair.frame1);
+    EXPECT_NEAR(0.5f, pair.t, 0.001f);
+    pair = clip.findFrames(2.f);
+    EXPECT_EQ(30u, pair.frame0);
+    EXPECT_EQ(30u, pair.frame1);
+    pair = clip.findFrames(-1.f);
+    EXPECT_EQ(0u, pair.frame0);
+    EXPECT_EQ(0.f, pair.t);
+}
+
+TEST(BakedClipTest, MatchesKeyframeSampling)
+{
+    const std::vector<NodeAnimation> source = makeTestClip(40);
+    const float duration = source[0].translationKeys.back().time;
+    const BakedClip clip = BakedClip::bake(source, duration, 60.f);
+    std::vector<DualQuaternion> pose(clip.numTracks);
+
+    // Exactly at frame times the baked clip reproduces the keyframes.
+    for (size_t frame = 0; frame < clip.numFrames; frame += 7) {
+        const float time = frame * clip.frameDuration;
+        clip.samplePose(time, pose.data());
+        for (size_t track = 0; track < source.size(); track++)
+            EXPECT_TRUE(TransformsNear(sampleKeyframes(source[track], time), pose[track], 0.0001f)) << "frame " << frame;
+    }
+    // In between, resampling error stays small for smooth motion.
+    for (float time = 0.f; time < duration; time += 0.0123f) {
+        clip.samplePose(time, pose.data());
+        for (size_t track = 0; track < source.size(); track++)
+            EXPECT_TRUE(TransformsNear(sampleKeyframes(source[track], time), pose[track], 0.01f)) << "time " << time;
+    }
+}
+
+TEST(BakedClipTest, MatricesMatchDualQuaternions)
+{
+    std::vector<NodeAnimation> source = makeTestClip(30);
+    // Enough tracks for a partial last chunk at any FloatN::Width.
+    for (int i = 0; i < 2*FloatN::Width; i++)
+        source.push_back(source[i % 3]);
+    const BakedClip clip = BakedClip::bake(source, 0.9f);
+    std::vector<DualQuaternion> dqs(clip.numTracks);
+    std::vector<nv::matrix4f> matrices(clip.numTracks);
+    for (float time = 0.f; time < 1.f; time += 0.1f) {
+        clip.samplePose(time, dqs.data());
+        clip.samplePose(time, matrices.data());
+        for (size_t track = 0; track < clip.numTracks; track++) {
+            const nv::matrix4f expected = DualQuaternion::toMatrix<nv::matrix4f>(dqs[track]);
+            for (int e = 0; e < 16; e++)
+                EXPECT_NEAR(expected._array[e], matrices[track]._array[e], 0.0001f);
+        }
+    }
+}
+
+/// Two clips of the same tracks, moving differently.
+AnimationSet makeTestAnimationSet()
+{
+    AnimationSet set;
+    std::vector<NodeAnimation> source = makeTestClip(31);
+    set.clips.push_back(BakedClip::bake(source, 1.f));
+    for (NodeAnimation& track: source) {
+        for (size_t k = 0; k < track.rotationKeys.size(); k++) {
+            const nv::quaternionf q = testRotation(0.1f*k, nv::vec3f(0.f, 1.f, 0.2f));
+            track.rotationKeys[k].value = nv::vec4f(q.x, q.y, q.z, q.w);
+            track.translationKeys[k].value.z += 3.f;
+        }
+    }
+    set.clips.push_back(BakedClip::bake(source, 1.f));
+    return set;
+}
+
+std::vector<DualQuaternion> samplePose(const AnimationSet& set, int clip, float time)
+{
+    std::vector<DualQuaternion> pose(set.numTracks());
+    set.clips[clip].samplePose(time, pose.data());
+    return pose;
+}
+
+/// DLB the way skinning.vert blends bones: weighted sum in the hemisphere of
+/// the first, normalized.
+DualQuaternion blendReference(const DualQuaternion* dqs, const float* weights, int count)
+{
+    Quaternion real(0.f, 0.f, 0.f, 0.f), dual(0.f, 0.f, 0.f, 0.f);
+    for (int i = 0; i < count; i++) {
+        const Quaternion& r = dqs[i].real;
+        const Quaternion& r0 = dqs[0].real;
+        const float w = weights[i] * (r.x*r0.x + r.y*r0.y + r.z*r0.z + r.w*r0.w < 0.f ? -1.f : 1.f);
+        real = real + w * r;
+        dual = dual + w * dqs[i].dual;
+    }
+    const float invLength = 1.f / std::sqrt(real.x*real.x + real.y*real.y + real.z*real.z + real.w*real.w);
+    return DualQuaternion(invLength * real, invLength * dual);
+}
+
+TEST(AnimationBlendingTest, SingleClipMatchesSampling)
+{
+    const AnimationSet set = makeTestAnimationSet();
+    BlendScratch scratch;
+    std::vector<DualQuaternion> dqs(set.numTracks());
+    std::vector<nv::matrix4f> matrices(set.numTracks());
+    for (float time = 0.f; time < 1.f; time += 0.17f) {
+        const AnimationState state = animationblending::playClip(1, time);
+        animationblending::evaluate(state, set, scratch, dqs.data());
+        animationblending::evaluate(state, set, scratch, matrices.data());
+        const std::vector<DualQuaternion> expected = samplePose(set, 1, time);
+        for (size_t track = 0; track < set.numTracks(); track++) {
+            EXPECT_TRUE(TransformsNear(expected[track], dqs[track], 1e-5f));
+            const nv::matrix4f m = DualQuaternion::toMatrix<nv::matrix4f>(expected[track]);
+            for (int e = 0; e < 16; e++)
+                EXPECT_NEAR(m._array[e], matrices[track]._array[e], 1e-4f);
+        }
+    }
+}
+
+TEST(AnimationBlendingTest, WeightedBlendIsNormalizedDLB)
+{
+    const AnimationSet set = makeTestAnimationSet();
+    AnimationState state = animationblending::playClip(0, 0.2f);
+    state.layers[0].players[0].weight = 2.f;
+    animationblending::addPlayer(state.layers[0], 1, 1.f, 0.5f);
+    animationblending::addPlayer(state.layers[0], 0, 1.f, 0.9f);
+
+    BlendScratch scratch;
+    std::vector<DualQuaternion> blended(set.numTracks());
+    animationblending::evaluate(state, set, scratch, blended.data());
+    const std::vector<DualQuaternion> a = samplePose(set, 0, 0.2f), b = samplePose(set, 1, 0.5f), c = samplePose(set, 0, 0.9f);
+    const float weights[3] = {0.5f, 0.25f, 0.25f};
+    for (size_t track = 0; track < set.numTracks(); track++) {
+        const DualQuaternion dqs[3] = {a[track], b[track], c[track]};
+        EXPECT_TRUE(TransformsNear(blendReference(dqs, weights, 3), blended[track], 1e-4f)) << track;
+    }
+}
+
+TEST(AnimationBlendingTest, CrossfadeMovesFromOneClipToTheOther)
+{
+    const AnimationSet set = makeTestAnimationSet();
+    AnimationState state = animationblending::playClip(0, 0.f);
+    animationblending::crossfade(state.layers[0], 1, 0.5f, 0.3f);
+    ASSERT_EQ(2, state.layers[0].numPlayers);
+
+    BlendScratch scratch;
+    std::vector<DualQuaternion> pose(set.numTracks());
+    animationblending::evaluate(state, set, scratch, pose.data());
+    std::vector<DualQuaternion> expected = samplePose(set, 0, 0.f);
+    for (size_t track = 0; track < set.numTracks(); track++)
+        EXPECT_TRUE(TransformsNear(expected[track], pose[track], 1e-5f));
+
+    // Halfway through the fade.
+    animationblending::advance(state, 0.25f, set);
+    EXPECT_NEAR(0.5f, state.layers[0].players[0].weight, 1e-5f);
+    EXPECT_NEAR(0.5f, state.layers[0].players[1].weight, 1e-5f);
+    EXPECT_NEAR(0.55f, state.layers[0].players[1].time, 1e-5f);
+    animationblending::evaluate(state, set, scratch, pose.data());
+    const std::vector<DualQuaternion> a = samplePose(set, 0, 0.25f), b = samplePose(set, 1, 0.55f);
+    const float weights[2] = {0.5f, 0.5f};
+    for (size_t track = 0; track < set.numTracks(); track++) {
+        const DualQuaternion dqs[2] = {a[track], b[track]};
+        EXPECT_TRUE(TransformsNear(blendReference(dqs, weights, 2), pose[track], 1e-4f));
+    }
+
+    // Done: the faded out player is gone.
+    animationblending::advance(state, 0.3f, set);
+    ASSERT_EQ(1, state.layers[0].numPlayers);
+    EXPECT_EQ(1, state.layers[0].players[0].clip);
+    EXPECT_EQ(1.f, state.layers[0].players[0].weight);
+    animationblending::evaluate(state, set, scratch, pose.data());
+    expected = samplePose(set, 1, 0.85f);
+    for (size_t track = 0; track < set.numTracks(); track++)
+        EXPECT_TRUE(TransformsNear(expected[track], pose[track], 1e-4f));
+}
+
+TEST(AnimationBlendingTest, PlayersLoopOrHold)
+{
+    const AnimationSet set = makeTestAnimationSet();
+    AnimationState state = animationblending::playClip(0, 0.9f);
+    AnimationLayer* layer = animationblending::addLayer(state, OverrideBlend, 0.5f);
+    ASSERT_TRUE(layer);
+    animationblending::addPlayer(*layer, 1, 1.f, 0.9f, -2.f, false);
+    animationblending::advance(state, 0.25f, set);
+    EXPECT_NEAR(0.15f, state.layers[0].players[0].time, 1e-5f);
+    EXPECT_NEAR(0.4f, state.layers[1].players[0].time, 1e-5f);
+    animationblending::advance(state, 0.25f, set);
+    EXPECT_EQ(0.f, state.layers[1].players[0].time);
+    state.layers[1].players[0].rate = 2.f;
+    animationblending::advance(state, 1.f, set);
+    EXPECT_EQ(1.f, state.layers[1].players[0].time);
+
+    for (int i = 2; i < AnimationState::MaxLayers; i++)
+        EXPECT_TRUE(animationblending::addLayer(state, AdditiveBlend) != nullptr);
+    EXPECT_TRUE(animationblending::addLayer(state, AdditiveBlend) == nullptr);
+}
+
+TEST(AnimationBlendingTest, MaskedOverrideAndAdditiveLayers)
+{
+    AnimationSet set = makeTestAnimationSet();
+    // The additive clip is clip 1 relative to its first frame.
+    set.clips.push_back(animationblending::makeAdditive(set.clips[1], set.clips[1], 0.f));
+    std::vector<float> mask(set.stride(), 0.f);
+    mask[0] = 1.f;
+    mask[2] = 0.5f;
+    set.masks.push_back(mask);
+
+    BlendScratch scratch;
+    std::vector<DualQuaternion> pose(set.numTracks());
+    const std::vector<DualQuaternion> base = samplePose(set, 0, 0.4f);
+
+    // Clip 1's first frame plus its additive motion is clip 1.
+    AnimationState state = animationblending::playClip(1, 0.f);
+    AnimationLayer* additive = animationblending::addLayer(state, AdditiveBlend, 1.f);
+    animationblending::addPlayer(*additive, 2, 1.f, 0.6f);
+    animationblending::evaluate(state, set, scratch, pose.data());
+    std::vector<DualQuaternion> expected = samplePose(set, 1, 0.6f);
+    for (size_t track = 0; track < set.numTracks(); track++)
+        EXPECT_TRUE(TransformsNear(expected[track], pose[track], 1e-4f)) << track;
+
+    // Masked: track 0 gets all of the layer, track 2 half, track 1 none.
+    state = animationblending::playClip(0, 0.4f);
+    AnimationLayer* over = animationblending::addLayer(state, OverrideBlend, 1.f, 0);
+    animationblending::addPlayer(*over, 1, 1.f, 0.7f);
+    animationblending::evaluate(state, set, scratch, pose.data());
+    const std::vector<DualQuaternion> other = samplePose(set, 1, 0.7f);
+    const float half[2] = {0.5f, 0.5f};
+    const DualQuaternion halfway[2] = {base[2], other[2]};
+    EXPECT_TRUE(TransformsNear(other[0], pose[0], 1e-5f));
+    EXPECT_TRUE(TransformsNear(base[1], pose[1], 1e-5f));
+    EXPECT_TRUE(TransformsNear(blendReference(halfway, half, 2), pose[2], 1e-4f));
+
+    // An additive layer at weight 0 changes nothing.
+    state = animationblending::playClip(0, 0.4f);
+    additive = animationblending::addLayer(state, AdditiveBlend, 0.f);
+    animationblending::addPlayer(*additive, 2, 1.f, 0.6f);
+    animationblending::evaluate(state, set, scratch, pose.data());
+    for (size_t track = 0; track < set.numTracks(); track++)
+        EXPECT_TRUE(TransformsNear(base[track], pose[track], 1e-5f));
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,400 @@
+#include "NvAssetLoader/NvAssetLoader.h"
+#include "NvAssetLoader/NvAssetLoaderAsync.h"
+#include "NvAssetLoader/NvAssetArchive.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Compiled with
+/// clang AssetLoaderTests.cpp ../../extensions/src/NvAssetLoader/NvAssetLoader.cpp ../../extensions/src/NvAssetLoader/NvAssetArchive.cpp ../../extensions/src/NvAssetLoader/NvAssetLoaderAsync.cpp ../../extensions/externals/src/R3/thread.cpp -o AssetLoaderTests -g3 -Wall -std=c++11 -DLINUX=1 -I. -I../../extensions/include/ -I../../extensions/externals/include/ -L./gtest/ -lgtest -lstdc++ -lpthread -lm
+///
+/// Run from this directory, so that the loader finds assets/.
+
+#include "gtest/gtest.h"
+
+static const char* const Assets[] = { "head.dds", "jacket.dds", "pants.dds", "dude.skm", "skinning.vert" };
+static const int NumAssets = sizeof(Assets) / sizeof(Assets[0]);
+
+// Lets the I/O thread finish (or drop) everything, without running callbacks.
+static void waitUntilIdle(const std::vector<NvAssetLoadHandle>& loads)
+{
+    for (size_t i = 0; i < loads.size(); i++) {
+        NvAssetLoadHandle load = loads[i];
+        load.wait();
+    }
+}
+
+TEST(AssetLoaderTest, AsyncReadMatchesRead)
+{
+    for (int i = 0; i < NumAssets; i++) {
+        NvAssetLoadHandle load = NvAssetLoaderReadAsync(Assets[i]);
+        load.wait();
+        ASSERT_EQ(NV_ASSET_LOAD_DONE, load.getStatus());
+        EXPECT_STREQ(Assets[i], load.getPath());
+
+        int32_t length = 0;
+        char* data = NvAssetLoaderRead(Assets[i], length);
+        ASSERT_TRUE(data != NULL);
+        ASSERT_EQ(length, load.getLength());
+        EXPECT_EQ(0, std::memcmp(data, load.getData(), length));
+        EXPECT_EQ('\0', load.getData()[length]);
+        NvAssetLoaderFree(data);
+    }
+    EXPECT_EQ(0, NvAssetLoaderGetPendingCount());
+}
+
+TEST(AssetLoaderTest, CallbacksRunOnlyWhenDispatched)
+{
+    const std::thread::id mainThread = std::this_thread::get_id();
+    int callbacks = 0;
+    bool wrongThread = false;
+    std::vector<NvAssetLoadHandle> loads;
+    for (int i = 0; i < NumAssets; i++) {
+        loads.push_back(NvAssetLoaderReadAsync(Assets[i], i, [&](NvAssetLoadHandle& load) {
+            callbacks++;
+            wrongThread = wrongThread || std::this_thread::get_id() != mainThread || !load.isDone();
+        }));
+    }
+    waitUntilIdle(loads);
+    EXPECT_EQ(0, callbacks);
+    EXPECT_EQ(NumAssets, NvAssetLoaderGetPendingCount());
+
+    EXPECT_EQ(2, NvAssetLoaderDispatchCompletions(2));
+    EXPECT_EQ(NumAssets - 2, NvAssetLoaderDispatchCompletions());
+    EXPECT_EQ(NumAssets, callbacks);
+    EXPECT_FALSE(wrongThread);
+    EXPECT_EQ(0, NvAssetLoaderGetPendingCount());
+    for (int i = 0; i < NumAssets; i++) {
+        EXPECT_EQ(NV_ASSET_LOAD_DONE, loads[i].getStatus());
+        EXPECT_FALSE(loads[i].cancel());
+    }
+}
+
+TEST(AssetLoaderTest, CancelledReadsNeverCallBack)
+{
+    int callbacks = 0;
+    std::vector<NvAssetLoadHandle> loads;
+    for (int round = 0; round < 20; round++) {
+        for (int i = 0; i < NumAssets; i++) {
+            loads.push_back(NvAssetLoaderReadAsync(Assets[i], NV_ASSET_PRIORITY_LOW,
+                                                   [&](NvAssetLoadHandle&) { callbacks++; }));
+        }
+    }
+    // Whether queued, being read or read, cancelling works until the callback runs.
+    for (size_t i = 0; i < loads.size(); i++) {
+        EXPECT_TRUE(loads[i].cancel());
+        EXPECT_FALSE(loads[i].cancel());
+    }
+    waitUntilIdle(loads);
+    while (NvAssetLoaderGetPendingCount() > 0)
+        std::this_thread::yield();
+    EXPECT_EQ(0, NvAssetLoaderDispatchCompletions());
+    EXPECT_EQ(0, callbacks);
+    for (size_t i = 0; i < loads.size(); i++) {
+        EXPECT_EQ(NV_ASSET_LOAD_CANCELLED, loads[i].getStatus());
+        EXPECT_TRUE(loads[i].getData() == NULL);
+    }
+
+    // Read, but the callback has not run yet.
+    NvAssetLoadHandle load = NvAssetLoaderReadAsync(Assets[0], NV_ASSET_PRIORITY_NORMAL,
+                                                    [&](NvAssetLoadHandle&) { callbacks++; });
+    load.wait();
+    EXPECT_EQ(NV_ASSET_LOAD_DONE, load.getStatus());
+    EXPECT_TRUE(load.cancel());
+    EXPECT_EQ(0, NvAssetLoaderDispatchCompletions());
+    EXPECT_EQ(0, callbacks);
+    EXPECT_EQ(NV_ASSET_LOAD_CANCELLED, load.getStatus());
+}
+
+TEST(AssetLoaderTest, MissingFilesFail)
+{
+    NvAssetLoadStatus status = NV_ASSET_LOAD_PENDING;
+    NvAssetLoadHandle load = NvAssetLoaderReadAsync("no such file", NV_ASSET_PRIORITY_HIGH,
+                                                    [&](NvAssetLoadHandle& l) { status = l.getStatus(); });
+    load.wait();
+    EXPECT_EQ(NV_ASSET_LOAD_FAILED, load.getStatus());
+    EXPECT_TRUE(load.getData() == NULL);
+    EXPECT_EQ(0, load.getLength());
+    EXPECT_EQ(1, NvAssetLoaderDispatchCompletions());
+    EXPECT_EQ(NV_ASSET_LOAD_FAILED, status);
+}
+
+TEST(AssetLoaderTest, TakenDataOutlivesRequest)
+{
+    char* data = NULL;
+    int32_t length = 0;
+    NvAssetLoaderReadAsync(Assets[1], NV_ASSET_PRIORITY_NORMAL, [&](NvAssetLoadHandle& load) {
+        length = load.getLength();
+        data = load.takeData();
+        EXPECT_TRUE(load.takeData() == NULL);
+    });
+    while (NvAssetLoaderDispatchCompletions() == 0)
+        std::this_thread::yield();
+    ASSERT_TRUE(data != NULL);
+
+    int32_t expectedLength = 0;
+    char* expected = NvAssetLoaderRead(Assets[1], expectedLength);
+    ASSERT_EQ(expectedLength, length);
+    EXPECT_EQ(0, std::memcmp(expected, data, length));
+    NvAssetLoaderFree(expected);
+    NvAssetLoaderFree(data);
+}
+
+TEST(AssetLoaderTest, AsyncMapMatchesReadAndUnmapsWithTheRequest)
+{
+    const char* mapped = NULL;
+    int32_t length = 0;
+    NvAssetLoadHandle load = NvAssetLoaderMapAsync(Assets[3], NV_ASSET_PRIORITY_NORMAL, [&](NvAssetLoadHandle& load) {
+        mapped = load.getData();
+        length = load.getLength();
+        EXPECT_TRUE(load.takeData() == NULL);
+        EXPECT_EQ(mapped, load.getData());
+    });
+    while (NvAssetLoaderDispatchCompletions() == 0)
+        std::this_thread::yield();
+    ASSERT_TRUE(mapped != NULL);
+
+    int32_t expectedLength = 0;
+    char* expected = NvAssetLoaderRead(Assets[3], expectedLength);
+    ASSERT_EQ(expectedLength, length);
+    EXPECT_EQ(0, std::memcmp(expected, mapped, length));
+    NvAssetLoaderFree(expected);
+
+    // The last handle takes the mapping with it.
+    load = NvAssetLoadHandle();
+    EXPECT_FALSE(NvAssetLoaderUnmap(mapped));
+
+    NvAssetLoadHandle missing = NvAssetLoaderMapAsync("no such file");
+    missing.wait();
+    EXPECT_EQ(NV_ASSET_LOAD_FAILED, missing.getStatus());
+    EXPECT_TRUE(missing.getData() == NULL);
+}
+
+TEST(AssetLoaderTest, CallbacksCanQueueReads)
+{
+    int callbacks = 0;
+    NvAssetLoaderReadAsync(Assets[3], NV_ASSET_PRIORITY_HIGH, [&](NvAssetLoadHandle&) {
+        callbacks++;
+        NvAssetLoaderReadAsync(Assets[0], NV_ASSET_PRIORITY_NORMAL, [&](NvAssetLoadHandle&) { callbacks++; });
+    });
+    while (callbacks < 2)
+        NvAssetLoaderDispatchCompletions();
+    EXPECT_EQ(0, NvAssetLoaderGetPendingCount());
+}
+
+TEST(AssetLoaderTest, ShutdownDropsPendingReads)
+{
+    int callbacks = 0;
+    std::vector<NvAssetLoadHandle> loads;
+    for (int i = 0; i < NumAssets; i++)
+        loads.push_back(NvAssetLoaderReadAsync(Assets[i], i, [&](NvAssetLoadHandle&) { callbacks++; }));
+    EXPECT_TRUE(NvAssetLoaderAsyncShutdown());
+    EXPECT_EQ(0, NvAssetLoaderGetPendingCount());
+    EXPECT_EQ(0, NvAssetLoaderDispatchCompletions());
+    EXPECT_EQ(0, callbacks);
+    for (size_t i = 0; i < loads.size(); i++)
+        EXPECT_TRUE(loads[i].isDone());
+
+    // Reads queued afterwards start a new I/O thread.
+    NvAssetLoadHandle load = NvAssetLoaderReadAsync(Assets[0]);
+    load.wait();
+    EXPECT_EQ(NV_ASSET_LOAD_DONE, load.getStatus());
+}
+
+static NvAssetArchiveFile makeFile(const std::string& name, const std::string& contents)
+{
+    NvAssetArchiveFile file;
+    file.name = name;
+    file.data.assign(contents.begin(), contents.end());
+    return file;
+}
+
+TEST(AssetArchiveTest, FindsEveryPackedFile)
+{
+    for (int numFiles = 0; numFiles <= 300; numFiles = numFiles * 2 + 1) {
+        std::vector<NvAssetArchiveFile> files;
+        for (int i = 0; i < numFiles; i++)
+            files.push_back(makeFile("dir/file" + std::to_string(i), std::string(i % 37, char('a' + i % 26))));
+        std::vector<char> data;
+        ASSERT_TRUE(NvAssetArchive::build(files, data));
+
+        NvAssetArchive archive;
+        ASSERT_TRUE(archive.init(data.data(), data.size()));
+        EXPECT_EQ(uint32_t(numFiles), archive.getNumEntries());
+        for (int i = 0; i < numFiles; i++) {
+            int32_t length = -1;
+            const char* packed = archive.find(files[i].name.c_str(), length);
+            ASSERT_TRUE(packed != NULL);
+            ASSERT_EQ(int32_t(files[i].data.size()), length);
+            EXPECT_EQ(0, std::memcmp(packed, files[i].data.data(), length));
+            EXPECT_EQ('\0', packed[length]);
+            EXPECT_EQ(0u, uintptr_t(packed - data.data()) % NvAssetArchiveHeader::Alignment);
+            EXPECT_TRUE(archive.contains(packed));
+        }
+        int32_t length = -1;
+        EXPECT_TRUE(archive.find("dir/file", length) == NULL);
+        EXPECT_TRUE(archive.find("file0", length) == NULL);
+        EXPECT_EQ(-1, length);
+    }
+}
+
+TEST(AssetArchiveTest, LaterFilesReplaceEarlierOnes)
+{
+    std::vector<NvAssetArchiveFile> files;
+    files.push_back(makeFile("a", "first"));
+    files.push_back(makeFile("b", "other"));
+    files.push_back(makeFile("a", "second"));
+    std::vector<char> data;
+    ASSERT_TRUE(NvAssetArchive::build(files, data));
+    NvAssetArchive archive;
+    ASSERT_TRUE(archive.init(data.data(), data.size()));
+    EXPECT_EQ(2u, archive.getNumEntries());
+    int32_t length = 0;
+    EXPECT_STREQ("second", archive.find("a", length));
+}
+
+TEST(AssetArchiveTest, RejectsMalformedArchives)
+{
+    std::vector<NvAssetArchiveFile> files;
+    files.push_back(makeFile("a", "contents"));
+    files.push_back(makeFile("b", "more contents"));
+    std::vector<char> data;
+    ASSERT_TRUE(NvAssetArchive::build(files, data));
+    NvAssetArchive archive;
+    EXPECT_FALSE(archive.init(data.data(), data.size() - 1));
+    EXPECT_FALSE(archive.init(data.data(), sizeof(NvAssetArchiveHeader) - 1));
+    EXPECT_FALSE(archive.init(NULL, 0));
+
+    std::vector<char> corrupt = data;
+    corrupt[0] = 'X';
+    EXPECT_FALSE(archive.init(corrupt.data(), corrupt.size()));
+    int32_t length = 0;
+    EXPECT_TRUE(archive.find("a", length) == NULL);
+
+    // An entry moved past the end of the file.
+    corrupt = data;
+    const NvAssetArchiveHeader* header = reinterpret_cast<const NvAssetArchiveHeader*>(corrupt.data());
+    NvAssetArchiveEntry* entries = reinterpret_cast<NvAssetArchiveEntry*>(&corrupt[header->entriesOffset]);
+    entries[1].offset = uint32_t(corrupt.size());
+    EXPECT_FALSE(archive.init(corrupt.data(), corrupt.size()));
+
+    // An entry in the wrong bucket.
+    corrupt = data;
+    entries = reinterpret_cast<NvAssetArchiveEntry*>(&corrupt[header->entriesOffset]);
+    std::swap(entries[0], entries[1]);
+    EXPECT_FALSE(archive.init(corrupt.data(), corrupt.size()));
+
+    EXPECT_TRUE(archive.init(data.data(), data.size()));
+}
+
+// Writes an archive under a temporary search path and mounts it.
+class MountedArchiveTest : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        char dir[] = "/tmp/AssetLoaderTestsXXXXXX";
+        ASSERT_TRUE(mkdtemp(dir) != NULL);
+        mDir = dir;
+        ASSERT_EQ(0, system(("mkdir " + mDir + "/assets").c_str()));
+
+        std::vector<NvAssetArchiveFile> files;
+        files.push_back(makeFile("packed.txt", "packed contents"));
+        files.push_back(makeFile("sub/dir.txt", "in a subdirectory"));
+        files.push_back(makeFile(Assets[0], "shadowed by the loose file"));
+        std::vector<char> data;
+        ASSERT_TRUE(NvAssetArchive::build(files, data));
+        FILE* fp = fopen((mDir + "/assets/test.nvpk").c_str(), "wb");
+        ASSERT_TRUE(fp != NULL);
+        fwrite(data.data(), 1, data.size(), fp);
+        fclose(fp);
+
+        NvAssetLoaderAddSearchPath(mDir.c_str());
+        ASSERT_TRUE(NvAssetLoaderMountArchive("test.nvpk"));
+    }
+
+    virtual void TearDown()
+    {
+        NvAssetLoaderUnmountArchive("test.nvpk");
+        NvAssetLoaderSetLooseFileOverride(true);
+        NvAssetLoaderRemoveSearchPath(mDir.c_str());
+        system(("rm -r " + mDir).c_str());
+    }
+
+    static std::string read(const char* filePath)
+    {
+        int32_t length = 0;
+        char* data = NvAssetLoaderRead(filePath, length);
+        const std::string contents = data ? std::string(data, length) : std::string("<missing>");
+        NvAssetLoaderFree(data);
+        return contents;
+    }
+
+    std::string mDir;
+};
+
+TEST_F(MountedArchiveTest, ReadsAndMapsPackedFiles)
+{
+    EXPECT_EQ("packed contents", read("packed.txt"));
+    EXPECT_EQ("in a subdirectory", read("sub/dir.txt"));
+    EXPECT_EQ("<missing>", read("missing.txt"));
+
+    // Mapping hands out the archive's own memory.
+    int32_t length = 0;
+    const char* mapped = NvAssetLoaderMap("packed.txt", length);
+    ASSERT_TRUE(mapped != NULL);
+    EXPECT_EQ(std::string("packed contents"), std::string(mapped, length));
+    const char* again = NvAssetLoaderMap("packed.txt", length);
+    EXPECT_EQ(mapped, again);
+    EXPECT_TRUE(NvAssetLoaderUnmap(mapped));
+    EXPECT_TRUE(NvAssetLoaderUnmap(again));
+
+    NvAssetLoadHandle load = NvAssetLoaderReadAsync("sub/dir.txt");
+    load.wait();
+    EXPECT_EQ(std::string("in a subdirectory"), std::string(load.getData(), load.getLength()));
+
+    NvAssetLoadHandle mapping = NvAssetLoaderMapAsync("packed.txt");
+    mapping.wait();
+    EXPECT_EQ(mapped, mapping.getData());
+    mapping = NvAssetLoadHandle();
+
+    EXPECT_TRUE(NvAssetLoaderUnmountArchive("test.nvpk"));
+    EXPECT_FALSE(NvAssetLoaderUnmountArchive("test.nvpk"));
+    EXPECT_EQ("<missing>", read("packed.txt"));
+}
+
+TEST_F(MountedArchiveTest, LooseFilesOverridePackedOnes)
+{
+    int32_t looseLength = 0;
+    char* loose = NvAssetLoaderRead(Assets[0], looseLength);
+    ASSERT_TRUE(loose != NULL);
+    EXPECT_GT(looseLength, 1000);
+    NvAssetLoaderFree(loose);
+
+    NvAssetLoaderSetLooseFileOverride(false);
+    EXPECT_EQ("shadowed by the loose file", read(Assets[0]));
+    // Loose files still fill in what the archive lacks.
+    int32_t length = 0;
+    char* data = NvAssetLoaderRead(Assets[1], length);
+    EXPECT_TRUE(data != NULL);
+    NvAssetLoaderFree(data);
+}
+
+TEST_F(MountedArchiveTest, RejectsFilesThatAreNotArchives)
+{
+    EXPECT_FALSE(NvAssetLoaderMountArchive(Assets[4]));
+    EXPECT_FALSE(NvAssetLoaderMountArchive("missing.nvpk"));
+    EXPECT_FALSE(NvAssetLoaderUnmountArchive(Assets[4]));
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    NvAssetLoaderInit(NULL);
+    const int result = RUN_ALL_TESTS();
+    NvAssetLoaderShutdown();
+    return result;
+}
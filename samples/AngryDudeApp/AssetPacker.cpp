@@ -0,0 +1,58 @@
+#include "NvAssetLoader/NvAssetArchive.h"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+/// Packs asset files into an archive (see NvAssetArchive.h) that the sample
+/// mounts with -archive. Files are named by their paths relative to the
+/// given root, which is normally the assets directory.
+/// Compiled with
+/// clang AssetPacker.cpp ../../extensions/src/NvAssetLoader/NvAssetArchive.cpp -o AssetPacker -O2 -Wall -std=c++11 -I. -I../../extensions/include/ -lstdc++ -lm
+/// and run as
+/// ./AssetPacker assets/AngryDudeApp.nvpk assets dude.skm head.dds jacket.dds pants.dds skinning.vert diffuse.frag debug.vert debug.frag
+///
+
+int main(int argc, char** argv)
+{
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " <output.nvpk> <root> <file>..." << std::endl;
+        return 1;
+    }
+    const char* output = argv[1];
+    const std::string root = argv[2];
+
+    std::vector<NvAssetArchiveFile> files;
+    size_t totalBytes = 0;
+    for (int arg = 3; arg < argc; arg++) {
+        NvAssetArchiveFile file;
+        file.name = argv[arg];
+        std::ifstream is((root + "/" + file.name).c_str(), std::ios::binary);
+        if (!is) {
+            std::cerr << "Cannot open " << root << "/" << file.name << std::endl;
+            return 1;
+        }
+        file.data.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+        totalBytes += file.data.size();
+        files.push_back(file);
+    }
+
+    std::vector<char> archive;
+    NvAssetArchive check;
+    if (!NvAssetArchive::build(files, archive) || !check.init(archive.data(), archive.size())) {
+        std::cerr << "Files do not fit an asset archive" << std::endl;
+        return 1;
+    }
+
+    std::ofstream os(output, std::ios::binary);
+    os.write(archive.data(), archive.size());
+    if (!os) {
+        std::cerr << "Cannot write " << output << std::endl;
+        return 1;
+    }
+    std::cout << output << ": " << check.getNumEntries() << " files, " << totalBytes << " bytes packed into "
+              << archive.size() << " bytes" << std::endl;
+    return 0;
+}
@@ -0,0 +1,187 @@
+#ifndef __BakedAnimation_hpp__
+#define __BakedAnimation_hpp__
+
+#include "Skinning.hpp"
+#include "Animation.hpp"
+#include "DualQuaternion.hpp"
+#include "DualQuaternionN.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+/// \file BakedAnimation.hpp
+/// \brief Clip resampled at a fixed rate, laid out for whole-pose sampling.
+///
+/// Keyframe tracks are sampled node by node, each with its own key search for
+/// translation and rotation. BakedClip resamples all tracks of a clip at regular
+/// intervals instead, so that the two frames surrounding any time follow from a
+/// single division, and stores every frame as structure of arrays: seven channels
+/// (translation xyz, rotation xyzw), each a contiguous run over all tracks padded
+/// to FloatN::Width. Sampling a pose is then one sweep over two frames, lerping
+/// FloatN::Width tracks at a time, normalizing the rotations (nlerp) and emitting
+/// dual quaternions or matrices.
+///
+/// Rotations are made hemisphere-consistent between frames when baking, so the
+/// sweep needs no sign test. The cost is memory: numFrames * 7 floats per track,
+/// independent of how many keys the source had.
+
+/// \brief Position of a time between two baked frames.
+struct BakedFramePair
+{
+    size_t frame0;
+    size_t frame1;
+    float  t;      ///< 0 at frame0, 1 at frame1.
+};
+
+/// \brief All NodeAnimations of a clip resampled at a fixed rate. Track i holds
+/// NodeAnimation i.
+struct BakedClip
+{
+    enum Channel { TX, TY, TZ, RX, RY, RZ, RW, NumChannels };
+
+    BakedClip(): duration(0.f), frameDuration(0.f), numFrames(0), numTracks(0), stride(0) {}
+
+    float  duration;
+    float  frameDuration; ///< Time between frames; divides duration evenly.
+    size_t numFrames;
+    size_t numTracks;
+    size_t stride;        ///< numTracks rounded up to FloatN::Width.
+
+    /// samples[(frame*NumChannels + channel)*stride + track].
+    std::vector<float> samples;
+
+    size_t sizeInBytes() const { return samples.size() * sizeof(float); }
+
+    const float* channel(size_t frame, Channel c) const
+    {
+        return &samples[(frame*NumChannels + c)*stride];
+    }
+
+    /// Resamples the time range [0, duration] of animations at (at least)
+    /// sampleRate frames per second, with the same key lookup and interpolation
+    /// the keyframe tracks are played back with.
+    static BakedClip bake(const std::vector<NodeAnimation>& animations, float duration, float sampleRate = 30.f)
+    {
+        const size_t W = FloatN::Width;
+        BakedClip clip;
+        const float intervals = std::ceil(duration * sampleRate);
+        clip.duration = duration;
+        clip.numFrames = static_cast<size_t>(intervals > 1.f ? intervals : 1.f) + 1;
+        clip.frameDuration = duration / (clip.numFrames - 1);
+        clip.numTracks = animations.size();
+        clip.stride = (clip.numTracks + W - 1) / W * W;
+        clip.samples.assign(clip.numFrames * NumChannels * clip.stride, 0.f);
+
+        for (size_t frame = 0; frame < clip.numFrames; frame++) {
+            // Padding lanes hold identity rotations so that normalization stays finite.
+            float* rw = &clip.samples[(frame*NumChannels + RW)*clip.stride];
+            for (size_t track = clip.numTracks; track < clip.stride; track++)
+                rw[track] = 1.f;
+        }
+
+        for (size_t track = 0; track < clip.numTracks; track++) {
+            const NodeAnimation& animation = animations[track];
+            NodeAnimationCursor cursor;
+            nv::quaternionf previous(0.f, 0.f, 0.f, 1.f);
+            for (size_t frame = 0; frame < clip.numFrames; frame++) {
+                const float time = frame == clip.numFrames - 1 ? duration : frame * clip.frameDuration;
+
+                const std::vector<AnimationKey>& translationKeys = animation.translationKeys;
+                const KeyframePair tk = findKeyframes(translationKeys, time, cursor.translation);
+                const nv::vec4f translation = (1.f-tk.t)*translationKeys[tk.index0].value + tk.t*translationKeys[tk.index1].value;
+
+                const std::vector<AnimationKey>& rotationKeys = animation.rotationKeys;
+                const KeyframePair rk = findKeyframes(rotationKeys, time, cursor.rotation);
+                const nv::vec4f& r0 = rotationKeys[rk.index0].value;
+                const nv::vec4f& r1 = rotationKeys[rk.index1].value;
+                nv::quaternionf rotation = interpolateRotation(nv::quaternionf(r0.x, r0.y, r0.z, r0.w),
+                                                               nv::quaternionf(r1.x, r1.y, r1.z, r1.w), rk.t);
+                if (rotation.x*previous.x + rotation.y*previous.y + rotation.z*previous.z + rotation.w*previous.w < 0.f)
+                    rotation = nv::quaternionf(-rotation.x, -rotation.y, -rotation.z, -rotation.w);
+                previous = rotation;
+
+                const float values[NumChannels] = {translation.x, translation.y, translation.z,
+                                                   rotation.x, rotation.y, rotation.z, rotation.w};
+                for (int c = 0; c < NumChannels; c++)
+                    clip.samples[(frame*NumChannels + c)*clip.stride + track] = values[c];
+            }
+        }
+        return clip;
+    }
+
+    /// Frames surrounding time; time is clamped to [0, duration].
+    BakedFramePair findFrames(float time) const
+    {
+        BakedFramePair pair;
+        const float f = frameDuration > 0.f ? time / frameDuration : 0.f;
+        const float last = static_cast<float>(numFrames - 1);
+        const float clamped = f < 0.f ? 0.f : (f > last ? last : f);
+        const float index0 = std::floor(clamped);
+        pair.frame0 = static_cast<size_t>(index0);
+        pair.frame1 = pair.frame0 + 1 < numFrames ? pair.frame0 + 1 : pair.frame0;
+        pair.t = clamped - index0;
+        return pair;
+    }
+
+    /// Samples the local transform of every track at time into out[0, numTracks).
+    void samplePose(float time, DualQuaternion* out) const
+    {
+        sweep(time, [=](size_t track, size_t count, const DualQuaternionN& dq) {
+            if (count == FloatN::Width)
+                dq.store(out + track);
+            else
+                dq.storePartial(out + track, count);
+        });
+    }
+
+    void samplePose(float time, nv::matrix4f* out) const
+    {
+        sweep(time, [=](size_t track, size_t count, const DualQuaternionN& dq) {
+            nv::matrix4f matrices[FloatN::Width];
+            dq.toMatrices(matrices);
+            for (size_t i = 0; i < count; i++)
+                out[track + i] = matrices[i];
+        });
+    }
+
+    /// Same, as eight lanes of dual quaternion components (real xyzw, then
+    /// dual xyzw), lane c of track i at lanes[c*laneStride + i]. laneStride
+    /// is at least stride; the padding tracks get identities.
+    void samplePose(float time, float* lanes, size_t laneStride) const
+    {
+        sweep(time, [=](size_t track, size_t, const DualQuaternionN& dq) {
+            const FloatN* components[8] = {&dq.real.x, &dq.real.y, &dq.real.z, &dq.real.w,
+                                           &dq.dual.x, &dq.dual.y, &dq.dual.z, &dq.dual.w};
+            for (int c = 0; c < 8; c++)
+                components[c]->store(lanes + c*laneStride + track);
+        });
+    }
+
+private:
+    /// Interpolates both frames around time FloatN::Width tracks at a time and
+    /// calls emit(firstTrack, numTracksInChunk, transforms).
+    template <typename F>
+    void sweep(float time, const F& emit) const
+    {
+        const size_t W = FloatN::Width;
+        const BakedFramePair pair = findFrames(time);
+        const float* frame0 = channel(pair.frame0, TX);
+        const float* frame1 = channel(pair.frame1, TX);
+        const FloatN t(pair.t), s(1.f - pair.t), half(0.5f), zero(0.f);
+
+        for (size_t track = 0; track < numTracks; track += W) {
+            FloatN c[NumChannels];
+            for (int i = 0; i < NumChannels; i++)
+                c[i] = s*FloatN::load(frame0 + i*stride + track) + t*FloatN::load(frame1 + i*stride + track);
+
+            const QuaternionN blended(c[RX], c[RY], c[RZ], c[RW]);
+            const QuaternionN rotation = (FloatN(1.f) / sqrt(dot(blended, blended))) * blended;
+            const QuaternionN translation(half*c[TX], half*c[TY], half*c[TZ], zero);
+            const size_t count = numTracks - track < W ? numTracks - track : W;
+            emit(track, count, DualQuaternionN(rotation, translation*rotation));
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,382 @@
+#ifndef __BinaryModel_hpp__
+#define __BinaryModel_hpp__
+
+#include "Skinning.hpp"
+#include "PackedVertex.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/// \file BinaryModel.hpp
+/// \brief Versioned on-disk SkinnedModel that is used where it lies.
+///
+/// The cereal archive of a SkinnedModel has to be deserialized element by
+/// element into freshly allocated vectors. A binary model file is instead a
+/// header with an offset table followed by sections, each an array of plain
+/// records starting at a multiple of BinaryModelHeader::Alignment:
+///
+/// - Meshes:         BinaryMesh, ranges into Vertices, Indices and Strings
+/// - Vertices:       Vertex, all meshes back to back
+/// - PackedVertices: PackedVertex, same ranges as Vertices
+/// - Indices:        unsigned short, all meshes back to back
+/// - Strings:        char, null-terminated names
+/// - Nodes:          BinaryNode, ranges into NodeChildren and Strings
+/// - NodeChildren:   int32_t node indices
+/// - Animations:     BinaryAnimation, ranges into AnimationKeys
+/// - AnimationKeys:  AnimationKey
+/// - Bones:          Bone
+///
+/// Once BinaryModel::parse has checked the header and every range, the
+/// sections are read straight from the file's memory (mapped with
+/// NvAssetLoaderMap or NvAssetLoaderMapAsync): vertex and index
+/// blobs go to buffer uploads as they are and names are used as C strings.
+/// Either vertex section may be left empty; a file meant for the renderer only
+/// needs the packed one. The file stores the host's little-endian layout;
+/// version is bumped whenever a record changes.
+
+/// \brief Location of one section, in bytes from the start of the file.
+struct BinaryModelSection
+{
+    uint32_t offset;
+    uint32_t size;
+    uint32_t count;   ///< Number of records; size is count * record size.
+};
+
+struct BinaryModelHeader
+{
+    enum { Version = 2, Alignment = 16 };
+    enum Section { Meshes, Vertices, Indices, Strings, Nodes, NodeChildren,
+                   Animations, AnimationKeys, Bones, PackedVertices, NumSections };
+
+    char     magic[4];  ///< "SKMD"
+    uint32_t version;
+    uint32_t alignment;
+    uint32_t numSections;
+    BinaryModelSection sections[NumSections];
+};
+
+struct BinaryMesh
+{
+    uint32_t firstVertex;
+    uint32_t numVertices;
+    uint32_t firstIndex;
+    uint32_t numIndices;
+    uint32_t albedoTextureFilename;  ///< Offset into Strings.
+    float    positionOffset[3];      ///< PackedVertexBounds of the packed vertices.
+    float    positionScale[3];
+
+    PackedVertexBounds bounds() const
+    {
+        PackedVertexBounds b;
+        b.offset = nv::vec3f(positionOffset[0], positionOffset[1], positionOffset[2]);
+        b.scale = nv::vec3f(positionScale[0], positionScale[1], positionScale[2]);
+        return b;
+    }
+};
+
+struct BinaryNode
+{
+    nv::matrix4f defaultTransform;
+    int32_t  nodeAnimationIdx;
+    int32_t  boneIdx;
+    uint32_t name;                   ///< Offset into Strings.
+    uint32_t firstChild;             ///< Range of NodeChildren.
+    uint32_t numChildren;
+};
+
+struct BinaryAnimation
+{
+    uint32_t firstTranslationKey;    ///< Ranges of AnimationKeys.
+    uint32_t numTranslationKeys;
+    uint32_t firstRotationKey;
+    uint32_t numRotationKeys;
+};
+
+/// \brief A read-only array inside a binary model file.
+template <typename T>
+struct BinaryArray
+{
+    BinaryArray(): data(nullptr), count(0) {}
+
+    const T* data;
+    size_t   count;
+
+    size_t size() const { return count; }
+    const T& operator[](size_t i) const { return data[i]; }
+    const T* begin() const { return data; }
+    const T* end() const { return data + count; }
+};
+
+/// \brief Sections of a parsed binary model file. Points into the file's
+/// memory, which must outlive it.
+struct BinaryModel
+{
+    /// Vertex sections written by write().
+    enum VertexFormat { FloatVertices = 1, PackedVertices = 2 };
+
+    BinaryArray<BinaryMesh>      meshes;
+    BinaryArray<Vertex>          vertices;
+    BinaryArray<PackedVertex>    packedVertices;
+    BinaryArray<unsigned short>  indices;
+    BinaryArray<char>            strings;
+    BinaryArray<BinaryNode>      nodes;
+    BinaryArray<int32_t>         nodeChildren;
+    BinaryArray<BinaryAnimation> animations;
+    BinaryArray<AnimationKey>    animationKeys;
+    BinaryArray<Bone>            bones;
+
+    const Vertex* meshVertices(const BinaryMesh& mesh) const { return vertices.data + mesh.firstVertex; }
+    const PackedVertex* meshPackedVertices(const BinaryMesh& mesh) const { return packedVertices.data + mesh.firstVertex; }
+    const unsigned short* meshIndices(const BinaryMesh& mesh) const { return indices.data + mesh.firstIndex; }
+    const char* string(uint32_t offset) const { return strings.data + offset; }
+
+    /// Checks the header, that every section and range lies within the file,
+    /// that the nodes form a tree under node 0 and that every track has keys.
+    /// Returns false, leaving model untouched, for anything else than a
+    /// well-formed file of this version.
+    static bool parse(const void* data, size_t length, BinaryModel& model)
+    {
+        const char* bytes = static_cast<const char*>(data);
+        if (!bytes || length < sizeof(BinaryModelHeader) || reinterpret_cast<uintptr_t>(bytes) % 4 != 0)
+            return false;
+        const BinaryModelHeader& header = *reinterpret_cast<const BinaryModelHeader*>(bytes);
+        if (std::memcmp(header.magic, "SKMD", 4) != 0 || header.version != BinaryModelHeader::Version ||
+            header.alignment != BinaryModelHeader::Alignment || header.numSections != BinaryModelHeader::NumSections)
+            return false;
+
+        BinaryModel m;
+        if (!getSection(bytes, length, BinaryModelHeader::Meshes, m.meshes) ||
+            !getSection(bytes, length, BinaryModelHeader::Vertices, m.vertices) ||
+            !getSection(bytes, length, BinaryModelHeader::Indices, m.indices) ||
+            !getSection(bytes, length, BinaryModelHeader::Strings, m.strings) ||
+            !getSection(bytes, length, BinaryModelHeader::Nodes, m.nodes) ||
+            !getSection(bytes, length, BinaryModelHeader::NodeChildren, m.nodeChildren) ||
+            !getSection(bytes, length, BinaryModelHeader::Animations, m.animations) ||
+            !getSection(bytes, length, BinaryModelHeader::AnimationKeys, m.animationKeys) ||
+            !getSection(bytes, length, BinaryModelHeader::Bones, m.bones) ||
+            !getSection(bytes, length, BinaryModelHeader::PackedVertices, m.packedVertices))
+            return false;
+
+        const size_t numVertices = std::max(m.vertices.count, m.packedVertices.count);
+        if ((m.vertices.count != 0 && m.vertices.count != numVertices) ||
+            (m.packedVertices.count != 0 && m.packedVertices.count != numVertices))
+            return false;
+
+        if (m.strings.count == 0 || m.strings[m.strings.count - 1] != '\0')
+            return false;
+        for (const BinaryMesh& mesh: m.meshes) {
+            if (!inRange(mesh.firstVertex, mesh.numVertices, numVertices) ||
+                !inRange(mesh.firstIndex, mesh.numIndices, m.indices.count) ||
+                mesh.albedoTextureFilename >= m.strings.count)
+                return false;
+            for (uint32_t i = 0; i < mesh.numIndices; i++)
+                if (m.meshIndices(mesh)[i] >= mesh.numVertices)
+                    return false;
+        }
+        for (const BinaryNode& node: m.nodes) {
+            if (!inRange(node.firstChild, node.numChildren, m.nodeChildren.count) || node.name >= m.strings.count ||
+                node.nodeAnimationIdx < -1 || node.nodeAnimationIdx >= static_cast<int64_t>(m.animations.count) ||
+                node.boneIdx < -1 || node.boneIdx >= static_cast<int64_t>(m.bones.count))
+                return false;
+        }
+        // Node 0 is the root and every other node the child of exactly one
+        // node, so walking down from the root visits each node once.
+        std::vector<uint8_t> isChild(m.nodes.count, 0);
+        for (const BinaryNode& node: m.nodes) {
+            for (uint32_t i = 0; i < node.numChildren; i++) {
+                const int32_t child = m.nodeChildren[node.firstChild + i];
+                if (child <= 0 || child >= static_cast<int64_t>(m.nodes.count) || isChild[child])
+                    return false;
+                isChild[child] = 1;
+            }
+        }
+        for (size_t i = 1; i < m.nodes.count; i++)
+            if (!isChild[i])
+                return false;
+        // Sampling reads at least the first key of every track.
+        for (const BinaryAnimation& animation: m.animations) {
+            if (animation.numTranslationKeys == 0 || animation.numRotationKeys == 0 ||
+                !inRange(animation.firstTranslationKey, animation.numTranslationKeys, m.animationKeys.count) ||
+                !inRange(animation.firstRotationKey, animation.numRotationKeys, m.animationKeys.count))
+                return false;
+        }
+
+        model = m;
+        return true;
+    }
+
+    /// Copies nodes, animations and bones into model, which the skeleton and
+    /// animation code take as vectors; each array is one contiguous copy.
+    /// Meshes get their texture names, and their vertices and indices only
+    /// with copyGeometry (the renderer uploads them from the file instead);
+    /// files with packed vertices only are unpacked.
+    void toSkinnedModel(SkinnedModel& model, bool copyGeometry) const
+    {
+        model.meshes.resize(meshes.count);
+        for (size_t i = 0; i < meshes.count; i++) {
+            const BinaryMesh& mesh = meshes[i];
+            Mesh& out = model.meshes[i];
+            out.albedoTextureFilename = string(mesh.albedoTextureFilename);
+            if (copyGeometry) {
+                if (vertices.count > 0) {
+                    out.vertices.assign(meshVertices(mesh), meshVertices(mesh) + mesh.numVertices);
+                } else {
+                    out.vertices.resize(mesh.numVertices);
+                    vertexpacking::unpackVertices(meshPackedVertices(mesh), mesh.numVertices, mesh.bounds(), out.vertices.data());
+                }
+                out.indices.assign(meshIndices(mesh), meshIndices(mesh) + mesh.numIndices);
+            }
+        }
+
+        model.nodeAnimations.resize(animations.count);
+        for (size_t i = 0; i < animations.count; i++) {
+            const BinaryAnimation& animation = animations[i];
+            const AnimationKey* translationKeys = animationKeys.data + animation.firstTranslationKey;
+            const AnimationKey* rotationKeys = animationKeys.data + animation.firstRotationKey;
+            model.nodeAnimations[i].translationKeys.assign(translationKeys, translationKeys + animation.numTranslationKeys);
+            model.nodeAnimations[i].rotationKeys.assign(rotationKeys, rotationKeys + animation.numRotationKeys);
+        }
+
+        model.modelNodes.resize(nodes.count);
+        for (size_t i = 0; i < nodes.count; i++) {
+            const BinaryNode& node = nodes[i];
+            ModelNode& out = model.modelNodes[i];
+            out.name = string(node.name);
+            out.childrenIndices.assign(nodeChildren.data + node.firstChild, nodeChildren.data + node.firstChild + node.numChildren);
+            out.defaultTransform = node.defaultTransform;
+            out.nodeAnimationIdx = node.nodeAnimationIdx;
+            out.boneIdx = node.boneIdx;
+        }
+
+        model.bones.assign(bones.begin(), bones.end());
+    }
+
+    /// Lays model out as a binary model file with the vertex sections in
+    /// vertexFormats (a combination of VertexFormat flags).
+    static std::vector<char> write(const SkinnedModel& model, unsigned vertexFormats = FloatVertices | PackedVertices)
+    {
+        std::vector<BinaryMesh>      meshRecords;
+        std::vector<Vertex>          vertexData;
+        std::vector<PackedVertex>    packedVertexData;
+        std::vector<unsigned short>  indexData;
+        std::vector<char>            stringData;
+        std::vector<BinaryNode>      nodeRecords;
+        std::vector<int32_t>         childData;
+        std::vector<BinaryAnimation> animationRecords;
+        std::vector<AnimationKey>    keyData;
+
+        size_t numVertices = 0;
+        for (const Mesh& mesh: model.meshes) {
+            BinaryMesh record;
+            record.firstVertex = static_cast<uint32_t>(numVertices);
+            record.numVertices = static_cast<uint32_t>(mesh.vertices.size());
+            record.firstIndex = static_cast<uint32_t>(indexData.size());
+            record.numIndices = static_cast<uint32_t>(mesh.indices.size());
+            record.albedoTextureFilename = appendString(stringData, mesh.albedoTextureFilename);
+            const PackedVertexBounds bounds = vertexpacking::computeBounds(mesh.vertices.data(), mesh.vertices.size());
+            for (int c = 0; c < 3; c++) {
+                record.positionOffset[c] = bounds.offset[c];
+                record.positionScale[c] = bounds.scale[c];
+            }
+            if (vertexFormats & FloatVertices)
+                vertexData.insert(vertexData.end(), mesh.vertices.begin(), mesh.vertices.end());
+            if (vertexFormats & PackedVertices) {
+                packedVertexData.resize(record.firstVertex + record.numVertices);
+                vertexpacking::packVertices(mesh.vertices.data(), mesh.vertices.size(), bounds, &packedVertexData[record.firstVertex]);
+            }
+            indexData.insert(indexData.end(), mesh.indices.begin(), mesh.indices.end());
+            meshRecords.push_back(record);
+            numVertices += mesh.vertices.size();
+        }
+
+        for (const ModelNode& node: model.modelNodes) {
+            BinaryNode record;
+            record.defaultTransform = node.defaultTransform;
+            record.nodeAnimationIdx = node.nodeAnimationIdx;
+            record.boneIdx = node.boneIdx;
+            record.name = appendString(stringData, node.name);
+            record.firstChild = static_cast<uint32_t>(childData.size());
+            record.numChildren = static_cast<uint32_t>(node.childrenIndices.size());
+            childData.insert(childData.end(), node.childrenIndices.begin(), node.childrenIndices.end());
+            nodeRecords.push_back(record);
+        }
+        if (stringData.empty())
+            stringData.push_back('\0');
+
+        for (const NodeAnimation& animation: model.nodeAnimations) {
+            BinaryAnimation record;
+            record.firstTranslationKey = static_cast<uint32_t>(keyData.size());
+            record.numTranslationKeys = static_cast<uint32_t>(animation.translationKeys.size());
+            keyData.insert(keyData.end(), animation.translationKeys.begin(), animation.translationKeys.end());
+            record.firstRotationKey = static_cast<uint32_t>(keyData.size());
+            record.numRotationKeys = static_cast<uint32_t>(animation.rotationKeys.size());
+            keyData.insert(keyData.end(), animation.rotationKeys.begin(), animation.rotationKeys.end());
+            animationRecords.push_back(record);
+        }
+
+        BinaryModelHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "SKMD", 4);
+        header.version = BinaryModelHeader::Version;
+        header.alignment = BinaryModelHeader::Alignment;
+        header.numSections = BinaryModelHeader::NumSections;
+
+        std::vector<char> file(sizeof(header));
+        appendSection(file, header, BinaryModelHeader::Meshes, meshRecords);
+        appendSection(file, header, BinaryModelHeader::Vertices, vertexData);
+        appendSection(file, header, BinaryModelHeader::Indices, indexData);
+        appendSection(file, header, BinaryModelHeader::Strings, stringData);
+        appendSection(file, header, BinaryModelHeader::Nodes, nodeRecords);
+        appendSection(file, header, BinaryModelHeader::NodeChildren, childData);
+        appendSection(file, header, BinaryModelHeader::Animations, animationRecords);
+        appendSection(file, header, BinaryModelHeader::AnimationKeys, keyData);
+        appendSection(file, header, BinaryModelHeader::Bones, model.bones);
+        appendSection(file, header, BinaryModelHeader::PackedVertices, packedVertexData);
+        std::memcpy(file.data(), &header, sizeof(header));
+        return file;
+    }
+
+private:
+    static bool inRange(uint32_t first, uint32_t count, size_t size)
+    {
+        return first <= size && count <= size - first;
+    }
+
+    template <typename T>
+    static bool getSection(const char* bytes, size_t length, BinaryModelHeader::Section s, BinaryArray<T>& array)
+    {
+        const BinaryModelSection& section = reinterpret_cast<const BinaryModelHeader*>(bytes)->sections[s];
+        if (section.offset % BinaryModelHeader::Alignment != 0 || section.offset > length ||
+            section.size > length - section.offset || uint64_t(section.count) * sizeof(T) != section.size)
+            return false;
+        array.data = reinterpret_cast<const T*>(bytes + section.offset);
+        array.count = section.count;
+        return true;
+    }
+
+    static uint32_t appendString(std::vector<char>& strings, const std::string& s)
+    {
+        const uint32_t offset = static_cast<uint32_t>(strings.size());
+        strings.insert(strings.end(), s.c_str(), s.c_str() + s.size() + 1);
+        return offset;
+    }
+
+    template <typename T>
+    static void appendSection(std::vector<char>& file, BinaryModelHeader& header, BinaryModelHeader::Section s,
+                              const std::vector<T>& records)
+    {
+        file.resize((file.size() + BinaryModelHeader::Alignment - 1) / BinaryModelHeader::Alignment * BinaryModelHeader::Alignment, 0);
+        BinaryModelSection& section = header.sections[s];
+        section.offset = static_cast<uint32_t>(file.size());
+        section.size = static_cast<uint32_t>(records.size() * sizeof(T));
+        section.count = static_cast<uint32_t>(records.size());
+        const char* begin = reinterpret_cast<const char*>(records.data());
+        file.insert(file.end(), begin, begin + section.size);
+    }
+};
+
+#endif
@@ -0,0 +1,97 @@
+#include "Skinning.hpp"
+#include "BinaryModel.hpp"
+#include "MeshOptimization.hpp"
+#include "InfluenceSplit.hpp"
+#include "InfluencePruning.hpp"
+#include "cereal/archives/binary.hpp"
+#include "cereal/types/vector.hpp"
+#include "cereal/types/string.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/// Converts a cereal-serialized SkinnedModel (.binmesh) to a binary model file
+/// (see BinaryModel.hpp) that the sample maps and uses in place. Both vertex
+/// formats are written unless -float or -packed restricts it to one. Bone
+/// influences are sorted heaviest first (InfluenceSplit.hpp), and meshes are
+/// welded and reordered for the vertex cache (MeshOptimization.hpp) unless
+/// -nooptimize is given. -prune drops influences lighter than the given
+/// weight first (InfluencePruning.hpp; InfluencePruner reports the error).
+/// Compiled with
+/// clang BinaryModelConverter.cpp ../../extensions/externals/src/Half/half.cpp -o BinaryModelConverter -O2 -Wall -std=c++11 -I. -I../../extensions/include/ -I../../extensions/externals/include/ -lstdc++ -lm
+/// and run as
+/// ./BinaryModelConverter assets/dude.binmesh assets/dude.skm
+///
+
+int main(int argc, char** argv)
+{
+    unsigned vertexFormats = BinaryModel::FloatVertices | BinaryModel::PackedVertices;
+    bool optimize = true;
+    PruningSettings pruning;
+    pruning.threshold = 0.f;
+    int arg = 1;
+    for (; arg < argc - 2; arg++) {
+        const std::string option = argv[arg];
+        if (option == "-float")
+            vertexFormats = BinaryModel::FloatVertices;
+        else if (option == "-packed")
+            vertexFormats = BinaryModel::PackedVertices;
+        else if (option == "-nooptimize")
+            optimize = false;
+        else if (option == "-prune" && arg + 1 < argc - 2)
+            std::istringstream(argv[++arg]) >> pruning.threshold;
+        else
+            break;
+    }
+    if (argc < 3 || arg != argc - 2) {
+        std::cerr << "Usage: " << argv[0] << " [-float|-packed] [-nooptimize] [-prune threshold] <input.binmesh> <output.skm>" << std::endl;
+        return 1;
+    }
+    const char* input = argv[argc - 2];
+    const char* output = argv[argc - 1];
+
+    std::ifstream is(input, std::ios::binary);
+    if (!is) {
+        std::cerr << "Cannot open " << input << std::endl;
+        return 1;
+    }
+    SkinnedModel model;
+    cereal::BinaryInputArchive iarchive(is);
+    iarchive(model);
+    PruningStats pruned = {};
+    for (Mesh& mesh: model.meshes) {
+        for (Vertex& vertex: mesh.vertices) {
+            if (pruning.threshold > 0.f)
+                influencepruning::pruneInfluences(vertex, pruning, &pruned);
+            else
+                influencesplit::sortInfluences(vertex);
+        }
+    }
+    if (pruning.threshold > 0.f)
+        std::cout << "Pruned " << pruned.numInfluences << " influences of " << pruned.numVertices << " vertices" << std::endl;
+    if (optimize)
+        for (Mesh& mesh: model.meshes)
+            meshoptimization::optimizeMesh(mesh);
+
+    const std::vector<char> file = BinaryModel::write(model, vertexFormats);
+    BinaryModel binary;
+    if (!BinaryModel::parse(file.data(), file.size(), binary)) {
+        std::cerr << "Model does not fit the binary model format" << std::endl;
+        return 1;
+    }
+
+    std::ofstream os(output, std::ios::binary);
+    os.write(file.data(), file.size());
+    if (!os) {
+        std::cerr << "Cannot write " << output << std::endl;
+        return 1;
+    }
+    std::cout << output << ": " << binary.meshes.size() << " meshes, " << std::max(binary.vertices.size(), binary.packedVertices.size()) << " vertices, "
+              << binary.indices.size() << " indices, " << binary.nodes.size() << " nodes, "
+              << binary.animationKeys.size() << " animation keys, " << file.size() << " bytes" << std::endl;
+    return 0;
+}
@@ -0,0 +1,240 @@
+#ifndef __BonePartitioning_hpp__
+#define __BonePartitioning_hpp__
+
+#include "Skinning.hpp"
+#include "PackedVertex.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+/// \file BonePartitioning.hpp
+/// \brief Splitting of meshes into parts that each fit a bone palette.
+///
+/// skinning.vert keeps the palette in a uniform array, and ES2 only promises
+/// 128 vertex uniform vectors: 4 per bone matrix, so some 30 bones. A mesh
+/// whose vertices reference more bones than the palette holds is drawn in
+/// partitions, each with a palette of its own (the bones it references, in
+/// local order) and vertices whose bone indices point into that palette.
+///
+/// partitionMesh grows one partition at a time. It starts at the first
+/// triangle not yet placed and keeps adding the triangle that brings in the
+/// fewest new bones (triangles that bring in none come for free), until no
+/// triangle fits. Triangles then go back into their original order, so that
+/// what MeshOptimization.hpp did for the vertex cache survives within each
+/// partition. Vertices used by triangles of several partitions are copied
+/// into each; the statistics count those copies.
+
+/// \brief Triangles of a partitioned mesh that share a palette.
+struct BonePartition
+{
+    std::vector<int> bones;   ///< Model bone of each palette entry.
+    size_t firstIndex;
+    size_t numIndices;
+    size_t firstVertex;
+    size_t numVertices;
+};
+
+/// \brief A mesh split by partitionMesh.
+template <typename V>
+struct PartitionedMesh
+{
+    std::vector<V> vertices;               ///< Bone indices are palette entries of their partition.
+    std::vector<unsigned short> indices;   ///< Into vertices; partitions are contiguous in both.
+    std::vector<BonePartition> partitions;
+};
+
+/// \brief Partitioning results, over any number of meshes.
+struct BonePartitionStats
+{
+    size_t numMeshes;
+    size_t numPartitions;         ///< Also the draw calls, before the influence split.
+    size_t numVertices;           ///< Before partitioning.
+    size_t numDuplicatedVertices; ///< Copies added for vertices shared by partitions.
+    size_t maxBones;              ///< Largest palette of any partition.
+};
+
+namespace bonepartitioning {
+
+/// Influence slot k of a vertex: its bone, and whether it has any weight.
+inline bool getInfluence(const Vertex& v, int k, int& bone)
+{
+    const float index = std::floor(v.bones[k]);
+    bone = static_cast<int>(index);
+    return v.bones[k] - index > 0.f;
+}
+
+inline bool getInfluence(const PackedVertex& v, int k, int& bone)
+{
+    bone = v.bones[k];
+    return v.weights[k] > 0;
+}
+
+/// Points influence slot k at another bone, keeping its weight.
+inline void setInfluenceBone(Vertex& v, int k, int bone)
+{
+    v.bones[k] = bone + (v.bones[k] - std::floor(v.bones[k]));
+}
+
+inline void setInfluenceBone(PackedVertex& v, int k, int bone)
+{
+    v.bones[k] = static_cast<uint8_t>(bone);
+}
+
+/// Highest bone index any weighted influence refers to, plus one.
+template <typename V>
+int countBones(const V* vertices, size_t numVertices)
+{
+    int numBones = 0;
+    for (size_t i = 0; i < numVertices; i++) {
+        for (int k = 0; k < 4; k++) {
+            int bone;
+            if (getInfluence(vertices[i], k, bone))
+                numBones = std::max(numBones, bone + 1);
+        }
+    }
+    return numBones;
+}
+
+/// Splits a triangle list into partitions of at most maxBones bones each.
+/// Fails, leaving out unspecified, if a triangle alone references more than
+/// maxBones bones (at most 12 ever do) or if the copies would not fit 16-bit
+/// indices. Adds to stats, if given.
+template <typename V>
+bool partitionMesh(const V* vertices, size_t numVertices, const unsigned short* indices, size_t numIndices,
+                   int maxBones, PartitionedMesh<V>& out, BonePartitionStats* stats = nullptr)
+{
+    const size_t numTriangles = numIndices / 3;
+    out.vertices.clear();
+    out.indices.clear();
+    out.partitions.clear();
+
+    // The distinct weighted bones of every triangle.
+    std::vector<int> triangleBones(12 * numTriangles);
+    std::vector<int> triangleNumBones(numTriangles, 0);
+    for (size_t t = 0; t < numTriangles; t++) {
+        int* bones = &triangleBones[12 * t];
+        for (int c = 0; c < 3; c++) {
+            for (int k = 0; k < 4; k++) {
+                int bone;
+                if (getInfluence(vertices[indices[3*t + c]], k, bone) &&
+                    std::find(bones, bones + triangleNumBones[t], bone) == bones + triangleNumBones[t])
+                    bones[triangleNumBones[t]++] = bone;
+            }
+        }
+        if (triangleNumBones[t] > maxBones)
+            return false;
+    }
+
+    const int numModelBones = countBones(vertices, numVertices);
+    // Palette entry of a bone in the current partition; bone 0 always has
+    // one, as the filler entry of partitions without weighted bones.
+    std::vector<int> localBone(std::max(numModelBones, 1), -1);
+    std::vector<int> localVertex(numVertices, -1);      // Copy of a vertex in the current partition.
+    std::vector<size_t> remaining(numTriangles);
+    for (size_t t = 0; t < numTriangles; t++)
+        remaining[t] = t;
+    std::vector<size_t> selected;
+
+    while (!remaining.empty()) {
+        BonePartition partition;
+        selected.clear();
+        size_t best = remaining[0];
+        while (true) {
+            // Take best in, with its bones.
+            for (int b = 0; b < triangleNumBones[best]; b++) {
+                const int bone = triangleBones[12 * best + b];
+                if (localBone[bone] == -1) {
+                    localBone[bone] = static_cast<int>(partition.bones.size());
+                    partition.bones.push_back(bone);
+                }
+            }
+
+            // Everything that now fits without new bones follows; of the
+            // rest, the one needing the fewest new bones is next.
+            size_t kept = 0;
+            int bestCost = maxBones + 1;
+            const size_t taken = best;
+            best = numTriangles;
+            for (size_t i = 0; i < remaining.size(); i++) {
+                const size_t t = remaining[i];
+                if (t == taken) {
+                    selected.push_back(t);
+                    continue;
+                }
+                int cost = 0;
+                for (int b = 0; b < triangleNumBones[t]; b++)
+                    if (localBone[triangleBones[12 * t + b]] == -1)
+                        cost++;
+                if (cost == 0) {
+                    selected.push_back(t);
+                    continue;
+                }
+                if (static_cast<int>(partition.bones.size()) + cost <= maxBones && cost < bestCost) {
+                    bestCost = cost;
+                    best = t;
+                }
+                remaining[kept++] = t;
+            }
+            remaining.resize(kept);
+            if (best == numTriangles)
+                break;
+        }
+        std::sort(selected.begin(), selected.end());
+        if (partition.bones.empty())
+            partition.bones.push_back(0);   // Only unweighted vertices; entry 0 must still exist.
+
+        partition.firstIndex = out.indices.size();
+        partition.numIndices = 3 * selected.size();
+        partition.firstVertex = out.vertices.size();
+        for (size_t t: selected) {
+            for (int c = 0; c < 3; c++) {
+                const unsigned short index = indices[3*t + c];
+                if (localVertex[index] == -1) {
+                    localVertex[index] = static_cast<int>(out.vertices.size());
+                    V v = vertices[index];
+                    for (int k = 0; k < 4; k++) {
+                        int bone;
+                        // Unweighted slots point at entry 0, which every partition has.
+                        setInfluenceBone(v, k, getInfluence(v, k, bone) ? localBone[bone] : 0);
+                    }
+                    out.vertices.push_back(v);
+                }
+                if (out.vertices.size() > 65536)
+                    return false;
+                out.indices.push_back(static_cast<unsigned short>(localVertex[index]));
+            }
+        }
+        partition.numVertices = out.vertices.size() - partition.firstVertex;
+
+        for (int bone: partition.bones)
+            localBone[bone] = -1;
+        for (size_t t: selected)
+            for (int c = 0; c < 3; c++)
+                localVertex[indices[3*t + c]] = -1;
+        out.partitions.push_back(partition);
+    }
+
+    if (stats) {
+        std::vector<bool> used(numVertices, false);
+        size_t numUsed = 0;
+        for (size_t i = 0; i < numIndices; i++) {
+            if (!used[indices[i]]) {
+                used[indices[i]] = true;
+                numUsed++;
+            }
+        }
+        stats->numMeshes++;
+        stats->numPartitions += out.partitions.size();
+        stats->numVertices += numVertices;
+        stats->numDuplicatedVertices += out.vertices.size() - numUsed;
+        for (const BonePartition& partition: out.partitions)
+            stats->maxBones = std::max(stats->maxBones, partition.bones.size());
+    }
+    return true;
+}
+
+} // namespace bonepartitioning
+
+#endif
@@ -0,0 +1,445 @@
+#ifndef __CompressedAnimation_hpp__
+#define __CompressedAnimation_hpp__
+
+#include "Skinning.hpp"
+#include "Animation.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+/// \file CompressedAnimation.hpp
+/// \brief Compact, resident form of the NodeAnimations of a clip.
+///
+/// An AnimationKey takes 20 bytes (a vec4f and a time) whether it holds a
+/// rotation or a translation. CompressedClip stores the same tracks as:
+///
+/// - rotations quantized with the "smallest three" scheme: the largest quaternion
+///   component is dropped (it follows from the unit length), the other three lie
+///   in [-1/sqrt(2), 1/sqrt(2)] and are stored with 15 bits each; the index of
+///   the dropped component goes into the two spare bits. 6 bytes per key.
+/// - translations quantized to 8 or 16 bits per component relative to the
+///   bounding box of the track. 3 or 6 bytes per key.
+/// - key times in time axes shared by every track with the same keys (typically
+///   all tracks of a clip exported at a fixed rate, and all constant tracks).
+///
+/// CompressedClip::compress is the offline encoder. It leaves out padding keys
+/// (see Animation.hpp), which the cursor never samples, drops keys that linear
+/// interpolation of their neighbours reproduces within the configured error bound,
+/// collapses constant tracks to a single key and picks the translation bit depth
+/// per track. Sampling uses the same KeyframeCursors and key lookup as the
+/// uncompressed tracks and only decodes the two keys it interpolates.
+
+namespace animationcompression {
+
+const float    smallestThreeRange = 0.70710678f; ///< Bound of the three smallest components.
+const uint16_t smallestThreeMax   = 0x7fff;      ///< 15 bits per component.
+
+/// Packs a unit quaternion into three 16 bit words.
+inline void encodeRotation(const nv::quaternionf& q, uint16_t packed[3])
+{
+    float c[4] = {q.x, q.y, q.z, q.w};
+    const float length = std::sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2] + c[3]*c[3]);
+    int largest = 0;
+    for (int i = 1; i < 4; i++)
+        if (std::abs(c[i]) > std::abs(c[largest]))
+            largest = i;
+    // q and -q are the same rotation; make the dropped component positive.
+    const float scale = (c[largest] < 0.f ? -1.f : 1.f) / length;
+
+    int k = 0;
+    for (int i = 0; i < 4; i++) {
+        if (i == largest)
+            continue;
+        const float normalized = (scale*c[i] / smallestThreeRange) * 0.5f + 0.5f;
+        const float quantized = std::floor(normalized * smallestThreeMax + 0.5f);
+        packed[k++] = static_cast<uint16_t>(quantized < 0.f ? 0.f : (quantized > smallestThreeMax ? smallestThreeMax : quantized));
+    }
+    packed[0] |= static_cast<uint16_t>((largest & 1) << 15);
+    packed[1] |= static_cast<uint16_t>((largest >> 1) << 15);
+}
+
+inline nv::quaternionf decodeRotation(const uint16_t packed[3])
+{
+    const int largest = (packed[0] >> 15) | ((packed[1] >> 15) << 1);
+    float c[4];
+    float sumSquares = 0.f;
+    int k = 0;
+    for (int i = 0; i < 4; i++) {
+        if (i == largest)
+            continue;
+        const float normalized = static_cast<float>(packed[k++] & smallestThreeMax) / smallestThreeMax;
+        c[i] = (normalized * 2.f - 1.f) * smallestThreeRange;
+        sumSquares += c[i]*c[i];
+    }
+    c[largest] = std::sqrt(sumSquares < 1.f ? 1.f - sumSquares : 0.f);
+    return nv::quaternionf(c[0], c[1], c[2], c[3]);
+}
+
+/// Rotation angle (radians) between two rotations. Computed from the chord
+/// between the unit quaternions, which unlike acos(dot) stays accurate for
+/// nearly identical rotations.
+inline float rotationError(const nv::quaternionf& a, const nv::quaternionf& b)
+{
+    const float la = std::sqrt(a.x*a.x + a.y*a.y + a.z*a.z + a.w*a.w);
+    const float lb = std::sqrt(b.x*b.x + b.y*b.y + b.z*b.z + b.w*b.w);
+    const float sb = (a.x*b.x + a.y*b.y + a.z*b.z + a.w*b.w < 0.f ? -1.f : 1.f) / lb;
+    const float dx = a.x/la - sb*b.x, dy = a.y/la - sb*b.y, dz = a.z/la - sb*b.z, dw = a.w/la - sb*b.w;
+    const float halfChord = 0.5f * std::sqrt(dx*dx + dy*dy + dz*dz + dw*dw);
+    return 4.f * std::asin(halfChord < 1.f ? halfChord : 1.f);
+}
+
+/// Largest per-component difference of two translations.
+inline float translationError(const nv::vec3f& a, const nv::vec3f& b)
+{
+    const float dx = std::abs(a.x - b.x), dy = std::abs(a.y - b.y), dz = std::abs(a.z - b.z);
+    return dx > dy ? (dx > dz ? dx : dz) : (dy > dz ? dy : dz);
+}
+
+/// Worst-case error introduced by the 15 bit smallest three quantization.
+const float rotationQuantizationError = 0.0002f;
+
+} // namespace animationcompression
+
+/// \brief Encoder settings. Errors are absolute: model units for translations,
+/// radians for rotations, measured against the source keys.
+struct AnimationCompressionSettings
+{
+    AnimationCompressionSettings(): maxTranslationError(0.01f), maxRotationError(0.001f), removeKeys(true) {}
+
+    float maxTranslationError;
+    float maxRotationError;
+    bool  removeKeys;          ///< Drop keys reproducible by interpolating their neighbours.
+};
+
+/// \brief What CompressedClip::compress did, errors measured at the source key times.
+struct AnimationCompressionStats
+{
+    AnimationCompressionStats(): sourceKeys(0), compressedKeys(0), sourceBytes(0), compressedBytes(0),
+                                 maxTranslationError(0.f), maxRotationError(0.f) {}
+
+    size_t sourceKeys;
+    size_t compressedKeys;
+    size_t sourceBytes;
+    size_t compressedBytes;
+    float  maxTranslationError;
+    float  maxRotationError;
+};
+
+/// \brief Key times shared by one or more tracks: CompressedClip::times[first, first + numKeys).
+struct CompressedTimeAxis
+{
+    uint32_t first;
+    uint32_t numKeys;
+};
+
+/// \brief A range-quantized translation track. Keys start at
+/// CompressedClip::translationData[dataOffset], 3 components of bits/8 bytes each.
+struct CompressedTranslationTrack
+{
+    uint32_t  timeAxis;
+    uint32_t  dataOffset;
+    uint32_t  bits;       ///< 8 or 16.
+    nv::vec3f minimum;
+    nv::vec3f scale;      ///< Value of one quantization step, per component.
+};
+
+/// \brief A smallest-three quantized rotation track. Keys start at
+/// CompressedClip::rotationData[dataOffset], 3 words each.
+struct CompressedRotationTrack
+{
+    uint32_t timeAxis;
+    uint32_t dataOffset;
+};
+
+/// \brief All NodeAnimations of a clip in compressed form. Track i holds
+/// NodeAnimation i, so nodeAnimationIdx works as a track index.
+struct CompressedClip
+{
+    std::vector<float>                      times;
+    std::vector<CompressedTimeAxis>         timeAxes;
+    std::vector<CompressedTranslationTrack> translationTracks;
+    std::vector<CompressedRotationTrack>    rotationTracks;
+    std::vector<uint8_t>                    translationData;
+    std::vector<uint16_t>                   rotationData;
+
+    size_t numTracks() const { return rotationTracks.size(); }
+
+    /// Resident size of the compressed data.
+    size_t sizeInBytes() const
+    {
+        return times.size() * sizeof(float) +
+               timeAxes.size() * sizeof(CompressedTimeAxis) +
+               translationTracks.size() * sizeof(CompressedTranslationTrack) +
+               rotationTracks.size() * sizeof(CompressedRotationTrack) +
+               translationData.size() * sizeof(uint8_t) +
+               rotationData.size() * sizeof(uint16_t);
+    }
+
+    /// Size of the key data of uncompressed tracks.
+    static size_t sourceSizeInBytes(const std::vector<NodeAnimation>& animations)
+    {
+        size_t keys = 0;
+        for (const NodeAnimation& animation: animations)
+            keys += animation.translationKeys.size() + animation.rotationKeys.size();
+        return keys * sizeof(AnimationKey);
+    }
+
+    nv::vec3f decodeTranslation(const CompressedTranslationTrack& track, size_t key) const
+    {
+        float q[3];
+        if (track.bits == 8) {
+            const uint8_t* data = &translationData[track.dataOffset + key*3];
+            for (int c = 0; c < 3; c++)
+                q[c] = data[c];
+        } else {
+            const uint8_t* data = &translationData[track.dataOffset + key*6];
+            for (int c = 0; c < 3; c++)
+                q[c] = static_cast<float>(data[2*c] | (data[2*c + 1] << 8));
+        }
+        return nv::vec3f(track.minimum.x + q[0]*track.scale.x,
+                         track.minimum.y + q[1]*track.scale.y,
+                         track.minimum.z + q[2]*track.scale.z);
+    }
+
+    nv::quaternionf decodeRotation(const CompressedRotationTrack& track, size_t key) const
+    {
+        return animationcompression::decodeRotation(&rotationData[track.dataOffset + key*3]);
+    }
+
+    /// Interpolated translation of a track; decodes two keys.
+    nv::vec3f sampleTranslation(int trackIdx, float time, KeyframeCursor& cursor) const
+    {
+        const CompressedTranslationTrack& track = translationTracks[trackIdx];
+        const CompressedTimeAxis& axis = timeAxes[track.timeAxis];
+        const KeyframePair keys = findKeyframes(&times[axis.first], axis.numKeys, time, cursor);
+        const nv::vec3f trans0 = decodeTranslation(track, keys.index0);
+        const nv::vec3f trans1 = decodeTranslation(track, keys.index1);
+        return (1.f-keys.t)*trans0 + keys.t*trans1;
+    }
+
+    /// Interpolated rotation of a track; decodes two keys.
+    nv::quaternionf sampleRotation(int trackIdx, float time, KeyframeCursor& cursor) const
+    {
+        const CompressedRotationTrack& track = rotationTracks[trackIdx];
+        const CompressedTimeAxis& axis = timeAxes[track.timeAxis];
+        const KeyframePair keys = findKeyframes(&times[axis.first], axis.numKeys, time, cursor);
+        return interpolateRotation(decodeRotation(track, keys.index0), decodeRotation(track, keys.index1), keys.t);
+    }
+
+    /// Offline encoder.
+    static CompressedClip compress(const std::vector<NodeAnimation>& animations,
+                                   const AnimationCompressionSettings& settings = AnimationCompressionSettings(),
+                                   AnimationCompressionStats* stats = nullptr)
+    {
+        using namespace animationcompression;
+
+        CompressedClip clip;
+        TimeAxisMap axisMap;
+        AnimationCompressionStats s;
+        s.sourceBytes = sourceSizeInBytes(animations);
+
+        // Half of each bound goes to key removal, the rest to quantization.
+        const float translationTolerance = 0.5f * settings.maxTranslationError;
+        const float rotationQuantization = rotationQuantizationError < settings.maxRotationError ? rotationQuantizationError : settings.maxRotationError;
+        const float rotationTolerance = settings.maxRotationError - rotationQuantization;
+
+        for (const NodeAnimation& animation: animations) {
+            // Translations.
+            std::vector<size_t> kept = selectKeys(animation.translationKeys, ascendingKeys(animation.translationKeys),
+                                                  translationTolerance, settings.removeKeys, &interpolationErrorTranslation);
+            CompressedTranslationTrack translationTrack;
+            translationTrack.timeAxis = clip.addTimeAxis(animation.translationKeys, kept, axisMap);
+            translationTrack.dataOffset = static_cast<uint32_t>(clip.translationData.size());
+
+            float lo[3] = {0.f, 0.f, 0.f}, hi[3] = {0.f, 0.f, 0.f};
+            for (size_t k = 0; k < kept.size(); k++) {
+                const float* v = &animation.translationKeys[kept[k]].value.x;
+                for (int c = 0; c < 3; c++) {
+                    lo[c] = k == 0 || v[c] < lo[c] ? v[c] : lo[c];
+                    hi[c] = k == 0 || v[c] > hi[c] ? v[c] : hi[c];
+                }
+            }
+            // 8 bits if half a quantization step stays within the remaining bound.
+            translationTrack.bits = 8;
+            for (int c = 0; c < 3; c++)
+                if ((hi[c] - lo[c]) / (2.f * 255.f) > settings.maxTranslationError - translationTolerance)
+                    translationTrack.bits = 16;
+            const float levels = translationTrack.bits == 8 ? 255.f : 65535.f;
+            float* minimum = &translationTrack.minimum.x;
+            float* scale = &translationTrack.scale.x;
+            for (int c = 0; c < 3; c++) {
+                minimum[c] = lo[c];
+                scale[c] = hi[c] > lo[c] ? (hi[c] - lo[c]) / levels : 0.f;
+            }
+            for (size_t k: kept) {
+                const float* v = &animation.translationKeys[k].value.x;
+                for (int c = 0; c < 3; c++) {
+                    const float q = scale[c] > 0.f ? std::floor((v[c] - minimum[c]) / scale[c] + 0.5f) : 0.f;
+                    const uint32_t quantized = static_cast<uint32_t>(q < 0.f ? 0.f : (q > levels ? levels : q));
+                    clip.translationData.push_back(static_cast<uint8_t>(quantized & 0xff));
+                    if (translationTrack.bits == 16)
+                        clip.translationData.push_back(static_cast<uint8_t>(quantized >> 8));
+                }
+            }
+            clip.translationTracks.push_back(translationTrack);
+
+            // Rotations.
+            kept = selectKeys(animation.rotationKeys, ascendingKeys(animation.rotationKeys),
+                              rotationTolerance, settings.removeKeys, &interpolationErrorRotation);
+            CompressedRotationTrack rotationTrack;
+            rotationTrack.timeAxis = clip.addTimeAxis(animation.rotationKeys, kept, axisMap);
+            rotationTrack.dataOffset = static_cast<uint32_t>(clip.rotationData.size());
+            for (size_t k: kept) {
+                uint16_t packed[3];
+                encodeRotation(toQuaternion(animation.rotationKeys[k].value), packed);
+                clip.rotationData.insert(clip.rotationData.end(), packed, packed + 3);
+            }
+            clip.rotationTracks.push_back(rotationTrack);
+
+            s.sourceKeys += animation.translationKeys.size() + animation.rotationKeys.size();
+        }
+
+        for (size_t i = 0; i < clip.numTracks(); i++)
+            s.compressedKeys += clip.timeAxes[clip.translationTracks[i].timeAxis].numKeys +
+                                clip.timeAxes[clip.rotationTracks[i].timeAxis].numKeys;
+        s.compressedBytes = clip.sizeInBytes();
+
+        // Measure the result against the source tracks, sampled the same way, at
+        // every source key time.
+        for (size_t i = 0; i < animations.size(); i++) {
+            const std::vector<AnimationKey>& translationKeys = animations[i].translationKeys;
+            KeyframeCursor sourceCursor, cursor;
+            for (const AnimationKey& key: translationKeys) {
+                const KeyframePair pair = findKeyframes(translationKeys, key.time, sourceCursor);
+                const nv::vec3f source = (1.f-pair.t)*toVector(translationKeys[pair.index0].value) + pair.t*toVector(translationKeys[pair.index1].value);
+                const float e = translationError(source, clip.sampleTranslation(static_cast<int>(i), key.time, cursor));
+                s.maxTranslationError = e > s.maxTranslationError ? e : s.maxTranslationError;
+            }
+            const std::vector<AnimationKey>& rotationKeys = animations[i].rotationKeys;
+            sourceCursor = cursor = KeyframeCursor();
+            for (const AnimationKey& key: rotationKeys) {
+                const KeyframePair pair = findKeyframes(rotationKeys, key.time, sourceCursor);
+                const nv::quaternionf source = interpolateRotation(toQuaternion(rotationKeys[pair.index0].value), toQuaternion(rotationKeys[pair.index1].value), pair.t);
+                const float e = rotationError(source, clip.sampleRotation(static_cast<int>(i), key.time, cursor));
+                s.maxRotationError = e > s.maxRotationError ? e : s.maxRotationError;
+            }
+        }
+        if (stats)
+            *stats = s;
+        return clip;
+    }
+
+private:
+    typedef std::map<std::vector<float>, uint32_t> TimeAxisMap;
+
+    static nv::vec3f toVector(const nv::vec4f& v) { return nv::vec3f(v.x, v.y, v.z); }
+    static nv::quaternionf toQuaternion(const nv::vec4f& v) { return nv::quaternionf(v.x, v.y, v.z, v.w); }
+
+    /// Error of reproducing keys[k] by interpolating keys[first] and keys[last].
+    static float interpolationErrorTranslation(const std::vector<AnimationKey>& keys, size_t first, size_t last, size_t k)
+    {
+        const float dt = keys[last].time - keys[first].time;
+        const float t = dt > 0.f ? (keys[k].time - keys[first].time) / dt : 0.f;
+        const nv::vec3f value = (1.f-t)*toVector(keys[first].value) + t*toVector(keys[last].value);
+        return animationcompression::translationError(value, toVector(keys[k].value));
+    }
+
+    static float interpolationErrorRotation(const std::vector<AnimationKey>& keys, size_t first, size_t last, size_t k)
+    {
+        const float dt = keys[last].time - keys[first].time;
+        const float t = dt > 0.f ? (keys[k].time - keys[first].time) / dt : 0.f;
+        const nv::quaternionf value = interpolateRotation(toQuaternion(keys[first].value), toQuaternion(keys[last].value), t);
+        return animationcompression::rotationError(value, toQuaternion(keys[k].value));
+    }
+
+    typedef float (*InterpolationError)(const std::vector<AnimationKey>&, size_t, size_t, size_t);
+
+    /// Indices of the keys to keep of the first numKeys, the ascending ones.
+    /// Greedily extends each segment while all keys inside it interpolate
+    /// within tolerance; a constant track keeps one key.
+    static std::vector<size_t> selectKeys(const std::vector<AnimationKey>& keys, size_t numKeys, float tolerance,
+                                          bool removeKeys, InterpolationError error)
+    {
+        std::vector<size_t> kept;
+        if (!removeKeys || numKeys < 3) {
+            for (size_t k = 0; k < numKeys; k++)
+                kept.push_back(k);
+            return kept;
+        }
+
+        // Before the first and past the last key the first key is held (see
+        // findKeyframes), so a track that never leaves it needs nothing else.
+        bool constant = true;
+        for (size_t k = 1; k < numKeys && constant; k++)
+            constant = error(keys, 0, 0, k) <= tolerance;
+        kept.push_back(0);
+        if (constant)
+            return kept;
+
+        size_t first = 0;
+        for (size_t last = 1; last < numKeys; last++) {
+            bool fits = true;
+            for (size_t k = first + 1; k < last && fits; k++)
+                fits = error(keys, first, last, k) <= tolerance;
+            if (!fits) {
+                first = last - 1;
+                if (kept.back() != first)
+                    kept.push_back(first);
+            }
+        }
+        if (kept.back() != numKeys - 1)
+            kept.push_back(numKeys - 1);
+        return kept;
+    }
+
+    uint32_t addTimeAxis(const std::vector<AnimationKey>& keys, const std::vector<size_t>& kept, TimeAxisMap& axisMap)
+    {
+        std::vector<float> axisTimes;
+        axisTimes.reserve(kept.size());
+        for (size_t k: kept)
+            axisTimes.push_back(keys[k].time);
+        TimeAxisMap::const_iterator existing = axisMap.find(axisTimes);
+        if (existing != axisMap.end())
+            return existing->second;
+
+        CompressedTimeAxis axis;
+        axis.first = static_cast<uint32_t>(times.size());
+        axis.numKeys = static_cast<uint32_t>(axisTimes.size());
+        times.insert(times.end(), axisTimes.begin(), axisTimes.end());
+        const uint32_t axisIdx = static_cast<uint32_t>(timeAxes.size());
+        timeAxes.push_back(axis);
+        axisMap[axisTimes] = axisIdx;
+        return axisIdx;
+    }
+};
+
+/// Cereal serialization, see Skinning.hpp.
+namespace cereal {
+
+template<class Archive> void serialize(Archive& archive, CompressedTimeAxis& axis)
+{
+    archive(axis.first, axis.numKeys);
+}
+
+template<class Archive> void serialize(Archive& archive, CompressedTranslationTrack& track)
+{
+    archive(track.timeAxis, track.dataOffset, track.bits, track.minimum, track.scale);
+}
+
+template<class Archive> void serialize(Archive& archive, CompressedRotationTrack& track)
+{
+    archive(track.timeAxis, track.dataOffset);
+}
+
+template<class Archive> void serialize(Archive& archive, CompressedClip& clip)
+{
+    archive(clip.times, clip.timeAxes, clip.translationTracks, clip.rotationTracks,
+            clip.translationData, clip.rotationData);
+}
+
+} // namespace cereal
+
+#endif
@@ -0,0 +1,259 @@
+#ifndef __CpuSkinning_hpp__
+#define __CpuSkinning_hpp__
+
+#include "Skinning.hpp"
+#include "DualQuaternion.hpp"
+#include "DualQuaternionN.hpp"
+#include "NvAppBase/NvJobSystem.h"
+
+#include <cmath>
+#include <cstddef>
+
+/// \file CpuSkinning.hpp
+/// \brief CPU implementation of skinning.vert.
+///
+/// Produces the same deformed positions and normals as the vertex shader, for both
+/// dual quaternion blending (the fast cross product path of DQB()) and linear blend
+/// skinning with a matrix palette. Vertices are read in the exact format uploaded
+/// to the GPU: Vertex::bones packs four influences, the integer part of each
+/// component being the bone index and the fractional part its weight.
+///
+/// Vertices are processed FloatN::Width at a time and, when an NvJobSystem
+/// is supplied, split across cores. Output goes into caller-provided buffers;
+/// nothing is allocated per call. Bones and uv are copied through unchanged so the
+/// result is a complete Vertex stream.
+
+namespace cpuskinning {
+
+/// Splits one packed influence into bone index and weight, like
+/// int(bones.x) and fract(bones.x) in the shader.
+inline void unpackInfluence(float packed, int& boneIdx, float& weight)
+{
+    const float index = std::floor(packed);
+    boneIdx = static_cast<int>(index);
+    weight = packed - index;
+}
+
+/// Skins a single vertex with dual quaternion blending. Reference implementation,
+/// also handy for one-off queries such as hit-testing a handful of vertices.
+inline Vertex skinVertex(const Vertex& in, const DualQuaternion* palette)
+{
+    const float* packed = &in.bones.x;
+    int idx;
+    float w;
+    unpackInfluence(packed[0], idx, w);
+    const Quaternion real0 = palette[idx].real;
+    Quaternion b0 = w * palette[idx].real;
+    Quaternion be = w * palette[idx].dual;
+    for (int k = 1; k < 4; k++) {
+        unpackInfluence(packed[k], idx, w);
+        const Quaternion& real = palette[idx].real;
+        const float d = real.x*real0.x + real.y*real0.y + real.z*real0.z + real.w*real0.w;
+        const float sw = d < 0.f ? -w : w;
+        b0 = b0 + sw * real;
+        be = be + sw * palette[idx].dual;
+    }
+    const float invLength = 1.f / std::sqrt(b0.x*b0.x + b0.y*b0.y + b0.z*b0.z + b0.w*b0.w);
+    const DualQuaternion c(invLength * b0, invLength * be);
+
+    // Same cross product formulation as the shader (and transformPoints).
+    const float a = c.real.w, b = c.dual.w;
+    const nv::vec3f r(c.real.x, c.real.y, c.real.z);
+    const nv::vec3f t(c.dual.x, c.dual.y, c.dual.z);
+    Vertex out = in;
+    out.position = in.position + 2.f * cross(r, cross(r, in.position) + a*in.position)
+                               + 2.f * (a*t - b*r + cross(r, t));
+    out.normal = in.normal + 2.f * cross(r, cross(r, in.normal) + a*in.normal);
+    return out;
+}
+
+/// Skins a single vertex with linear blending of a matrix palette.
+inline Vertex skinVertex(const Vertex& in, const nv::matrix4f* palette)
+{
+    const float* packed = &in.bones.x;
+    nv::matrix4f transform;
+    for (int e = 0; e < 16; e++)
+        transform._array[e] = 0.f;
+    for (int k = 0; k < 4; k++) {
+        int idx;
+        float w;
+        unpackInfluence(packed[k], idx, w);
+        for (int e = 0; e < 16; e++)
+            transform._array[e] += w * palette[idx]._array[e];
+    }
+    Vertex out = in;
+    out.position = nv::vec3f(transform * nv::vec4f(in.position, 1.f));
+    out.normal   = nv::vec3f(transform * nv::vec4f(in.normal, 0.f));
+    return out;
+}
+
+/// Vertex attributes of FloatN::Width vertices in SoA form.
+struct VertexLanes
+{
+    static const int Width = FloatN::Width;
+
+    /// Loads count (<= Width) vertices; missing lanes replicate the first vertex.
+    void load(const Vertex* in, size_t count)
+    {
+        float p[3][Width], n[3][Width], b[4][Width];
+        for (int j = 0; j < Width; j++) {
+            const Vertex& v = in[static_cast<size_t>(j) < count ? j : 0];
+            p[0][j] = v.position.x; p[1][j] = v.position.y; p[2][j] = v.position.z;
+            n[0][j] = v.normal.x;   n[1][j] = v.normal.y;   n[2][j] = v.normal.z;
+            for (int k = 0; k < 4; k++) {
+                const float index = std::floor((&v.bones.x)[k]);
+                boneIdx[k][j] = static_cast<int>(index);
+                b[k][j] = (&v.bones.x)[k] - index;
+            }
+        }
+        px = FloatN::load(p[0]); py = FloatN::load(p[1]); pz = FloatN::load(p[2]);
+        nx = FloatN::load(n[0]); ny = FloatN::load(n[1]); nz = FloatN::load(n[2]);
+        for (int k = 0; k < 4; k++)
+            weight[k] = FloatN::load(b[k]);
+    }
+
+    /// Writes count (<= Width) vertices: skinned position/normal, bones and uv copied from in.
+    void store(const Vertex* in, Vertex* out, size_t count) const
+    {
+        float p[3][Width], n[3][Width];
+        px.store(p[0]); py.store(p[1]); pz.store(p[2]);
+        nx.store(n[0]); ny.store(n[1]); nz.store(n[2]);
+        for (size_t j = 0; j < count; j++) {
+            Vertex& v = out[j];
+            v.position = nv::vec3f(p[0][j], p[1][j], p[2][j]);
+            v.normal   = nv::vec3f(n[0][j], n[1][j], n[2][j]);
+            v.bones    = in[j].bones;
+            v.uv       = in[j].uv;
+        }
+    }
+
+    FloatN px, py, pz;
+    FloatN nx, ny, nz;
+    FloatN weight[4];
+    int    boneIdx[4][Width];
+};
+
+/// Dual quaternion blending of in[0, count) into out[0, count).
+inline void skinVerticesDQB(const Vertex* in, Vertex* out, size_t count, const DualQuaternion* palette)
+{
+    const size_t W = FloatN::Width;
+    VertexLanes lanes;
+    DualQuaternion gathered[FloatN::Width];
+    for (size_t i = 0; i < count; i += W) {
+        const size_t n = count - i < W ? count - i : W;
+        lanes.load(in + i, n);
+
+        for (size_t j = 0; j < W; j++)
+            gathered[j] = palette[lanes.boneIdx[0][j]];
+        const DualQuaternionN q0 = DualQuaternionN::load(gathered);
+        QuaternionN b0 = lanes.weight[0] * q0.real;
+        QuaternionN be = lanes.weight[0] * q0.dual;
+
+        for (int k = 1; k < 4; k++) {
+            for (size_t j = 0; j < W; j++)
+                gathered[j] = palette[lanes.boneIdx[k][j]];
+            const DualQuaternionN q = DualQuaternionN::load(gathered);
+            // Antipodality: flip influences in the other hemisphere than the first one.
+            const FloatN w = select(dot(q.real, q0.real) < FloatN(0.f), -lanes.weight[k], lanes.weight[k]);
+            b0 = b0 + w * q.real;
+            be = be + w * q.dual;
+        }
+
+        const DualQuaternionN c = normalize(DualQuaternionN(b0, be));
+        transformPoints(c, lanes.px, lanes.py, lanes.pz);
+        transformNormals(c, lanes.nx, lanes.ny, lanes.nz);
+        lanes.store(in + i, out + i, n);
+    }
+}
+
+/// Linear blend skinning of in[0, count) into out[0, count).
+inline void skinVerticesLBS(const Vertex* in, Vertex* out, size_t count, const nv::matrix4f* palette)
+{
+    const size_t W = FloatN::Width;
+    VertexLanes lanes;
+    float gathered[12][FloatN::Width];
+    for (size_t i = 0; i < count; i += W) {
+        const size_t n = count - i < W ? count - i : W;
+        lanes.load(in + i, n);
+
+        // Blended upper 3x4 part; the last row only carries the weight sum
+        // which the shader's perspective divide makes irrelevant.
+        FloatN m[12];
+        for (int e = 0; e < 12; e++)
+            m[e] = FloatN(0.f);
+        for (int k = 0; k < 4; k++) {
+            for (size_t j = 0; j < W; j++) {
+                const nv::matrix4f& bone = palette[lanes.boneIdx[k][j]];
+                for (int r = 0; r < 3; r++)
+                    for (int c = 0; c < 4; c++)
+                        gathered[r*4 + c][j] = bone(r, c);
+            }
+            for (int e = 0; e < 12; e++)
+                m[e] = m[e] + lanes.weight[k] * FloatN::load(gathered[e]);
+        }
+
+        const FloatN px = lanes.px, py = lanes.py, pz = lanes.pz;
+        lanes.px = m[0]*px + m[1]*py + m[2]*pz  + m[3];
+        lanes.py = m[4]*px + m[5]*py + m[6]*pz  + m[7];
+        lanes.pz = m[8]*px + m[9]*py + m[10]*pz + m[11];
+        const FloatN nx = lanes.nx, ny = lanes.ny, nz = lanes.nz;
+        lanes.nx = m[0]*nx + m[1]*ny + m[2]*nz;
+        lanes.ny = m[4]*nx + m[5]*ny + m[6]*nz;
+        lanes.nz = m[8]*nx + m[9]*ny + m[10]*nz;
+        lanes.store(in + i, out + i, n);
+    }
+}
+
+inline void skinVertices(const Vertex* in, Vertex* out, size_t count, const DualQuaternion* palette)
+{
+    skinVerticesDQB(in, out, count, palette);
+}
+
+inline void skinVertices(const Vertex* in, Vertex* out, size_t count, const nv::matrix4f* palette)
+{
+    skinVerticesLBS(in, out, count, palette);
+}
+
+} // namespace cpuskinning
+
+/// \brief Multithreaded front end of the CPU skinning kernels.
+///
+/// Splits vertex streams into chunks of getGrainSize() vertices and skins them on
+/// the supplied NvJobSystem (or on the calling thread if none was given).
+/// T is either DualQuaternion (DQB) or nv::matrix4f (LBS), matching the palettes
+/// AngryDudeApp::updateSkinning builds for the shader.
+class CpuSkinning
+{
+public:
+    explicit CpuSkinning(NvJobSystem* workers = nullptr, size_t grainSize = 1024):
+        mWorkers(workers), mGrainSize(grainSize) {}
+
+    /// Skins count vertices from in into out (out must hold count vertices and
+    /// must not overlap in). palette holds one transform per bone.
+    template <typename T>
+    void skin(const Vertex* in, Vertex* out, size_t count, const T* palette) const
+    {
+        if (!mWorkers) {
+            cpuskinning::skinVertices(in, out, count, palette);
+            return;
+        }
+        mWorkers->parallelFor(count, mGrainSize, [=](size_t begin, size_t end) {
+            cpuskinning::skinVertices(in + begin, out + begin, end - begin, palette);
+        });
+    }
+
+    /// Skins all vertices of mesh into out (mesh.vertices.size() elements).
+    template <typename T>
+    void skin(const Mesh& mesh, Vertex* out, const T* palette) const
+    {
+        skin(mesh.vertices.data(), out, mesh.vertices.size(), palette);
+    }
+
+    size_t getGrainSize() const { return mGrainSize; }
+
+private:
+    NvJobSystem* mWorkers;
+    size_t       mGrainSize;
+};
+
+#endif
@@ -0,0 +1,172 @@
+#ifndef __Crowd_hpp__
+#define __Crowd_hpp__
+
+#include "Skinning.hpp"
+#include "DualQuaternion.hpp"
+#include "Skeleton.hpp"
+#include "BakedAnimation.hpp"
+#include "AnimationBlending.hpp"
+#include "NvAppBase/NvJobSystem.h"
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+/// \file Crowd.hpp
+/// \brief Many independently animated instances of one skinned model.
+///
+/// Every instance has its own AnimationState (clips, layers and blend weights,
+/// see AnimationBlending.hpp), playback rate and world transform and gets its
+/// own bone palette. Crowd::update advances all of them in one batched pass:
+/// instances are split across an NvJobSystem, and each instance blends its
+/// clips, evaluates the dynamic part of the Skeleton and writes its palette
+/// into one contiguous store (numBones entries per instance, in model space).
+/// Nothing is allocated per frame; each thread works in its own scratch pose.
+///
+/// The palette store is plain memory of any size, independent of how palettes
+/// reach the GPU, and Crowd does not touch OpenGL, so the whole CPU side can be
+/// run and timed headlessly.
+
+/// \brief Palettes and per-thread scratch of a Crowd in one representation,
+/// T being nv::matrix4f or DualQuaternion.
+template <typename T>
+struct CrowdPalettes
+{
+    std::vector<T> palettes;                ///< numInstances * numBones, instance-major.
+    std::vector<SkeletonPose<T> > poses;    ///< Scratch pose per thread.
+    std::vector<std::vector<T> >  tracks;   ///< Scratch blended tracks per thread.
+};
+
+/// \brief Per-instance playback state, structure of arrays.
+struct CrowdInstances
+{
+    std::vector<AnimationState> animations;    ///< What each instance plays, see AnimationBlending.hpp.
+    std::vector<float>        rates;           ///< Playback rate of the whole state, 1 is real time.
+    std::vector<nv::matrix4f> worldTransforms; ///< Model to world, applied when drawing.
+
+    size_t size() const { return animations.size(); }
+};
+
+class Crowd
+{
+public:
+    /// skeleton, cache and animations must outlive the crowd. Without workers
+    /// the update runs on the calling thread.
+    Crowd(const Skeleton& skeleton, const SkeletonCache& cache, const AnimationSet& animations,
+          NvJobSystem* workers = nullptr, size_t grainSize = 16):
+        mSkeleton(skeleton), mCache(cache), mAnimations(animations), mWorkers(workers), mGrainSize(grainSize) {}
+
+    /// Sets the number of instances. New instances loop clip 0 from time 0,
+    /// at rate 1, and have an identity world transform.
+    void resize(size_t numInstances)
+    {
+        mInstances.animations.resize(numInstances, animationblending::playClip(0));
+        mInstances.rates.resize(numInstances, 1.f);
+        mInstances.worldTransforms.resize(numInstances, nv::matrix4f());
+        resizePalettes(mMatrices, numInstances);
+        resizePalettes(mDualQuaternions, numInstances);
+        mScratch.resize(mWorkers ? mWorkers->getNumThreads() : 1);
+    }
+
+    size_t size() const { return mInstances.size(); }
+    size_t getNumBones() const { return mCache.boneNodes.size(); }
+
+    CrowdInstances& getInstances() { return mInstances; }
+    const CrowdInstances& getInstances() const { return mInstances; }
+
+    /// Advances every instance by deltaTime * its rate and rebuilds its
+    /// palette in representation T.
+    template <typename T>
+    void update(float deltaTime)
+    {
+        if (mWorkers) {
+            mWorkers->parallelForWithThreadIndex(size(), mGrainSize, [=](size_t begin, size_t end, int32_t threadIndex) {
+                updateInstances<T>(begin, end, threadIndex, deltaTime);
+            });
+        } else {
+            updateInstances<T>(0, size(), 0, deltaTime);
+        }
+    }
+
+    /// getNumBones() transforms of an instance, as built by the last update<T>.
+    template <typename T>
+    const T* getPalette(size_t instance) const
+    {
+        return &palettes<T>().palettes[instance * getNumBones()];
+    }
+
+private:
+    template <typename T> CrowdPalettes<T>& palettes();
+    template <typename T> const CrowdPalettes<T>& palettes() const;
+
+    template <typename T>
+    void resizePalettes(CrowdPalettes<T>& p, size_t numInstances)
+    {
+        T identity;
+        convertTransform(nv::matrix4f(), identity);
+        p.palettes.resize(numInstances * getNumBones(), identity);
+
+        const size_t numThreads = mWorkers ? mWorkers->getNumThreads() : 1;
+        p.poses.resize(numThreads);
+        p.tracks.resize(numThreads);
+        for (size_t i = 0; i < numThreads; i++) {
+            mCache.initPose(p.poses[i]);
+            p.tracks[i].resize(mAnimations.numTracks());
+        }
+    }
+
+    template <typename T>
+    void updateInstances(size_t begin, size_t end, int threadIndex, float deltaTime)
+    {
+        CrowdPalettes<T>& p = palettes<T>();
+        SkeletonPose<T>& pose = p.poses[threadIndex];
+        T* tracks = p.tracks[threadIndex].data();
+        const std::vector<T>& boneOffsets = mCache.get<T>().boneOffsets;
+        const size_t numBones = getNumBones();
+        BlendScratch& scratch = mScratch[threadIndex];
+
+        for (size_t instance = begin; instance < end; instance++) {
+            AnimationState& animation = mInstances.animations[instance];
+            animationblending::advance(animation, mInstances.rates[instance] * deltaTime, mAnimations);
+            animationblending::evaluate(animation, mAnimations, scratch, tracks);
+            for (int i: mCache.animatedNodes)
+                pose.local[i] = tracks[mSkeleton.nodeAnimationIndices[i]];
+            computeGlobalTransforms(mSkeleton, mCache, pose);
+
+            T* palette = &p.palettes[instance * numBones];
+            for (size_t bone = 0; bone < numBones; bone++) {
+                const int node = mCache.boneNodes[bone];
+                if (node != -1)
+                    palette[bone] = pose.global[node] * boneOffsets[bone];
+            }
+        }
+    }
+
+    Crowd(const Crowd&);
+    Crowd& operator=(const Crowd&);
+
+    const Skeleton&      mSkeleton;
+    const SkeletonCache& mCache;
+    const AnimationSet&  mAnimations;
+    NvJobSystem*         mWorkers;
+    size_t               mGrainSize;
+
+    CrowdInstances                 mInstances;
+    CrowdPalettes<nv::matrix4f>    mMatrices;
+    CrowdPalettes<DualQuaternion>  mDualQuaternions;
+    std::vector<BlendScratch>      mScratch;   ///< Per thread.
+};
+
+template <>
+inline CrowdPalettes<nv::matrix4f>& Crowd::palettes<nv::matrix4f>() { return mMatrices; }
+
+template <>
+inline CrowdPalettes<DualQuaternion>& Crowd::palettes<DualQuaternion>() { return mDualQuaternions; }
+
+template <>
+inline const CrowdPalettes<nv::matrix4f>& Crowd::palettes<nv::matrix4f>() const { return mMatrices; }
+
+template <>
+inline const CrowdPalettes<DualQuaternion>& Crowd::palettes<DualQuaternion>() const { return mDualQuaternions; }
+
+#endif
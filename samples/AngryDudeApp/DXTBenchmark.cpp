@@ -0,0 +1,156 @@
+#include "../../extensions/src/NvGLUtils/DXTDecoder.h"
+#include "../../extensions/src/NvGLUtils/BlockDXT.h"
+#include "NvAppBase/NvJobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/// Times DXT expansion, the software fallback NvImage uses when a device has
+/// no S3TC support, on the character textures (1024x1024 DXT5, 1 MB each):
+///
+/// - blockDXT: the previous expandDXT, BlockDXT5::decodeBlock into a
+///             ColorBlock, then scattered pixel by pixel
+/// - decoder:  nv::decodeDXTBlockRows on one thread
+/// - parallel: nv::decodeDXTBlockRows over block rows on an NvJobSystem, the
+///             way NvSampleApp sets up NvImage
+///
+/// Compiled with
+/// clang DXTBenchmark.cpp ../../extensions/src/NvGLUtils/DXTDecoder.cpp ../../extensions/src/NvGLUtils/BlockDXT.cpp ../../extensions/src/NvGLUtils/ColorBlock.cpp ../../extensions/src/NvAppBase/NvJobSystem.cpp ../../extensions/externals/src/R3/thread.cpp -o DXTBenchmark -O2 -Wall -std=c++11 -I. -I../../extensions/include/ -I../../extensions/externals/include/ -lstdc++ -lpthread -lm
+/// and run from this directory as
+/// ./DXTBenchmark [-repeat N] [-threads T] [texture.dds...]
+///
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+/// Fastest of repeat runs of fn, in milliseconds; the fastest run is the one
+/// least disturbed by the rest of the system.
+template <typename F>
+double fastestMs(int repeat, const F& fn)
+{
+    double fastest = 0.0;
+    for (int r = 0; r < repeat; r++) {
+        const Clock::time_point begin = Clock::now();
+        fn();
+        const double ms = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count() / 1e6;
+        fastest = (r == 0 || ms < fastest) ? ms : fastest;
+    }
+    return fastest;
+}
+
+struct Texture
+{
+    std::string name;
+    uint32_t width;
+    uint32_t height;
+    std::vector<uint8_t> data;   // whole file; the top level starts after the header
+};
+
+/// Reads the top level of a DXT5 DDS file.
+bool loadTexture(const std::string& name, Texture& texture)
+{
+    FILE* file = std::fopen(name.c_str(), "rb");
+    if (!file)
+        return false;
+    uint8_t buffer[65536];
+    for (size_t n; (n = std::fread(buffer, 1, sizeof(buffer), file)) > 0; )
+        texture.data.insert(texture.data.end(), buffer, buffer + n);
+    std::fclose(file);
+
+    if (texture.data.size() < 128 || std::memcmp(&texture.data[84], "DXT5", 4) != 0)
+        return false;
+    std::memcpy(&texture.height, &texture.data[12], 4);
+    std::memcpy(&texture.width, &texture.data[16], 4);
+    texture.name = name;
+    return texture.data.size() >= 128 + size_t((texture.width + 3) / 4) * ((texture.height + 3) / 4) * 16;
+}
+
+void decodeBlockDXT(const uint8_t* blocks, int32_t width, int32_t height, uint32_t* pixels)
+{
+    for (int32_t j = 0; j < (height + 3) / 4; j++) {
+        for (int32_t i = 0; i < (width + 3) / 4; i++) {
+            nv::ColorBlock color;
+            reinterpret_cast<const nv::BlockDXT5*>(blocks)->decodeBlock(&color);
+            for (int32_t y = 0; y < 4 && 4*j + y < height; y++)
+                for (int32_t x = 0; x < 4 && 4*i + x < width; x++)
+                    pixels[4*i + x + (4*j + y) * width] = (uint32_t)color.color(x, y);
+            blocks += sizeof(nv::BlockDXT5);
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int repeat = 20;
+    int threads = 0;
+    std::vector<std::string> names;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "-repeat" && i + 1 < argc)
+            std::stringstream(argv[++i]) >> repeat;
+        else if (arg == "-threads" && i + 1 < argc)
+            std::stringstream(argv[++i]) >> threads;
+        else if (arg[0] == '-') {
+            std::fprintf(stderr, "Usage: %s [-repeat N] [-threads T] [texture.dds...]\n", argv[0]);
+            return 1;
+        } else
+            names.push_back(arg);
+    }
+    if (names.empty()) {
+        names.push_back("assets/head.dds");
+        names.push_back("assets/jacket.dds");
+        names.push_back("assets/pants.dds");
+        names.push_back("assets/upBodyC.dds");
+    }
+    if (repeat < 1) {
+        std::fprintf(stderr, "The repeat count must be positive\n");
+        return 1;
+    }
+
+    NvJobSystem jobs(threads);
+    std::printf("%-24s %12s %12s %12s %9s\n", "texture", "blockDXT ms", "decoder ms",
+                "parallel ms", "speedup");
+    for (size_t t = 0; t < names.size(); t++) {
+        Texture texture;
+        if (!loadTexture(names[t], texture)) {
+            std::fprintf(stderr, "Cannot load %s as DXT5\n", names[t].c_str());
+            return 1;
+        }
+        const int32_t width = texture.width, height = texture.height;
+        const uint8_t* blocks = &texture.data[128];
+        std::vector<uint32_t> reference(size_t(width) * height), pixels(reference.size());
+
+        const double blockDXTMs = fastestMs(repeat, [&]() {
+            decodeBlockDXT(blocks, width, height, reference.data());
+        });
+        const double decoderMs = fastestMs(repeat, [&]() {
+            nv::decodeDXTBlockRows(nv::DXTFormat_DXT5, blocks, width, height, 0, (height + 3) / 4, pixels.data());
+        });
+        bool identical = (pixels == reference);
+
+        // the grain NvImage::expandDXT uses
+        const size_t grainSize = std::max<size_t>(1, 16384 / ((width + 3) / 4));
+        std::fill(pixels.begin(), pixels.end(), 0);
+        const double parallelMs = fastestMs(repeat, [&]() {
+            jobs.parallelFor((height + 3) / 4, grainSize, [&](size_t begin, size_t end) {
+                nv::decodeDXTBlockRows(nv::DXTFormat_DXT5, blocks, width, height, int32_t(begin), int32_t(end), pixels.data());
+            });
+        });
+        identical = identical && (pixels == reference);
+
+        std::printf("%-24s %12.2f %12.2f %12.2f %8.1fx%s\n", texture.name.c_str(), blockDXTMs, decoderMs,
+                    parallelMs, blockDXTMs / parallelMs, identical ? "" : "  MISMATCH");
+        if (!identical)
+            return 1;
+    }
+    std::printf("%d job threads, fastest of %d runs\n", jobs.getNumThreads(), repeat);
+    return 0;
+}
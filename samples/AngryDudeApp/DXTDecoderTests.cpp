@@ -0,0 +1,160 @@
+#include "../../extensions/src/NvGLUtils/DXTDecoder.h"
+#include "../../extensions/src/NvGLUtils/BlockDXT.h"
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+/// Compiled with
+/// clang DXTDecoderTests.cpp ../../extensions/src/NvGLUtils/DXTDecoder.cpp ../../extensions/src/NvGLUtils/BlockDXT.cpp ../../extensions/src/NvGLUtils/ColorBlock.cpp -o DXTDecoderTests -g3 -Wall -std=c++11 -I. -I../../extensions/include/ -L./gtest/ -lgtest -lstdc++ -lpthread -lm
+/// and run from this directory, so that assets/ is found.
+///
+
+#include "gtest/gtest.h"
+
+namespace {
+
+/// The expansion NvImage::expandDXT did before decodeDXTBlockRows: one
+/// ColorBlock per block, scattered pixel by pixel.
+template <typename Block>
+std::vector<uint32_t> referenceDecode(const uint8_t* blocks, int32_t width, int32_t height)
+{
+    std::vector<uint32_t> pixels(size_t(width) * height);
+    for (int32_t j = 0; j < (height + 3) / 4; j++) {
+        for (int32_t i = 0; i < (width + 3) / 4; i++) {
+            nv::ColorBlock color;
+            reinterpret_cast<const Block*>(blocks)->decodeBlock(&color);
+            for (int32_t y = 0; y < 4 && 4*j + y < height; y++)
+                for (int32_t x = 0; x < 4 && 4*i + x < width; x++)
+                    pixels[4*i + x + (4*j + y) * width] = (uint32_t)color.color(x, y);
+            blocks += sizeof(Block);
+        }
+    }
+    return pixels;
+}
+
+std::vector<uint32_t> referenceDecode(nv::DXTFormat format, const uint8_t* blocks, int32_t width, int32_t height)
+{
+    if (format == nv::DXTFormat_DXT1)
+        return referenceDecode<nv::BlockDXT1>(blocks, width, height);
+    if (format == nv::DXTFormat_DXT3)
+        return referenceDecode<nv::BlockDXT3>(blocks, width, height);
+    return referenceDecode<nv::BlockDXT5>(blocks, width, height);
+}
+
+std::vector<uint32_t> decode(nv::DXTFormat format, const uint8_t* blocks, int32_t width, int32_t height)
+{
+    std::vector<uint32_t> pixels(size_t(width) * height);
+    nv::decodeDXTBlockRows(format, blocks, width, height, 0, (height + 3) / 4, pixels.data());
+    return pixels;
+}
+
+std::vector<uint8_t> randomBlocks(nv::DXTFormat format, int32_t width, int32_t height, std::mt19937& rng)
+{
+    std::vector<uint8_t> blocks(size_t((width + 3) / 4) * ((height + 3) / 4) * nv::blockSizeDXT(format));
+    for (uint8_t& b: blocks)
+        b = uint8_t(rng());
+    return blocks;
+}
+
+const nv::DXTFormat formats[] = {nv::DXTFormat_DXT1, nv::DXTFormat_DXT3, nv::DXTFormat_DXT5};
+
+} // namespace
+
+TEST(DXTDecoderTest, RandomSurfacesMatchBlockDXT)
+{
+    std::mt19937 rng(7);
+    const int32_t sizes[][2] = {{1, 1}, {2, 3}, {4, 4}, {13, 7}, {16, 8}, {64, 64}, {130, 66}};
+    for (nv::DXTFormat format: formats) {
+        for (const int32_t* size: sizes) {
+            const std::vector<uint8_t> blocks = randomBlocks(format, size[0], size[1], rng);
+            EXPECT_EQ(referenceDecode(format, blocks.data(), size[0], size[1]),
+                      decode(format, blocks.data(), size[0], size[1]))
+                << "format " << format << ", " << size[0] << "x" << size[1];
+        }
+    }
+}
+
+TEST(DXTDecoderTest, BothColorModesMatchBlockDXT)
+{
+    // Random blocks hit c0 > c1 and c0 <= c1 about equally; equal end points
+    // and the extremes are added explicitly.
+    std::mt19937 rng(11);
+    std::vector<uint8_t> blocks = randomBlocks(nv::DXTFormat_DXT1, 1024, 256, rng);
+    const uint16_t ends[][2] = {{0, 0}, {0xFFFF, 0xFFFF}, {0xFFFF, 0}, {0, 0xFFFF}, {0x1234, 0x1234}, {0xF800, 0x07E0}};
+    for (size_t i = 0; i < sizeof(ends) / sizeof(ends[0]); i++) {
+        memcpy(&blocks[8 * i], &ends[i][0], 2);
+        memcpy(&blocks[8 * i + 2], &ends[i][1], 2);
+    }
+    EXPECT_EQ(referenceDecode(nv::DXTFormat_DXT1, blocks.data(), 1024, 256),
+              decode(nv::DXTFormat_DXT1, blocks.data(), 1024, 256));
+}
+
+TEST(DXTDecoderTest, AllDXT5AlphaEndPointsMatchBlockDXT)
+{
+    // One block per (alpha0, alpha1) pair, covering both interpolation modes
+    // and every division the palette can do.
+    std::mt19937 rng(13);
+    std::vector<uint8_t> blocks = randomBlocks(nv::DXTFormat_DXT5, 1024, 1024, rng);
+    for (size_t i = 0; i < 65536; i++) {
+        blocks[16 * i] = uint8_t(i & 0xFF);
+        blocks[16 * i + 1] = uint8_t(i >> 8);
+    }
+    EXPECT_EQ(referenceDecode(nv::DXTFormat_DXT5, blocks.data(), 1024, 1024),
+              decode(nv::DXTFormat_DXT5, blocks.data(), 1024, 1024));
+}
+
+TEST(DXTDecoderTest, RowRangesWriteOnlyTheirRows)
+{
+    std::mt19937 rng(17);
+    const int32_t width = 37, height = 23;   // 6 block rows, the last partial
+    for (nv::DXTFormat format: formats) {
+        const std::vector<uint8_t> blocks = randomBlocks(format, width, height, rng);
+        const std::vector<uint32_t> expected = decode(format, blocks.data(), width, height);
+
+        const uint32_t sentinel = 0xDEADBEEF;
+        std::vector<uint32_t> pixels(size_t(width) * height, sentinel);
+        nv::decodeDXTBlockRows(format, blocks.data(), width, height, 2, 4, pixels.data());
+        for (int32_t y = 0; y < height; y++)
+            for (int32_t x = 0; x < width; x++) {
+                const size_t p = size_t(y) * width + x;
+                ASSERT_EQ((y >= 8 && y < 16) ? expected[p] : sentinel, pixels[p]) << x << "," << y;
+            }
+
+        // the remaining ranges, out of order, complete the surface
+        nv::decodeDXTBlockRows(format, blocks.data(), width, height, 5, 6, pixels.data());
+        nv::decodeDXTBlockRows(format, blocks.data(), width, height, 0, 2, pixels.data());
+        nv::decodeDXTBlockRows(format, blocks.data(), width, height, 4, 5, pixels.data());
+        EXPECT_EQ(expected, pixels);
+    }
+}
+
+TEST(DXTDecoderTest, CharacterTexturesMatchBlockDXT)
+{
+    const char* names[] = {"assets/head.dds", "assets/jacket.dds", "assets/pants.dds", "assets/upBodyC.dds"};
+    for (const char* name: names) {
+        FILE* file = fopen(name, "rb");
+        ASSERT_TRUE(file != NULL) << name;
+        std::vector<uint8_t> data;
+        uint8_t buffer[65536];
+        for (size_t n; (n = fread(buffer, 1, sizeof(buffer), file)) > 0; )
+            data.insert(data.end(), buffer, buffer + n);
+        fclose(file);
+
+        // Top level of a plain DDS: the header is 4 + 124 bytes.
+        ASSERT_GT(data.size(), 128u) << name;
+        uint32_t height, width;
+        memcpy(&height, &data[12], 4);
+        memcpy(&width, &data[16], 4);
+        ASSERT_EQ(0, memcmp(&data[84], "DXT5", 4)) << name;
+        ASSERT_GE(data.size(), 128 + size_t((width + 3) / 4) * ((height + 3) / 4) * 16) << name;
+        EXPECT_TRUE(referenceDecode(nv::DXTFormat_DXT5, &data[128], width, height) ==
+                    decode(nv::DXTFormat_DXT5, &data[128], width, height)) << name;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
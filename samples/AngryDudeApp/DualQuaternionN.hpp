@@ -0,0 +1,590 @@
+#ifndef __DualQuaternionN_hpp__
+#define __DualQuaternionN_hpp__
+
+#include "DualQuaternion.hpp"
+
+#include <cstddef>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define DUALQUATERNIONN_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DUALQUATERNIONN_SSE 1
+#endif
+
+/// \file DualQuaternionN.hpp
+/// \brief Batched (structure-of-arrays) quaternion and dual quaternion math.
+///
+/// Composing bone transforms one DualQuaternion at a time leaves most of a SIMD
+/// register unused. The types in this file hold FloatN::Width quaternions at once,
+/// one component per register: all x components of Width quaternions live in one
+/// FloatN, all y components in the next one and so on. Every operation is then
+/// written exactly like its scalar counterpart in DualQuaternion.hpp, but processes
+/// Width objects per instruction.
+///
+/// The register width is picked at compile time:
+/// - AVX2 (compiled with -mavx2): 8 lanes,
+/// - SSE2 (every x86-64 target): 4 lanes,
+/// - anything else (Emscripten, ARM without intrinsics): 4 lanes of plain floats.
+///
+/// Most code does not need the lane types directly. The free functions at the end
+/// of this file (multiply, conjugateDual, normalize, transformPoints, ...) work over
+/// whole arrays of the scalar DualQuaternion, loading Width elements at a time,
+/// so bone palettes can stay in the layout uploaded to the shader.
+
+/// \brief Width floats processed by a single instruction.
+class FloatN
+{
+public:
+#if DUALQUATERNIONN_AVX2
+    static const int Width = 8;
+    typedef __m256 Native;
+#elif DUALQUATERNIONN_SSE
+    static const int Width = 4;
+    typedef __m128 Native;
+#else
+    static const int Width = 4;
+    struct Native { float v[4]; };
+#endif
+
+    FloatN() = default;
+    FloatN(Native n): n(n) {}
+
+    /// Broadcasts f to all lanes.
+    FloatN(float f)
+    {
+#if DUALQUATERNIONN_AVX2
+        n = _mm256_set1_ps(f);
+#elif DUALQUATERNIONN_SSE
+        n = _mm_set1_ps(f);
+#else
+        for (int i = 0; i < Width; i++)
+            n.v[i] = f;
+#endif
+    }
+
+    /// Loads Width consecutive floats (no alignment requirement).
+    static const FloatN load(const float* p)
+    {
+#if DUALQUATERNIONN_AVX2
+        return FloatN(_mm256_loadu_ps(p));
+#elif DUALQUATERNIONN_SSE
+        return FloatN(_mm_loadu_ps(p));
+#else
+        FloatN f;
+        for (int i = 0; i < Width; i++)
+            f.n.v[i] = p[i];
+        return f;
+#endif
+    }
+
+    /// Stores Width consecutive floats (no alignment requirement).
+    void store(float* p) const
+    {
+#if DUALQUATERNIONN_AVX2
+        _mm256_storeu_ps(p, n);
+#elif DUALQUATERNIONN_SSE
+        _mm_storeu_ps(p, n);
+#else
+        for (int i = 0; i < Width; i++)
+            p[i] = n.v[i];
+#endif
+    }
+
+    Native n;
+};
+
+/// \brief Per-lane boolean, result of a FloatN comparison. Only consumed by select().
+class MaskN
+{
+public:
+#if DUALQUATERNIONN_AVX2
+    typedef __m256 Native;
+#elif DUALQUATERNIONN_SSE
+    typedef __m128 Native;
+#else
+    struct Native { bool v[4]; };
+#endif
+
+    MaskN(Native n): n(n) {}
+
+    Native n;
+};
+
+#if DUALQUATERNIONN_AVX2
+
+inline const FloatN operator + (const FloatN& a, const FloatN& b) { return _mm256_add_ps(a.n, b.n); }
+inline const FloatN operator - (const FloatN& a, const FloatN& b) { return _mm256_sub_ps(a.n, b.n); }
+inline const FloatN operator * (const FloatN& a, const FloatN& b) { return _mm256_mul_ps(a.n, b.n); }
+inline const FloatN operator / (const FloatN& a, const FloatN& b) { return _mm256_div_ps(a.n, b.n); }
+inline const FloatN operator - (const FloatN& a) { return _mm256_xor_ps(a.n, _mm256_set1_ps(-0.f)); }
+inline const FloatN sqrt(const FloatN& a) { return _mm256_sqrt_ps(a.n); }
+inline const FloatN max(const FloatN& a, const FloatN& b) { return _mm256_max_ps(a.n, b.n); }
+inline const MaskN operator < (const FloatN& a, const FloatN& b) { return _mm256_cmp_ps(a.n, b.n, _CMP_LT_OQ); }
+inline const MaskN operator > (const FloatN& a, const FloatN& b) { return _mm256_cmp_ps(a.n, b.n, _CMP_GT_OQ); }
+inline const MaskN operator && (const MaskN& a, const MaskN& b) { return _mm256_and_ps(a.n, b.n); }
+/// Per lane: mask ? a : b.
+inline const FloatN select(const MaskN& mask, const FloatN& a, const FloatN& b) { return _mm256_blendv_ps(b.n, a.n, mask.n); }
+
+#elif DUALQUATERNIONN_SSE
+
+inline const FloatN operator + (const FloatN& a, const FloatN& b) { return _mm_add_ps(a.n, b.n); }
+inline const FloatN operator - (const FloatN& a, const FloatN& b) { return _mm_sub_ps(a.n, b.n); }
+inline const FloatN operator * (const FloatN& a, const FloatN& b) { return _mm_mul_ps(a.n, b.n); }
+inline const FloatN operator / (const FloatN& a, const FloatN& b) { return _mm_div_ps(a.n, b.n); }
+inline const FloatN operator - (const FloatN& a) { return _mm_xor_ps(a.n, _mm_set1_ps(-0.f)); }
+inline const FloatN sqrt(const FloatN& a) { return _mm_sqrt_ps(a.n); }
+inline const FloatN max(const FloatN& a, const FloatN& b) { return _mm_max_ps(a.n, b.n); }
+inline const MaskN operator < (const FloatN& a, const FloatN& b) { return _mm_cmplt_ps(a.n, b.n); }
+inline const MaskN operator > (const FloatN& a, const FloatN& b) { return _mm_cmpgt_ps(a.n, b.n); }
+inline const MaskN operator && (const MaskN& a, const MaskN& b) { return _mm_and_ps(a.n, b.n); }
+/// Per lane: mask ? a : b.
+inline const FloatN select(const MaskN& mask, const FloatN& a, const FloatN& b)
+{
+    return _mm_or_ps(_mm_and_ps(mask.n, a.n), _mm_andnot_ps(mask.n, b.n));
+}
+
+#else
+
+#define DUALQUATERNIONN_SCALAR_OP(result, expr) \
+    result r; \
+    for (int i = 0; i < FloatN::Width; i++) \
+        r.n.v[i] = (expr); \
+    return r;
+
+inline const FloatN operator + (const FloatN& a, const FloatN& b) { DUALQUATERNIONN_SCALAR_OP(FloatN, a.n.v[i] + b.n.v[i]) }
+inline const FloatN operator - (const FloatN& a, const FloatN& b) { DUALQUATERNIONN_SCALAR_OP(FloatN, a.n.v[i] - b.n.v[i]) }
+inline const FloatN operator * (const FloatN& a, const FloatN& b) { DUALQUATERNIONN_SCALAR_OP(FloatN, a.n.v[i] * b.n.v[i]) }
+inline const FloatN operator / (const FloatN& a, const FloatN& b) { DUALQUATERNIONN_SCALAR_OP(FloatN, a.n.v[i] / b.n.v[i]) }
+inline const FloatN operator - (const FloatN& a) { DUALQUATERNIONN_SCALAR_OP(FloatN, -a.n.v[i]) }
+inline const FloatN sqrt(const FloatN& a) { DUALQUATERNIONN_SCALAR_OP(FloatN, std::sqrt(a.n.v[i])) }
+inline const FloatN max(const FloatN& a, const FloatN& b) { DUALQUATERNIONN_SCALAR_OP(FloatN, a.n.v[i] > b.n.v[i] ? a.n.v[i] : b.n.v[i]) }
+inline const MaskN operator < (const FloatN& a, const FloatN& b) { MaskN::Native m; for (int i = 0; i < FloatN::Width; i++) m.v[i] = a.n.v[i] < b.n.v[i]; return m; }
+inline const MaskN operator > (const FloatN& a, const FloatN& b) { MaskN::Native m; for (int i = 0; i < FloatN::Width; i++) m.v[i] = a.n.v[i] > b.n.v[i]; return m; }
+inline const MaskN operator && (const MaskN& a, const MaskN& b) { MaskN::Native m; for (int i = 0; i < FloatN::Width; i++) m.v[i] = a.n.v[i] && b.n.v[i]; return m; }
+/// Per lane: mask ? a : b.
+inline const FloatN select(const MaskN& mask, const FloatN& a, const FloatN& b) { DUALQUATERNIONN_SCALAR_OP(FloatN, mask.n.v[i] ? a.n.v[i] : b.n.v[i]) }
+
+#undef DUALQUATERNIONN_SCALAR_OP
+
+#endif
+
+/// \brief FloatN::Width quaternions, one FloatN per component.
+class QuaternionN
+{
+public:
+    QuaternionN() = default;
+    QuaternionN(const FloatN& x, const FloatN& y, const FloatN& z, const FloatN& w): x(x), y(y), z(z), w(w) {}
+
+    /// Broadcasts a single quaternion to all lanes.
+    QuaternionN(const Quaternion& q): x(q.x), y(q.y), z(q.z), w(q.w) {}
+
+    FloatN x,y,z; ///< Vector parts.
+    FloatN w;     ///< Scalar parts.
+};
+
+inline const QuaternionN operator + (const QuaternionN& a, const QuaternionN& b)
+{
+    return QuaternionN(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w);
+}
+
+inline const QuaternionN operator * (const QuaternionN& a, const QuaternionN& b)
+{
+    return QuaternionN(a.y*b.z - a.z*b.y + a.w*b.x + a.x*b.w,
+                       a.z*b.x - a.x*b.z + a.w*b.y + a.y*b.w,
+                       a.x*b.y - a.y*b.x + a.w*b.z + a.z*b.w,
+                       a.w*b.w - a.x*b.x - a.y*b.y - a.z*b.z);
+}
+
+inline const QuaternionN operator * (const FloatN& s, const QuaternionN& q)
+{
+    return QuaternionN(s*q.x, s*q.y, s*q.z, s*q.w);
+}
+
+inline const QuaternionN conjugate(const QuaternionN& q)
+{
+    return QuaternionN(-q.x, -q.y, -q.z, q.w);
+}
+
+inline const FloatN dot(const QuaternionN& a, const QuaternionN& b)
+{
+    return a.x*b.x + a.y*b.y + a.z*b.z + a.w*b.w;
+}
+
+/// \brief FloatN::Width dual quaternions in structure-of-arrays form.
+///
+/// Lane i of every member belongs to the i-th dual quaternion. load() and store()
+/// convert from and to the array-of-structures DualQuaternion layout.
+class DualQuaternionN
+{
+public:
+    static const int Width = FloatN::Width;
+
+    DualQuaternionN() = default;
+    DualQuaternionN(const QuaternionN& real, const QuaternionN& dual): real(real), dual(dual) {}
+
+    /// Broadcasts a single dual quaternion to all lanes.
+    DualQuaternionN(const DualQuaternion& dq): real(dq.real), dual(dq.dual) {}
+
+    /// Loads Width consecutive dual quaternions.
+    static const DualQuaternionN load(const DualQuaternion* dqs)
+    {
+#if DUALQUATERNIONN_SSE
+        // Each DualQuaternion is two __m128 rows; a 4x4 transpose turns four real
+        // (or dual) parts into the x, y, z and w registers.
+        __m128 r0 = _mm_loadu_ps(&dqs[0].real.x), r1 = _mm_loadu_ps(&dqs[1].real.x);
+        __m128 r2 = _mm_loadu_ps(&dqs[2].real.x), r3 = _mm_loadu_ps(&dqs[3].real.x);
+        __m128 d0 = _mm_loadu_ps(&dqs[0].dual.x), d1 = _mm_loadu_ps(&dqs[1].dual.x);
+        __m128 d2 = _mm_loadu_ps(&dqs[2].dual.x), d3 = _mm_loadu_ps(&dqs[3].dual.x);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _MM_TRANSPOSE4_PS(d0, d1, d2, d3);
+        return DualQuaternionN(QuaternionN(r0, r1, r2, r3), QuaternionN(d0, d1, d2, d3));
+#else
+        float lanes[8][Width];
+        for (int i = 0; i < Width; i++) {
+            const float* src = &dqs[i].real.x;
+            for (int c = 0; c < 8; c++)
+                lanes[c][i] = src[c];
+        }
+        return fromLanes(lanes);
+#endif
+    }
+
+    /// Stores Width consecutive dual quaternions.
+    void store(DualQuaternion* dqs) const
+    {
+#if DUALQUATERNIONN_SSE
+        __m128 r0 = real.x.n, r1 = real.y.n, r2 = real.z.n, r3 = real.w.n;
+        __m128 d0 = dual.x.n, d1 = dual.y.n, d2 = dual.z.n, d3 = dual.w.n;
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _MM_TRANSPOSE4_PS(d0, d1, d2, d3);
+        _mm_storeu_ps(&dqs[0].real.x, r0); _mm_storeu_ps(&dqs[0].dual.x, d0);
+        _mm_storeu_ps(&dqs[1].real.x, r1); _mm_storeu_ps(&dqs[1].dual.x, d1);
+        _mm_storeu_ps(&dqs[2].real.x, r2); _mm_storeu_ps(&dqs[2].dual.x, d2);
+        _mm_storeu_ps(&dqs[3].real.x, r3); _mm_storeu_ps(&dqs[3].dual.x, d3);
+#else
+        float lanes[8][Width];
+        toLanes(lanes);
+        for (int i = 0; i < Width; i++) {
+            float* dst = &dqs[i].real.x;
+            for (int c = 0; c < 8; c++)
+                dst[c] = lanes[c][i];
+        }
+#endif
+    }
+
+    /// Loads count (< Width allowed) dual quaternions, filling the remaining lanes
+    /// with identities so that tails of arrays can go through the same code.
+    static const DualQuaternionN loadPartial(const DualQuaternion* dqs, size_t count)
+    {
+        DualQuaternion tmp[Width];
+        for (int i = 0; i < Width; i++)
+            tmp[i] = static_cast<size_t>(i) < count ? dqs[i] : DualQuaternion::identity();
+        return load(tmp);
+    }
+
+    /// Stores the first count (< Width allowed) lanes.
+    void storePartial(DualQuaternion* dqs, size_t count) const
+    {
+        DualQuaternion tmp[Width];
+        store(tmp);
+        for (size_t i = 0; i < count; i++)
+            dqs[i] = tmp[i];
+    }
+
+    /// Converts Width 4x4 rigid transformation matrices (see DualQuaternion::fromMatrix).
+    /// Quaternion::fromMatrix picks one of four formulas based on the largest diagonal
+    /// element; here all four are evaluated and the right one is selected per lane.
+    template <typename M4>
+    static const DualQuaternionN fromMatrices(const M4* m)
+    {
+        float e[12][Width];
+        for (int i = 0; i < Width; i++) {
+            e[0][i] = m[i](0,0); e[1][i] = m[i](0,1); e[2][i]  = m[i](0,2); e[3][i]  = m[i](0,3);
+            e[4][i] = m[i](1,0); e[5][i] = m[i](1,1); e[6][i]  = m[i](1,2); e[7][i]  = m[i](1,3);
+            e[8][i] = m[i](2,0); e[9][i] = m[i](2,1); e[10][i] = m[i](2,2); e[11][i] = m[i](2,3);
+        }
+        const FloatN m00 = FloatN::load(e[0]), m01 = FloatN::load(e[1]), m02 = FloatN::load(e[2]);
+        const FloatN m10 = FloatN::load(e[4]), m11 = FloatN::load(e[5]), m12 = FloatN::load(e[6]);
+        const FloatN m20 = FloatN::load(e[8]), m21 = FloatN::load(e[9]), m22 = FloatN::load(e[10]);
+
+        const FloatN one(1.f), quarter(0.25f), tiny(1e-12f);
+        const FloatN trace = m00 + m11 + m22;
+
+        // Clamp before sqrt so that lanes taking a different branch do not produce NaNs.
+        const FloatN sw = sqrt(max(trace + one, tiny)) * FloatN(2.f);
+        const FloatN sx = sqrt(max(m00 - m11 - m22 + one, tiny)) * FloatN(2.f);
+        const FloatN sy = sqrt(max(m11 - m00 - m22 + one, tiny)) * FloatN(2.f);
+        const FloatN sz = sqrt(max(m22 - m00 - m11 + one, tiny)) * FloatN(2.f);
+
+        const QuaternionN qw((m21 - m12) / sw, (m02 - m20) / sw, (m10 - m01) / sw, quarter * sw);
+        const QuaternionN qx(quarter * sx, (m01 + m10) / sx, (m02 + m20) / sx, (m21 - m12) / sx);
+        const QuaternionN qy((m01 + m10) / sy, quarter * sy, (m12 + m21) / sy, (m02 - m20) / sy);
+        const QuaternionN qz((m02 + m20) / sz, (m12 + m21) / sz, quarter * sz, (m10 - m01) / sz);
+
+        const MaskN useW = trace > FloatN(0.f);
+        const MaskN useX = (m00 > m11) && (m00 > m22);
+        const MaskN useY = m11 > m22;
+        #define DUALQUATERNIONN_PICK(c) select(useW, qw.c, select(useX, qx.c, select(useY, qy.c, qz.c)))
+        const QuaternionN rotation(DUALQUATERNIONN_PICK(x), DUALQUATERNIONN_PICK(y),
+                                   DUALQUATERNIONN_PICK(z), DUALQUATERNIONN_PICK(w));
+        #undef DUALQUATERNIONN_PICK
+
+        const FloatN half(0.5f);
+        const QuaternionN translation(half * FloatN::load(e[3]),
+                                      half * FloatN::load(e[7]),
+                                      half * FloatN::load(e[11]),
+                                      FloatN(0.f));
+        return DualQuaternionN(rotation, translation*rotation);
+    }
+
+    /// Converts to Width 4x4 matrices (see DualQuaternion::toMatrix).
+    /// Assumes unit dual quaternions.
+    template <typename M4>
+    void toMatrices(M4* m) const
+    {
+        const QuaternionN& q = real;
+        const FloatN one(1.f), two(2.f);
+        const FloatN xx = q.x*q.x, yy = q.y*q.y, zz = q.z*q.z;
+        const FloatN xy = q.x*q.y, xz = q.x*q.z, yz = q.y*q.z;
+        const FloatN wx = q.w*q.x, wy = q.w*q.y, wz = q.w*q.z;
+        const QuaternionN t = two * (dual * conjugate(real));
+
+        float e[12][Width];
+        (one - two*(yy + zz)).store(e[0]);
+        (two*(xy - wz)).store(e[1]);
+        (two*(xz + wy)).store(e[2]);
+        t.x.store(e[3]);
+        (two*(xy + wz)).store(e[4]);
+        (one - two*(xx + zz)).store(e[5]);
+        (two*(yz - wx)).store(e[6]);
+        t.y.store(e[7]);
+        (two*(xz - wy)).store(e[8]);
+        (two*(yz + wx)).store(e[9]);
+        (one - two*(xx + yy)).store(e[10]);
+        t.z.store(e[11]);
+
+        for (int i = 0; i < Width; i++) {
+            for (int r = 0; r < 3; r++)
+                for (int c = 0; c < 4; c++)
+                    m[i](r,c) = e[r*4 + c][i];
+            m[i](3,0) = 0.f;
+            m[i](3,1) = 0.f;
+            m[i](3,2) = 0.f;
+            m[i](3,3) = 1.f;
+        }
+    }
+
+    QuaternionN real, dual;
+
+private:
+    static const DualQuaternionN fromLanes(const float (&lanes)[8][Width])
+    {
+        return DualQuaternionN(QuaternionN(FloatN::load(lanes[0]), FloatN::load(lanes[1]),
+                                           FloatN::load(lanes[2]), FloatN::load(lanes[3])),
+                               QuaternionN(FloatN::load(lanes[4]), FloatN::load(lanes[5]),
+                                           FloatN::load(lanes[6]), FloatN::load(lanes[7])));
+    }
+
+    void toLanes(float (&lanes)[8][Width]) const
+    {
+        real.x.store(lanes[0]); real.y.store(lanes[1]); real.z.store(lanes[2]); real.w.store(lanes[3]);
+        dual.x.store(lanes[4]); dual.y.store(lanes[5]); dual.z.store(lanes[6]); dual.w.store(lanes[7]);
+    }
+};
+
+inline const DualQuaternionN operator * (const DualQuaternionN& a, const DualQuaternionN& b)
+{
+    return DualQuaternionN(a.real*b.real,
+                           a.real*b.dual + a.dual*b.real);
+}
+
+inline const DualQuaternionN conjugateDual(const DualQuaternionN& dq)
+{
+    return DualQuaternionN(conjugate(dq.real),
+                           QuaternionN(dq.dual.x, dq.dual.y, dq.dual.z, -dq.dual.w));
+}
+
+/// Divides both parts by the norm of the real part, exactly like the
+/// normalization at the end of DQB() in skinning.vert.
+inline const DualQuaternionN normalize(const DualQuaternionN& dq)
+{
+    const FloatN invLength = FloatN(1.f) / sqrt(dot(dq.real, dq.real));
+    return DualQuaternionN(invLength * dq.real, invLength * dq.dual);
+}
+
+/// Transforms Width points (px, py, pz are overwritten) with unit dual quaternions,
+/// using the cross product formulation from skinning.vert:
+/// p' = p + 2 r x (r x p + a p) + 2 (a t - b r + r x t).
+inline void transformPoints(const DualQuaternionN& dq, FloatN& px, FloatN& py, FloatN& pz)
+{
+    const FloatN& a = dq.real.w;
+    const FloatN& b = dq.dual.w;
+    const FloatN &rx = dq.real.x, &ry = dq.real.y, &rz = dq.real.z;
+    const FloatN &tx = dq.dual.x, &ty = dq.dual.y, &tz = dq.dual.z;
+    const FloatN two(2.f);
+
+    const FloatN cx = ry*pz - rz*py + a*px;
+    const FloatN cy = rz*px - rx*pz + a*py;
+    const FloatN cz = rx*py - ry*px + a*pz;
+    const FloatN ox = px + two*(ry*cz - rz*cy) + two*(a*tx - b*rx + ry*tz - rz*ty);
+    const FloatN oy = py + two*(rz*cx - rx*cz) + two*(a*ty - b*ry + rz*tx - rx*tz);
+    const FloatN oz = pz + two*(rx*cy - ry*cx) + two*(a*tz - b*rz + rx*ty - ry*tx);
+    px = ox;
+    py = oy;
+    pz = oz;
+}
+
+/// Rotates Width normals (rotation part only, no translation).
+inline void transformNormals(const DualQuaternionN& dq, FloatN& nx, FloatN& ny, FloatN& nz)
+{
+    const FloatN& a = dq.real.w;
+    const FloatN &rx = dq.real.x, &ry = dq.real.y, &rz = dq.real.z;
+    const FloatN two(2.f);
+
+    const FloatN cx = ry*nz - rz*ny + a*nx;
+    const FloatN cy = rz*nx - rx*nz + a*ny;
+    const FloatN cz = rx*ny - ry*nx + a*nz;
+    const FloatN ox = nx + two*(ry*cz - rz*cy);
+    const FloatN oy = ny + two*(rz*cx - rx*cz);
+    const FloatN oz = nz + two*(rx*cy - ry*cx);
+    nx = ox;
+    ny = oy;
+    nz = oz;
+}
+
+/// \name Whole-array operations
+/// Operate on arrays of the scalar (array-of-structures) DualQuaternion, Width
+/// elements per iteration. count does not need to be a multiple of Width.
+/// Input and output arrays may alias.
+///@{
+
+/// out[i] = a[i] * b[i]
+inline void multiply(const DualQuaternion* a, const DualQuaternion* b, DualQuaternion* out, size_t count)
+{
+    const size_t W = DualQuaternionN::Width;
+    size_t i = 0;
+    for (; i + W <= count; i += W)
+        (DualQuaternionN::load(a + i) * DualQuaternionN::load(b + i)).store(out + i);
+    if (i < count)
+        (DualQuaternionN::loadPartial(a + i, count - i) *
+         DualQuaternionN::loadPartial(b + i, count - i)).storePartial(out + i, count - i);
+}
+
+/// out[i] = a * b[i]; the common "parent times children" case.
+inline void multiply(const DualQuaternion& a, const DualQuaternion* b, DualQuaternion* out, size_t count)
+{
+    const size_t W = DualQuaternionN::Width;
+    const DualQuaternionN aN(a);
+    size_t i = 0;
+    for (; i + W <= count; i += W)
+        (aN * DualQuaternionN::load(b + i)).store(out + i);
+    if (i < count)
+        (aN * DualQuaternionN::loadPartial(b + i, count - i)).storePartial(out + i, count - i);
+}
+
+/// out[i] = conjugateDual(in[i])
+inline void conjugateDual(const DualQuaternion* in, DualQuaternion* out, size_t count)
+{
+    const size_t W = DualQuaternionN::Width;
+    size_t i = 0;
+    for (; i + W <= count; i += W)
+        conjugateDual(DualQuaternionN::load(in + i)).store(out + i);
+    if (i < count)
+        conjugateDual(DualQuaternionN::loadPartial(in + i, count - i)).storePartial(out + i, count - i);
+}
+
+/// Normalizes dqs in place.
+inline void normalize(DualQuaternion* dqs, size_t count)
+{
+    const size_t W = DualQuaternionN::Width;
+    size_t i = 0;
+    for (; i + W <= count; i += W)
+        normalize(DualQuaternionN::load(dqs + i)).store(dqs + i);
+    if (i < count)
+        normalize(DualQuaternionN::loadPartial(dqs + i, count - i)).storePartial(dqs + i, count - i);
+}
+
+namespace detail {
+
+template <typename V3, typename Transform>
+inline void transformArray(const DualQuaternion* dqs, const V3* in, V3* out, size_t count, Transform transform)
+{
+    const size_t W = DualQuaternionN::Width;
+    float x[DualQuaternionN::Width], y[DualQuaternionN::Width], z[DualQuaternionN::Width];
+    for (size_t i = 0; i < count; i += W) {
+        const size_t n = count - i < W ? count - i : W;
+        for (size_t j = 0; j < W; j++) {
+            const V3& v = in[i + (j < n ? j : 0)];
+            x[j] = v.x;
+            y[j] = v.y;
+            z[j] = v.z;
+        }
+        FloatN px = FloatN::load(x), py = FloatN::load(y), pz = FloatN::load(z);
+        const DualQuaternionN dq = n == W ? DualQuaternionN::load(dqs + i)
+                                          : DualQuaternionN::loadPartial(dqs + i, n);
+        transform(dq, px, py, pz);
+        px.store(x);
+        py.store(y);
+        pz.store(z);
+        for (size_t j = 0; j < n; j++)
+            out[i + j] = V3(x[j], y[j], z[j]);
+    }
+}
+
+} // namespace detail
+
+/// out[i] = point in[i] transformed by unit dual quaternion dqs[i].
+/// V3 needs public x, y, z members and a (x, y, z) constructor.
+template <typename V3>
+inline void transformPoints(const DualQuaternion* dqs, const V3* in, V3* out, size_t count)
+{
+    detail::transformArray(dqs, in, out, count,
+        [](const DualQuaternionN& dq, FloatN& x, FloatN& y, FloatN& z) { transformPoints(dq, x, y, z); });
+}
+
+/// out[i] = normal in[i] rotated by unit dual quaternion dqs[i].
+template <typename V3>
+inline void transformNormals(const DualQuaternion* dqs, const V3* in, V3* out, size_t count)
+{
+    detail::transformArray(dqs, in, out, count,
+        [](const DualQuaternionN& dq, FloatN& x, FloatN& y, FloatN& z) { transformNormals(dq, x, y, z); });
+}
+
+/// out[i] = DualQuaternion::fromMatrix(in[i])
+template <typename M4>
+inline void fromMatrices(const M4* in, DualQuaternion* out, size_t count)
+{
+    const size_t W = DualQuaternionN::Width;
+    size_t i = 0;
+    for (; i + W <= count; i += W)
+        DualQuaternionN::fromMatrices(in + i).store(out + i);
+    if (i < count) {
+        M4 tmp[DualQuaternionN::Width];
+        for (size_t j = 0; j < W; j++)
+            tmp[j] = in[i + (j < count - i ? j : 0)];
+        DualQuaternionN::fromMatrices(tmp).storePartial(out + i, count - i);
+    }
+}
+
+/// out[i] = DualQuaternion::toMatrix<M4>(in[i])
+template <typename M4>
+inline void toMatrices(const DualQuaternion* in, M4* out, size_t count)
+{
+    const size_t W = DualQuaternionN::Width;
+    size_t i = 0;
+    for (; i + W <= count; i += W)
+        DualQuaternionN::load(in + i).toMatrices(out + i);
+    if (i < count) {
+        M4 tmp[DualQuaternionN::Width];
+        DualQuaternionN::loadPartial(in + i, count - i).toMatrices(tmp);
+        for (size_t j = 0; j < count - i; j++)
+            out[i + j] = tmp[j];
+    }
+}
+
+///@}
+
+#endif
@@ -1,6 +1,8 @@
 #include "DualQuaternion.hpp"
+#include "DualQuaternionN.hpp"
 #include "NV/NvMath.h"
 #include <iostream>
+#include <vector>
 
 /// Compiled with
 /// clang DualQuaternionTests.cpp -o DualQuaternionTests -g3 -Wall -std=c++11 -I. -I../../extensions/include/ -L./gtest/ -lgtest -lstdc++ -lpthread -lm
@@ -168,6 +170,114 @@ TEST(DualQuaternionTest, FromMatrix)
     EXPECT_TRUE(Vec3Equal(nr, DualQuaternion::toVector<nv::vec3f>(r)));
 }
 
+// Deterministic, non-trivial unit dual quaternion used by the batch tests.
+DualQuaternion testDualQuaternion(int i)
+{
+    const nv::vec3f axis = nv::normalize(nv::vec3f(1.f + i, -1.5f + 0.3f*i, 0.2f*i - 1.f));
+    const float thetaRadians = -3.f + 0.55f*i;
+    const nv::vec3f trans(0.5f*i, 2.f - i, 0.42f*i*i);
+    return DualQuaternion(trans, Quaternion(axis, thetaRadians));
+}
+
+::testing::AssertionResult DualQuaternionEqual(const DualQuaternion& a, const DualQuaternion& b)
+{
+    const float eps = 0.0001f;
+    const float* fa = &a.real.x;
+    const float* fb = &b.real.x;
+    for (int i = 0; i < 8; i++) {
+        if (std::abs(fa[i]-fb[i]) > eps)
+            return ::testing::AssertionFailure() << "Dual quaternions differ in component " << i
+                                                 << ": " << fa[i] << " and " << fb[i];
+    }
+    return ::testing::AssertionSuccess();
+}
+
+// Odd count on purpose, so that both full batches and the partial tail are exercised.
+const int batchTestCount = 2*DualQuaternionN::Width + 3;
+
+TEST(DualQuaternionNTest, Multiply)
+{
+    std::vector<DualQuaternion> a, b, out(batchTestCount);
+    for (int i = 0; i < batchTestCount; i++) {
+        a.push_back(testDualQuaternion(i));
+        b.push_back(testDualQuaternion(batchTestCount - i));
+    }
+    multiply(a.data(), b.data(), out.data(), batchTestCount);
+    for (int i = 0; i < batchTestCount; i++)
+        EXPECT_TRUE(DualQuaternionEqual(a[i]*b[i], out[i]));
+
+    multiply(a[3], b.data(), out.data(), batchTestCount);
+    for (int i = 0; i < batchTestCount; i++)
+        EXPECT_TRUE(DualQuaternionEqual(a[3]*b[i], out[i]));
+}
+
+TEST(DualQuaternionNTest, ConjugateAndNormalize)
+{
+    std::vector<DualQuaternion> dqs, out(batchTestCount);
+    for (int i = 0; i < batchTestCount; i++)
+        dqs.push_back(testDualQuaternion(i));
+    conjugateDual(dqs.data(), out.data(), batchTestCount);
+    for (int i = 0; i < batchTestCount; i++)
+        EXPECT_TRUE(DualQuaternionEqual(conjugateDual(dqs[i]), out[i]));
+
+    // Scaling a unit dual quaternion and normalizing it must give back the original.
+    for (int i = 0; i < batchTestCount; i++) {
+        const float s = 0.5f + i;
+        out[i] = DualQuaternion(s*dqs[i].real, s*dqs[i].dual);
+    }
+    normalize(out.data(), batchTestCount);
+    for (int i = 0; i < batchTestCount; i++)
+        EXPECT_TRUE(DualQuaternionEqual(dqs[i], out[i]));
+}
+
+TEST(DualQuaternionNTest, TransformPointsAndNormals)
+{
+    std::vector<DualQuaternion> dqs;
+    std::vector<nv::vec3f> points, out(batchTestCount);
+    for (int i = 0; i < batchTestCount; i++) {
+        dqs.push_back(testDualQuaternion(i));
+        points.push_back(nv::vec3f(-0.42f*i, 1.42f, 4.2f - i));
+    }
+
+    transformPoints(dqs.data(), points.data(), out.data(), batchTestCount);
+    for (int i = 0; i < batchTestCount; i++) {
+        const DualQuaternion r = dqs[i]*DualQuaternion::fromVector(points[i])*conjugateDual(dqs[i]);
+        EXPECT_TRUE(Vec3Equal(DualQuaternion::toVector<nv::vec3f>(r), out[i]));
+    }
+
+    transformNormals(dqs.data(), points.data(), out.data(), batchTestCount);
+    for (int i = 0; i < batchTestCount; i++) {
+        const Quaternion r = dqs[i].real*Quaternion::fromVector(points[i])*conjugate(dqs[i].real);
+        EXPECT_TRUE(Vec3Equal(Quaternion::toVector<nv::vec3f>(r), out[i]));
+    }
+}
+
+TEST(DualQuaternionNTest, MatrixConversions)
+{
+    std::vector<nv::matrix4f> matrices(batchTestCount), back(batchTestCount);
+    for (int i = 0; i < batchTestCount; i++) {
+        // Different yaw/pitch/roll per element so that every branch of fromMatrix is taken.
+        rotationYawPitchRoll(matrices[i], 0.7f*i, -0.42f*i, NV_PI*(i%4)/2.f);
+        matrices[i].set_translate(nv::vec3f(2.f*i, -5.f, 0.42f));
+    }
+
+    std::vector<DualQuaternion> dqs(batchTestCount);
+    fromMatrices(matrices.data(), dqs.data(), batchTestCount);
+    for (int i = 0; i < batchTestCount; i++) {
+        const nv::vec3f v(-1.f, 0.42f*i, 4.2f);
+        const nv::vec3f expected = nv::vec3f(matrices[i] * nv::vec4f(v, 1.f));
+        const DualQuaternion r = dqs[i]*DualQuaternion::fromVector(v)*conjugateDual(dqs[i]);
+        EXPECT_TRUE(Vec3Equal(expected, DualQuaternion::toVector<nv::vec3f>(r)));
+    }
+
+    toMatrices(dqs.data(), back.data(), batchTestCount);
+    for (int i = 0; i < batchTestCount; i++) {
+        const nv::matrix4f scalar = DualQuaternion::toMatrix<nv::matrix4f>(dqs[i]);
+        for (int e = 0; e < 16; e++)
+            EXPECT_NEAR(scalar._array[e], back[i]._array[e], 0.0001f);
+    }
+}
+
 int main(int argc, char** argv)
 {
     ::testing::InitGoogleTest(&argc, argv);
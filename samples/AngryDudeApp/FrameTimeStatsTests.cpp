@@ -0,0 +1,141 @@
+#include "NvAppBase/NvFrameTimeStats.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+/// Compiled with
+/// clang FrameTimeStatsTests.cpp ../../extensions/src/NvAppBase/NvFrameTimeStats.cpp -o FrameTimeStatsTests -g3 -Wall -std=c++11 -DLINUX=1 -I. -I../../extensions/include/ -I../../extensions/externals/include/ -L./gtest/ -lgtest -lstdc++ -lpthread -lm
+///
+
+#include "gtest/gtest.h"
+
+// 1, 2, ..., count milliseconds, shuffled.
+static std::vector<float> makeTimes(int count)
+{
+    std::vector<float> times;
+    for (int i = 1; i <= count; i++)
+        times.push_back(float(i));
+    for (int i = count - 1; i > 0; i--)
+        std::swap(times[i], times[(i * 7919) % (i + 1)]);
+    return times;
+}
+
+static std::string writeAndRead(const NvFrameTimeStats& stats)
+{
+    char dir[] = "/tmp/FrameTimeStatsTestsXXXXXX";
+    if (!mkdtemp(dir))
+        return std::string();
+    const std::string path = std::string(dir) + "/frames.csv";
+    EXPECT_TRUE(stats.writeCSV(path.c_str()));
+
+    std::string text;
+    FILE* fp = fopen(path.c_str(), "r");
+    if (fp) {
+        char buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+            text.append(buffer, n);
+        fclose(fp);
+    }
+    system(("rm -r " + std::string(dir)).c_str());
+    return text;
+}
+
+TEST(FrameTimeStatsTest, NearestRankPercentiles)
+{
+    const NvFrameTimeStats::Summary s = NvFrameTimeStats::summarize(makeTimes(100), 0.f);
+    EXPECT_EQ(100, s.frames);
+    EXPECT_EQ(1.f, s.min);
+    EXPECT_EQ(50.f, s.median);
+    EXPECT_EQ(95.f, s.p95);
+    EXPECT_EQ(99.f, s.p99);
+    EXPECT_EQ(100.f, s.max);
+    EXPECT_FLOAT_EQ(50.5f, s.mean);
+
+    // Ranks round up: of 10 frames, the 95th and 99th percentiles are the 10th.
+    const NvFrameTimeStats::Summary ten = NvFrameTimeStats::summarize(makeTimes(10), 0.f);
+    EXPECT_EQ(5.f, ten.median);
+    EXPECT_EQ(10.f, ten.p95);
+    EXPECT_EQ(10.f, ten.p99);
+
+    const NvFrameTimeStats::Summary one = NvFrameTimeStats::summarize(std::vector<float>(1, 16.7f), 0.f);
+    EXPECT_EQ(1, one.frames);
+    EXPECT_EQ(16.7f, one.min);
+    EXPECT_EQ(16.7f, one.median);
+    EXPECT_EQ(16.7f, one.p99);
+    EXPECT_EQ(16.7f, one.max);
+}
+
+TEST(FrameTimeStatsTest, StuttersAgainstTwiceTheMedianByDefault)
+{
+    std::vector<float> times(9, 10.f);
+    times.push_back(20.f);  // Exactly at the threshold, not a stutter.
+    times.push_back(25.f);
+    for (float threshold: {0.f, -1.f}) {
+        const NvFrameTimeStats::Summary s = NvFrameTimeStats::summarize(times, threshold);
+        EXPECT_EQ(10.f, s.median);
+        EXPECT_EQ(20.f, s.stutterThreshold);
+        EXPECT_EQ(1, s.stutters);
+    }
+}
+
+TEST(FrameTimeStatsTest, StuttersAgainstAnExplicitThreshold)
+{
+    std::vector<float> times(9, 10.f);
+    times.push_back(20.f);
+    times.push_back(25.f);
+    const NvFrameTimeStats::Summary s = NvFrameTimeStats::summarize(times, 15.f);
+    EXPECT_EQ(15.f, s.stutterThreshold);
+    EXPECT_EQ(2, s.stutters);
+
+    EXPECT_EQ(0, NvFrameTimeStats::summarize(times, 30.f).stutters);
+    EXPECT_EQ(11, NvFrameTimeStats::summarize(times, 5.f).stutters);
+}
+
+TEST(FrameTimeStatsTest, EmptySeriesIsAllZero)
+{
+    const NvFrameTimeStats::Summary s = NvFrameTimeStats::summarize(std::vector<float>(), 15.f);
+    EXPECT_EQ(0, s.frames);
+    EXPECT_EQ(0.f, s.min);
+    EXPECT_EQ(0.f, s.median);
+    EXPECT_EQ(0.f, s.p95);
+    EXPECT_EQ(0.f, s.p99);
+    EXPECT_EQ(0.f, s.max);
+    EXPECT_EQ(0.f, s.mean);
+    EXPECT_EQ(0.f, s.stutterThreshold);
+    EXPECT_EQ(0, s.stutters);
+}
+
+TEST(FrameTimeStatsTest, CSVLeavesMissingTimesEmpty)
+{
+    // GPU times arrive late, so the GPU series is usually the shorter one.
+    NvFrameTimeStats stats;
+    stats.addCPUTime(1.f);
+    stats.addCPUTime(2.5f);
+    stats.addCPUTime(3.f);
+    stats.addGPUTime(0.75f);
+    EXPECT_EQ("frame,cpu_ms,gpu_ms\n"
+              "0,1.0000,0.7500\n"
+              "1,2.5000,\n"
+              "2,3.0000,\n", writeAndRead(stats));
+
+    stats.clear();
+    stats.addCPUTime(4.f);
+    stats.addGPUTime(5.f);
+    stats.addGPUTime(6.f);
+    EXPECT_EQ("frame,cpu_ms,gpu_ms\n"
+              "0,4.0000,5.0000\n"
+              "1,,6.0000\n", writeAndRead(stats));
+
+    stats.clear();
+    EXPECT_EQ("frame,cpu_ms,gpu_ms\n", writeAndRead(stats));
+    EXPECT_FALSE(stats.writeCSV("/nonexistent/FrameTimeStatsTests/frames.csv"));
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,208 @@
+#include "NvAppBase/NvFrameTrace.h"
+#include "NV/NvStopWatch.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Compiled with
+/// clang FrameTraceTests.cpp ../../extensions/src/NvAppBase/NvFrameTrace.cpp -o FrameTraceTests -g3 -Wall -std=c++11 -DLINUX=1 -I. -I../../extensions/include/ -I../../extensions/externals/include/ -L./gtest/ -lgtest -lstdc++ -lpthread -lm
+///
+/// Every test records on a thread of its own, so that it starts with an
+/// empty ring buffer; the trace itself is global and only ever grows.
+
+#include "gtest/gtest.h"
+
+// What NvSampleApp's platform layer provides, on std::chrono.
+class ChronoStopWatch : public NvStopWatch
+{
+public:
+    ChronoStopWatch() : mRunning(false), mElapsed(0.0) {}
+    virtual void start() { mStart = Clock::now(); mRunning = true; }
+    virtual void stop() { mElapsed += seconds(); mRunning = false; }
+    virtual void reset() { mElapsed = 0.0; mStart = Clock::now(); }
+    virtual const float getTime() const { return float(mElapsed + (mRunning ? seconds() : 0.0)); }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+    double seconds() const { return std::chrono::duration<double>(Clock::now() - mStart).count(); }
+
+    Clock::time_point mStart;
+    bool mRunning;
+    double mElapsed;
+};
+
+class ChronoStopWatchFactory : public NvStopWatchFactory
+{
+public:
+    virtual NvStopWatch* createStopWatch() { return new ChronoStopWatch; }
+};
+
+struct TracedScope
+{
+    std::string name;
+    double begin;    // Microseconds, as written.
+    double duration;
+};
+
+// Writes the trace under a temporary directory and returns the scopes of the
+// thread called threadName, in the order written; file receives the text.
+static std::vector<TracedScope> writeAndRead(const std::string& threadName, std::string* file = NULL)
+{
+    std::vector<TracedScope> scopes;
+    char dir[] = "/tmp/FrameTraceTestsXXXXXX";
+    if (!mkdtemp(dir))
+        return scopes;
+    const std::string path = std::string(dir) + "/trace.json";
+    EXPECT_TRUE(NvFrameTrace::writeChromeTrace(path.c_str()));
+
+    std::string text;
+    FILE* fp = fopen(path.c_str(), "r");
+    if (fp) {
+        char buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+            text.append(buffer, n);
+        fclose(fp);
+    }
+    system(("rm -r " + std::string(dir)).c_str());
+    if (file)
+        *file = text;
+
+    // One event per line; find the thread's id, then its scopes.
+    int tid = -1;
+    const std::string metadata = "\"args\":{\"name\":\"" + threadName + "\"}}";
+    size_t begin = 0;
+    std::vector<std::string> lines;
+    while (begin < text.size()) {
+        size_t end = text.find('\n', begin);
+        if (end == std::string::npos)
+            end = text.size();
+        lines.push_back(text.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    for (const std::string& line: lines)
+        if (line.find("\"ph\":\"M\"") != std::string::npos && line.find(metadata) != std::string::npos)
+            sscanf(line.c_str() + line.find("\"tid\":"), "\"tid\":%d", &tid);
+    EXPECT_NE(-1, tid) << "no thread named " << threadName;
+
+    for (const std::string& line: lines) {
+        const size_t ts = line.find(",\"ts\":");
+        if (line.find("\"ph\":\"X\"") == std::string::npos || ts == std::string::npos)
+            continue;
+        TracedScope scope;
+        int scopeTid = 0;
+        if (sscanf(line.c_str() + ts, ",\"ts\":%lf,\"dur\":%lf,\"pid\":1,\"tid\":%d}", &scope.begin, &scope.duration, &scopeTid) != 3)
+            ADD_FAILURE() << "cannot parse " << line;
+        if (scopeTid != tid)
+            continue;
+        const size_t nameBegin = strlen("{\"name\":\"");
+        scope.name = line.substr(nameBegin, line.find("\",\"cat\":") - nameBegin);
+        scopes.push_back(scope);
+    }
+    return scopes;
+}
+
+static void initTrace()
+{
+    static ChronoStopWatchFactory factory;
+    NvFrameTrace::globalInit(&factory);
+    NvFrameTrace::setEnabled(true);
+}
+
+TEST(FrameTraceTest, ScopesNestAndFollowEachOther)
+{
+    initTrace();
+    std::thread([] {
+        NvFrameTrace::setThreadName("nesting");
+        NV_TRACE_SCOPE("frame");
+        {
+            NV_TRACE_SCOPE("update");
+            NV_TRACE_SCOPE("skinning");
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        {
+            NV_TRACE_SCOPE("draw");
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }).join();
+
+    // Scopes are recorded when they end, innermost first.
+    const std::vector<TracedScope> scopes = writeAndRead("nesting");
+    ASSERT_EQ(4u, scopes.size());
+    EXPECT_EQ("skinning", scopes[0].name);
+    EXPECT_EQ("update", scopes[1].name);
+    EXPECT_EQ("draw", scopes[2].name);
+    EXPECT_EQ("frame", scopes[3].name);
+
+    const double tolerance = 0.01;
+    for (int inner = 0; inner < 3; inner++) {
+        const int outer = inner == 0 ? 1 : 3;
+        EXPECT_GE(scopes[inner].begin, scopes[outer].begin);
+        EXPECT_LE(scopes[inner].begin + scopes[inner].duration, scopes[outer].begin + scopes[outer].duration + tolerance);
+    }
+    EXPECT_GE(scopes[0].duration, 2000.0);
+    EXPECT_GE(scopes[2].begin + tolerance, scopes[1].begin + scopes[1].duration);
+}
+
+TEST(FrameTraceTest, RingBufferKeepsTheLatestScopes)
+{
+    initTrace();
+    const uint32_t extra = 100;
+    std::thread([extra] {
+        NvFrameTrace::setThreadName("wrapping");
+        for (uint32_t i = 0; i < NvFrameTrace::EVENTS_PER_THREAD + extra; i++)
+            NvFrameTrace::record("tick", i, i + 0.25);
+    }).join();
+
+    // Once wrapped, the oldest slot is the one the thread writes next, so
+    // the writer leaves it out.
+    const std::vector<TracedScope> scopes = writeAndRead("wrapping");
+    ASSERT_EQ(size_t(NvFrameTrace::EVENTS_PER_THREAD - 1), scopes.size());
+    for (size_t n = 0; n < scopes.size(); n++) {
+        ASSERT_EQ(double(extra + 1 + n) * 1.0e6, scopes[n].begin) << "scope " << n;
+        EXPECT_EQ(0.25e6, scopes[n].duration);
+    }
+}
+
+TEST(FrameTraceTest, DisabledScopesAreNotRecorded)
+{
+    initTrace();
+    std::thread([] {
+        NvFrameTrace::setThreadName("disabled");
+        NvFrameTrace::setEnabled(false);
+        { NV_TRACE_SCOPE("hidden"); }
+        NvFrameTrace::setEnabled(true);
+        { NV_TRACE_SCOPE("shown"); }
+    }).join();
+
+    const std::vector<TracedScope> scopes = writeAndRead("disabled");
+    ASSERT_EQ(1u, scopes.size());
+    EXPECT_EQ("shown", scopes[0].name);
+}
+
+TEST(FrameTraceTest, WritesEscapedChromeTraceJSON)
+{
+    initTrace();
+    std::thread([] {
+        NvFrameTrace::setThreadName("quote\" back\\slash");
+        NvFrameTrace::record("say \"hi\"", 1.0, 1.5);
+    }).join();
+
+    std::string file;
+    writeAndRead("quote\\\" back\\\\slash", &file);
+    EXPECT_EQ(0u, file.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"));
+    EXPECT_EQ(file.size() - 4, file.rfind("\n]}\n"));
+    EXPECT_NE(std::string::npos, file.find("{\"name\":\"say \\\"hi\\\"\",\"cat\":\"frame\",\"ph\":\"X\",\"ts\":1000000.000,\"dur\":500000.000"));
+
+    EXPECT_FALSE(NvFrameTrace::writeChromeTrace("/nonexistent/FrameTraceTests/trace.json"));
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
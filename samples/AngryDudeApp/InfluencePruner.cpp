@@ -0,0 +1,170 @@
+#include "Skinning.hpp"
+#include "Animation.hpp"
+#include "Skeleton.hpp"
+#include "InfluencePruning.hpp"
+#include "InfluenceSplit.hpp"
+#include "cereal/archives/binary.hpp"
+#include "cereal/types/vector.hpp"
+#include "cereal/types/string.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/// Reports the bone influences of every mesh in a .binmesh file (influence
+/// counts, weight histogram), prunes them as InfluencePruning.hpp does, and
+/// reports the deformation error this costs: the largest and average
+/// distance between each vertex skinned before and after, with dual
+/// quaternions and with matrices, over poses sampled evenly from the
+/// animation (see animationDuration, or -duration). Optionally writes the
+/// pruned model.
+/// Compiled with
+/// clang InfluencePruner.cpp ../../extensions/externals/src/Half/half.cpp -o InfluencePruner -O2 -Wall -std=c++11 -I. -I../../extensions/include/ -I../../extensions/externals/include/ -lstdc++ -lm
+/// and run as
+/// ./InfluencePruner [-threshold 0.05] [-maxinfluences 4] [-poses 64] [-duration seconds] assets/dude.binmesh [pruned.binmesh]
+///
+
+void printHistogram(const char* label, const InfluenceHistogram& h)
+{
+    std::printf("  %-8s %6u vertices, by influences 0/1/2/3/4: %u/%u/%u/%u/%u, min weight %.4f, max |sum - 1| %.4f\n", label,
+                unsigned(h.numVertices), unsigned(h.numInfluences[0]), unsigned(h.numInfluences[1]),
+                unsigned(h.numInfluences[2]), unsigned(h.numInfluences[3]), unsigned(h.numInfluences[4]),
+                h.minWeight, h.maxSumError);
+    std::printf("  %-8s weights by tenths:", "");
+    for (int bin = 0; bin < InfluenceHistogram::NumWeightBins; bin++)
+        std::printf(" %u", unsigned(h.weights[bin]));
+    std::printf("\n");
+}
+
+void printError(const char* label, const DeformationError& e)
+{
+    std::printf("  %-8s max %.5f (vertex %u, pose %u), average %.6f units, max normal error %.3f degrees\n", label,
+                e.maxPositionError, unsigned(e.worstVertex), unsigned(e.worstPose), e.averagePositionError,
+                e.maxNormalError * 180.f / 3.14159265f);
+}
+
+/// numPoses palettes of every bone, evenly spaced over [0, duration).
+template <typename T>
+std::vector<T> samplePalettes(const SkinnedModel& model, int numPoses, float duration)
+{
+    const Skeleton skeleton = Skeleton::fromModel(model);
+    const SkeletonCache cache = SkeletonCache::fromSkeleton(skeleton, model.bones);
+    const std::vector<T>& boneOffsets = cache.get<T>().boneOffsets;
+    SkeletonPose<T> pose;
+    cache.initPose(pose);
+    std::vector<NodeAnimationCursor> cursors(model.nodeAnimations.size());
+
+    std::vector<T> palettes(numPoses * model.bones.size());
+    for (int p = 0; p < numPoses; p++) {
+        const float time = duration * p / numPoses;
+        for (int i: cache.animatedNodes) {
+            const int track = skeleton.nodeAnimationIndices[i];
+            const nv::vec3f translation = sampleTranslation(model.nodeAnimations[track], time, cursors[track]);
+            const nv::quaternionf rotation = sampleRotation(model.nodeAnimations[track], time, cursors[track]);
+            nv::matrix4f local;
+            rotation.get_value(local);
+            local.set_translate(translation);
+            convertTransform(local, pose.local[i]);
+        }
+        computeGlobalTransforms(skeleton, cache, pose);
+        T* palette = &palettes[p * model.bones.size()];
+        for (size_t bone = 0; bone < model.bones.size(); bone++) {
+            const int node = cache.boneNodes[bone];
+            if (node != -1)
+                palette[bone] = pose.global[node] * boneOffsets[bone];
+        }
+    }
+    return palettes;
+}
+
+int main(int argc, char** argv)
+{
+    PruningSettings settings;
+    int numPoses = 64;
+    float duration = 0.f;       // 0: the animation's, as played by the sample.
+    int arg = 1;
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        const std::string option = argv[arg];
+        std::istringstream value(argv[arg + 1]);
+        if (option == "-threshold")
+            value >> settings.threshold;
+        else if (option == "-maxinfluences")
+            value >> settings.maxInfluences;
+        else if (option == "-poses")
+            value >> numPoses;
+        else if (option == "-duration")
+            value >> duration;
+        else
+            break;
+    }
+    if (arg != argc - 1 && arg != argc - 2) {
+        std::cerr << "Usage: " << argv[0] << " [-threshold t] [-maxinfluences n] [-poses n] [-duration seconds] <input.binmesh> [output.binmesh]" << std::endl;
+        return 1;
+    }
+
+    std::ifstream is(argv[arg], std::ios::binary);
+    if (!is) {
+        std::cerr << "Cannot open " << argv[arg] << std::endl;
+        return 1;
+    }
+    SkinnedModel model;
+    {
+        cereal::BinaryInputArchive iarchive(is);
+        iarchive(model);
+    }
+    if (duration <= 0.f)
+        duration = animationDuration(model.nodeAnimations);
+
+    const std::vector<DualQuaternion> dualQuaternions = samplePalettes<DualQuaternion>(model, numPoses, duration);
+    const std::vector<nv::matrix4f> matrices = samplePalettes<nv::matrix4f>(model, numPoses, duration);
+
+    std::printf("Pruning weights below %g, keeping at most %d; error over %d poses in %g s\n",
+                settings.threshold, settings.maxInfluences, numPoses, duration);
+    InfluenceHistogram totalBefore = {}, totalAfter = {};
+    PruningStats totalPruned = {};
+    float maxError = 0.f;
+    for (Mesh& mesh: model.meshes) {
+        std::printf("%s\n", mesh.albedoTextureFilename.c_str());
+        const std::vector<Vertex> original = mesh.vertices;
+        InfluenceHistogram before = {}, after = {};
+        PruningStats pruned = {};
+        influencepruning::analyzeInfluences(mesh.vertices.data(), mesh.vertices.size(), before);
+        for (Vertex& v: mesh.vertices)
+            influencepruning::pruneInfluences(v, settings, &pruned);
+        influencepruning::analyzeInfluences(mesh.vertices.data(), mesh.vertices.size(), after);
+        influencepruning::analyzeInfluences(original.data(), original.size(), totalBefore);
+        influencepruning::analyzeInfluences(mesh.vertices.data(), mesh.vertices.size(), totalAfter);
+
+        printHistogram("before", before);
+        printHistogram("after", after);
+        std::printf("  %-8s %u influences of %u vertices dropped, largest %.4f\n", "pruned",
+                    unsigned(pruned.numInfluences), unsigned(pruned.numVertices), pruned.maxDroppedWeight);
+        totalPruned.numInfluences += pruned.numInfluences;
+        totalPruned.numVertices += pruned.numVertices;
+        totalPruned.maxDroppedWeight = std::max(totalPruned.maxDroppedWeight, pruned.maxDroppedWeight);
+
+        const DeformationError dqb = influencepruning::measureDeformationError(original.data(), mesh.vertices.data(), original.size(),
+                                                                               dualQuaternions.data(), numPoses, model.bones.size());
+        const DeformationError lbs = influencepruning::measureDeformationError(original.data(), mesh.vertices.data(), original.size(),
+                                                                               matrices.data(), numPoses, model.bones.size());
+        printError("DQB", dqb);
+        printError("LBS", lbs);
+        maxError = std::max(maxError, std::max(dqb.maxPositionError, lbs.maxPositionError));
+    }
+
+    std::printf("All meshes\n");
+    printHistogram("before", totalBefore);
+    printHistogram("after", totalAfter);
+    std::printf("  %u influences of %u vertices dropped, largest %.4f; worst-case error %.5f units\n",
+                unsigned(totalPruned.numInfluences), unsigned(totalPruned.numVertices), totalPruned.maxDroppedWeight, maxError);
+
+    if (arg == argc - 2) {
+        std::ofstream os(argv[arg + 1], std::ios::binary);
+        cereal::BinaryOutputArchive oarchive(os);
+        oarchive(model);
+    }
+    return 0;
+}
@@ -0,0 +1,175 @@
+#ifndef __InfluencePruning_hpp__
+#define __InfluencePruning_hpp__
+
+#include "Skinning.hpp"
+#include "CpuSkinning.hpp"
+#include "InfluenceSplit.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+/// \file InfluencePruning.hpp
+/// \brief Analysis and pruning of the bone influences of Vertex::bones.
+///
+/// Exporters keep every influence the artist painted, down to weights too
+/// small to move a vertex visibly. Each one still costs a palette lookup and
+/// a blend in skinning.vert, and keeps its vertex in a more expensive
+/// MAX_INFLUENCES variant (InfluenceSplit.hpp). The passes here:
+///
+/// - analyzeInfluences histograms influence counts and weights
+/// - pruneInfluences drops weights below a threshold (or beyond a maximum
+///   count), renormalizes the rest to sum to 1 and sorts them heaviest first
+/// - measureDeformationError skins the original and the pruned vertices with
+///   the same poses and reports how far apart they end up
+///
+/// Weights are the fractional parts of Vertex::bones, so a weight can get
+/// no closer to 1 than MaxWeight; a single remaining influence is stored
+/// with MaxWeight, as vertexpacking::unpackVertex does.
+
+/// \brief Influence counts and weight distribution of a set of vertices.
+struct InfluenceHistogram
+{
+    static const int NumWeightBins = 10;
+
+    size_t numVertices;
+    size_t numInfluences[5];         ///< [n]: vertices with n nonzero weights.
+    size_t weights[NumWeightBins];   ///< Nonzero weights in [i, i+1) / NumWeightBins.
+    float  minWeight;                ///< Smallest nonzero weight; 0 if there is none.
+    float  maxSumError;              ///< Largest difference of a vertex's weight sum from 1.
+};
+
+/// \brief What pruneInfluences keeps.
+struct PruningSettings
+{
+    float threshold;       ///< Weights below are dropped, the heaviest never.
+    int   maxInfluences;   ///< At most this many of the heaviest are kept.
+
+    PruningSettings() : threshold(0.05f), maxInfluences(4) {}
+};
+
+/// \brief What pruneInfluences dropped, over any number of vertices.
+struct PruningStats
+{
+    size_t numVertices;          ///< Vertices that lost an influence.
+    size_t numInfluences;        ///< Influences dropped.
+    float  maxDroppedWeight;     ///< Largest weight dropped, before renormalization.
+};
+
+/// \brief Distance between two skinnings of the same vertices, over all poses.
+struct DeformationError
+{
+    float  maxPositionError;     ///< In model units.
+    size_t worstVertex;
+    size_t worstPose;
+    float  averagePositionError;
+    float  maxNormalError;       ///< Angle in radians.
+};
+
+namespace influencepruning {
+
+const float MaxWeight = 0.999f;
+
+/// Adds the vertices to histogram, which must start zeroed.
+inline void analyzeInfluences(const Vertex* vertices, size_t count, InfluenceHistogram& histogram)
+{
+    for (size_t i = 0; i < count; i++) {
+        const float* packed = &vertices[i].bones.x;
+        int n = 0;
+        float sum = 0.f;
+        for (int k = 0; k < 4; k++) {
+            int boneIdx;
+            float w;
+            cpuskinning::unpackInfluence(packed[k], boneIdx, w);
+            if (w <= 0.f)
+                continue;
+            if (histogram.minWeight == 0.f || w < histogram.minWeight)
+                histogram.minWeight = w;
+            const int bin = std::min(static_cast<int>(w * InfluenceHistogram::NumWeightBins), InfluenceHistogram::NumWeightBins - 1);
+            histogram.weights[bin]++;
+            sum += w;
+            n++;
+        }
+        histogram.numVertices++;
+        histogram.numInfluences[n]++;
+        histogram.maxSumError = std::max(histogram.maxSumError, std::abs(sum - 1.f));
+    }
+}
+
+/// Drops the influences settings asks for, renormalizes the others and
+/// sorts them heaviest first; dropped slots become bone 0 with weight 0.
+/// Returns the number of influences dropped and adds them to stats, if given.
+inline int pruneInfluences(Vertex& v, const PruningSettings& settings, PruningStats* stats = nullptr)
+{
+    influencesplit::sortInfluences(v);
+    float* packed = &v.bones.x;
+    int bones[4];
+    float weights[4];
+    for (int k = 0; k < 4; k++)
+        cpuskinning::unpackInfluence(packed[k], bones[k], weights[k]);
+
+    int kept = 1;
+    while (kept < std::min(settings.maxInfluences, 4) && weights[kept] > 0.f && weights[kept] >= settings.threshold)
+        kept++;
+    int dropped = 0;
+    float maxDropped = 0.f;
+    for (int k = kept; k < 4; k++) {
+        if (weights[k] > 0.f) {
+            dropped++;
+            maxDropped = std::max(maxDropped, weights[k]);
+        }
+    }
+
+    float sum = 0.f;
+    for (int k = 0; k < kept; k++)
+        sum += weights[k];
+    for (int k = 0; k < 4; k++) {
+        if (k < kept && sum > 0.f)
+            packed[k] = bones[k] + std::min(weights[k] / sum, MaxWeight);
+        else if (k >= kept)
+            packed[k] = 0.f;
+    }
+
+    if (stats && dropped) {
+        stats->numVertices++;
+        stats->numInfluences += dropped;
+        stats->maxDroppedWeight = std::max(stats->maxDroppedWeight, maxDropped);
+    }
+    return dropped;
+}
+
+/// Skins both vertex sets with every palette, numBones transforms each, the
+/// way skinning.vert does (T selects DQB or LBS), and compares the results.
+template <typename T>
+DeformationError measureDeformationError(const Vertex* original, const Vertex* pruned, size_t count,
+                                         const T* palettes, size_t numPoses, size_t numBones)
+{
+    DeformationError error = {};
+    double sum = 0.0;
+    for (size_t pose = 0; pose < numPoses; pose++) {
+        const T* palette = palettes + pose * numBones;
+        for (size_t i = 0; i < count; i++) {
+            const Vertex a = cpuskinning::skinVertex(original[i], palette);
+            const Vertex b = cpuskinning::skinVertex(pruned[i], palette);
+            const float distance = nv::length(a.position - b.position);
+            sum += distance;
+            if (distance > error.maxPositionError) {
+                error.maxPositionError = distance;
+                error.worstVertex = i;
+                error.worstPose = pose;
+            }
+            const float lengths = nv::length(a.normal) * nv::length(b.normal);
+            if (lengths > 0.f) {
+                const float cosine = std::max(-1.f, std::min(1.f, nv::dot(a.normal, b.normal) / lengths));
+                error.maxNormalError = std::max(error.maxNormalError, std::acos(cosine));
+            }
+        }
+    }
+    const size_t samples = count * numPoses;
+    error.averagePositionError = samples ? static_cast<float>(sum / samples) : 0.f;
+    return error;
+}
+
+} // namespace influencepruning
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef __InfluenceSplit_hpp__
+#define __InfluenceSplit_hpp__
+
+#include "Skinning.hpp"
+#include "PackedVertex.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// \file InfluenceSplit.hpp
+/// \brief Grouping of triangles by the number of bone influences they need.
+///
+/// skinning.vert is compiled once per influence count (MAX_INFLUENCES 1 to
+/// 4), and a variant blends only that many bones. Most of dude's vertices
+/// have fewer than four: a vertex needs as many slots as it takes to reach
+/// its last nonzero weight, and a triangle as many as its neediest vertex.
+/// splitByInfluences reorders a mesh's triangles into one contiguous run per
+/// slot count, each drawn with its own variant.
+///
+/// Slots are counted up to the last used one, not by the used ones, so that
+/// a vertex with an unused slot between two used ones still gets all its
+/// bones. sortInfluences moves the used slots to the front, heaviest first;
+/// BinaryModelConverter applies it so that the two counts agree.
+
+/// \brief Triangles of a mesh drawn with the same skinning variant.
+struct InfluenceBatch
+{
+    int    maxInfluences;  ///< Slots the variant blends, 1 to 4.
+    size_t firstIndex;
+    size_t numIndices;
+};
+
+/// \brief Triangles and vertices per slot count, over any number of meshes.
+struct InfluenceSplitStats
+{
+    size_t numTriangles[4];  ///< [n - 1]: triangles that need n slots.
+    size_t numVertices[4];   ///< [n - 1]: vertices that need n slots.
+
+    /// Slots blended per vertex, on average over the triangle corners, with
+    /// the split; without it every corner blends 4.
+    float averageInfluences() const
+    {
+        size_t corners = 0, blended = 0;
+        for (int n = 0; n < 4; n++) {
+            corners += 3 * numTriangles[n];
+            blended += 3 * numTriangles[n] * (n + 1);
+        }
+        return corners ? float(blended) / corners : 0.f;
+    }
+};
+
+namespace influencesplit {
+
+const int MaxInfluences = 4;
+
+/// Slots up to and including the last with a nonzero weight; at least 1.
+inline int countInfluences(const Vertex& v)
+{
+    for (int k = MaxInfluences - 1; k > 0; k--)
+        if (v.bones[k] - std::floor(v.bones[k]) > 0.f)
+            return k + 1;
+    return 1;
+}
+
+inline int countInfluences(const PackedVertex& v)
+{
+    for (int k = MaxInfluences - 1; k > 0; k--)
+        if (v.weights[k] > 0)
+            return k + 1;
+    return 1;
+}
+
+/// Orders the influences by weight, heaviest first, so that the unused
+/// slots come last. Ties keep their order.
+inline void sortInfluences(Vertex& v)
+{
+    float slots[MaxInfluences] = { v.bones.x, v.bones.y, v.bones.z, v.bones.w };
+    std::stable_sort(slots, slots + MaxInfluences, [](float a, float b) {
+        return a - std::floor(a) > b - std::floor(b);
+    });
+    v.bones = nv::vec4f(slots[0], slots[1], slots[2], slots[3]);
+}
+
+inline void sortInfluences(PackedVertex& v)
+{
+    int order[MaxInfluences] = { 0, 1, 2, 3 };
+    std::stable_sort(order, order + MaxInfluences, [&v](int a, int b) {
+        return v.weights[a] > v.weights[b];
+    });
+    const PackedVertex original = v;
+    for (int k = 0; k < MaxInfluences; k++) {
+        v.bones[k] = original.bones[order[k]];
+        v.weights[k] = original.weights[order[k]];
+    }
+}
+
+/// countInfluences of every vertex.
+template <typename V>
+std::vector<uint8_t> countInfluences(const V* vertices, size_t numVertices)
+{
+    std::vector<uint8_t> counts(numVertices);
+    for (size_t i = 0; i < numVertices; i++)
+        counts[i] = static_cast<uint8_t>(countInfluences(vertices[i]));
+    return counts;
+}
+
+/// Reorders the triangles of a triangle list by the most slots any of their
+/// vertices needs, fewest first, keeping their order (and so their vertex
+/// cache locality) within each group. Returns one batch per nonempty group
+/// and adds the counts to stats, if given.
+/// \param[in] counts countInfluences of every vertex the indices reference
+inline std::vector<InfluenceBatch> splitByInfluences(unsigned short* indices, size_t numIndices, const uint8_t* counts,
+                                                     InfluenceSplitStats* stats = nullptr)
+{
+    const size_t numTriangles = numIndices / 3;
+    std::vector<uint8_t> triangleCounts(numTriangles);
+    size_t groupSizes[MaxInfluences] = { 0, 0, 0, 0 };
+    for (size_t t = 0; t < numTriangles; t++) {
+        const unsigned short* triangle = &indices[3*t];
+        const int n = std::max(counts[triangle[0]], std::max(counts[triangle[1]], counts[triangle[2]]));
+        triangleCounts[t] = static_cast<uint8_t>(n);
+        groupSizes[n - 1]++;
+    }
+
+    // Counting sort; stable, so each group keeps the incoming order.
+    size_t groupStarts[MaxInfluences];
+    size_t start = 0;
+    for (int n = 0; n < MaxInfluences; n++) {
+        groupStarts[n] = start;
+        start += groupSizes[n];
+    }
+    std::vector<unsigned short> sorted(3 * numTriangles);
+    for (size_t t = 0; t < numTriangles; t++) {
+        const size_t to = groupStarts[triangleCounts[t] - 1]++;
+        std::copy(&indices[3*t], &indices[3*t + 3], &sorted[3*to]);
+    }
+    std::copy(sorted.begin(), sorted.end(), indices);
+
+    std::vector<InfluenceBatch> batches;
+    size_t firstIndex = 0;
+    for (int n = 0; n < MaxInfluences; n++) {
+        if (groupSizes[n] == 0)
+            continue;
+        InfluenceBatch batch;
+        batch.maxInfluences = n + 1;
+        batch.firstIndex = firstIndex;
+        batch.numIndices = 3 * groupSizes[n];
+        batches.push_back(batch);
+        firstIndex += batch.numIndices;
+    }
+
+    if (stats) {
+        for (int n = 0; n < MaxInfluences; n++)
+            stats->numTriangles[n] += groupSizes[n];
+        std::vector<bool> seen;
+        for (size_t i = 0; i < 3 * numTriangles; i++) {
+            const unsigned short index = indices[i];
+            if (index >= seen.size())
+                seen.resize(index + 1, false);
+            if (!seen[index]) {
+                seen[index] = true;
+                stats->numVertices[counts[index] - 1]++;
+            }
+        }
+    }
+    return batches;
+}
+
+} // namespace influencesplit
+
+#endif
@@ -0,0 +1,115 @@
+#include "NvAppBase/NvJobSystem.h"
+#include <atomic>
+#include <vector>
+
+/// Compiled with
+/// clang JobSystemTests.cpp ../../extensions/src/NvAppBase/NvJobSystem.cpp ../../extensions/externals/src/R3/thread.cpp -o JobSystemTests -g3 -Wall -std=c++11 -I. -I../../extensions/include/ -I../../extensions/externals/include/ -L./gtest/ -lgtest -lstdc++ -lpthread -lm
+///
+
+#include "gtest/gtest.h"
+
+TEST(JobSystemTest, ParallelForVisitsEveryIndexOnce)
+{
+    for (int numThreads = 1; numThreads <= 4; numThreads += 3) {
+        NvJobSystem jobs(numThreads);
+        const size_t count = 10007;
+        std::vector<std::atomic<int> > visits(count);
+        for (std::atomic<int>& v: visits)
+            v.store(0);
+        std::atomic<bool> badRange(false), badThread(false);
+
+        for (size_t grainSize = 1; grainSize <= 4096; grainSize *= 8) {
+            jobs.parallelForWithThreadIndex(count, grainSize, [&](size_t begin, size_t end, int32_t threadIndex) {
+                if (begin >= end || end - begin > grainSize || end > count)
+                    badRange.store(true);
+                if (threadIndex < 0 || threadIndex >= jobs.getNumThreads())
+                    badThread.store(true);
+                for (size_t i = begin; i < end; i++)
+                    visits[i]++;
+            });
+        }
+        EXPECT_FALSE(badRange.load());
+        EXPECT_FALSE(badThread.load());
+        for (size_t i = 0; i < count; i++)
+            ASSERT_EQ(5, visits[i].load()) << "index " << i << ", " << numThreads << " threads";
+    }
+}
+
+TEST(JobSystemTest, DependenciesRunFirst)
+{
+    NvJobSystem jobs(4);
+    for (int pass = 0; pass < 50; pass++) {
+        std::atomic<int> sequence(0);
+        int a = -1, b = -1, c = -1, d = -1;
+
+        // a -> {b, c} -> d
+        NvJobHandle jobA = jobs.createJob([&]() { a = sequence++; });
+        NvJobHandle jobB = jobs.createJob([&]() { b = sequence++; });
+        NvJobHandle jobC = jobs.createJob([&]() { c = sequence++; });
+        NvJobHandle jobD = jobs.createJob([&]() { d = sequence++; });
+        jobs.addDependency(jobB, jobA);
+        jobs.addDependency(jobC, jobA);
+        jobs.addDependency(jobD, jobB);
+        jobs.addDependency(jobD, jobC);
+        jobs.submit(jobD);
+        jobs.submit(jobC);
+        jobs.submit(jobB);
+        EXPECT_FALSE(jobD.isDone());
+        jobs.submit(jobA);
+        jobs.wait(jobD);
+
+        ASSERT_TRUE(jobA.isDone() && jobB.isDone() && jobC.isDone() && jobD.isDone());
+        EXPECT_EQ(0, a);
+        EXPECT_LT(a, b);
+        EXPECT_LT(a, c);
+        EXPECT_EQ(3, d);
+    }
+}
+
+TEST(JobSystemTest, ContinuationOfFinishedJobRuns)
+{
+    NvJobSystem jobs(2);
+    int value = 0;
+    NvJobHandle first = jobs.run([&]() { value = 1; });
+    jobs.wait(first);
+    NvJobHandle second = jobs.then(first, [&]() { value *= 10; });
+    jobs.wait(second);
+    EXPECT_EQ(10, value);
+}
+
+TEST(JobSystemTest, NestedWorkIsHelpedAlong)
+{
+    // Jobs that wait on jobs of their own: with only two threads this
+    // deadlocks unless waiting threads run queued work.
+    NvJobSystem jobs(2);
+    std::atomic<int> total(0);
+    std::vector<NvJobHandle> outer;
+    for (int i = 0; i < 16; i++) {
+        outer.push_back(jobs.run([&]() {
+            jobs.parallelFor(100, 7, [&](size_t begin, size_t end) {
+                total += static_cast<int>(end - begin);
+            });
+            NvJobHandle inner = jobs.run([&]() { total += 1000; });
+            jobs.wait(inner);
+        }));
+    }
+    for (const NvJobHandle& job: outer)
+        jobs.wait(job);
+    EXPECT_EQ(16 * 1100, total.load());
+}
+
+TEST(JobSystemTest, SingleThreadRunsOnSubmit)
+{
+    NvJobSystem jobs(1);
+    EXPECT_EQ(1, jobs.getNumThreads());
+    int value = 0;
+    NvJobHandle job = jobs.run([&]() { value = 42; });
+    EXPECT_TRUE(job.isDone());
+    EXPECT_EQ(42, value);
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,277 @@
+#ifndef __MeshOptimization_hpp__
+#define __MeshOptimization_hpp__
+
+#include "Skinning.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <vector>
+
+/// \file MeshOptimization.hpp
+/// \brief Index and vertex reordering for the post-transform vertex cache.
+///
+/// Every vertex the GPU transforms runs the full skinning blend of
+/// skinning.vert, and it is transformed again whenever its index misses the
+/// post-transform cache. Three offline passes reduce that work:
+///
+/// - weldVertices merges bitwise identical vertices, turning an unindexed
+///   triangle soup (which is what the exporter produced for dude) into an
+///   indexed mesh; without it no triangle order can reuse anything
+/// - optimizeVertexCache reorders triangles with Tom Forsyth's "Linear-Speed
+///   Vertex Cache Optimisation", which scores vertices by their position in a
+///   simulated LRU cache and by how many triangles still use them
+/// - optimizeVertexFetch renumbers vertices in order of first use, so that
+///   vertex fetches walk the buffer front to back
+///
+/// analyzeVertexCache measures the result against a FIFO cache: ACMR (average
+/// cache miss ratio, transformed vertices per triangle; 0.5 is the ideal for a
+/// large regular grid, 3 means no reuse at all) and ATVR (transformed vertices
+/// per unique vertex; 1 is the ideal).
+
+/// \brief Vertex cache efficiency of an index buffer.
+struct VertexCacheStats
+{
+    size_t numTriangles;
+    size_t numVertices;      ///< Distinct vertices referenced.
+    size_t numTransformed;   ///< Cache misses.
+    float  acmr;
+    float  atvr;
+};
+
+namespace meshoptimization {
+
+/// Simulates a FIFO post-transform cache of cacheSize entries, the model of
+/// most hardware, over a triangle list.
+inline VertexCacheStats analyzeVertexCache(const unsigned short* indices, size_t numIndices, size_t cacheSize = 16)
+{
+    VertexCacheStats stats;
+    stats.numTriangles = numIndices / 3;
+    stats.numVertices = 0;
+    stats.numTransformed = 0;
+
+    std::vector<int> fifo(cacheSize, -1);
+    size_t head = 0;
+    std::vector<bool> seen;
+    for (size_t i = 0; i < numIndices; i++) {
+        const int index = indices[i];
+        if (index >= static_cast<int>(seen.size()))
+            seen.resize(index + 1, false);
+        if (!seen[index]) {
+            seen[index] = true;
+            stats.numVertices++;
+        }
+        if (std::find(fifo.begin(), fifo.end(), index) == fifo.end()) {
+            fifo[head] = index;
+            head = (head + 1) % cacheSize;
+            stats.numTransformed++;
+        }
+    }
+    stats.acmr = stats.numTriangles ? float(stats.numTransformed) / stats.numTriangles : 0.f;
+    stats.atvr = stats.numVertices ? float(stats.numTransformed) / stats.numVertices : 0.f;
+    return stats;
+}
+
+inline VertexCacheStats analyzeVertexCache(const Mesh& mesh, size_t cacheSize = 16)
+{
+    return analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), cacheSize);
+}
+
+namespace detail {
+
+struct VertexLess
+{
+    bool operator()(const Vertex& a, const Vertex& b) const
+    {
+        return std::memcmp(&a, &b, sizeof(Vertex)) < 0;
+    }
+};
+
+/// Scoring constants of Forsyth's reference implementation.
+const int   ForsythCacheSize   = 32;
+const float ForsythDecayPower  = 1.5f;
+const float ForsythLastTriangleScore = 0.75f;
+const float ForsythValenceScale = 2.f;
+const float ForsythValencePower = 0.5f;
+
+inline float forsythScore(int cachePosition, int remainingTriangles)
+{
+    if (remainingTriangles == 0)
+        return -1.f;
+
+    float score = 0.f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            // The last triangle's vertices; deliberately not the highest score
+            // so that strips do not just turn around.
+            score = ForsythLastTriangleScore;
+        } else {
+            const float scaler = 1.f / (ForsythCacheSize - 3);
+            score = std::pow(1.f - (cachePosition - 3) * scaler, ForsythDecayPower);
+        }
+    }
+    // Favour vertices with few triangles left, to finish them off.
+    return score + ForsythValenceScale * std::pow(static_cast<float>(remainingTriangles), -ForsythValencePower);
+}
+
+} // namespace detail
+
+/// Merges bitwise identical vertices and rewrites the indices to match.
+/// Vertices keep the order of their first occurrence. Returns the new
+/// vertex count.
+inline size_t weldVertices(Mesh& mesh)
+{
+    std::map<Vertex, unsigned short, detail::VertexLess> unique;
+    std::vector<Vertex> vertices;
+    std::vector<unsigned short> remap(mesh.vertices.size());
+    for (size_t i = 0; i < mesh.vertices.size(); i++) {
+        const unsigned short next = static_cast<unsigned short>(vertices.size());
+        const std::pair<std::map<Vertex, unsigned short, detail::VertexLess>::iterator, bool> inserted =
+            unique.insert(std::make_pair(mesh.vertices[i], next));
+        if (inserted.second)
+            vertices.push_back(mesh.vertices[i]);
+        remap[i] = inserted.first->second;
+    }
+    for (unsigned short& index: mesh.indices)
+        index = remap[index];
+    mesh.vertices.swap(vertices);
+    return mesh.vertices.size();
+}
+
+/// Reorders the triangles of an indexed triangle list (Forsyth). Triangles
+/// keep their winding; only their order changes.
+inline void optimizeVertexCache(std::vector<unsigned short>& indices, size_t numVertices)
+{
+    using namespace detail;
+    const size_t numTriangles = indices.size() / 3;
+    if (numTriangles == 0)
+        return;
+
+    // Triangles of each vertex, as offsets into one adjacency array.
+    std::vector<int> remaining(numVertices, 0);
+    for (unsigned short index: indices)
+        remaining[index]++;
+    std::vector<int> firstTriangle(numVertices + 1, 0);
+    for (size_t v = 0; v < numVertices; v++)
+        firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+    std::vector<int> adjacency(indices.size());
+    std::vector<int> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+    for (size_t t = 0; t < numTriangles; t++)
+        for (int k = 0; k < 3; k++)
+            adjacency[fill[indices[3*t + k]]++] = static_cast<int>(t);
+
+    std::vector<int> cachePosition(numVertices, -1);
+    std::vector<float> vertexScore(numVertices);
+    for (size_t v = 0; v < numVertices; v++)
+        vertexScore[v] = forsythScore(-1, remaining[v]);
+
+    std::vector<float> triangleScore(numTriangles);
+    std::vector<bool> added(numTriangles, false);
+    for (size_t t = 0; t < numTriangles; t++)
+        triangleScore[t] = vertexScore[indices[3*t]] + vertexScore[indices[3*t + 1]] + vertexScore[indices[3*t + 2]];
+
+    std::vector<unsigned short> output;
+    output.reserve(indices.size());
+    std::vector<int> cache, nextCache;
+    cache.reserve(ForsythCacheSize + 3);
+    nextCache.reserve(ForsythCacheSize + 3);
+    size_t scanStart = 0;
+
+    int best = -1;
+    float bestScore = -1.f;
+    for (size_t t = 0; t < numTriangles; t++) {
+        if (triangleScore[t] > bestScore) {
+            bestScore = triangleScore[t];
+            best = static_cast<int>(t);
+        }
+    }
+
+    while (best != -1) {
+        added[best] = true;
+        const unsigned short* triangle = &indices[3*best];
+        output.insert(output.end(), triangle, triangle + 3);
+
+        // The triangle's vertices move to the front of the LRU cache.
+        nextCache.assign(triangle, triangle + 3);
+        for (int v: cache)
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                nextCache.push_back(v);
+        for (int k = 0; k < 3; k++) {
+            const int v = triangle[k];
+            remaining[v]--;
+            int* begin = &adjacency[firstTriangle[v]];
+            int* end = begin + remaining[v] + 1;
+            *std::find(begin, end, best) = *(end - 1);   // Keep live triangles first.
+        }
+
+        // Rescore everything in (or just evicted from) the cache and the
+        // triangles around it; the best of those goes next.
+        best = -1;
+        bestScore = -1.f;
+        for (size_t i = 0; i < nextCache.size(); i++) {
+            const int v = nextCache[i];
+            cachePosition[v] = i < static_cast<size_t>(ForsythCacheSize) ? static_cast<int>(i) : -1;
+            const float newScore = forsythScore(cachePosition[v], remaining[v]);
+            const float delta = newScore - vertexScore[v];
+            vertexScore[v] = newScore;
+            for (int a = firstTriangle[v]; a < firstTriangle[v] + remaining[v]; a++) {
+                const int t = adjacency[a];
+                triangleScore[t] += delta;
+                if (triangleScore[t] > bestScore) {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+        }
+        if (nextCache.size() > static_cast<size_t>(ForsythCacheSize))
+            nextCache.resize(ForsythCacheSize);
+        cache.swap(nextCache);
+
+        if (best == -1) {
+            // Nothing in the cache touches a remaining triangle; take the next
+            // unadded one (scores only ever matter relative to the cache).
+            while (scanStart < numTriangles && added[scanStart])
+                scanStart++;
+            if (scanStart < numTriangles)
+                best = static_cast<int>(scanStart);
+        }
+    }
+    indices.swap(output);
+}
+
+inline void optimizeVertexCache(Mesh& mesh)
+{
+    optimizeVertexCache(mesh.indices, mesh.vertices.size());
+}
+
+/// Renumbers vertices in order of first use by the indices and drops
+/// unreferenced ones. Returns the new vertex count.
+inline size_t optimizeVertexFetch(Mesh& mesh)
+{
+    std::vector<int> remap(mesh.vertices.size(), -1);
+    std::vector<Vertex> vertices;
+    vertices.reserve(mesh.vertices.size());
+    for (unsigned short& index: mesh.indices) {
+        if (remap[index] == -1) {
+            remap[index] = static_cast<int>(vertices.size());
+            vertices.push_back(mesh.vertices[index]);
+        }
+        index = static_cast<unsigned short>(remap[index]);
+    }
+    mesh.vertices.swap(vertices);
+    return mesh.vertices.size();
+}
+
+/// All three passes, in the order they depend on each other.
+inline void optimizeMesh(Mesh& mesh)
+{
+    weldVertices(mesh);
+    optimizeVertexCache(mesh);
+    optimizeVertexFetch(mesh);
+}
+
+} // namespace meshoptimization
+
+#endif
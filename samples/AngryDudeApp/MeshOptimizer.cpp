@@ -0,0 +1,69 @@
+#include "Skinning.hpp"
+#include "MeshOptimization.hpp"
+#include "cereal/archives/binary.hpp"
+#include "cereal/types/vector.hpp"
+#include "cereal/types/string.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+/// Reports vertex cache efficiency (ACMR and ATVR for 16 and 32 entry FIFO
+/// caches) of every mesh in a .binmesh file, before and after the passes of
+/// MeshOptimization.hpp, and optionally writes the optimized model.
+/// Compiled with
+/// clang MeshOptimizer.cpp -o MeshOptimizer -O2 -Wall -std=c++11 -I. -I../../extensions/include/ -lstdc++ -lm
+/// and run as
+/// ./MeshOptimizer assets/dude.binmesh [optimized.binmesh]
+///
+
+void printStats(const char* label, const Mesh& mesh)
+{
+    const VertexCacheStats fifo16 = meshoptimization::analyzeVertexCache(mesh, 16);
+    const VertexCacheStats fifo32 = meshoptimization::analyzeVertexCache(mesh, 32);
+    std::printf("  %-10s %6u vertices %6u triangles  ACMR %.3f / %.3f  ATVR %.3f / %.3f\n", label,
+                unsigned(mesh.vertices.size()), unsigned(fifo16.numTriangles),
+                fifo16.acmr, fifo32.acmr, fifo16.atvr, fifo32.atvr);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 2 && argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <input.binmesh> [output.binmesh]" << std::endl;
+        return 1;
+    }
+
+    std::ifstream is(argv[1], std::ios::binary);
+    if (!is) {
+        std::cerr << "Cannot open " << argv[1] << std::endl;
+        return 1;
+    }
+    SkinnedModel model;
+    {
+        cereal::BinaryInputArchive iarchive(is);
+        iarchive(model);
+    }
+
+    std::printf("ACMR / ATVR for 16 / 32 entry FIFO caches\n");
+    size_t transformedBefore = 0, transformedAfter = 0;
+    for (Mesh& mesh: model.meshes) {
+        std::printf("%s\n", mesh.albedoTextureFilename.c_str());
+        printStats("original", mesh);
+        transformedBefore += meshoptimization::analyzeVertexCache(mesh).numTransformed;
+
+        meshoptimization::weldVertices(mesh);
+        printStats("welded", mesh);
+        meshoptimization::optimizeVertexCache(mesh);
+        meshoptimization::optimizeVertexFetch(mesh);
+        printStats("optimized", mesh);
+        transformedAfter += meshoptimization::analyzeVertexCache(mesh).numTransformed;
+    }
+    std::printf("Vertex shader invocations (16 entry FIFO): %u -> %u\n", unsigned(transformedBefore), unsigned(transformedAfter));
+
+    if (argc == 3) {
+        std::ofstream os(argv[2], std::ios::binary);
+        cereal::BinaryOutputArchive oarchive(os);
+        oarchive(model);
+    }
+    return 0;
+}
@@ -0,0 +1,207 @@
+#ifndef __PackedVertex_hpp__
+#define __PackedVertex_hpp__
+
+#include "Skinning.hpp"
+#include "NV/NvMath.h"
+#include "Half/half.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+/// \file PackedVertex.hpp
+/// \brief 20 byte skinned vertex, decoded in skinning.vert.
+///
+/// Vertex spends 48 bytes on full floats. PackedVertex keeps the same data in 20:
+///
+/// - position: unsigned 16-bit, normalized within the mesh's bounds; the shader
+///   rescales it with the mesh's PackedVertexBounds (positionOffset/positionScale)
+/// - normal:   octahedral encoding, two signed bytes read as c/127
+/// - bones:    four 8-bit bone indices
+/// - weights:  four 8-bit weights, normalized (they sum to 255)
+/// - uv:       half floats, passed to the shader as raw 16-bit patterns and
+///             decoded there, since ES 2 / WebGL have no half float attributes
+///
+/// Every attribute starts on a multiple of its component size. The decode
+/// functions here use the same arithmetic as the shader.
+
+struct PackedVertex
+{
+    uint16_t position[3];
+    int8_t   normal[2];
+    uint8_t  bones[4];
+    uint8_t  weights[4];
+    uint16_t uv[2];
+};
+
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex must stay tightly packed");
+
+/// \brief Maps quantized positions back into a mesh: offset + scale * q/65535.
+struct PackedVertexBounds
+{
+    nv::vec3f offset;
+    nv::vec3f scale;
+};
+
+namespace vertexpacking {
+
+/// Bounds of the given vertices. Flat extents get a scale of 1 so that
+/// positions stay finite.
+inline PackedVertexBounds computeBounds(const Vertex* vertices, size_t count)
+{
+    nv::vec3f lo(0.f, 0.f, 0.f), hi(0.f, 0.f, 0.f);
+    for (size_t i = 0; i < count; i++) {
+        const nv::vec3f& p = vertices[i].position;
+        if (i == 0)
+            lo = hi = p;
+        lo = nv::vec3f(std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z));
+        hi = nv::vec3f(std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z));
+    }
+    PackedVertexBounds bounds;
+    bounds.offset = lo;
+    bounds.scale = hi - lo;
+    for (int c = 0; c < 3; c++)
+        if (bounds.scale[c] <= 0.f)
+            bounds.scale[c] = 1.f;
+    return bounds;
+}
+
+inline uint16_t encodePosition(float value, float offset, float scale)
+{
+    const float q = std::floor((value - offset) / scale * 65535.f + 0.5f);
+    return static_cast<uint16_t>(std::min(std::max(q, 0.f), 65535.f));
+}
+
+inline nv::vec3f decodePosition(const uint16_t q[3], const PackedVertexBounds& bounds)
+{
+    return nv::vec3f(bounds.offset.x + bounds.scale.x * (q[0] / 65535.f),
+                     bounds.offset.y + bounds.scale.y * (q[1] / 65535.f),
+                     bounds.offset.z + bounds.scale.z * (q[2] / 65535.f));
+}
+
+inline nv::vec3f decodeOctahedral(const int8_t e[2])
+{
+    const float x = std::max(e[0] / 127.f, -1.f);
+    const float y = std::max(e[1] / 127.f, -1.f);
+    nv::vec3f v(x, y, 1.f - std::abs(x) - std::abs(y));
+    if (v.z < 0.f) {
+        v.x = (1.f - std::abs(y)) * (x < 0.f ? -1.f : 1.f);
+        v.y = (1.f - std::abs(x)) * (y < 0.f ? -1.f : 1.f);
+    }
+    return nv::normalize(v);
+}
+
+/// Octahedral encoding of a unit normal. Of the four roundings around the
+/// projected point, keeps the one that decodes closest to n.
+inline void encodeOctahedral(const nv::vec3f& n, int8_t e[2])
+{
+    const float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    float x = n.x / l1, y = n.y / l1;
+    if (n.z < 0.f) {
+        const float fx = (1.f - std::abs(y)) * (x < 0.f ? -1.f : 1.f);
+        const float fy = (1.f - std::abs(x)) * (y < 0.f ? -1.f : 1.f);
+        x = fx;
+        y = fy;
+    }
+
+    float bestDot = -2.f;
+    for (int i = 0; i < 4; i++) {
+        const float cx = (i & 1 ? std::ceil(x * 127.f) : std::floor(x * 127.f));
+        const float cy = (i & 2 ? std::ceil(y * 127.f) : std::floor(y * 127.f));
+        const int8_t candidate[2] = {static_cast<int8_t>(std::min(std::max(cx, -127.f), 127.f)),
+                                     static_cast<int8_t>(std::min(std::max(cy, -127.f), 127.f))};
+        const float d = nv::dot(decodeOctahedral(candidate), n);
+        if (d > bestDot) {
+            bestDot = d;
+            e[0] = candidate[0];
+            e[1] = candidate[1];
+        }
+    }
+}
+
+/// Splits Vertex::bones (index + fractional weight per component) into 8-bit
+/// indices and 8-bit weights that sum to exactly 255, rounding so that the
+/// largest remainders get the leftover units.
+inline void encodeInfluences(const nv::vec4f& packed, uint8_t bones[4], uint8_t weights[4])
+{
+    float w[4], total = 0.f;
+    for (int k = 0; k < 4; k++) {
+        const float index = std::floor(packed[k]);
+        bones[k] = static_cast<uint8_t>(index);
+        w[k] = packed[k] - index;
+        total += w[k];
+    }
+    if (total <= 0.f) {
+        w[0] = total = 1.f;
+    }
+
+    int sum = 0;
+    float remainder[4];
+    for (int k = 0; k < 4; k++) {
+        const float scaled = w[k] / total * 255.f;
+        weights[k] = static_cast<uint8_t>(std::floor(scaled));
+        remainder[k] = scaled - weights[k];
+        sum += weights[k];
+    }
+    for (; sum < 255; sum++) {
+        const int k = static_cast<int>(std::max_element(remainder, remainder + 4) - remainder);
+        weights[k]++;
+        remainder[k] = -1.f;
+    }
+}
+
+/// Half float to float with the arithmetic of halfToFloat in skinning.vert
+/// (infinities and NaNs are not expected in texture coordinates).
+inline float decodeHalf(uint16_t bits)
+{
+    const float h = bits;
+    const float s = h >= 32768.f ? -1.f : 1.f;
+    const float m = std::fmod(h, 32768.f);
+    const float e = std::floor(m / 1024.f);
+    const float f = m - e*1024.f;
+    if (e == 0.f)
+        return s * f * std::exp2(-24.f);
+    return s * std::exp2(e - 15.f) * (1.f + f / 1024.f);
+}
+
+inline PackedVertex packVertex(const Vertex& v, const PackedVertexBounds& bounds)
+{
+    PackedVertex p;
+    for (int c = 0; c < 3; c++)
+        p.position[c] = encodePosition(v.position[c], bounds.offset[c], bounds.scale[c]);
+    encodeOctahedral(nv::normalize(v.normal), p.normal);
+    encodeInfluences(v.bones, p.bones, p.weights);
+    p.uv[0] = half(v.uv.x).bits();
+    p.uv[1] = half(v.uv.y).bits();
+    return p;
+}
+
+/// Back to the float layout. Weights are stored as fractions, so a single full
+/// influence comes out as 0.999, the value the source meshes use.
+inline Vertex unpackVertex(const PackedVertex& p, const PackedVertexBounds& bounds)
+{
+    Vertex v;
+    v.position = decodePosition(p.position, bounds);
+    v.normal = decodeOctahedral(p.normal);
+    for (int k = 0; k < 4; k++)
+        v.bones[k] = p.bones[k] + std::min(p.weights[k] / 255.f, 0.999f);
+    v.uv = nv::vec2f(decodeHalf(p.uv[0]), decodeHalf(p.uv[1]));
+    return v;
+}
+
+inline void packVertices(const Vertex* in, size_t count, const PackedVertexBounds& bounds, PackedVertex* out)
+{
+    for (size_t i = 0; i < count; i++)
+        out[i] = packVertex(in[i], bounds);
+}
+
+inline void unpackVertices(const PackedVertex* in, size_t count, const PackedVertexBounds& bounds, Vertex* out)
+{
+    for (size_t i = 0; i < count; i++)
+        out[i] = unpackVertex(in[i], bounds);
+}
+
+} // namespace vertexpacking
+
+#endif
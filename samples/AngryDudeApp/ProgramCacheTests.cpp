@@ -0,0 +1,169 @@
+#include "NvGLUtils/NvGLSLProgramCache.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/// Compiled with
+/// clang ProgramCacheTests.cpp ../../extensions/src/NvGLUtils/NvGLSLProgramCache.cpp -o ProgramCacheTests -g3 -Wall -std=c++11 -DLINUX=1 -I. -I../../extensions/include/ -I../../extensions/externals/include/ -L./gtest/ -lgtest -lstdc++ -lpthread -lm
+///
+/// Caches write under a temporary directory, removed after each test.
+
+#include "gtest/gtest.h"
+
+static const int32_t VertexShader = 0x8B31;     // GL_VERTEX_SHADER
+static const int32_t FragmentShader = 0x8B30;   // GL_FRAGMENT_SHADER
+
+static uint64_t keyOf(const std::string& driver, const char* vert, const char* frag)
+{
+    const int32_t types[] = { VertexShader, FragmentShader };
+    const char* const sources[] = { vert, frag };
+    return NvGLSLProgramCache::computeKey(driver, types, sources, 2);
+}
+
+static NvGLSLProgramBinary makeBinary(size_t length, char seed)
+{
+    NvGLSLProgramBinary binary;
+    binary.format = 0x8E21;
+    binary.compileSeconds = 0.25f;
+    for (size_t i = 0; i < length; i++)
+        binary.data.push_back(char(seed + i * 13));
+    return binary;
+}
+
+TEST(ProgramCacheTest, KeyCoversDriverSourcesAndDefines)
+{
+    const char* vert = "void main() { gl_Position = vec4(0.0); }";
+    const char* frag = "void main() { gl_FragColor = vec4(1.0); }";
+    const uint64_t key = keyOf("NVIDIA\nGeForce\n4.5\n", vert, frag);
+    EXPECT_EQ(key, keyOf("NVIDIA\nGeForce\n4.5\n", vert, frag));
+
+    EXPECT_NE(key, keyOf("NVIDIA\nGeForce\n4.6\n", vert, frag));
+    EXPECT_NE(key, keyOf("NVIDIA\nGeForce\n4.5\n", frag, vert));
+    EXPECT_NE(key, keyOf("NVIDIA\nGeForce\n4.5\n", "#define MAX_INFLUENCES 2\nvoid main() { gl_Position = vec4(0.0); }", frag));
+
+    // Text moved from one stage to the next
+    EXPECT_NE(keyOf("", "ab", "c"), keyOf("", "a", "bc"));
+
+    const int32_t types[] = { FragmentShader, FragmentShader };
+    const char* const sources[] = { vert, frag };
+    EXPECT_NE(key, NvGLSLProgramCache::computeKey("NVIDIA\nGeForce\n4.5\n", types, sources, 2));
+}
+
+TEST(ProgramCacheTest, EncodeDecodeRoundTrip)
+{
+    const NvGLSLProgramBinary binary = makeBinary(1000, 3);
+    std::vector<char> file;
+    NvGLSLProgramCache::encode(42, binary, file);
+    ASSERT_EQ(sizeof(NvGLSLProgramCacheHeader) + 1000, file.size());
+
+    NvGLSLProgramBinary decoded;
+    ASSERT_TRUE(NvGLSLProgramCache::decode(42, file.data(), file.size(), decoded));
+    EXPECT_EQ(binary.format, decoded.format);
+    EXPECT_EQ(binary.compileSeconds, decoded.compileSeconds);
+    EXPECT_TRUE(binary.data == decoded.data);
+}
+
+TEST(ProgramCacheTest, DecodeRejectsDamagedFiles)
+{
+    std::vector<char> file;
+    NvGLSLProgramCache::encode(42, makeBinary(100, 5), file);
+    NvGLSLProgramBinary decoded;
+
+    EXPECT_FALSE(NvGLSLProgramCache::decode(43, file.data(), file.size(), decoded));
+    EXPECT_FALSE(NvGLSLProgramCache::decode(42, file.data(), file.size() - 1, decoded));
+    EXPECT_FALSE(NvGLSLProgramCache::decode(42, file.data(), sizeof(NvGLSLProgramCacheHeader) - 1, decoded));
+    EXPECT_FALSE(NvGLSLProgramCache::decode(42, NULL, 0, decoded));
+
+    std::vector<char> corrupt = file;
+    corrupt.back() ^= 1;
+    EXPECT_FALSE(NvGLSLProgramCache::decode(42, corrupt.data(), corrupt.size(), decoded));
+
+    std::vector<char> newer = file;
+    NvGLSLProgramCacheHeader header;
+    memcpy(&header, newer.data(), sizeof(header));
+    header.version++;
+    memcpy(&newer[0], &header, sizeof(header));
+    EXPECT_FALSE(NvGLSLProgramCache::decode(42, newer.data(), newer.size(), decoded));
+
+    std::vector<char> empty;
+    NvGLSLProgramCache::encode(42, makeBinary(0, 0), empty);
+    EXPECT_FALSE(NvGLSLProgramCache::decode(42, empty.data(), empty.size(), decoded));
+}
+
+// Points the cache at a directory the cache creates itself, under a temporary one.
+class ProgramCacheDirectoryTest : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        char dir[] = "/tmp/ProgramCacheTestsXXXXXX";
+        ASSERT_TRUE(mkdtemp(dir) != NULL);
+        mDir = dir;
+        mCacheDirectory = mDir + "/cache";
+    }
+
+    virtual void TearDown()
+    {
+        system(("rm -r " + mDir).c_str());
+    }
+
+    std::string mDir;
+    std::string mCacheDirectory;
+};
+
+TEST_F(ProgramCacheDirectoryTest, StoresLoadsAndRemovesFiles)
+{
+    NvGLSLProgramCache cache(mCacheDirectory.c_str());
+    const uint64_t key = keyOf("test driver", "vert", "frag");
+    cache.remove(key);
+
+    NvGLSLProgramBinary loaded;
+    EXPECT_FALSE(cache.load(key, loaded));
+
+    ASSERT_TRUE(cache.store(key, makeBinary(50000, 1)));
+    ASSERT_TRUE(cache.load(key, loaded));
+    EXPECT_TRUE(makeBinary(50000, 1).data == loaded.data);
+
+    // Replaced, with nothing left behind under the temporary name
+    ASSERT_TRUE(cache.store(key, makeBinary(10, 2)));
+    ASSERT_TRUE(cache.load(key, loaded));
+    EXPECT_EQ(10u, loaded.data.size());
+    FILE* fp = fopen((cache.getPath(key) + ".tmp").c_str(), "rb");
+    EXPECT_TRUE(fp == NULL);
+    if (fp)
+        fclose(fp);
+
+    // A second cache on the same directory, as on the next launch
+    NvGLSLProgramCache nextLaunch(mCacheDirectory.c_str());
+    EXPECT_TRUE(nextLaunch.load(key, loaded));
+
+    cache.remove(key);
+    EXPECT_FALSE(cache.load(key, loaded));
+    EXPECT_EQ(2u, cache.getStats().stored);
+}
+
+TEST_F(ProgramCacheDirectoryTest, CountsHitsMissesAndTimeSaved)
+{
+    NvGLSLProgramCache cache(mCacheDirectory.c_str());
+    cache.countMiss(0.5f, false);
+    cache.countMiss(0.25f, true);
+    cache.countHit(0.01f, 0.5f);
+    cache.countHit(0.02f, 0.25f);
+
+    const NvGLSLProgramCacheStats& stats = cache.getStats();
+    EXPECT_EQ(2u, stats.hits);
+    EXPECT_EQ(2u, stats.misses);
+    EXPECT_EQ(1u, stats.rejected);
+    EXPECT_EQ(0u, stats.stored);
+    EXPECT_FLOAT_EQ(0.75f, stats.compileSeconds);
+    EXPECT_FLOAT_EQ(0.03f, stats.loadSeconds);
+    EXPECT_FLOAT_EQ(0.72f, stats.savedSeconds);
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,304 @@
+#include "NvGLUtils/NvGLSLProgram.h"
+#include "NvGLUtils/NvGLSLProgramVariants.h"
+#include "NvAssetLoader/NvAssetLoader.h"
+#include <cstring>
+#include <string>
+#include <vector>
+
+/// Compiled with
+/// clang ProgramStateTests.cpp ../../extensions/src/NvGLUtils/NvGLSLProgram.cpp ../../extensions/src/NvGLUtils/NvGLSLProgramCache.cpp ../../extensions/src/NvGLUtils/NvGLSLProgramVariants.cpp -o ProgramStateTests -g3 -Wall -std=c++11 -DLINUX=1 -I. -I../../extensions/include/ -I../../extensions/externals/include/ -I../../extensions/externals/include/GLFW/ -L./gtest/ -lgtest -lstdc++ -lpthread -lm
+///
+/// Runs NvGLSLProgram against a fake GL that counts the calls it gets.
+
+#include "gtest/gtest.h"
+
+namespace {
+
+struct FakeGL
+{
+    GLuint nextName;
+    GLuint boundProgram;
+    int useProgramCalls;
+    int uniformCalls;
+} gl;
+
+std::vector<std::string> shaderSources;     // In the order given
+std::vector<std::string> attribBindings;    // "<program> <location> <name>"
+
+void resetFakeGL()
+{
+    memset(&gl, 0, sizeof(gl));
+    gl.nextName = 1;
+    shaderSources.clear();
+    attribBindings.clear();
+}
+
+// Programs and shaders compile and link; nothing else is tracked.
+GLuint GLAPIENTRY createShader(GLenum) { return gl.nextName++; }
+GLuint GLAPIENTRY createProgram() { return gl.nextName++; }
+void GLAPIENTRY shaderSource(GLuint, GLsizei, const GLchar** source, const GLint*) { shaderSources.push_back(source[0]); }
+void GLAPIENTRY bindAttribLocation(GLuint program, GLuint location, const GLchar* name)
+{
+    attribBindings.push_back(std::to_string(program) + " " + std::to_string(location) + " " + name);
+}
+void GLAPIENTRY compileShader(GLuint) {}
+void GLAPIENTRY attachShader(GLuint, GLuint) {}
+void GLAPIENTRY deleteShader(GLuint) {}
+void GLAPIENTRY deleteProgram(GLuint) {}
+void GLAPIENTRY linkProgram(GLuint) {}
+void GLAPIENTRY getShaderiv(GLuint, GLenum, GLint* value) { *value = 1; }
+void GLAPIENTRY getProgramiv(GLuint, GLenum pname, GLint* value) { *value = (pname == GL_LINK_STATUS) ? 1 : 0; }
+void GLAPIENTRY getInfoLog(GLuint, GLsizei, GLsizei*, GLchar*) {}
+GLint GLAPIENTRY getLocation(GLuint, const GLchar*) { return 0; }
+void GLAPIENTRY activeTexture(GLenum) {}
+void GLAPIENTRY useProgram(GLuint program) { gl.boundProgram = program; gl.useProgramCalls++; }
+void GLAPIENTRY uniform1i(GLint, GLint) { gl.uniformCalls++; }
+void GLAPIENTRY uniform2i(GLint, GLint, GLint) { gl.uniformCalls++; }
+void GLAPIENTRY uniform3i(GLint, GLint, GLint, GLint) { gl.uniformCalls++; }
+void GLAPIENTRY uniform1f(GLint, GLfloat) { gl.uniformCalls++; }
+void GLAPIENTRY uniform2f(GLint, GLfloat, GLfloat) { gl.uniformCalls++; }
+void GLAPIENTRY uniform3f(GLint, GLfloat, GLfloat, GLfloat) { gl.uniformCalls++; }
+void GLAPIENTRY uniform4f(GLint, GLfloat, GLfloat, GLfloat, GLfloat) { gl.uniformCalls++; }
+void GLAPIENTRY uniformfv(GLint, GLsizei, const GLfloat*) { gl.uniformCalls++; }
+void GLAPIENTRY uniformMatrix4fv(GLint, GLsizei, GLboolean, const GLfloat*) { gl.uniformCalls++; }
+
+} // namespace
+
+// The GLEW entry points NvGLSLProgram uses; no program binaries.
+extern "C" {
+PFNGLCREATESHADERPROC __glewCreateShader = createShader;
+PFNGLCREATEPROGRAMPROC __glewCreateProgram = createProgram;
+PFNGLSHADERSOURCEPROC __glewShaderSource = shaderSource;
+PFNGLCOMPILESHADERPROC __glewCompileShader = compileShader;
+PFNGLATTACHSHADERPROC __glewAttachShader = attachShader;
+PFNGLDELETESHADERPROC __glewDeleteShader = deleteShader;
+PFNGLDELETEPROGRAMPROC __glewDeleteProgram = deleteProgram;
+PFNGLLINKPROGRAMPROC __glewLinkProgram = linkProgram;
+PFNGLBINDATTRIBLOCATIONPROC __glewBindAttribLocation = bindAttribLocation;
+PFNGLGETSHADERIVPROC __glewGetShaderiv = getShaderiv;
+PFNGLGETPROGRAMIVPROC __glewGetProgramiv = getProgramiv;
+PFNGLGETSHADERINFOLOGPROC __glewGetShaderInfoLog = getInfoLog;
+PFNGLGETPROGRAMINFOLOGPROC __glewGetProgramInfoLog = getInfoLog;
+PFNGLGETATTRIBLOCATIONPROC __glewGetAttribLocation = getLocation;
+PFNGLGETUNIFORMLOCATIONPROC __glewGetUniformLocation = getLocation;
+PFNGLACTIVETEXTUREPROC __glewActiveTexture = activeTexture;
+PFNGLUSEPROGRAMPROC __glewUseProgram = useProgram;
+PFNGLUNIFORM1IPROC __glewUniform1i = uniform1i;
+PFNGLUNIFORM2IPROC __glewUniform2i = uniform2i;
+PFNGLUNIFORM3IPROC __glewUniform3i = uniform3i;
+PFNGLUNIFORM1FPROC __glewUniform1f = uniform1f;
+PFNGLUNIFORM2FPROC __glewUniform2f = uniform2f;
+PFNGLUNIFORM3FPROC __glewUniform3f = uniform3f;
+PFNGLUNIFORM4FPROC __glewUniform4f = uniform4f;
+PFNGLUNIFORM3FVPROC __glewUniform3fv = uniformfv;
+PFNGLUNIFORM4FVPROC __glewUniform4fv = uniformfv;
+PFNGLUNIFORMMATRIX4FVPROC __glewUniformMatrix4fv = uniformMatrix4fv;
+PFNGLGETPROGRAMBINARYPROC __glewGetProgramBinary = NULL;
+PFNGLPROGRAMBINARYPROC __glewProgramBinary = NULL;
+PFNGLPROGRAMPARAMETERIPROC __glewProgramParameteri = NULL;
+
+void GLAPIENTRY glBindTexture(GLenum, GLuint) {}
+GLenum GLAPIENTRY glGetError() { return GL_NO_ERROR; }
+void GLAPIENTRY glGetIntegerv(GLenum, GLint* value) { *value = 0; }
+const GLubyte* GLAPIENTRY glGetString(GLenum) { return reinterpret_cast<const GLubyte*>(""); }
+}
+
+char* NvAssetLoaderRead(const char*, int32_t& length) { length = 0; return NULL; }
+bool NvAssetLoaderFree(char*) { return true; }
+
+class ProgramStateTest : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        resetFakeGL();
+        NvGLSLProgram::resetShadowState();
+        NvGLSLProgram::resetCallStats();
+        a = NvGLSLProgram::createFromStrings("vert a", "frag a");
+        b = NvGLSLProgram::createFromStrings("vert b", "frag b");
+        ASSERT_TRUE(a && b);
+    }
+
+    virtual void TearDown()
+    {
+        delete a;
+        delete b;
+    }
+
+    NvGLSLProgram* a;
+    NvGLSLProgram* b;
+};
+
+TEST_F(ProgramStateTest, EnableSkipsTheBoundProgram)
+{
+    a->enable();
+    a->setUniform1f(0, 1.f);
+    a->disable();
+    a->enable();
+    a->disable();
+    EXPECT_EQ(1, gl.useProgramCalls);
+    EXPECT_EQ(a->getProgram(), gl.boundProgram);
+
+    b->enable();
+    a->enable();
+    EXPECT_EQ(3, gl.useProgramCalls);
+    EXPECT_EQ(a->getProgram(), gl.boundProgram);
+
+    NvGLSLProgram::useProgram(0);
+    EXPECT_EQ(0u, gl.boundProgram);
+    NvGLSLProgram::useProgram(0);
+    EXPECT_EQ(4, gl.useProgramCalls);
+
+    const NvGLSLProgramCallStats& stats = NvGLSLProgram::getCallStats();
+    EXPECT_EQ(4u, stats.programsIssued);
+    EXPECT_EQ(2u, stats.programsSkipped);
+}
+
+TEST_F(ProgramStateTest, ResetShadowStateRebinds)
+{
+    a->enable();
+    // As after a context loss, or foreign code calling glUseProgram.
+    gl.boundProgram = 0;
+    NvGLSLProgram::resetShadowState();
+    a->enable();
+    EXPECT_EQ(2, gl.useProgramCalls);
+    EXPECT_EQ(a->getProgram(), gl.boundProgram);
+}
+
+TEST_F(ProgramStateTest, DeletingTheBoundProgramUnbindsIt)
+{
+    a->enable();
+    a->disable();
+    delete a;
+    a = NULL;
+    EXPECT_EQ(0u, gl.boundProgram);
+    b->enable();
+    EXPECT_EQ(b->getProgram(), gl.boundProgram);
+}
+
+TEST_F(ProgramStateTest, UnchangedUniformsAreNotUploaded)
+{
+    a->enable();
+    float mvp[16] = { 1.f, 0.f, 0.f, 0.f,  0.f, 1.f, 0.f, 0.f,  0.f, 0.f, 1.f, 0.f,  0.f, 0.f, 0.f, 1.f };
+    std::vector<float> palette(60 * 16, 0.5f);
+    for (int frame = 0; frame < 3; frame++) {
+        a->setUniformMatrix4fv(0, mvp, 1, false);
+        a->setUniform1i(1, 1);
+        a->setUniformMatrix4fv(2, palette.data(), 60, false);
+        a->setUniform3f(70, 1.f, 2.f, 3.f);
+    }
+    EXPECT_EQ(4, gl.uniformCalls);
+
+    mvp[12] = 5.f;
+    a->setUniformMatrix4fv(0, mvp, 1, false);
+    a->setUniformMatrix4fv(0, mvp, 1, true);    // transposed is another value
+    a->setUniform1i(1, 0);
+    a->setUniform1f(1, 0.f);                    // so is another type
+    palette[60 * 16 - 1] = 0.f;
+    a->setUniformMatrix4fv(2, palette.data(), 60, false);
+    a->setUniformMatrix4fv(2, palette.data(), 59, false);
+    EXPECT_EQ(10, gl.uniformCalls);
+
+    const NvGLSLProgramCallStats& stats = NvGLSLProgram::getCallStats();
+    EXPECT_EQ(10u, stats.uniformsIssued);
+    EXPECT_EQ(8u, stats.uniformsSkipped);
+}
+
+TEST_F(ProgramStateTest, UniformsAreShadowedPerProgram)
+{
+    a->enable();
+    a->setUniform4f(0, 1.f, 2.f, 3.f, 4.f);
+    b->enable();
+    b->setUniform4f(0, 1.f, 2.f, 3.f, 4.f);
+    a->enable();
+    a->setUniform4f(0, 1.f, 2.f, 3.f, 4.f);
+    EXPECT_EQ(2, gl.uniformCalls);
+
+    // Relinking resets the program's uniforms.
+    a->relink();
+    a->setUniform4f(0, 1.f, 2.f, 3.f, 4.f);
+    EXPECT_EQ(3, gl.uniformCalls);
+}
+
+TEST_F(ProgramStateTest, ArrayUploadsInvalidateTheElementsTheyCover)
+{
+    a->enable();
+    const float elements[3 * 4] = { 0.f, 0.f, 0.f, 0.f,  1.f, 1.f, 1.f, 1.f,  2.f, 2.f, 2.f, 2.f };
+    a->setUniform4f(11, 1.f, 1.f, 1.f, 1.f);   // element 1 on its own
+    a->setUniform4fv(10, elements, 3);         // then the whole array
+    a->setUniform4f(11, 1.f, 1.f, 1.f, 1.f);   // the same value, but no longer known
+    EXPECT_EQ(3, gl.uniformCalls);
+
+    a->setUniform4fv(10, elements, 3);         // element 1 was set since
+    EXPECT_EQ(4, gl.uniformCalls);
+    a->setUniform4f(12, 0.f, 0.f, 0.f, 0.f);   // an element in the array's range
+    a->setUniform4fv(10, elements, 3);
+    EXPECT_EQ(6, gl.uniformCalls);
+    a->setUniform4fv(10, elements, 3);
+    EXPECT_EQ(6, gl.uniformCalls);
+}
+
+TEST_F(ProgramStateTest, SamplerUnitsAreShadowed)
+{
+    a->enable();
+    a->bindTexture2D(3, 0, 7);
+    a->bindTexture2D(3, 0, 8);
+    a->bindTexture2D(3, 1, 8);
+    EXPECT_EQ(2, gl.uniformCalls);
+}
+
+TEST(ProgramVariantsTest, AddDefinesFollowsVersion)
+{
+    const char* const defines[] = { "BLEND_DQ", "MAX_INFLUENCES 2" };
+    EXPECT_EQ("#version 100\n#define BLEND_DQ\n#define MAX_INFLUENCES 2\n\nvoid main() {}\n",
+              NvGLSLProgram::addDefines("#version 100\n\nvoid main() {}\n", defines, 2));
+    EXPECT_EQ("\n  #version 100\n#define BLEND_DQ\nvoid main() {}",
+              NvGLSLProgram::addDefines("\n  #version 100\nvoid main() {}", defines, 1));
+    EXPECT_EQ("#version 100\n#define BLEND_DQ\n", NvGLSLProgram::addDefines("#version 100", defines, 1));
+    // Without a leading #version the defines go first.
+    EXPECT_EQ("#define BLEND_DQ\nvoid main() {}\n// #version 100\n",
+              NvGLSLProgram::addDefines("void main() {}\n// #version 100\n", defines, 1));
+    EXPECT_EQ("#version 100\nvoid main() {}", NvGLSLProgram::addDefines("#version 100\nvoid main() {}", defines, 0));
+}
+
+TEST(ProgramVariantsTest, VariantsAreCompiledOnceWithTheirDefines)
+{
+    resetFakeGL();
+    NvGLSLProgramVariants variants;
+    variants.setSourceFromStrings("#version 100\nvert", "#version 100\nfrag");
+    const char* const attributes[] = { "position", "normal" };
+    variants.setAttribLocations(attributes, 2);
+
+    const char* const dq[] = { "MAX_INFLUENCES 1", "BLEND_DQ" };
+    const char* const lbs[] = { "MAX_INFLUENCES 1" };
+    NvGLSLProgram* first = variants.get(dq, 2);
+    ASSERT_TRUE(first != NULL);
+    EXPECT_EQ(first, variants.get(dq, 2));
+    NvGLSLProgram* second = variants.get(lbs, 1);
+    ASSERT_TRUE(second != NULL);
+    EXPECT_NE(first, second);
+    EXPECT_EQ(2u, variants.size());
+
+    ASSERT_EQ(4u, shaderSources.size());
+    EXPECT_EQ("#version 100\n#define MAX_INFLUENCES 1\n#define BLEND_DQ\nvert", shaderSources[0]);
+    EXPECT_EQ("#version 100\n#define MAX_INFLUENCES 1\n#define BLEND_DQ\nfrag", shaderSources[1]);
+    EXPECT_EQ("#version 100\n#define MAX_INFLUENCES 1\nvert", shaderSources[2]);
+
+    // Both variants get the same locations, before they are linked.
+    const std::string p1 = std::to_string(first->getProgram()), p2 = std::to_string(second->getProgram());
+    ASSERT_EQ(4u, attribBindings.size());
+    EXPECT_EQ(p1 + " 0 position", attribBindings[0]);
+    EXPECT_EQ(p1 + " 1 normal", attribBindings[1]);
+    EXPECT_EQ(p2 + " 0 position", attribBindings[2]);
+    EXPECT_EQ(p2 + " 1 normal", attribBindings[3]);
+
+    // New sources drop the old variants.
+    variants.setSourceFromStrings("#version 100\nvert2", "#version 100\nfrag2");
+    EXPECT_EQ(0u, variants.size());
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
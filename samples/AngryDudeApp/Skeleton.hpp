@@ -0,0 +1,228 @@
+#ifndef __Skeleton_hpp__
+#define __Skeleton_hpp__
+
+#include "Skinning.hpp"
+#include "DualQuaternion.hpp"
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// \file Skeleton.hpp
+/// \brief Flat, topologically sorted node hierarchy.
+///
+/// SkinnedModel::modelNodes is a tree stored as per-node child index lists, which
+/// has to be walked with a queue or a stack. Skeleton is built once from it: nodes
+/// are renumbered in depth-first preorder so that every parent comes before all of
+/// its descendants, and the tree is reduced to one parent index per node. Global
+/// (model space) transforms then follow from local ones in a single linear pass
+/// over contiguous arrays, without recursion, queues or allocations:
+///
+///     global[i] = global[parents[i]] * local[i]
+///
+/// The same layout serves nv::matrix4f and DualQuaternion transforms, see
+/// SkeletonPose and computeGlobalTransforms.
+///
+/// Most of a rig does not change from frame to frame: bone offsets are constant,
+/// helper nodes without animation keep their default transform and whole subtrees
+/// above the first animated node are fixed. SkeletonCache converts all of that to
+/// both representations once, so per frame only animated nodes and their
+/// descendants are evaluated and no matrix is converted to a dual quaternion.
+
+/// \brief Node hierarchy of a SkinnedModel, flattened in topological order.
+/// All arrays are indexed by flat node index.
+struct Skeleton
+{
+    std::vector<int> parents;              ///< Flat index of the parent, -1 for the root.
+    std::vector<int> modelNodeIndices;     ///< Index into SkinnedModel::modelNodes.
+    std::vector<int> boneIndices;          ///< ModelNode::boneIdx (-1 if the node has no bone).
+    std::vector<int> nodeAnimationIndices; ///< ModelNode::nodeAnimationIdx (-1 if not animated).
+    std::vector<nv::matrix4f> defaultTransforms; ///< ModelNode::defaultTransform.
+
+    size_t size() const { return parents.size(); }
+
+    /// Flattens the hierarchy below modelNodes[rootNodeIdx] (node 0 is the root in
+    /// models exported for this sample).
+    static Skeleton fromModel(const SkinnedModel& model, int rootNodeIdx = 0)
+    {
+        Skeleton skeleton;
+        const size_t numNodes = model.modelNodes.size();
+        skeleton.parents.reserve(numNodes);
+        skeleton.modelNodeIndices.reserve(numNodes);
+        skeleton.boneIndices.reserve(numNodes);
+        skeleton.nodeAnimationIndices.reserve(numNodes);
+        skeleton.defaultTransforms.reserve(numNodes);
+
+        // Depth-first preorder keeps every subtree contiguous.
+        typedef std::pair<int, int> NodeIdxParentFlatIdx;
+        std::vector<NodeIdxParentFlatIdx> stack{std::make_pair(rootNodeIdx, -1)};
+        while (!stack.empty()) {
+            const NodeIdxParentFlatIdx top = stack.back();
+            stack.pop_back();
+
+            const ModelNode& node = model.modelNodes[top.first];
+            const int flatIdx = static_cast<int>(skeleton.parents.size());
+            skeleton.parents.push_back(top.second);
+            skeleton.modelNodeIndices.push_back(top.first);
+            skeleton.boneIndices.push_back(node.boneIdx);
+            skeleton.nodeAnimationIndices.push_back(node.nodeAnimationIdx);
+            skeleton.defaultTransforms.push_back(node.defaultTransform);
+
+            // Pushed in reverse so that children are visited in their original order.
+            for (auto child = node.childrenIndices.rbegin(); child != node.childrenIndices.rend(); ++child)
+                stack.push_back(std::make_pair(*child, flatIdx));
+        }
+        return skeleton;
+    }
+};
+
+/// Flat index of the node of model called name, -1 if there is none.
+inline int findNode(const Skeleton& skeleton, const SkinnedModel& model, const std::string& name)
+{
+    for (size_t i = 0; i < skeleton.size(); i++)
+        if (model.modelNodes[skeleton.modelNodeIndices[i]].name == name)
+            return static_cast<int>(i);
+    return -1;
+}
+
+/// \brief Local and global transforms of every Skeleton node, T being
+/// nv::matrix4f or DualQuaternion.
+template <typename T>
+struct SkeletonPose
+{
+    std::vector<T> local;
+    std::vector<T> global;
+
+    explicit SkeletonPose(size_t numNodes = 0): local(numNodes), global(numNodes) {}
+
+    void resize(size_t numNodes)
+    {
+        local.resize(numNodes);
+        global.resize(numNodes);
+    }
+};
+
+/// Computes global transforms from local ones for all nodes of skeleton.
+/// global and local may not alias.
+template <typename T>
+inline void computeGlobalTransforms(const Skeleton& skeleton, const T* local, T* global)
+{
+    const int* parents = skeleton.parents.data();
+    const size_t numNodes = skeleton.size();
+    for (size_t i = 0; i < numNodes; i++) {
+        const int parent = parents[i];
+        global[i] = parent < 0 ? local[i] : global[parent] * local[i];
+    }
+}
+
+template <typename T>
+inline void computeGlobalTransforms(const Skeleton& skeleton, SkeletonPose<T>& pose)
+{
+    computeGlobalTransforms(skeleton, pose.local.data(), pose.global.data());
+}
+
+/// Converts a transform stored as a matrix to the representation T.
+inline void convertTransform(const nv::matrix4f& m, nv::matrix4f& out) { out = m; }
+inline void convertTransform(const nv::matrix4f& m, DualQuaternion& out) { out = DualQuaternion::fromMatrix(m); }
+
+/// \brief Constant transforms of a skeleton in one representation.
+template <typename T>
+struct SkeletonTransforms
+{
+    std::vector<T> defaultLocal; ///< Skeleton::defaultTransforms, per flat node.
+    std::vector<T> staticGlobal; ///< Global transforms of the default pose (valid for static nodes).
+    std::vector<T> boneOffsets;  ///< Bone::offset, per bone.
+
+    void build(const Skeleton& skeleton, const std::vector<Bone>& bones)
+    {
+        defaultLocal.resize(skeleton.size());
+        staticGlobal.resize(skeleton.size());
+        boneOffsets.resize(bones.size());
+        for (size_t i = 0; i < skeleton.size(); i++)
+            convertTransform(skeleton.defaultTransforms[i], defaultLocal[i]);
+        for (size_t i = 0; i < bones.size(); i++)
+            convertTransform(bones[i].offset, boneOffsets[i]);
+        computeGlobalTransforms(skeleton, defaultLocal.data(), staticGlobal.data());
+    }
+};
+
+/// \brief Everything about a Skeleton that is constant over time, in matrix and
+/// dual quaternion form.
+///
+/// A node is static when neither it nor any of its ancestors is animated; its
+/// global transform is then the one of the default pose. The remaining (dynamic)
+/// nodes are listed in topological order, together with the subset that carries
+/// animation. Initialize poses with initPose() and evaluate them with
+/// computeGlobalTransforms(skeleton, cache, pose).
+struct SkeletonCache
+{
+    std::vector<int> dynamicNodes;  ///< Flat indices of non-static nodes, parents first.
+    std::vector<int> animatedNodes; ///< Flat indices of nodes with a NodeAnimation.
+    std::vector<int> boneNodes;     ///< Flat node index of every bone (-1 if unused).
+    SkeletonTransforms<nv::matrix4f>   matrices;
+    SkeletonTransforms<DualQuaternion> dualQuaternions;
+
+    static SkeletonCache fromSkeleton(const Skeleton& skeleton, const std::vector<Bone>& bones)
+    {
+        SkeletonCache cache;
+        std::vector<char> dynamic(skeleton.size(), 0);
+        cache.boneNodes.assign(bones.size(), -1);
+        for (size_t i = 0; i < skeleton.size(); i++) {
+            const int parent = skeleton.parents[i];
+            const bool animated = skeleton.nodeAnimationIndices[i] != -1;
+            dynamic[i] = animated || (parent >= 0 && dynamic[parent]);
+            if (dynamic[i])
+                cache.dynamicNodes.push_back(static_cast<int>(i));
+            if (animated)
+                cache.animatedNodes.push_back(static_cast<int>(i));
+            const int boneIdx = skeleton.boneIndices[i];
+            if (boneIdx >= 0 && static_cast<size_t>(boneIdx) < bones.size())
+                cache.boneNodes[boneIdx] = static_cast<int>(i);
+        }
+        cache.matrices.build(skeleton, bones);
+        cache.dualQuaternions.build(skeleton, bones);
+        return cache;
+    }
+
+    template <typename T> const SkeletonTransforms<T>& get() const;
+
+    /// Sizes pose for the skeleton and fills in everything that never changes:
+    /// default local transforms and global transforms of static nodes.
+    template <typename T>
+    void initPose(SkeletonPose<T>& pose) const
+    {
+        const SkeletonTransforms<T>& transforms = get<T>();
+        pose.local = transforms.defaultLocal;
+        pose.global = transforms.staticGlobal;
+    }
+};
+
+template <>
+inline const SkeletonTransforms<nv::matrix4f>& SkeletonCache::get<nv::matrix4f>() const
+{
+    return matrices;
+}
+
+template <>
+inline const SkeletonTransforms<DualQuaternion>& SkeletonCache::get<DualQuaternion>() const
+{
+    return dualQuaternions;
+}
+
+/// Updates global transforms of the dynamic nodes of a pose set up with
+/// SkeletonCache::initPose. Only local transforms of animated nodes are expected
+/// to change between calls.
+template <typename T>
+inline void computeGlobalTransforms(const Skeleton& skeleton, const SkeletonCache& cache, SkeletonPose<T>& pose)
+{
+    const int* parents = skeleton.parents.data();
+    const T* local = pose.local.data();
+    T* global = pose.global.data();
+    for (int i: cache.dynamicNodes) {
+        const int parent = parents[i];
+        global[i] = parent < 0 ? local[i] : global[parent] * local[i];
+    }
+}
+
+#endif
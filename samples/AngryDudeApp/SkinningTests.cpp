@@ -0,0 +1,992 @@
+#include "CpuSkinning.hpp"
+#include "Skeleton.hpp"
+#include "Crowd.hpp"
+#include "BinaryModel.hpp"
+#include "PackedVertex.hpp"
+#include "MeshOptimization.hpp"
+#include "InfluenceSplit.hpp"
+#include "InfluencePruning.hpp"
+#include "BonePartitioning.hpp"
+#include "NV/NvMath.h"
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+/// Compiled with
+/// clang SkinningTests.cpp ../../extensions/src/NvAppBase/NvJobSystem.cpp ../../extensions/externals/src/R3/thread.cpp ../../extensions/externals/src/Half/half.cpp -o SkinningTests -g3 -Wall -std=c++11 -I. -I../../extensions/include/ -I../../extensions/externals/include/ -L./gtest/ -lgtest -lstdc++ -lpthread -lm
+///
+
+std::ostream& operator<<(std::ostream& os, const nv::vec3f& v)
+{
+    os << "(" << v.x << ", " << v.y << ", "  << v.z << ")";
+    return os;
+}
+
+// Included here in order for stream << operators to be visible.
+#include "gtest/gtest.h"
+
+::testing::AssertionResult Vec3Near(const nv::vec3f& a, const nv::vec3f& b, float eps = 0.0001f)
+{
+    if (std::abs(a.x-b.x) < eps &&
+        std::abs(a.y-b.y) < eps &&
+        std::abs(a.z-b.z) < eps)
+        return ::testing::AssertionSuccess();
+    else
+        return ::testing::AssertionFailure() << "Vectors not equal:" << a << "  and  " << b;
+}
+
+const int numTestBones = 7;
+
+void makeTestPalettes(std::vector<DualQuaternion>& dqs, std::vector<nv::matrix4f>& matrices)
+{
+    for (int i = 0; i < numTestBones; i++) {
+        const nv::vec3f axis = nv::normalize(nv::vec3f(1.f + i, -1.f, 0.5f*i));
+        const nv::vec3f trans(0.3f*i, -1.f + i, 2.f);
+        dqs.push_back(DualQuaternion(trans, Quaternion(axis, 0.4f*i - 1.f)));
+        matrices.push_back(DualQuaternion::toMatrix<nv::matrix4f>(dqs.back()));
+    }
+}
+
+// Packs up to four (bone, weight) influences the way the exporter does.
+nv::vec4f packBones(int b0, float w0, int b1 = 0, float w1 = 0.f,
+                    int b2 = 0, float w2 = 0.f, int b3 = 0, float w3 = 0.f)
+{
+    return nv::vec4f(b0 + w0, b1 + w1, b2 + w2, b3 + w3);
+}
+
+std::vector<Vertex> makeTestVertices(int count)
+{
+    std::vector<Vertex> vertices(count);
+    for (int i = 0; i < count; i++) {
+        Vertex& v = vertices[i];
+        v.position = nv::vec3f(0.1f*i, 1.f - 0.05f*i, 0.3f);
+        v.normal = nv::normalize(nv::vec3f(1.f, 0.2f*i, -0.5f));
+        v.bones = packBones(i % numTestBones, 0.5f,
+                            (i + 1) % numTestBones, 0.25f,
+                            (i + 3) % numTestBones, 0.125f,
+                            (i + 5) % numTestBones, 0.125f);
+        v.uv = nv::vec2f(0.01f*i, 0.5f);
+    }
+    return vertices;
+}
+
+TEST(CpuSkinningTest, SingleInfluenceMatchesRigidTransform)
+{
+    std::vector<DualQuaternion> dqs;
+    std::vector<nv::matrix4f> matrices;
+    makeTestPalettes(dqs, matrices);
+
+    Vertex v;
+    v.position = nv::vec3f(1.f, -2.f, 0.5f);
+    v.normal = nv::vec3f(0.f, 1.f, 0.f);
+    // The weight is stored in the fractional part, so "1" is just below 1.
+    v.bones = packBones(3, 0.99999f);
+    v.uv = nv::vec2f(0.f, 0.f);
+
+    const nv::vec3f expected = nv::vec3f(matrices[3] * nv::vec4f(v.position, 1.f));
+    EXPECT_TRUE(Vec3Near(expected, cpuskinning::skinVertex(v, dqs.data()).position, 0.001f));
+    EXPECT_TRUE(Vec3Near(expected, cpuskinning::skinVertex(v, matrices.data()).position, 0.001f));
+}
+
+TEST(CpuSkinningTest, BatchedKernelsMatchReference)
+{
+    std::vector<DualQuaternion> dqs;
+    std::vector<nv::matrix4f> matrices;
+    makeTestPalettes(dqs, matrices);
+
+    const int count = 4*FloatN::Width + 3;
+    const std::vector<Vertex> in = makeTestVertices(count);
+    std::vector<Vertex> outDQB(count), outLBS(count);
+    cpuskinning::skinVerticesDQB(in.data(), outDQB.data(), count, dqs.data());
+    cpuskinning::skinVerticesLBS(in.data(), outLBS.data(), count, matrices.data());
+
+    for (int i = 0; i < count; i++) {
+        const Vertex dqb = cpuskinning::skinVertex(in[i], dqs.data());
+        const Vertex lbs = cpuskinning::skinVertex(in[i], matrices.data());
+        EXPECT_TRUE(Vec3Near(dqb.position, outDQB[i].position));
+        EXPECT_TRUE(Vec3Near(dqb.normal, outDQB[i].normal));
+        EXPECT_TRUE(Vec3Near(lbs.position, outLBS[i].position));
+        EXPECT_TRUE(Vec3Near(lbs.normal, outLBS[i].normal));
+        EXPECT_EQ(in[i].bones, outDQB[i].bones);
+        EXPECT_EQ(in[i].uv, outLBS[i].uv);
+    }
+}
+
+TEST(CpuSkinningTest, MultithreadedMatchesSingleThreaded)
+{
+    std::vector<DualQuaternion> dqs;
+    std::vector<nv::matrix4f> matrices;
+    makeTestPalettes(dqs, matrices);
+
+    Mesh mesh;
+    mesh.vertices = makeTestVertices(10007);
+    std::vector<Vertex> serial(mesh.vertices.size()), parallel(mesh.vertices.size());
+
+    NvJobSystem workers(4);
+    const CpuSkinning single;
+    const CpuSkinning multi(&workers, 256);
+    for (int pass = 0; pass < 3; pass++) {
+        single.skin(mesh, serial.data(), dqs.data());
+        multi.skin(mesh, parallel.data(), dqs.data());
+        for (size_t i = 0; i < serial.size(); i++)
+            ASSERT_EQ(serial[i].position, parallel[i].position);
+
+        single.skin(mesh, serial.data(), matrices.data());
+        multi.skin(mesh, parallel.data(), matrices.data());
+        for (size_t i = 0; i < serial.size(); i++)
+            ASSERT_EQ(serial[i].position, parallel[i].position);
+    }
+}
+
+/// Small hierarchy whose children are listed out of index order:
+/// 0 -> {3, 1}, 3 -> {2}, 1 -> {4, 5}.
+SkinnedModel makeTestModel()
+{
+    const int children[][2] = {{3, 1}, {4, 5}, {-1, -1}, {2, -1}, {-1, -1}, {-1, -1}};
+    SkinnedModel model;
+    for (int i = 0; i < 6; i++) {
+        ModelNode node;
+        for (int c: children[i])
+            if (c != -1)
+                node.childrenIndices.push_back(c);
+        node.defaultTransform = DualQuaternion::toMatrix<nv::matrix4f>(
+            DualQuaternion(nv::vec3f(0.5f*i, 1.f, -0.2f*i), Quaternion(nv::normalize(nv::vec3f(1.f, i, 1.f)), 0.3f*i)));
+        node.nodeAnimationIdx = -1;
+        node.boneIdx = i % 2 ? i/2 : -1;
+        model.modelNodes.push_back(node);
+    }
+    return model;
+}
+
+void recursiveGlobalTransforms(const SkinnedModel& model, int nodeIdx, const nv::matrix4f& parent,
+                               std::vector<nv::matrix4f>& globals)
+{
+    const ModelNode& node = model.modelNodes[nodeIdx];
+    globals[nodeIdx] = parent * node.defaultTransform;
+    for (int child: node.childrenIndices)
+        recursiveGlobalTransforms(model, child, globals[nodeIdx], globals);
+}
+
+TEST(SkeletonTest, FlatEvaluationMatchesHierarchy)
+{
+    const SkinnedModel model = makeTestModel();
+    const Skeleton skeleton = Skeleton::fromModel(model);
+    ASSERT_EQ(model.modelNodes.size(), skeleton.size());
+    EXPECT_EQ(-1, skeleton.parents[0]);
+    for (size_t i = 1; i < skeleton.size(); i++) {
+        EXPECT_LE(0, skeleton.parents[i]);
+        EXPECT_LT(skeleton.parents[i], static_cast<int>(i));
+    }
+
+    std::vector<nv::matrix4f> expected(model.modelNodes.size());
+    recursiveGlobalTransforms(model, 0, nv::matrix4f(), expected);
+
+    SkeletonPose<nv::matrix4f> matrixPose(skeleton.size());
+    SkeletonPose<DualQuaternion> dqPose(skeleton.size());
+    for (size_t i = 0; i < skeleton.size(); i++) {
+        matrixPose.local[i] = skeleton.defaultTransforms[i];
+        dqPose.local[i] = DualQuaternion::fromMatrix(skeleton.defaultTransforms[i]);
+    }
+    computeGlobalTransforms(skeleton, matrixPose);
+    computeGlobalTransforms(skeleton, dqPose);
+
+    const nv::vec3f p(0.7f, -1.3f, 2.f);
+    for (size_t i = 0; i < skeleton.size(); i++) {
+        const int nodeIdx = skeleton.modelNodeIndices[i];
+        EXPECT_EQ(model.modelNodes[nodeIdx].boneIdx, skeleton.boneIndices[i]);
+        const nv::vec3f e = nv::vec3f(expected[nodeIdx] * nv::vec4f(p, 1.f));
+        EXPECT_TRUE(Vec3Near(e, nv::vec3f(matrixPose.global[i] * nv::vec4f(p, 1.f))));
+        EXPECT_TRUE(Vec3Near(e, nv::vec3f(DualQuaternion::toMatrix<nv::matrix4f>(dqPose.global[i]) * nv::vec4f(p, 1.f)), 0.001f));
+    }
+}
+
+TEST(SkeletonTest, CachedEvaluationMatchesFull)
+{
+    SkinnedModel model = makeTestModel();
+    model.modelNodes[3].nodeAnimationIdx = 0;
+    model.modelNodes[4].nodeAnimationIdx = 1;
+    for (int i = 0; i < 3; i++) {
+        Bone bone;
+        bone.offset = DualQuaternion::toMatrix<nv::matrix4f>(
+            DualQuaternion(nv::vec3f(-1.f, 0.1f*i, 2.f), Quaternion(nv::normalize(nv::vec3f(i, 1.f, 0.f)), -0.5f*i)));
+        model.bones.push_back(bone);
+    }
+    const Skeleton skeleton = Skeleton::fromModel(model);
+    const SkeletonCache cache = SkeletonCache::fromSkeleton(skeleton, model.bones);
+
+    // 0 -> {3 -> {2}, 1 -> {4, 5}}: 3, 2 and 4 are dynamic, 0, 1 and 5 static.
+    EXPECT_EQ(2u, cache.animatedNodes.size());
+    ASSERT_EQ(3u, cache.dynamicNodes.size());
+    for (int i: cache.dynamicNodes) {
+        const int nodeIdx = skeleton.modelNodeIndices[i];
+        EXPECT_TRUE(nodeIdx == 3 || nodeIdx == 2 || nodeIdx == 4);
+    }
+    for (size_t b = 0; b < model.bones.size(); b++)
+        EXPECT_EQ(static_cast<int>(b), skeleton.boneIndices[cache.boneNodes[b]]);
+
+    SkeletonPose<nv::matrix4f> cached, full(skeleton.size());
+    SkeletonPose<DualQuaternion> cachedDQ;
+    cache.initPose(cached);
+    cache.initPose(cachedDQ);
+    for (int frame = 0; frame < 3; frame++) {
+        for (size_t i = 0; i < skeleton.size(); i++)
+            full.local[i] = skeleton.defaultTransforms[i];
+        for (int i: cache.animatedNodes) {
+            const DualQuaternion animated(nv::vec3f(0.1f*frame, -0.3f*i, 1.f), Quaternion(nv::normalize(nv::vec3f(1.f, frame, i)), 0.2f*frame + 0.1f*i));
+            full.local[i] = cached.local[i] = DualQuaternion::toMatrix<nv::matrix4f>(animated);
+            cachedDQ.local[i] = animated;
+        }
+        computeGlobalTransforms(skeleton, full);
+        computeGlobalTransforms(skeleton, cache, cached);
+        computeGlobalTransforms(skeleton, cache, cachedDQ);
+
+        const nv::vec3f p(0.7f, -1.3f, 2.f);
+        for (size_t i = 0; i < skeleton.size(); i++) {
+            const nv::vec3f e = nv::vec3f(full.global[i] * nv::vec4f(p, 1.f));
+            EXPECT_TRUE(Vec3Near(e, nv::vec3f(cached.global[i] * nv::vec4f(p, 1.f))));
+            EXPECT_TRUE(Vec3Near(e, nv::vec3f(DualQuaternion::toMatrix<nv::matrix4f>(cachedDQ.global[i]) * nv::vec4f(p, 1.f)), 0.001f));
+        }
+        for (size_t b = 0; b < model.bones.size(); b++) {
+            const nv::vec3f e = nv::vec3f(model.bones[b].offset * nv::vec4f(p, 1.f));
+            const nv::matrix4f offset = DualQuaternion::toMatrix<nv::matrix4f>(cache.dualQuaternions.boneOffsets[b]);
+            EXPECT_TRUE(Vec3Near(e, nv::vec3f(offset * nv::vec4f(p, 1.f)), 0.001f));
+        }
+    }
+}
+
+/// Test model with nodes 3 and 4 animated by two tracks, and three bones.
+SkinnedModel makeAnimatedTestModel()
+{
+    SkinnedModel model = makeTestModel();
+    model.modelNodes[3].nodeAnimationIdx = 0;
+    model.modelNodes[4].nodeAnimationIdx = 1;
+    for (int i = 0; i < 3; i++) {
+        Bone bone;
+        bone.offset = DualQuaternion::toMatrix<nv::matrix4f>(
+            DualQuaternion(nv::vec3f(-1.f, 0.1f*i, 2.f), Quaternion(nv::normalize(nv::vec3f(i, 1.f, 0.f)), -0.5f*i)));
+        model.bones.push_back(bone);
+    }
+    model.nodeAnimations.resize(2);
+    for (int track = 0; track < 2; track++) {
+        for (int k = 0; k <= 20; k++) {
+            AnimationKey key;
+            key.time = k * 0.05f;
+            key.value = nv::vec4f(std::sin(3.f*key.time + track), 1.f, 0.2f*k, 0.f);
+            model.nodeAnimations[track].translationKeys.push_back(key);
+            const Quaternion q(nv::normalize(nv::vec3f(1.f, track, 0.5f)), 2.f*key.time);
+            key.value = nv::vec4f(q.x, q.y, q.z, q.w);
+            model.nodeAnimations[track].rotationKeys.push_back(key);
+        }
+    }
+    return model;
+}
+
+void setUpCrowd(Crowd& crowd, size_t numInstances)
+{
+    crowd.resize(numInstances);
+    CrowdInstances& instances = crowd.getInstances();
+    for (size_t i = 0; i < numInstances; i++) {
+        instances.animations[i] = animationblending::playClip(0, 0.013f * i);
+        instances.rates[i] = 0.5f + 0.1f * (i % 7);
+    }
+}
+
+TEST(CrowdTest, MatchesSingleInstanceEvaluation)
+{
+    const SkinnedModel model = makeAnimatedTestModel();
+    const Skeleton skeleton = Skeleton::fromModel(model);
+    const SkeletonCache cache = SkeletonCache::fromSkeleton(skeleton, model.bones);
+    AnimationSet animations;
+    animations.clips.push_back(BakedClip::bake(model.nodeAnimations, 1.f));
+    const BakedClip& clip = animations.clips[0];
+
+    Crowd crowd(skeleton, cache, animations);
+    const size_t numInstances = 37;
+    setUpCrowd(crowd, numInstances);
+    const float deltaTime = 0.4f;
+    crowd.update<nv::matrix4f>(deltaTime);
+    crowd.update<nv::matrix4f>(deltaTime);
+
+    std::vector<nv::matrix4f> tracks(clip.numTracks);
+    SkeletonPose<nv::matrix4f> pose(skeleton.size());
+    const nv::vec3f p(0.3f, 1.f, -2.f);
+    for (size_t i = 0; i < numInstances; i++) {
+        const float expectedTime = std::fmod(0.013f * i + 2.f * deltaTime * (0.5f + 0.1f * (i % 7)), 1.f);
+        const float time = crowd.getInstances().animations[i].layers[0].players[0].time;
+        EXPECT_NEAR(expectedTime, time, 0.0001f);
+
+        clip.samplePose(time, tracks.data());
+        for (size_t n = 0; n < skeleton.size(); n++) {
+            const int track = skeleton.nodeAnimationIndices[n];
+            pose.local[n] = track != -1 ? tracks[track] : skeleton.defaultTransforms[n];
+        }
+        computeGlobalTransforms(skeleton, pose);
+
+        const nv::matrix4f* palette = crowd.getPalette<nv::matrix4f>(i);
+        for (size_t n = 0; n < skeleton.size(); n++) {
+            const int bone = skeleton.boneIndices[n];
+            if (bone == -1)
+                continue;
+            const nv::matrix4f expected = pose.global[n] * model.bones[bone].offset;
+            EXPECT_TRUE(Vec3Near(nv::vec3f(expected * nv::vec4f(p, 1.f)), nv::vec3f(palette[bone] * nv::vec4f(p, 1.f)), 0.001f));
+        }
+    }
+}
+
+TEST(CrowdTest, MultithreadedMatchesSingleThreaded)
+{
+    const SkinnedModel model = makeAnimatedTestModel();
+    const Skeleton skeleton = Skeleton::fromModel(model);
+    const SkeletonCache cache = SkeletonCache::fromSkeleton(skeleton, model.bones);
+    AnimationSet animations;
+    animations.clips.push_back(BakedClip::bake(model.nodeAnimations, 1.f));
+
+    NvJobSystem workers(4);
+    Crowd single(skeleton, cache, animations);
+    Crowd multi(skeleton, cache, animations, &workers, 5);
+    const size_t numInstances = 203;
+    setUpCrowd(single, numInstances);
+    setUpCrowd(multi, numInstances);
+    for (int frame = 0; frame < 3; frame++) {
+        single.update<DualQuaternion>(1.f/60.f);
+        multi.update<DualQuaternion>(1.f/60.f);
+    }
+    for (size_t i = 0; i < numInstances; i++) {
+        const DualQuaternion* a = single.getPalette<DualQuaternion>(i);
+        const DualQuaternion* b = multi.getPalette<DualQuaternion>(i);
+        for (size_t bone = 0; bone < single.getNumBones(); bone++) {
+            EXPECT_EQ(a[bone].real.w, b[bone].real.w);
+            EXPECT_EQ(a[bone].dual.x, b[bone].dual.x);
+        }
+    }
+}
+
+TEST(PackedVertexTest, RoundTripWithinQuantizationError)
+{
+    const std::vector<Vertex> vertices = makeTestVertices(100);
+    const PackedVertexBounds bounds = vertexpacking::computeBounds(vertices.data(), vertices.size());
+    std::vector<PackedVertex> packed(vertices.size());
+    std::vector<Vertex> unpacked(vertices.size());
+    vertexpacking::packVertices(vertices.data(), vertices.size(), bounds, packed.data());
+    vertexpacking::unpackVertices(packed.data(), packed.size(), bounds, unpacked.data());
+
+    for (size_t i = 0; i < vertices.size(); i++) {
+        const Vertex& a = vertices[i];
+        const Vertex& b = unpacked[i];
+        for (int c = 0; c < 3; c++)
+            EXPECT_NEAR(a.position[c], b.position[c], 0.5f * bounds.scale[c] / 65535.f + 1e-6f);
+        // 8-bit octahedral normals are within a degree.
+        EXPECT_GT(nv::dot(a.normal, b.normal), std::cos(1.f * 3.14159265f / 180.f));
+        for (int k = 0; k < 4; k++) {
+            EXPECT_EQ(std::floor(a.bones[k]), std::floor(b.bones[k]));
+            EXPECT_NEAR(a.bones[k] - std::floor(a.bones[k]), b.bones[k] - std::floor(b.bones[k]), 0.5f / 255.f + 1e-6f);
+        }
+        EXPECT_NEAR(a.uv.x, b.uv.x, 1.f / 2048.f);
+        EXPECT_NEAR(a.uv.y, b.uv.y, 1.f / 2048.f);
+    }
+}
+
+TEST(PackedVertexTest, OctahedralNormalsInAllOctants)
+{
+    for (int i = 0; i < 1000; i++) {
+        const float z = 1.f - 2.f * (i + 0.5f) / 1000.f;
+        const float r = std::sqrt(1.f - z*z);
+        const float phi = 2.39996323f * i;
+        const nv::vec3f n(r * std::cos(phi), r * std::sin(phi), z);
+        int8_t e[2];
+        vertexpacking::encodeOctahedral(n, e);
+        EXPECT_GT(nv::dot(n, vertexpacking::decodeOctahedral(e)), std::cos(1.f * 3.14159265f / 180.f)) << i;
+    }
+}
+
+TEST(PackedVertexTest, WeightsAreNormalized)
+{
+    uint8_t bones[4], weights[4];
+    vertexpacking::encodeInfluences(nv::vec4f(3.999f, 0.f, 0.f, 0.f), bones, weights);
+    EXPECT_EQ(3, bones[0]);
+    EXPECT_EQ(255, weights[0]);
+    EXPECT_EQ(0, weights[1] + weights[2] + weights[3]);
+
+    vertexpacking::encodeInfluences(nv::vec4f(1.333f, 2.333f, 7.333f, 0.f), bones, weights);
+    EXPECT_EQ(255, weights[0] + weights[1] + weights[2] + weights[3]);
+    EXPECT_EQ(7, bones[2]);
+    EXPECT_LE(std::abs(weights[0] - weights[2]), 1);
+}
+
+TEST(PackedVertexTest, ShaderHalfDecodeMatchesHalf)
+{
+    for (int bits = 0; bits < 65536; bits++) {
+        half h;
+        h.setBits(static_cast<unsigned short>(bits));
+        if (!h.isFinite())
+            continue;
+        EXPECT_EQ(static_cast<float>(h), vertexpacking::decodeHalf(static_cast<uint16_t>(bits))) << bits;
+    }
+}
+
+/// Unindexed triangle soup of a size x size quad grid, triangles in a
+/// scrambled order.
+Mesh makeTestGridSoup(int size)
+{
+    Mesh mesh;
+    std::vector<int> quads;
+    for (int i = 0; i < size*size; i++)
+        quads.push_back((i * 7919) % (size*size));
+    for (int q: quads) {
+        const int x = q % size, y = q / size;
+        const int corners[6][2] = {{x, y}, {x+1, y}, {x+1, y+1}, {x, y}, {x+1, y+1}, {x, y+1}};
+        for (const int* c: corners) {
+            Vertex v;
+            v.position = nv::vec3f(float(c[0]), float(c[1]), 0.f);
+            v.normal = nv::vec3f(0.f, 0.f, 1.f);
+            v.bones = packBones(c[0] % numTestBones, 0.75f, c[1] % numTestBones, 0.25f, 0, 0.f, 0, 0.f);
+            v.uv = nv::vec2f(c[0] / float(size), c[1] / float(size));
+            mesh.indices.push_back(static_cast<unsigned short>(mesh.vertices.size()));
+            mesh.vertices.push_back(v);
+        }
+    }
+    return mesh;
+}
+
+/// Triangles as sorted position triples, rotated so that winding is kept.
+std::vector<std::vector<float> > trianglePositions(const Mesh& mesh)
+{
+    std::vector<std::vector<float> > triangles;
+    for (size_t t = 0; t < mesh.indices.size(); t += 3) {
+        std::vector<std::vector<float> > corners;
+        for (int k = 0; k < 3; k++) {
+            const nv::vec3f& p = mesh.vertices[mesh.indices[t + k]].position;
+            corners.push_back(std::vector<float>{p.x, p.y, p.z});
+        }
+        std::rotate(corners.begin(), std::min_element(corners.begin(), corners.end()), corners.end());
+        std::vector<float> triangle;
+        for (const std::vector<float>& c: corners)
+            triangle.insert(triangle.end(), c.begin(), c.end());
+        triangles.push_back(triangle);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+TEST(MeshOptimizationTest, AnalyzeVertexCache)
+{
+    const unsigned short quad[] = {0, 1, 2, 0, 2, 3};
+    const VertexCacheStats stats = meshoptimization::analyzeVertexCache(quad, 6);
+    EXPECT_EQ(2u, stats.numTriangles);
+    EXPECT_EQ(4u, stats.numVertices);
+    EXPECT_EQ(4u, stats.numTransformed);
+    EXPECT_FLOAT_EQ(2.f, stats.acmr);
+    EXPECT_FLOAT_EQ(1.f, stats.atvr);
+
+    // In a 3 entry FIFO, 3 evicts 0, which then evicts 1; hits do not
+    // refresh entries.
+    const unsigned short strip[] = {0, 1, 2, 2, 1, 3, 0, 3, 1};
+    EXPECT_EQ(6u, meshoptimization::analyzeVertexCache(strip, 9, 3).numTransformed);
+}
+
+TEST(MeshOptimizationTest, WeldVertices)
+{
+    Mesh mesh = makeTestGridSoup(8);
+    const std::vector<std::vector<float> > before = trianglePositions(mesh);
+    EXPECT_EQ(9u*9u, meshoptimization::weldVertices(mesh));
+    EXPECT_EQ(8u*8u*6u, mesh.indices.size());
+    EXPECT_EQ(before, trianglePositions(mesh));
+}
+
+TEST(MeshOptimizationTest, OptimizedMeshKeepsTrianglesAndReusesVertices)
+{
+    Mesh mesh = makeTestGridSoup(16);
+    const std::vector<std::vector<float> > before = trianglePositions(mesh);
+    meshoptimization::weldVertices(mesh);
+    const VertexCacheStats welded = meshoptimization::analyzeVertexCache(mesh);
+
+    meshoptimization::optimizeVertexCache(mesh);
+    const VertexCacheStats optimized = meshoptimization::analyzeVertexCache(mesh);
+    EXPECT_EQ(before, trianglePositions(mesh));
+    EXPECT_LT(optimized.acmr, 0.8f);
+    EXPECT_LT(optimized.acmr, welded.acmr);
+    EXPECT_LT(optimized.atvr, 1.5f);
+
+    // Fetch order follows first use and changes nothing the cache sees.
+    EXPECT_EQ(17u*17u, meshoptimization::optimizeVertexFetch(mesh));
+    EXPECT_EQ(before, trianglePositions(mesh));
+    unsigned short next = 0;
+    for (unsigned short index: mesh.indices) {
+        EXPECT_LE(index, next);
+        if (index == next)
+            next++;
+    }
+    EXPECT_EQ(optimized.numTransformed, meshoptimization::analyzeVertexCache(mesh).numTransformed);
+}
+
+TEST(InfluenceSplitTest, CountsSlotsUpToTheLastUsed)
+{
+    Vertex v;
+    v.bones = nv::vec4f(3.f, 0.f, 0.f, 0.f);
+    EXPECT_EQ(1, influencesplit::countInfluences(v));
+    v.bones = nv::vec4f(3.5f, 7.5f, 0.f, 0.f);
+    EXPECT_EQ(2, influencesplit::countInfluences(v));
+    // A gap does not end the count.
+    v.bones = nv::vec4f(3.5f, 0.f, 0.f, 9.5f);
+    EXPECT_EQ(4, influencesplit::countInfluences(v));
+
+    PackedVertex p = {};
+    p.weights[0] = 255;
+    EXPECT_EQ(1, influencesplit::countInfluences(p));
+    p.weights[0] = 200;
+    p.weights[2] = 55;
+    EXPECT_EQ(3, influencesplit::countInfluences(p));
+}
+
+TEST(InfluenceSplitTest, SortPutsHeaviestFirst)
+{
+    Vertex v;
+    v.bones = nv::vec4f(3.f, 1.25f, 0.f, 9.75f);
+    influencesplit::sortInfluences(v);
+    EXPECT_FLOAT_EQ(9.75f, v.bones.x);
+    EXPECT_FLOAT_EQ(1.25f, v.bones.y);
+    EXPECT_EQ(2, influencesplit::countInfluences(v));
+
+    PackedVertex p = {};
+    p.bones[1] = 4;  p.weights[1] = 55;
+    p.bones[3] = 12; p.weights[3] = 200;
+    influencesplit::sortInfluences(p);
+    EXPECT_EQ(12, p.bones[0]);
+    EXPECT_EQ(200, p.weights[0]);
+    EXPECT_EQ(4, p.bones[1]);
+    EXPECT_EQ(55, p.weights[1]);
+    EXPECT_EQ(2, influencesplit::countInfluences(p));
+}
+
+TEST(InfluenceSplitTest, GroupsTrianglesByNeediestVertex)
+{
+    const uint8_t counts[] = {1, 1, 1, 2, 4, 1};
+    unsigned short indices[] = {
+        0, 1, 4,    // 4
+        0, 1, 2,    // 1
+        1, 3, 2,    // 2
+        2, 1, 5,    // 1
+        4, 3, 5,    // 4
+    };
+    InfluenceSplitStats stats = {};
+    const std::vector<InfluenceBatch> batches = influencesplit::splitByInfluences(indices, 15, counts, &stats);
+
+    ASSERT_EQ(3u, batches.size());
+    EXPECT_EQ(1, batches[0].maxInfluences);
+    EXPECT_EQ(0u, batches[0].firstIndex);
+    EXPECT_EQ(6u, batches[0].numIndices);
+    EXPECT_EQ(2, batches[1].maxInfluences);
+    EXPECT_EQ(6u, batches[1].firstIndex);
+    EXPECT_EQ(3u, batches[1].numIndices);
+    EXPECT_EQ(4, batches[2].maxInfluences);
+    EXPECT_EQ(9u, batches[2].firstIndex);
+    EXPECT_EQ(6u, batches[2].numIndices);
+
+    // Stable within groups, winding kept.
+    const unsigned short expected[] = {0, 1, 2,  2, 1, 5,  1, 3, 2,  0, 1, 4,  4, 3, 5};
+    EXPECT_TRUE(std::equal(indices, indices + 15, expected));
+
+    EXPECT_EQ(2u, stats.numTriangles[0]);
+    EXPECT_EQ(1u, stats.numTriangles[1]);
+    EXPECT_EQ(0u, stats.numTriangles[2]);
+    EXPECT_EQ(2u, stats.numTriangles[3]);
+    EXPECT_EQ(4u, stats.numVertices[0]);
+    EXPECT_EQ(1u, stats.numVertices[1]);
+    EXPECT_EQ(1u, stats.numVertices[3]);
+    EXPECT_FLOAT_EQ((2*1 + 1*2 + 2*4) / 5.f, stats.averageInfluences());
+}
+
+TEST(InfluenceSplitTest, SplitMeshDrawsEveryTriangle)
+{
+    Mesh mesh = makeTestGridSoup(8);
+    meshoptimization::optimizeMesh(mesh);
+    for (size_t i = 0; i < mesh.vertices.size(); i++) {
+        // 1 to 4 influences, with unused slots first.
+        const int n = 1 + i % 4;
+        nv::vec4f bones(0.f, 0.f, 0.f, 0.f);
+        for (int k = 4 - n; k < 4; k++)
+            bones[k] = k + 1.f / (n + 1);
+        mesh.vertices[i].bones = bones;
+        influencesplit::sortInfluences(mesh.vertices[i]);
+    }
+    const std::vector<std::vector<float> > before = trianglePositions(mesh);
+
+    const std::vector<uint8_t> counts = influencesplit::countInfluences(mesh.vertices.data(), mesh.vertices.size());
+    const std::vector<InfluenceBatch> batches = influencesplit::splitByInfluences(mesh.indices.data(), mesh.indices.size(), counts.data());
+    EXPECT_EQ(before, trianglePositions(mesh));
+
+    size_t next = 0;
+    for (const InfluenceBatch& batch: batches) {
+        EXPECT_EQ(next, batch.firstIndex);
+        for (size_t i = batch.firstIndex; i < batch.firstIndex + batch.numIndices; i++)
+            EXPECT_LE(counts[mesh.indices[i]], batch.maxInfluences);
+        next += batch.numIndices;
+    }
+    EXPECT_EQ(mesh.indices.size(), next);
+}
+
+TEST(InfluencePruningTest, Histogram)
+{
+    std::vector<Vertex> vertices = makeTestVertices(3);
+    vertices[1].bones = packBones(2, 0.999f);
+    vertices[2].bones = packBones(1, 0.5f, 4, 0.45f);
+    InfluenceHistogram histogram = {};
+    influencepruning::analyzeInfluences(vertices.data(), vertices.size(), histogram);
+    EXPECT_EQ(3u, histogram.numVertices);
+    EXPECT_EQ(1u, histogram.numInfluences[1]);
+    EXPECT_EQ(1u, histogram.numInfluences[2]);
+    EXPECT_EQ(1u, histogram.numInfluences[4]);
+    EXPECT_EQ(2u, histogram.weights[1]);    // 0.125 twice
+    EXPECT_EQ(1u, histogram.weights[2]);    // 0.25
+    EXPECT_EQ(1u, histogram.weights[4]);    // 0.45
+    EXPECT_EQ(2u, histogram.weights[5]);    // 0.5 twice
+    EXPECT_EQ(1u, histogram.weights[9]);    // 0.999
+    EXPECT_NEAR(0.125f, histogram.minWeight, 1e-5f);
+    EXPECT_NEAR(0.05f, histogram.maxSumError, 1e-5f);
+}
+
+TEST(InfluencePruningTest, PruneRenormalizesAndKeepsTheHeaviest)
+{
+    PruningSettings settings;
+    settings.threshold = 0.2f;
+    PruningStats stats = {};
+
+    Vertex v = makeTestVertices(1)[0];  // 0.5, 0.25, 0.125, 0.125
+    EXPECT_EQ(2, influencepruning::pruneInfluences(v, settings, &stats));
+    int bone;
+    float weight;
+    cpuskinning::unpackInfluence(v.bones.x, bone, weight);
+    EXPECT_EQ(0, bone);
+    EXPECT_NEAR(2.f / 3.f, weight, 1e-4f);
+    cpuskinning::unpackInfluence(v.bones.y, bone, weight);
+    EXPECT_EQ(1, bone);
+    EXPECT_NEAR(1.f / 3.f, weight, 1e-4f);
+    EXPECT_EQ(0.f, v.bones.z);
+    EXPECT_EQ(0.f, v.bones.w);
+
+    // Below the threshold, but the heaviest; stored like a full weight.
+    v.bones = packBones(5, 0.01f, 3, 0.005f);
+    EXPECT_EQ(1, influencepruning::pruneInfluences(v, settings, &stats));
+    EXPECT_FLOAT_EQ(5.f + influencepruning::MaxWeight, v.bones.x);
+    EXPECT_EQ(0.f, v.bones.y);
+
+    settings.threshold = 0.f;
+    settings.maxInfluences = 3;
+    v = makeTestVertices(1)[0];
+    EXPECT_EQ(1, influencepruning::pruneInfluences(v, settings, &stats));
+    EXPECT_EQ(3, influencesplit::countInfluences(v));
+
+    EXPECT_EQ(3u, stats.numVertices);
+    EXPECT_EQ(4u, stats.numInfluences);
+    EXPECT_FLOAT_EQ(0.125f, stats.maxDroppedWeight);
+}
+
+TEST(InfluencePruningTest, DeformationErrorGrowsWithThreshold)
+{
+    std::vector<DualQuaternion> dqs;
+    std::vector<nv::matrix4f> matrices;
+    makeTestPalettes(dqs, matrices);
+    const std::vector<Vertex> original = makeTestVertices(20);
+
+    // Renormalizing weights that already sum to 1 changes nothing.
+    std::vector<Vertex> pruned = original;
+    PruningSettings settings;
+    settings.threshold = 0.f;
+    for (Vertex& v: pruned)
+        influencepruning::pruneInfluences(v, settings);
+    DeformationError error = influencepruning::measureDeformationError(original.data(), pruned.data(), 20, dqs.data(), 1, numTestBones);
+    EXPECT_LT(error.maxPositionError, 1e-4f);
+
+    float previous[2] = {0.f, 0.f};
+    const float thresholds[] = {0.2f, 0.3f};
+    for (float threshold: thresholds) {
+        pruned = original;
+        settings.threshold = threshold;
+        for (Vertex& v: pruned)
+            influencepruning::pruneInfluences(v, settings);
+        for (int matrix = 0; matrix < 2; matrix++) {
+            error = matrix ? influencepruning::measureDeformationError(original.data(), pruned.data(), 20, matrices.data(), 1, numTestBones)
+                           : influencepruning::measureDeformationError(original.data(), pruned.data(), 20, dqs.data(), 1, numTestBones);
+            EXPECT_GT(error.maxPositionError, previous[matrix]);
+            EXPECT_LE(error.averagePositionError, error.maxPositionError);
+            EXPECT_LT(error.worstVertex, 20u);
+
+            // The reported worst vertex is that far off.
+            const Vertex a = matrix ? cpuskinning::skinVertex(original[error.worstVertex], matrices.data())
+                                    : cpuskinning::skinVertex(original[error.worstVertex], dqs.data());
+            const Vertex b = matrix ? cpuskinning::skinVertex(pruned[error.worstVertex], matrices.data())
+                                    : cpuskinning::skinVertex(pruned[error.worstVertex], dqs.data());
+            EXPECT_NEAR(error.maxPositionError, nv::length(a.position - b.position), 1e-5f);
+            previous[matrix] = error.maxPositionError;
+        }
+    }
+}
+
+// A welded 8x8 grid whose vertices each blend their own bone and the one
+// of the row above, 81 bones in all.
+Mesh makeTestBoneGrid()
+{
+    Mesh mesh = makeTestGridSoup(8);
+    meshoptimization::weldVertices(mesh);
+    for (Vertex& v: mesh.vertices) {
+        const int x = int(v.position.x), y = int(v.position.y);
+        v.bones = packBones(9*y + x, 0.75f, 9*((y + 1) % 9) + x, 0.25f);
+    }
+    return mesh;
+}
+
+TEST(BonePartitioningTest, PartitionsFitAndMapBackToModelBones)
+{
+    const Mesh mesh = makeTestBoneGrid();
+    EXPECT_EQ(81, bonepartitioning::countBones(mesh.vertices.data(), mesh.vertices.size()));
+    PartitionedMesh<Vertex> out;
+    BonePartitionStats stats = {};
+    ASSERT_TRUE(bonepartitioning::partitionMesh(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size(),
+                                                20, out, &stats));
+    EXPECT_GT(out.partitions.size(), 4u);
+    EXPECT_EQ(out.partitions.size(), stats.numPartitions);
+    EXPECT_EQ(out.vertices.size() - 81, stats.numDuplicatedVertices);
+    EXPECT_LE(stats.maxBones, 20u);
+
+    // Same triangles, same winding.
+    Mesh partitioned;
+    partitioned.vertices = out.vertices;
+    partitioned.indices = out.indices;
+    EXPECT_EQ(trianglePositions(mesh), trianglePositions(partitioned));
+
+    // Every partition skins its vertices with its own palette as the whole
+    // palette skins the originals.
+    std::vector<DualQuaternion> palette;
+    for (int i = 0; i < 81; i++)
+        palette.push_back(DualQuaternion(nv::vec3f(0.1f*i, 0.f, -0.05f*i), Quaternion(nv::vec3f(0.f, 1.f, 0.f), 0.03f*i)));
+    size_t firstIndex = 0, firstVertex = 0;
+    for (const BonePartition& partition: out.partitions) {
+        EXPECT_EQ(firstIndex, partition.firstIndex);
+        EXPECT_EQ(firstVertex, partition.firstVertex);
+        EXPECT_LE(partition.bones.size(), 20u);
+        std::vector<DualQuaternion> local;
+        for (int bone: partition.bones)
+            local.push_back(palette[bone]);
+        for (size_t i = partition.firstIndex; i < partition.firstIndex + partition.numIndices; i++) {
+            const unsigned short index = out.indices[i];
+            ASSERT_GE(index, partition.firstVertex);
+            ASSERT_LT(index, partition.firstVertex + partition.numVertices);
+            const Vertex& v = out.vertices[index];
+            for (int k = 0; k < 4; k++)
+                EXPECT_LT(int(v.bones[k]), int(partition.bones.size()));
+            const Vertex& original = *std::find_if(mesh.vertices.begin(), mesh.vertices.end(),
+                                                   [&v](const Vertex& o) { return o.position == v.position; });
+            EXPECT_TRUE(Vec3Near(cpuskinning::skinVertex(original, palette.data()).position,
+                                 cpuskinning::skinVertex(v, local.data()).position));
+        }
+        firstIndex += partition.numIndices;
+        firstVertex += partition.numVertices;
+    }
+    EXPECT_EQ(out.indices.size(), firstIndex);
+    EXPECT_EQ(out.vertices.size(), firstVertex);
+}
+
+TEST(BonePartitioningTest, FitsInOneOrFails)
+{
+    const Mesh mesh = makeTestBoneGrid();
+    PartitionedMesh<Vertex> out;
+    BonePartitionStats stats = {};
+    ASSERT_TRUE(bonepartitioning::partitionMesh(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size(),
+                                                81, out, &stats));
+    ASSERT_EQ(1u, out.partitions.size());
+    EXPECT_EQ(81u, out.partitions[0].bones.size());
+    EXPECT_EQ(0u, stats.numDuplicatedVertices);
+
+    // The corners of a triangle reference 5 bones here.
+    EXPECT_FALSE(bonepartitioning::partitionMesh(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size(),
+                                                 4, out));
+    EXPECT_TRUE(bonepartitioning::partitionMesh(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size(),
+                                                5, out));
+}
+
+TEST(BonePartitioningTest, UnweightedMeshGetsOneFillerBone)
+{
+    Mesh mesh = makeTestBoneGrid();
+    for (Vertex& v: mesh.vertices)
+        v.bones = nv::vec4f(0.f, 0.f, 0.f, 0.f);
+    EXPECT_EQ(0, bonepartitioning::countBones(mesh.vertices.data(), mesh.vertices.size()));
+    PartitionedMesh<Vertex> out;
+    BonePartitionStats stats = {};
+    ASSERT_TRUE(bonepartitioning::partitionMesh(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size(),
+                                                20, out, &stats));
+    ASSERT_EQ(1u, out.partitions.size());
+    EXPECT_EQ(std::vector<int>(1, 0), out.partitions[0].bones);
+    EXPECT_EQ(mesh.indices.size(), out.partitions[0].numIndices);
+    EXPECT_EQ(mesh.vertices.size(), out.vertices.size());
+    EXPECT_EQ(0u, stats.numDuplicatedVertices);
+    for (const Vertex& v: out.vertices)
+        EXPECT_EQ(nv::vec4f(0.f, 0.f, 0.f, 0.f), v.bones);
+}
+
+TEST(BonePartitioningTest, PackedVerticesKeepTheirWeights)
+{
+    const Mesh mesh = makeTestBoneGrid();
+    const PackedVertexBounds bounds = vertexpacking::computeBounds(mesh.vertices.data(), mesh.vertices.size());
+    std::vector<PackedVertex> packed(mesh.vertices.size());
+    vertexpacking::packVertices(mesh.vertices.data(), mesh.vertices.size(), bounds, packed.data());
+
+    PartitionedMesh<PackedVertex> out;
+    ASSERT_TRUE(bonepartitioning::partitionMesh(packed.data(), packed.size(), mesh.indices.data(), mesh.indices.size(), 16, out));
+    for (const BonePartition& partition: out.partitions) {
+        EXPECT_LE(partition.bones.size(), 16u);
+        for (size_t i = partition.firstIndex; i < partition.firstIndex + partition.numIndices; i++) {
+            const PackedVertex& v = out.vertices[out.indices[i]];
+            const Vertex unpacked = vertexpacking::unpackVertex(v, bounds);
+            const int x = int(unpacked.position.x + 0.5f), y = int(unpacked.position.y + 0.5f);
+            EXPECT_EQ(9*y + x, partition.bones[v.bones[0]]);
+            EXPECT_EQ(9*((y + 1) % 9) + x, partition.bones[v.bones[1]]);
+            EXPECT_EQ(255, v.weights[0] + v.weights[1]);
+        }
+    }
+}
+
+TEST(BinaryModelTest, RoundTrip)
+{
+    SkinnedModel model = makeAnimatedTestModel();
+    model.modelNodes[2].name = "leaf";
+    Mesh mesh;
+    mesh.vertices = makeTestVertices(10);
+    for (int i = 0; i < 10; i++)
+        mesh.indices.push_back(static_cast<unsigned short>(9 - i));
+    mesh.albedoTextureFilename = "head.dds";
+    model.meshes.push_back(mesh);
+    model.meshes.push_back(Mesh());
+
+    const std::vector<char> file = BinaryModel::write(model);
+    BinaryModel binary;
+    ASSERT_TRUE(BinaryModel::parse(file.data(), file.size(), binary));
+    for (int s = 0; s < BinaryModelHeader::NumSections; s++)
+        EXPECT_EQ(0u, reinterpret_cast<const BinaryModelHeader*>(file.data())->sections[s].offset % BinaryModelHeader::Alignment);
+
+    // Geometry is read in place.
+    ASSERT_EQ(2u, binary.meshes.size());
+    EXPECT_EQ(0, std::memcmp(binary.meshVertices(binary.meshes[0]), mesh.vertices.data(), 10*sizeof(Vertex)));
+    EXPECT_EQ(0, std::memcmp(binary.meshIndices(binary.meshes[0]), mesh.indices.data(), 10*sizeof(unsigned short)));
+    ASSERT_EQ(10u, binary.packedVertices.size());
+    const PackedVertexBounds bounds = vertexpacking::computeBounds(mesh.vertices.data(), mesh.vertices.size());
+    const PackedVertexBounds stored = binary.meshes[0].bounds();
+    EXPECT_EQ(0, std::memcmp(&bounds, &stored, sizeof(bounds)));
+    EXPECT_EQ(vertexpacking::packVertex(mesh.vertices[3], bounds).position[1], binary.meshPackedVertices(binary.meshes[0])[3].position[1]);
+    EXPECT_STREQ("head.dds", binary.string(binary.meshes[0].albedoTextureFilename));
+    EXPECT_EQ(0u, binary.meshes[1].numVertices);
+
+    SkinnedModel loaded;
+    binary.toSkinnedModel(loaded, true);
+    ASSERT_EQ(model.modelNodes.size(), loaded.modelNodes.size());
+    for (size_t i = 0; i < model.modelNodes.size(); i++) {
+        EXPECT_EQ(model.modelNodes[i].name, loaded.modelNodes[i].name);
+        EXPECT_EQ(model.modelNodes[i].childrenIndices, loaded.modelNodes[i].childrenIndices);
+        EXPECT_EQ(model.modelNodes[i].nodeAnimationIdx, loaded.modelNodes[i].nodeAnimationIdx);
+        EXPECT_EQ(model.modelNodes[i].boneIdx, loaded.modelNodes[i].boneIdx);
+        EXPECT_EQ(0, std::memcmp(&model.modelNodes[i].defaultTransform, &loaded.modelNodes[i].defaultTransform, sizeof(nv::matrix4f)));
+    }
+    ASSERT_EQ(model.nodeAnimations.size(), loaded.nodeAnimations.size());
+    for (size_t i = 0; i < model.nodeAnimations.size(); i++) {
+        const NodeAnimation& a = model.nodeAnimations[i];
+        const NodeAnimation& b = loaded.nodeAnimations[i];
+        ASSERT_EQ(a.translationKeys.size(), b.translationKeys.size());
+        ASSERT_EQ(a.rotationKeys.size(), b.rotationKeys.size());
+        EXPECT_EQ(0, std::memcmp(a.translationKeys.data(), b.translationKeys.data(), a.translationKeys.size()*sizeof(AnimationKey)));
+        EXPECT_EQ(0, std::memcmp(a.rotationKeys.data(), b.rotationKeys.data(), a.rotationKeys.size()*sizeof(AnimationKey)));
+    }
+    ASSERT_EQ(model.bones.size(), loaded.bones.size());
+    EXPECT_EQ(0, std::memcmp(model.bones.data(), loaded.bones.data(), model.bones.size()*sizeof(Bone)));
+    ASSERT_EQ(2u, loaded.meshes.size());
+    EXPECT_EQ("head.dds", loaded.meshes[0].albedoTextureFilename);
+    EXPECT_EQ(mesh.indices, loaded.meshes[0].indices);
+
+    SkinnedModel withoutGeometry;
+    binary.toSkinnedModel(withoutGeometry, false);
+    EXPECT_TRUE(withoutGeometry.meshes[0].vertices.empty());
+    EXPECT_EQ("head.dds", withoutGeometry.meshes[0].albedoTextureFilename);
+}
+
+TEST(BinaryModelTest, RejectsMalformedFiles)
+{
+    SkinnedModel model = makeAnimatedTestModel();
+    Mesh mesh;
+    mesh.vertices = makeTestVertices(3);
+    mesh.indices.assign(3, 0);
+    model.meshes.push_back(mesh);
+    const std::vector<char> file = BinaryModel::write(model);
+    BinaryModel binary;
+
+    EXPECT_FALSE(BinaryModel::parse(file.data(), file.size() - 1, binary));
+    EXPECT_FALSE(BinaryModel::parse(file.data(), sizeof(BinaryModelHeader) - 1, binary));
+
+    std::vector<char> corrupt = file;
+    corrupt[0] = 'X';
+    EXPECT_FALSE(BinaryModel::parse(corrupt.data(), corrupt.size(), binary));
+
+    corrupt = file;
+    reinterpret_cast<BinaryModelHeader*>(corrupt.data())->version++;
+    EXPECT_FALSE(BinaryModel::parse(corrupt.data(), corrupt.size(), binary));
+
+    // An index past the mesh's vertices.
+    corrupt = file;
+    const BinaryModelSection& indices = reinterpret_cast<const BinaryModelHeader*>(corrupt.data())->sections[BinaryModelHeader::Indices];
+    reinterpret_cast<unsigned short*>(corrupt.data() + indices.offset)[1] = 3;
+    EXPECT_FALSE(BinaryModel::parse(corrupt.data(), corrupt.size(), binary));
+
+    // A child index past the nodes.
+    corrupt = file;
+    const BinaryModelSection& children = reinterpret_cast<const BinaryModelHeader*>(corrupt.data())->sections[BinaryModelHeader::NodeChildren];
+    reinterpret_cast<int32_t*>(corrupt.data() + children.offset)[0] = static_cast<int32_t>(model.modelNodes.size());
+    EXPECT_FALSE(BinaryModel::parse(corrupt.data(), corrupt.size(), binary));
+
+    // Cycles: node 3 (children 3, 1, 4, 5, 2 of nodes 0, 1, 3) back to the
+    // root, and node 1 to itself, which also leaves node 4 without a parent.
+    corrupt = file;
+    reinterpret_cast<int32_t*>(corrupt.data() + children.offset)[4] = 0;
+    EXPECT_FALSE(BinaryModel::parse(corrupt.data(), corrupt.size(), binary));
+    corrupt = file;
+    reinterpret_cast<int32_t*>(corrupt.data() + children.offset)[2] = 1;
+    EXPECT_FALSE(BinaryModel::parse(corrupt.data(), corrupt.size(), binary));
+
+    // A track without keys.
+    const BinaryModelSection& animations = reinterpret_cast<const BinaryModelHeader*>(file.data())->sections[BinaryModelHeader::Animations];
+    corrupt = file;
+    reinterpret_cast<BinaryAnimation*>(corrupt.data() + animations.offset)[1].numTranslationKeys = 0;
+    EXPECT_FALSE(BinaryModel::parse(corrupt.data(), corrupt.size(), binary));
+    corrupt = file;
+    reinterpret_cast<BinaryAnimation*>(corrupt.data() + animations.offset)[0].numRotationKeys = 0;
+    EXPECT_FALSE(BinaryModel::parse(corrupt.data(), corrupt.size(), binary));
+
+    EXPECT_EQ(nullptr, binary.meshes.data);
+    EXPECT_TRUE(BinaryModel::parse(file.data(), file.size(), binary));
+}
+
+TEST(BinaryModelTest, PackedVerticesOnly)
+{
+    SkinnedModel model = makeAnimatedTestModel();
+    Mesh mesh;
+    mesh.vertices = makeTestVertices(20);
+    mesh.indices.assign(3, 19);
+    model.meshes.push_back(mesh);
+    model.meshes.push_back(mesh);
+
+    const std::vector<char> file = BinaryModel::write(model, BinaryModel::PackedVertices);
+    BinaryModel binary;
+    ASSERT_TRUE(BinaryModel::parse(file.data(), file.size(), binary));
+    EXPECT_EQ(0u, binary.vertices.size());
+    EXPECT_EQ(40u, binary.packedVertices.size());
+    EXPECT_EQ(20u, binary.meshes[1].firstVertex);
+
+    // Loading geometry unpacks it.
+    SkinnedModel loaded;
+    binary.toSkinnedModel(loaded, true);
+    ASSERT_EQ(20u, loaded.meshes[1].vertices.size());
+    EXPECT_TRUE(Vec3Near(mesh.vertices[7].position, loaded.meshes[1].vertices[7].position, 0.001f));
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
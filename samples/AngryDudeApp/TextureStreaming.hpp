@@ -0,0 +1,332 @@
+#ifndef __TextureStreaming_hpp__
+#define __TextureStreaming_hpp__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/// \file TextureStreaming.hpp
+/// \brief Progressive, budgeted upload of texture mip chains.
+///
+/// TextureStreamer decides what to upload each frame; it makes no GL calls,
+/// the app turns its TextureUploads into glTexImage2D/glTexSubImage2D. Every
+/// texture gets its coarsest levels first, so that something can be drawn
+/// right away, and is then refined one (or, with budget to spare, several)
+/// levels at a time until its finest level is resident. The bytes uploaded
+/// per frame stay within a budget.
+///
+/// ES 2 and WebGL have no GL_TEXTURE_BASE_LEVEL: a texture's level 0 must be
+/// its finest level. A refinement is therefore a new texture (a "build") whose
+/// level 0 is the next finer mip, followed by the coarser levels again; it
+/// replaces the resident texture once its last level is in. Re-uploading the
+/// coarser levels adds about a third to the bytes of each refinement.
+///
+/// Uncompressed levels larger than what is left of a frame's budget are split
+/// into bands of rows. Compressed levels go in whole (there is no way to define
+/// a compressed level without its data in WebGL); a compressed level larger
+/// than the budget goes alone in a frame of its own.
+///
+/// Levels come from the file when it has them (DDS mip chains are used as
+/// they are); buildMipChainRGBA8 fills in missing levels of uncompressed
+/// images on the CPU.
+
+/// \brief One level of a mip chain in client memory.
+struct MipLevel
+{
+    int32_t        width;
+    int32_t        height;
+    size_t         bytes;
+    const uint8_t* data;
+};
+
+/// \brief One GL upload: rows [firstRow, endRow) of a source level.
+struct TextureUpload
+{
+    size_t         texture;      ///< Index returned by TextureStreamer::add.
+    int32_t        level;        ///< Source level.
+    int32_t        targetLevel;  ///< Level of the texture being built (its level 0 is the build's finest level).
+    int32_t        firstRow;
+    int32_t        endRow;
+    const uint8_t* data;         ///< First byte of firstRow.
+    size_t         bytes;
+    bool           beginBuild;   ///< First upload of a build: create the texture it goes to.
+    bool           defineLevel;  ///< First upload to targetLevel: define the level before (or while) filling it.
+    bool           endBuild;     ///< Last upload of a build: the built texture replaces the resident one.
+};
+
+/// \brief Residency of all streamed textures.
+struct TextureStreamingStats
+{
+    size_t numTextures;
+    size_t numResident;     ///< Textures with something to draw.
+    size_t numComplete;     ///< Textures with their finest level resident.
+    size_t residentBytes;   ///< Bytes of the resident chains.
+    size_t totalBytes;      ///< Bytes of the full chains.
+    size_t stagingBytes;    ///< Client memory still held for uploads.
+    size_t uploadedBytes;   ///< All bytes uploaded, re-uploaded coarse levels included.
+    size_t lastFrameBytes;  ///< Bytes uploaded by the last update.
+    size_t uploadFrames;    ///< Updates that uploaded anything.
+};
+
+class TextureStreamer
+{
+public:
+    TextureStreamer() : mUploadedBytes(0), mLastFrameBytes(0), mUploadFrames(0) {}
+
+    /// Queues a texture for streaming. levels[0] is the finest level, each
+    /// following one half the size of the previous one. The level data must
+    /// stay valid as long as staging is held: the streamer releases staging
+    /// once the finest level is resident.
+    /// \return the texture's index, used by TextureUpload and residentLevel
+    size_t add(const std::vector<MipLevel>& levels, bool compressed, const std::shared_ptr<const void>& staging)
+    {
+        Texture texture;
+        texture.levels = levels;
+        texture.compressed = compressed;
+        texture.staging = staging;
+        texture.residentLevel = static_cast<int32_t>(levels.size());
+        texture.buildLevel = texture.residentLevel;
+        texture.uploadLevel = texture.residentLevel;
+        texture.uploadRow = 0;
+        mTextures.push_back(texture);
+        return mTextures.size() - 1;
+    }
+
+    /// Chooses this frame's uploads, appending them to uploads in the order
+    /// they have to be made. Textures with the least resident detail go
+    /// first, and a new build takes no more than a fair share of what is
+    /// left, so every texture gets something to draw in the first frame.
+    /// Uploads add up to at most budget bytes, except that a frame always
+    /// makes progress: an upload that cannot be split may go alone. Their
+    /// data stays valid until the next update.
+    void update(size_t budget, std::vector<TextureUpload>& uploads)
+    {
+        mReleased.clear();
+        const size_t firstUpload = uploads.size();
+        size_t remaining = budget;
+        bool uploaded = false;
+        std::vector<size_t> order;
+        for (bool progress = true; progress && (remaining > 0 || !uploaded); ) {
+            order.clear();
+            for (size_t i = 0; i < mTextures.size(); i++)
+                if (mTextures[i].residentLevel > 0)
+                    order.push_back(i);
+            std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+                return residentWidth(mTextures[a]) < residentWidth(mTextures[b]);
+            });
+
+            progress = false;
+            for (size_t k = 0; k < order.size() && (remaining > 0 || !uploaded); k++) {
+                const size_t share = remaining / (order.size() - k);
+                progress = stream(order[k], share, remaining, uploaded, uploads) || progress;
+            }
+        }
+
+        mLastFrameBytes = 0;
+        for (size_t i = firstUpload; i < uploads.size(); i++)
+            mLastFrameBytes += uploads[i].bytes;
+        mUploadedBytes += mLastFrameBytes;
+        if (mLastFrameBytes > 0)
+            mUploadFrames++;
+    }
+
+    size_t size() const { return mTextures.size(); }
+    const std::vector<MipLevel>& getLevels(size_t texture) const { return mTextures[texture].levels; }
+
+    /// Finest level of the resident texture, the number of levels when
+    /// nothing is resident yet.
+    int32_t residentLevel(size_t texture) const { return mTextures[texture].residentLevel; }
+
+    bool isComplete(size_t texture) const { return mTextures[texture].residentLevel == 0; }
+
+    bool isStreaming() const
+    {
+        for (const Texture& t: mTextures)
+            if (t.residentLevel > 0)
+                return true;
+        return false;
+    }
+
+    TextureStreamingStats getStats() const
+    {
+        TextureStreamingStats stats = TextureStreamingStats();
+        stats.numTextures = mTextures.size();
+        for (const Texture& t: mTextures) {
+            const int32_t numLevels = static_cast<int32_t>(t.levels.size());
+            stats.numResident += (t.residentLevel < numLevels) ? 1 : 0;
+            stats.numComplete += (t.residentLevel == 0) ? 1 : 0;
+            stats.residentBytes += chainBytes(t, t.residentLevel);
+            stats.totalBytes += chainBytes(t, 0);
+            if (t.staging)
+                stats.stagingBytes += chainBytes(t, 0);
+        }
+        stats.uploadedBytes = mUploadedBytes;
+        stats.lastFrameBytes = mLastFrameBytes;
+        stats.uploadFrames = mUploadFrames;
+        return stats;
+    }
+
+private:
+    struct Texture
+    {
+        std::vector<MipLevel>       levels;
+        bool                        compressed;
+        std::shared_ptr<const void> staging;
+        int32_t residentLevel;  ///< Finest level of the resident texture.
+        int32_t buildLevel;     ///< Finest level of the texture being built; residentLevel when idle.
+        int32_t uploadLevel;    ///< Level of the next upload of the build.
+        int32_t uploadRow;      ///< Row of the next upload within uploadLevel.
+    };
+
+    static bool isBuilding(const Texture& t) { return t.buildLevel != t.residentLevel; }
+
+    static int32_t residentWidth(const Texture& t)
+    {
+        return (t.residentLevel < static_cast<int32_t>(t.levels.size())) ? t.levels[t.residentLevel].width : 0;
+    }
+
+    /// Bytes of levels [first, levels.size()).
+    static size_t chainBytes(const Texture& t, int32_t first)
+    {
+        size_t bytes = 0;
+        for (size_t l = first; l < t.levels.size(); l++)
+            bytes += t.levels[l].bytes;
+        return bytes;
+    }
+
+    /// Continues (or starts) the build of a texture with what is left of the
+    /// budget. A new build goes as fine as share allows.
+    /// \return true if anything was uploaded
+    bool stream(size_t index, size_t share, size_t& remaining, bool& uploaded, std::vector<TextureUpload>& uploads)
+    {
+        Texture& t = mTextures[index];
+        const int32_t numLevels = static_cast<int32_t>(t.levels.size());
+        const bool newBuild = !isBuilding(t);
+        if (newBuild) {
+            // The finest level whose chain fits into the share, but at
+            // least one level finer than what is resident.
+            int32_t level = t.residentLevel - 1;
+            while (level > 0 && chainBytes(t, level - 1) <= share)
+                level--;
+            t.buildLevel = level;
+            t.uploadLevel = level;
+            t.uploadRow = 0;
+        }
+
+        const size_t numUploads = uploads.size();
+        while (t.uploadLevel < numLevels && (remaining > 0 || !uploaded)) {
+            const MipLevel& level = t.levels[t.uploadLevel];
+            const int32_t rowsLeft = level.height - t.uploadRow;
+            const size_t rowBytes = level.bytes / level.height;
+            int32_t rows = rowsLeft;
+            if (rowsLeft * rowBytes > remaining) {
+                if (!t.compressed)
+                    rows = static_cast<int32_t>(remaining / rowBytes);
+                else if (uploaded)
+                    rows = 0;
+                if (rows == 0 && !uploaded)
+                    rows = t.compressed ? rowsLeft : 1;
+                if (rows == 0)
+                    break;
+            }
+
+            TextureUpload upload;
+            upload.texture = index;
+            upload.level = t.uploadLevel;
+            upload.targetLevel = t.uploadLevel - t.buildLevel;
+            upload.firstRow = t.uploadRow;
+            upload.endRow = t.uploadRow + rows;
+            upload.data = level.data + t.uploadRow * rowBytes;
+            upload.bytes = (rows == rowsLeft) ? level.bytes - t.uploadRow * rowBytes : rows * rowBytes;
+            upload.beginBuild = (t.uploadLevel == t.buildLevel && t.uploadRow == 0);
+            upload.defineLevel = (t.uploadRow == 0);
+
+            remaining -= std::min(remaining, upload.bytes);
+            uploaded = true;
+            t.uploadRow += rows;
+            if (t.uploadRow == level.height) {
+                t.uploadLevel++;
+                t.uploadRow = 0;
+            }
+
+            upload.endBuild = (t.uploadLevel == numLevels);
+            if (upload.endBuild) {
+                t.residentLevel = t.buildLevel;
+                if (t.residentLevel == 0) {
+                    // Nothing left to upload once the app has made this
+                    // frame's uploads
+                    mReleased.push_back(t.staging);
+                    t.staging.reset();
+                    for (MipLevel& l: t.levels)
+                        l.data = nullptr;
+                }
+            }
+            uploads.push_back(upload);
+        }
+
+        if (uploads.size() == numUploads) {
+            // Nothing fit; choose again with next frame's budget
+            if (newBuild)
+                t.buildLevel = t.uploadLevel = t.residentLevel;
+            return false;
+        }
+        return true;
+    }
+
+    std::vector<Texture> mTextures;
+    std::vector<std::shared_ptr<const void> > mReleased;  ///< Staging of the last update's final uploads.
+    size_t mUploadedBytes;
+    size_t mLastFrameBytes;
+    size_t mUploadFrames;
+};
+
+namespace texturestreaming {
+
+/// Fills in the levels an uncompressed RGBA8 image lacks, down to 1x1, with
+/// a 2x2 box filter (the last row or column is repeated for odd sizes).
+/// levels must hold at least the finest level; the new levels are appended,
+/// their pixels kept in storage.
+inline void buildMipChainRGBA8(std::vector<MipLevel>& levels, std::vector<uint8_t>& storage)
+{
+    size_t bytes = 0;
+    for (int32_t w = levels.back().width, h = levels.back().height; w > 1 || h > 1; ) {
+        w = std::max(w / 2, 1);
+        h = std::max(h / 2, 1);
+        bytes += size_t(w) * h * 4;
+    }
+    storage.resize(bytes);
+
+    uint8_t* next = storage.data();
+    while (levels.back().width > 1 || levels.back().height > 1) {
+        const MipLevel src = levels.back();
+        MipLevel dst;
+        dst.width = std::max(src.width / 2, 1);
+        dst.height = std::max(src.height / 2, 1);
+        dst.bytes = size_t(dst.width) * dst.height * 4;
+        dst.data = next;
+        for (int32_t y = 0; y < dst.height; y++) {
+            const uint8_t* row0 = src.data + size_t(std::min(2*y, src.height - 1)) * src.width * 4;
+            const uint8_t* row1 = src.data + size_t(std::min(2*y + 1, src.height - 1)) * src.width * 4;
+            for (int32_t x = 0; x < dst.width; x++) {
+                const int32_t x0 = std::min(2*x, src.width - 1) * 4;
+                const int32_t x1 = std::min(2*x + 1, src.width - 1) * 4;
+                for (int32_t c = 0; c < 4; c++)
+                    *next++ = static_cast<uint8_t>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+            }
+        }
+        levels.push_back(dst);
+    }
+}
+
+/// True when the chain goes down to 1x1, which is what mipmapped sampling
+/// needs in ES 2.
+inline bool isCompleteChain(const std::vector<MipLevel>& levels)
+{
+    return !levels.empty() && levels.back().width == 1 && levels.back().height == 1;
+}
+
+} // namespace texturestreaming
+
+#endif
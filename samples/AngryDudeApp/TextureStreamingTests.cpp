@@ -0,0 +1,300 @@
+#include "TextureStreaming.hpp"
+#include <cstring>
+#include <map>
+#include <memory>
+#include <vector>
+
+/// Compiled with
+/// clang TextureStreamingTests.cpp -o TextureStreamingTests -g3 -Wall -std=c++11 -I. -L./gtest/ -lgtest -lstdc++ -lpthread -lm
+///
+
+#include "gtest/gtest.h"
+
+namespace {
+
+/// A mip chain with recognizable pixels, kept alive by the returned staging.
+std::shared_ptr<std::vector<uint8_t> > makeChain(int32_t width, int32_t height, int32_t numLevels, size_t bytesPerPixel,
+                                                 uint8_t seed, std::vector<MipLevel>& levels)
+{
+    std::shared_ptr<std::vector<uint8_t> > storage = std::make_shared<std::vector<uint8_t> >();
+    std::vector<size_t> offsets;
+    for (int32_t l = 0, w = width, h = height; l < numLevels; l++, w = std::max(w / 2, 1), h = std::max(h / 2, 1)) {
+        offsets.push_back(storage->size());
+        for (size_t i = 0; i < size_t(w) * h * bytesPerPixel; i++)
+            storage->push_back(static_cast<uint8_t>(seed + 7 * l + i));
+    }
+    levels.clear();
+    for (int32_t l = 0, w = width, h = height; l < numLevels; l++, w = std::max(w / 2, 1), h = std::max(h / 2, 1)) {
+        MipLevel level;
+        level.width = w;
+        level.height = h;
+        level.bytes = size_t(w) * h * bytesPerPixel;
+        level.data = storage->data() + offsets[l];
+        levels.push_back(level);
+    }
+    return storage;
+}
+
+/// Stands in for GL: applies uploads to textures made of byte arrays and
+/// checks that every build is complete and correct when it replaces the
+/// resident texture.
+struct FakeGL
+{
+    typedef std::vector<std::vector<uint8_t> > Texture;
+
+    explicit FakeGL(const TextureStreamer& streamer) : streamer(streamer) {}
+
+    void apply(const std::vector<TextureUpload>& uploads)
+    {
+        for (const TextureUpload& u: uploads) {
+            const std::vector<MipLevel>& levels = streamer.getLevels(u.texture);
+            if (u.beginBuild)
+                building[u.texture] = Texture();
+            ASSERT_TRUE(building.count(u.texture)) << "upload outside a build";
+            Texture& t = building[u.texture];
+            if (u.defineLevel) {
+                ASSERT_EQ(size_t(u.targetLevel), t.size()) << "levels defined out of order";
+                ASSERT_EQ(0, u.firstRow);
+                t.push_back(std::vector<uint8_t>());
+            }
+            ASSERT_EQ(size_t(u.targetLevel) + 1, t.size());
+            const size_t rowBytes = levels[u.level].bytes / levels[u.level].height;
+            ASSERT_EQ(t.back().size(), u.firstRow * rowBytes) << "rows out of order";
+            ASSERT_EQ(u.bytes, (u.endRow - u.firstRow) * rowBytes);
+            t.back().insert(t.back().end(), u.data, u.data + u.bytes);
+
+            if (u.endBuild) {
+                const int32_t finest = u.level - u.targetLevel;
+                ASSERT_EQ(levels.size() - finest, t.size());
+                resident[u.texture] = t;
+                building.erase(u.texture);
+                finestResident[u.texture] = finest;
+            }
+        }
+    }
+
+    const TextureStreamer& streamer;
+    std::map<size_t, Texture> building;
+    std::map<size_t, Texture> resident;
+    std::map<size_t, int32_t> finestResident;
+};
+
+size_t totalBytes(const std::vector<TextureUpload>& uploads)
+{
+    size_t bytes = 0;
+    for (const TextureUpload& u: uploads)
+        bytes += u.bytes;
+    return bytes;
+}
+
+} // namespace
+
+TEST(TextureStreamingTest, EveryTextureIsDrawableAfterTheFirstFrame)
+{
+    TextureStreamer streamer;
+    std::vector<MipLevel> levels;
+    for (int i = 0; i < 4; i++)
+        streamer.add(levels, false, makeChain(256, 256, 9, 4, uint8_t(i), levels));
+    ASSERT_EQ(4u, streamer.size());
+
+    std::vector<TextureUpload> uploads;
+    streamer.update(64 * 1024, uploads);
+    EXPECT_LE(totalBytes(uploads), 64u * 1024);
+    for (size_t i = 0; i < streamer.size(); i++)
+        EXPECT_LT(streamer.residentLevel(i), 9) << "texture " << i;
+
+    const TextureStreamingStats stats = streamer.getStats();
+    EXPECT_EQ(4u, stats.numTextures);
+    EXPECT_EQ(4u, stats.numResident);
+    EXPECT_EQ(totalBytes(uploads), stats.lastFrameBytes);
+}
+
+TEST(TextureStreamingTest, RefinesWithinTheBudgetUntilComplete)
+{
+    TextureStreamer streamer;
+    FakeGL gl(streamer);
+    std::vector<std::shared_ptr<std::vector<uint8_t> > > chains;
+    std::vector<MipLevel> levels;
+    for (int i = 0; i < 3; i++) {
+        chains.push_back(makeChain(512, 256, 10, 4, uint8_t(16 * i), levels));
+        streamer.add(levels, false, chains.back());
+    }
+
+    const size_t budget = 100 * 1000;   // not a multiple of any row
+    int frames = 0;
+    int32_t lastFinest[3] = {10, 10, 10};
+    for (; streamer.isStreaming() && frames < 1000; frames++) {
+        std::vector<TextureUpload> uploads;
+        streamer.update(budget, uploads);
+        ASSERT_FALSE(uploads.empty());
+        ASSERT_LE(totalBytes(uploads), budget);
+        gl.apply(uploads);
+        for (size_t t = 0; t < 3; t++) {
+            // residency only ever improves, and matches what was built
+            ASSERT_LE(streamer.residentLevel(t), lastFinest[t]);
+            lastFinest[t] = streamer.residentLevel(t);
+            if (gl.finestResident.count(t)) {
+                ASSERT_EQ(gl.finestResident[t], streamer.residentLevel(t));
+            }
+        }
+    }
+    ASSERT_FALSE(streamer.isStreaming());
+
+    // the resident textures hold exactly the source chains
+    for (size_t t = 0; t < 3; t++) {
+        ASSERT_TRUE(streamer.isComplete(t));
+        const FakeGL::Texture& texture = gl.resident[t];
+        ASSERT_EQ(10u, texture.size());
+        size_t offset = 0;
+        for (size_t l = 0; l < texture.size(); l++) {
+            ASSERT_EQ(0, memcmp(texture[l].data(), chains[t]->data() + offset, texture[l].size())) << t << "/" << l;
+            offset += texture[l].size();
+        }
+    }
+
+    const TextureStreamingStats stats = streamer.getStats();
+    EXPECT_EQ(3u, stats.numComplete);
+    EXPECT_EQ(stats.totalBytes, stats.residentBytes);
+    EXPECT_EQ(size_t(frames), stats.uploadFrames);
+    // Coarser levels are uploaded again with each refinement, about a third
+    // more than the finer level, never more than all of it again.
+    EXPECT_GE(stats.uploadedBytes, stats.totalBytes);
+    EXPECT_LE(stats.uploadedBytes, 2 * stats.totalBytes);
+    EXPECT_LE(stats.uploadedBytes, size_t(frames) * budget);
+}
+
+TEST(TextureStreamingTest, LargeBudgetUploadsEachChainOnce)
+{
+    TextureStreamer streamer;
+    FakeGL gl(streamer);
+    std::vector<MipLevel> levels;
+    std::shared_ptr<std::vector<uint8_t> > a = makeChain(128, 128, 8, 4, 1, levels);
+    streamer.add(levels, false, a);
+    std::shared_ptr<std::vector<uint8_t> > b = makeChain(64, 64, 7, 4, 2, levels);
+    streamer.add(levels, false, b);
+
+    std::vector<TextureUpload> uploads;
+    streamer.update(1 << 24, uploads);
+    gl.apply(uploads);
+    EXPECT_FALSE(streamer.isStreaming());
+    EXPECT_EQ(a->size() + b->size(), totalBytes(uploads));
+    for (const TextureUpload& u: uploads)
+        EXPECT_EQ(u.level, u.targetLevel);
+}
+
+TEST(TextureStreamingTest, CompressedLevelsGoWhole)
+{
+    TextureStreamer streamer;
+    FakeGL gl(streamer);
+    std::vector<MipLevel> levels;
+    // 1 byte per pixel, like DXT5; levels from 64 KB down to 1 byte
+    streamer.add(levels, true, makeChain(256, 256, 9, 1, 3, levels));
+
+    const size_t budget = 10000;
+    int frames = 0;
+    for (; streamer.isStreaming() && frames < 100; frames++) {
+        std::vector<TextureUpload> uploads;
+        streamer.update(budget, uploads);
+        gl.apply(uploads);
+        for (const TextureUpload& u: uploads) {
+            EXPECT_EQ(0, u.firstRow);
+            EXPECT_EQ(levels[u.level].height, u.endRow);
+        }
+        // a level over the budget goes alone
+        if (totalBytes(uploads) > budget) {
+            EXPECT_EQ(1u, uploads.size());
+        }
+    }
+    EXPECT_FALSE(streamer.isStreaming());
+}
+
+TEST(TextureStreamingTest, ZeroBudgetStillMakesProgress)
+{
+    TextureStreamer streamer;
+    FakeGL gl(streamer);
+    std::vector<MipLevel> levels;
+    streamer.add(levels, false, makeChain(8, 8, 4, 4, 5, levels));
+
+    int frames = 0;
+    for (; streamer.isStreaming() && frames < 1000; frames++) {
+        std::vector<TextureUpload> uploads;
+        streamer.update(0, uploads);
+        ASSERT_EQ(1u, uploads.size());
+        EXPECT_EQ(1, uploads[0].endRow - uploads[0].firstRow);
+        gl.apply(uploads);
+    }
+    EXPECT_FALSE(streamer.isStreaming());
+}
+
+TEST(TextureStreamingTest, StagingIsReleasedOnceComplete)
+{
+    TextureStreamer streamer;
+    std::vector<MipLevel> levels;
+    std::weak_ptr<std::vector<uint8_t> > staging;
+    {
+        std::shared_ptr<std::vector<uint8_t> > chain = makeChain(64, 64, 7, 4, 9, levels);
+        staging = chain;
+        streamer.add(levels, false, chain);
+    }
+    EXPECT_FALSE(staging.expired());
+    EXPECT_GT(streamer.getStats().stagingBytes, 0u);
+
+    while (streamer.isStreaming()) {
+        std::vector<TextureUpload> uploads;
+        streamer.update(4096, uploads);
+    }
+    // the last uploads still point into it until the next update
+    EXPECT_FALSE(staging.expired());
+    std::vector<TextureUpload> uploads;
+    streamer.update(4096, uploads);
+    EXPECT_TRUE(uploads.empty());
+    EXPECT_TRUE(staging.expired());
+    EXPECT_EQ(0u, streamer.getStats().stagingBytes);
+    for (const MipLevel& level: streamer.getLevels(0))
+        EXPECT_TRUE(level.data == nullptr);
+}
+
+TEST(TextureStreamingTest, BuildsMissingLevelsWithABoxFilter)
+{
+    // 3x2 RGBA: odd widths repeat the last column
+    const uint8_t pixels[3 * 2 * 4] = {
+        0, 10, 20, 255,   4, 14, 24, 255,   100, 0, 0, 0,
+        8, 18, 28, 255,  12, 22, 32, 255,   200, 0, 0, 0,
+    };
+    std::vector<MipLevel> levels(1);
+    levels[0].width = 3;
+    levels[0].height = 2;
+    levels[0].bytes = sizeof(pixels);
+    levels[0].data = pixels;
+    EXPECT_FALSE(texturestreaming::isCompleteChain(levels));
+
+    std::vector<uint8_t> storage;
+    texturestreaming::buildMipChainRGBA8(levels, storage);
+    ASSERT_EQ(2u, levels.size());
+    EXPECT_TRUE(texturestreaming::isCompleteChain(levels));
+    EXPECT_EQ(1, levels[1].width);
+    EXPECT_EQ(1, levels[1].height);
+    EXPECT_EQ(4u, levels[1].bytes);
+    EXPECT_EQ(storage.data(), levels[1].data);
+    const uint8_t expected[4] = {6, 16, 26, 255};
+    EXPECT_EQ(0, memcmp(expected, levels[1].data, 4));
+
+    // a 1024x1024 level gets the 10 levels below it
+    std::vector<uint8_t> big(1024 * 1024 * 4, 128);
+    levels.resize(1);
+    levels[0].width = levels[0].height = 1024;
+    levels[0].bytes = big.size();
+    levels[0].data = big.data();
+    texturestreaming::buildMipChainRGBA8(levels, storage);
+    ASSERT_EQ(11u, levels.size());
+    for (size_t l = 1; l < levels.size(); l++) {
+        EXPECT_EQ(1024 >> l, levels[l].width);
+        EXPECT_EQ(128, levels[l].data[levels[l].bytes - 1]);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
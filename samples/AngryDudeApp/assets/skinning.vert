@@ -1,14 +1,37 @@
 #version 100
 
+// Compiled in variants (NvGLSLProgramVariants), with these defines:
+// BLEND_DQ         dual quaternion blending; linear blending otherwise
+// MAX_INFLUENCES   bones blended per vertex, 1 to 4; vertices must have
+//                  their used influences first (InfluenceSplit.hpp)
+// PACKED_VERTICES  PackedVertex input; Vertex otherwise
+// MAX_BONES        palette size; meshes with more bones are drawn in
+//                  partitions (BonePartitioning.hpp)
+#ifndef MAX_INFLUENCES
+#define MAX_INFLUENCES 4
+#endif
+#ifndef MAX_BONES
+#define MAX_BONES 60
+#endif
+
 uniform mat4 mvp;
-uniform mat4 boneMatrices[60];
-uniform vec4 boneDualQuaternions[120];
+#ifdef BLEND_DQ
+uniform vec4 boneDualQuaternions[2*MAX_BONES];
+#else
+uniform mat4 boneMatrices[MAX_BONES];
+#endif
 
-uniform bool useDQB;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
 
+// Float vertices: bones packs index (integer part) and weight (fraction).
+// Packed vertices (PackedVertex.hpp): position is normalized within the mesh
+// bounds, normal.xy is octahedral in bytes, bones and weights are separate
+// and uv holds the bit patterns of two half floats.
 attribute vec3 position;
 attribute vec3 normal;
 attribute vec4 bones;
+attribute vec4 weights;
 attribute vec2 uv;
 
 varying vec2 vuv;
@@ -21,55 +44,112 @@ float bsign(float value)
     return 1.0;
 }
 
-void DQB()
+#ifdef PACKED_VERTICES
+vec3 octahedralToNormal(vec2 e)
+{
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (v.z < 0.0)
+        v.xy = (1.0 - abs(v.yx)) * vec2(bsign(v.x), bsign(v.y));
+    return normalize(v);
+}
+
+float halfToFloat(float h)
+{
+    float s = h >= 32768.0 ? -1.0 : 1.0;
+    float m = mod(h, 32768.0);
+    float e = floor(m / 1024.0);
+    float f = m - e*1024.0;
+    if (e == 0.0)
+        return s * f * exp2(-24.0);
+    return s * exp2(e - 15.0) * (1.0 + f / 1024.0);
+}
+#endif
+
+#ifdef BLEND_DQ
+void DQB(vec3 p, vec3 n, vec4 indices, vec4 w)
 {
-    vec4 real0 = boneDualQuaternions[int(bones.x)*2    ];
-    vec4 dual0 = boneDualQuaternions[int(bones.x)*2 + 1];
-    vec4 b0 = real0 * fract(bones.x);
-    vec4 be = dual0 * fract(bones.x);
-
-    vec4 real = boneDualQuaternions[int(bones.y)*2    ];
-    vec4 dual = boneDualQuaternions[int(bones.y)*2 + 1];
-    b0 += real * fract(bones.y) * bsign(dot(real, real0));
-    be += dual * fract(bones.y) * bsign(dot(real, real0));
-
-    real = boneDualQuaternions[int(bones.z)*2    ];
-    dual = boneDualQuaternions[int(bones.z)*2 + 1];
-    b0 += real * fract(bones.z) * bsign(dot(real, real0));
-    be += dual * fract(bones.z) * bsign(dot(real, real0));
-
-    real = boneDualQuaternions[int(bones.w)*2    ];
-    dual = boneDualQuaternions[int(bones.w)*2 + 1];
-    b0 += real * fract(bones.w) * bsign(dot(real, real0));
-    be += dual * fract(bones.w) * bsign(dot(real, real0));
+    vec4 real0 = boneDualQuaternions[int(indices.x)*2    ];
+    vec4 dual0 = boneDualQuaternions[int(indices.x)*2 + 1];
+#if MAX_INFLUENCES == 1
+    // A single unit dual quaternion needs no blending or normalization.
+    vec4 c0 = real0;
+    vec4 ce = dual0;
+#else
+    vec4 b0 = real0 * w.x;
+    vec4 be = dual0 * w.x;
+
+    vec4 real = boneDualQuaternions[int(indices.y)*2    ];
+    vec4 dual = boneDualQuaternions[int(indices.y)*2 + 1];
+    b0 += real * w.y * bsign(dot(real, real0));
+    be += dual * w.y * bsign(dot(real, real0));
+
+#if MAX_INFLUENCES > 2
+    real = boneDualQuaternions[int(indices.z)*2    ];
+    dual = boneDualQuaternions[int(indices.z)*2 + 1];
+    b0 += real * w.z * bsign(dot(real, real0));
+    be += dual * w.z * bsign(dot(real, real0));
+#endif
+
+#if MAX_INFLUENCES > 3
+    real = boneDualQuaternions[int(indices.w)*2    ];
+    dual = boneDualQuaternions[int(indices.w)*2 + 1];
+    b0 += real * w.w * bsign(dot(real, real0));
+    be += dual * w.w * bsign(dot(real, real0));
+#endif
 
     vec4 c0 = b0 / sqrt(dot(b0, b0));
     vec4 ce = be / sqrt(dot(b0, b0));
+#endif
 
     // Fast version (from Geometric Skinning with Approximate Dual Quaternion Blending [Kavan et al]).
     // Bypassing dual quaternion-to-matrix conversion.
-    vec3 p = position;
     float a = c0.w;
     float b = ce.w;
     vec3 r = c0.xyz;
     vec3 t = ce.xyz;
-    vnormal = normal + 2.0 * cross(r, cross(r, normal) + a*normal);
+    vnormal = n + 2.0 * cross(r, cross(r, n) + a*n);
     gl_Position = mvp * vec4(p + 2.0 * cross(r, cross(r, p) + a*p)
                                + 2.0 * (a*t - b*r + cross(r, t)), 1.0);
 }
+#else
+void LBS(vec3 p, vec3 n, vec4 indices, vec4 w)
+{
+#if MAX_INFLUENCES == 1
+    // The single weight is 1, up to quantization.
+    mat4 transform = boneMatrices[int(indices.x)];
+#else
+    mat4 transform = boneMatrices[int(indices.x)] * w.x +
+                     boneMatrices[int(indices.y)] * w.y;
+#if MAX_INFLUENCES > 2
+    transform += boneMatrices[int(indices.z)] * w.z;
+#endif
+#if MAX_INFLUENCES > 3
+    transform += boneMatrices[int(indices.w)] * w.w;
+#endif
+#endif
+    vnormal = (transform * vec4(n, 0.0)).xyz;
+    gl_Position = mvp * transform * vec4(p, 1.0);
+}
+#endif
 
 void main()
 {
+    vec3 p = positionOffset + positionScale * position;
+#ifdef PACKED_VERTICES
+    vec3 n = octahedralToNormal(max(normal.xy / 127.0, -1.0));
+    vec4 indices = bones;
+    vec4 w = weights / 255.0;
+    vuv = vec2(halfToFloat(uv.x), halfToFloat(uv.y));
+#else
+    vec3 n = normal;
+    vec4 indices = floor(bones);
+    vec4 w = fract(bones);
     vuv = uv;
-    if (useDQB) {
-        DQB();
-    }
-    else {
-        mat4 transform = boneMatrices[int(bones.x)] * fract(bones.x) +
-                         boneMatrices[int(bones.y)] * fract(bones.y) +
-                         boneMatrices[int(bones.z)] * fract(bones.z) +
-                         boneMatrices[int(bones.w)] * fract(bones.w);
-        vnormal = (transform * vec4(normal, 0.0)).xyz;
-        gl_Position = mvp * transform * vec4(position, 1.0);
-    }
+#endif
+
+#ifdef BLEND_DQ
+    DQB(p, n, indices, w);
+#else
+    LBS(p, n, indices, w);
+#endif
 }
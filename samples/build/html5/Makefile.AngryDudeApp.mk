@@ -4,18 +4,27 @@
 ProjectName = AngryDudeApp
 
 AngryDudeApp_cppfiles   += ./../../../extensions/externals/src/Half/half.cpp
+AngryDudeApp_cppfiles   += ./../../../extensions/externals/src/R3/thread.cpp
 AngryDudeApp_cppfiles   += ./../../../extensions/src/NvAppBase/InputCallbacksHtml5.cpp
 AngryDudeApp_cppfiles   += ./../../../extensions/src/NvAppBase/MainHtml5.cpp
 AngryDudeApp_cppfiles   += ./../../../extensions/src/NvAppBase/NvAppBase.cpp
 AngryDudeApp_cppfiles   += ./../../../extensions/src/NvAppBase/NvFramerateCounter.cpp
+AngryDudeApp_cppfiles   += ./../../../extensions/src/NvAppBase/NvFrameTimeStats.cpp
+AngryDudeApp_cppfiles   += ./../../../extensions/src/NvAppBase/NvFrameTrace.cpp
 AngryDudeApp_cppfiles   += ./../../../extensions/src/NvAppBase/NvInputTransformer.cpp
+AngryDudeApp_cppfiles   += ./../../../extensions/src/NvAppBase/NvJobSystem.cpp
 AngryDudeApp_cppfiles   += ./../../../extensions/src/NvAppBase/NvLogs.cpp
 AngryDudeApp_cppfiles   += ./../../../extensions/src/NvAppBase/NvSampleApp.cpp
 AngryDudeApp_cppfiles   += ./../../../extensions/src/NvAssetLoader/NvAssetLoader.cpp
+AngryDudeApp_cppfiles   += ./../../../extensions/src/NvAssetLoader/NvAssetArchive.cpp
+AngryDudeApp_cppfiles   += ./../../../extensions/src/NvAssetLoader/NvAssetLoaderAsync.cpp
 AngryDudeApp_cppfiles   += ./../../../extensions/src/NvGLUtils/BlockDXT.cpp
+AngryDudeApp_cppfiles   += ./../../../extensions/src/NvGLUtils/DXTDecoder.cpp
 AngryDudeApp_cppfiles   += ./../../../extensions/src/NvGLUtils/ColorBlock.cpp
 AngryDudeApp_cppfiles   += ./../../../extensions/src/NvGLUtils/NvFilePtr.cpp
 AngryDudeApp_cppfiles   += ./../../../extensions/src/NvGLUtils/NvGLSLProgram.cpp
+AngryDudeApp_cppfiles   += ./../../../extensions/src/NvGLUtils/NvGLSLProgramCache.cpp
+AngryDudeApp_cppfiles   += ./../../../extensions/src/NvGLUtils/NvGLSLProgramVariants.cpp
 AngryDudeApp_cppfiles   += ./../../../extensions/src/NvGLUtils/NvImage.cpp
 AngryDudeApp_cppfiles   += ./../../../extensions/src/NvGLUtils/NvImageDDS.cpp
 AngryDudeApp_cppfiles   += ./../../../extensions/src/NvGLUtils/NvImageGL.cpp
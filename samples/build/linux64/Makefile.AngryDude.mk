@@ -44,6 +44,7 @@ AngryDudeApp_debug_libraries += NvGamepadD
 AngryDudeApp_debug_libraries += NvGLUtilsD
 AngryDudeApp_debug_libraries += NvModelD
 AngryDudeApp_debug_libraries += NvUID
+AngryDudeApp_debug_libraries += R3D
 AngryDudeApp_debug_common_cflags	:= $(AngryDudeApp_custom_cflags)
 AngryDudeApp_debug_common_cflags    += -MMD
 AngryDudeApp_debug_common_cflags    += $(addprefix -D, $(AngryDudeApp_debug_defines))
@@ -0,0 +1,69 @@
+ProjectName = AnimationBenchmark
+AnimationBenchmark_cppfiles   += ./../../AngryDudeApp/AnimationBenchmark.cpp
+
+AnimationBenchmark_cpp_release_dep    = $(addprefix $(DEPSDIR)/, $(subst ./, , $(subst ../, , $(patsubst %.cpp, %.cpp.release.P, $(AnimationBenchmark_cppfiles)))))
+AnimationBenchmark_c_release_dep      = $(addprefix $(DEPSDIR)/, $(subst ./, , $(subst ../, , $(patsubst %.c, %.c.release.P, $(AnimationBenchmark_cfiles)))))
+AnimationBenchmark_release_dep      = $(AnimationBenchmark_cpp_release_dep) $(AnimationBenchmark_c_release_dep)
+-include $(AnimationBenchmark_release_dep)
+AnimationBenchmark_release_hpaths    := 
+AnimationBenchmark_release_hpaths    += ./../../AngryDudeApp
+AnimationBenchmark_release_hpaths    += ./../../../extensions/include
+AnimationBenchmark_release_hpaths    += ./../../../extensions/externals/include
+AnimationBenchmark_release_lpaths    := 
+AnimationBenchmark_release_lpaths    += ./../../../extensions/externals/lib/osx32
+AnimationBenchmark_release_lpaths    += ./../../../extensions/lib/linux64
+AnimationBenchmark_release_defines   := $(AnimationBenchmark_custom_defines)
+AnimationBenchmark_release_defines   += LINUX=1
+AnimationBenchmark_release_defines   += NDEBUG
+AnimationBenchmark_release_libraries := 
+AnimationBenchmark_release_libraries += pthread
+AnimationBenchmark_release_libraries += Half
+AnimationBenchmark_release_libraries += NvAppBase
+AnimationBenchmark_release_libraries += NvAssetLoader
+AnimationBenchmark_release_libraries += R3
+AnimationBenchmark_release_common_cflags	:= $(AnimationBenchmark_custom_cflags)
+AnimationBenchmark_release_common_cflags    += -MMD
+AnimationBenchmark_release_common_cflags    += $(addprefix -D, $(AnimationBenchmark_release_defines))
+AnimationBenchmark_release_common_cflags    += $(addprefix -I, $(AnimationBenchmark_release_hpaths))
+AnimationBenchmark_release_common_cflags  += -m64
+AnimationBenchmark_release_cflags	:= $(AnimationBenchmark_release_common_cflags)
+AnimationBenchmark_release_cflags  += -Wall -Wextra -Wno-unused-parameter -Wno-ignored-qualifiers -Wno-unused-but-set-variable -Wno-switch -Wno-unused-variable -Wno-unused-function -Wno-reorder
+AnimationBenchmark_release_cflags  += -O2
+AnimationBenchmark_release_cppflags	:= $(AnimationBenchmark_release_common_cflags)
+AnimationBenchmark_release_cppflags  += -Wall -Wextra -Wno-unused-parameter -Wno-ignored-qualifiers -Wno-unused-but-set-variable -Wno-switch -Wno-unused-variable -Wno-unused-function -Wno-reorder
+AnimationBenchmark_release_cppflags  += -O2
+AnimationBenchmark_release_lflags    := $(AnimationBenchmark_custom_lflags)
+AnimationBenchmark_release_lflags    += $(addprefix -L, $(AnimationBenchmark_release_lpaths))
+AnimationBenchmark_release_lflags    += -Wl,--start-group $(addprefix -l, $(AnimationBenchmark_release_libraries)) -Wl,--end-group
+AnimationBenchmark_release_lflags  += -m64
+AnimationBenchmark_release_objsdir  = $(OBJS_DIR)/AnimationBenchmark_release
+AnimationBenchmark_release_cpp_o    = $(addprefix $(AnimationBenchmark_release_objsdir)/, $(subst ./, , $(subst ../, , $(patsubst %.cpp, %.cpp.o, $(AnimationBenchmark_cppfiles)))))
+AnimationBenchmark_release_c_o      = $(addprefix $(AnimationBenchmark_release_objsdir)/, $(subst ./, , $(subst ../, , $(patsubst %.c, %.c.o, $(AnimationBenchmark_cfiles)))))
+AnimationBenchmark_release_obj      = $(AnimationBenchmark_release_cpp_o) $(AnimationBenchmark_release_c_o)
+AnimationBenchmark_release_bin      := ./../../bin/linux64/AnimationBenchmark
+
+clean_AnimationBenchmark_release: 
+	@$(ECHO) clean AnimationBenchmark release
+	@$(RMDIR) $(AnimationBenchmark_release_objsdir)
+	@$(RMDIR) $(AnimationBenchmark_release_bin)
+
+build_AnimationBenchmark_release: postbuild_AnimationBenchmark_release
+postbuild_AnimationBenchmark_release: mainbuild_AnimationBenchmark_release
+mainbuild_AnimationBenchmark_release: prebuild_AnimationBenchmark_release $(AnimationBenchmark_release_bin)
+prebuild_AnimationBenchmark_release:
+
+$(AnimationBenchmark_release_bin): $(AnimationBenchmark_release_obj) build_Half_release build_NvAppBase_release build_NvAssetLoader_release build_R3_release 
+	@mkdir -p `dirname ./../../bin/linux64/AnimationBenchmark`
+	@$(CCLD) $(AnimationBenchmark_release_obj) $(AnimationBenchmark_release_lflags) -o $(AnimationBenchmark_release_bin) 
+	@$(ECHO) building $@ complete!
+
+AnimationBenchmark_release_DEPDIR = $(dir $(@))/$(*F)
+$(AnimationBenchmark_release_cpp_o): $(AnimationBenchmark_release_objsdir)/%.o:
+	@$(ECHO) AnimationBenchmark: compiling release $(filter %$(strip $(subst .cpp.o,.cpp, $(subst $(AnimationBenchmark_release_objsdir),, $@))), $(AnimationBenchmark_cppfiles))...
+	@mkdir -p $(dir $(@))
+	@$(CXX) $(AnimationBenchmark_release_cppflags) -c $(filter %$(strip $(subst .cpp.o,.cpp, $(subst $(AnimationBenchmark_release_objsdir),, $@))), $(AnimationBenchmark_cppfiles)) -o $@
+	@mkdir -p $(dir $(addprefix $(DEPSDIR)/, $(subst ./, , $(subst ../, , $(filter %$(strip $(subst .cpp.o,.cpp, $(subst $(AnimationBenchmark_release_objsdir),, $@))), $(AnimationBenchmark_cppfiles))))))
+	@cp $(AnimationBenchmark_release_DEPDIR).d $(addprefix $(DEPSDIR)/, $(subst ./, , $(subst ../, , $(filter %$(strip $(subst .cpp.o,.cpp, $(subst $(AnimationBenchmark_release_objsdir),, $@))), $(AnimationBenchmark_cppfiles))))).release.P; \
+	  sed -e 's/#.*//' -e 's/^[^:]*: *//' -e 's/ *\\$$//' \
+		-e '/^$$/ d' -e 's/$$/ :/' < $(AnimationBenchmark_release_DEPDIR).d >> $(addprefix $(DEPSDIR)/, $(subst ./, , $(subst ../, , $(filter %$(strip $(subst .cpp.o,.cpp, $(subst $(AnimationBenchmark_release_objsdir),, $@))), $(AnimationBenchmark_cppfiles))))).release.P; \
+	  rm -f $(AnimationBenchmark_release_DEPDIR).d
@@ -9,7 +9,10 @@ NvAppBase_cppfiles   += ./../../../extensions/src/NvAppBase/MainMacOSX.cpp
 NvAppBase_cppfiles   += ./../../../extensions/src/NvAppBase/MainWin32.cpp
 NvAppBase_cppfiles   += ./../../../extensions/src/NvAppBase/NvAppBase.cpp
 NvAppBase_cppfiles   += ./../../../extensions/src/NvAppBase/NvFramerateCounter.cpp
+NvAppBase_cppfiles   += ./../../../extensions/src/NvAppBase/NvFrameTimeStats.cpp
+NvAppBase_cppfiles   += ./../../../extensions/src/NvAppBase/NvFrameTrace.cpp
 NvAppBase_cppfiles   += ./../../../extensions/src/NvAppBase/NvInputTransformer.cpp
+NvAppBase_cppfiles   += ./../../../extensions/src/NvAppBase/NvJobSystem.cpp
 NvAppBase_cppfiles   += ./../../../extensions/src/NvAppBase/NvLogs.cpp
 NvAppBase_cppfiles   += ./../../../extensions/src/NvAppBase/NvSampleApp.cpp
 NvAppBase_cfiles   += ./../../../extensions/src/NvAppBase/NvAndroidNativeAppGlue.c
@@ -2,9 +2,12 @@
 -include Makefile.custom
 ProjectName = NvGLUtils
 NvGLUtils_cppfiles   += ./../../../extensions/src/NvGLUtils/BlockDXT.cpp
+NvGLUtils_cppfiles   += ./../../../extensions/src/NvGLUtils/DXTDecoder.cpp
 NvGLUtils_cppfiles   += ./../../../extensions/src/NvGLUtils/ColorBlock.cpp
 NvGLUtils_cppfiles   += ./../../../extensions/src/NvGLUtils/NvFilePtr.cpp
 NvGLUtils_cppfiles   += ./../../../extensions/src/NvGLUtils/NvGLSLProgram.cpp
+NvGLUtils_cppfiles   += ./../../../extensions/src/NvGLUtils/NvGLSLProgramCache.cpp
+NvGLUtils_cppfiles   += ./../../../extensions/src/NvGLUtils/NvGLSLProgramVariants.cpp
 NvGLUtils_cppfiles   += ./../../../extensions/src/NvGLUtils/NvImage.cpp
 NvGLUtils_cppfiles   += ./../../../extensions/src/NvGLUtils/NvImageDDS.cpp
 NvGLUtils_cppfiles   += ./../../../extensions/src/NvGLUtils/NvImageGL.cpp